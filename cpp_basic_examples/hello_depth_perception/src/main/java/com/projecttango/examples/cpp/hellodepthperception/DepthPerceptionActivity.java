@@ -20,17 +20,35 @@ import android.app.Activity;
 import android.content.ComponentName;
 import android.content.ServiceConnection;
 import android.os.Bundle;
+import android.os.Handler;
 import android.os.IBinder;
+import android.widget.TextView;
 
 import com.projecttango.examples.cpp.util.TangoInitializationHelper;
 
 /**
  * The main activity of the hello depth perception example application.
  *
- * This activity shows a message and logs the depth information to the logcat. It is responsible for
+ * This activity shows the depth statistics and logs them to the logcat. It is responsible for
  * hooking to the android lifecycle events to native code code which calls into Tango C API.
  */
 public class DepthPerceptionActivity extends Activity {
+    // The interval at which the depth statistics on screen are refreshed, in milliseconds.
+    private static final int UPDATE_UI_INTERVAL_MS = 500;
+
+    // Shows the depth statistics.
+    private TextView mDepthStatsTextView;
+
+    // Handles the depth statistics UI update loop.
+    private Handler mHandler = new Handler();
+
+    private Runnable mUpdateUiRunnable = new Runnable() {
+        public void run() {
+            mDepthStatsTextView.setText(TangoJniNative.getDepthStatsSummary());
+            mHandler.postDelayed(this, UPDATE_UI_INTERVAL_MS);
+        }
+    };
+
     // Tango Service connection.
     ServiceConnection mTangoServiceConnection = new ServiceConnection() {
         public void onServiceConnected(ComponentName name, IBinder service) {
@@ -48,6 +66,7 @@ public class DepthPerceptionActivity extends Activity {
         super.onCreate(savedInstanceState);
         // Setting content view of this activity.
         setContentView(R.layout.activity_depth_perception);
+        mDepthStatsTextView = (TextView) findViewById(R.id.depth_stats_text_view);
         TangoJniNative.onCreate(this);
     }
 
@@ -55,11 +74,13 @@ public class DepthPerceptionActivity extends Activity {
     protected void onResume() {
         super.onResume();
         TangoInitializationHelper.bindTangoService(this, mTangoServiceConnection);
+        mHandler.post(mUpdateUiRunnable);
     }
 
     @Override
     protected void onPause() {
         super.onPause();
+        mHandler.removeCallbacks(mUpdateUiRunnable);
         TangoJniNative.onPause();
         unbindService(mTangoServiceConnection);
     }
@@ -57,4 +57,9 @@ public class TangoJniNative {
      * Interfaces to native OnPause function.
      */
     public static native void onPause();
+
+    /**
+     * Returns a summary of the recent depth statistics for display.
+     */
+    public static native String getDepthStatsSummary();
 }
@@ -14,6 +14,7 @@
 # limitations under the License.
 #
 LOCAL_PATH := $(call my-dir)
+PROJECT_ROOT_FROM_JNI:= ../../../../..
 PROJECT_ROOT:= $(call my-dir)/../../../../..
 
 include $(CLEAR_VARS)
@@ -21,8 +22,11 @@ LOCAL_MODULE    := libhello_depth_perception
 LOCAL_SHARED_LIBRARIES := tango_client_api tango_support
 LOCAL_CFLAGS    := -std=c++11
 
+LOCAL_C_INCLUDES := $(PROJECT_ROOT)/tango_perception/include
+
 LOCAL_SRC_FILES := jni_interface.cc \
-                   hello_depth_perception_app.cc
+                   hello_depth_perception_app.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/depth_stats.cc
 
 LOCAL_LDLIBS    := -llog -lGLESv2 -L$(SYSROOT)/usr/lib
 include $(BUILD_SHARED_LIBRARY)
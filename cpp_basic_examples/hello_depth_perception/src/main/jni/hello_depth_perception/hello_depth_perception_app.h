@@ -19,9 +19,12 @@
 
 #include <android/log.h>
 #include <jni.h>
+#include <string>
 
 #include <tango_client_api.h>  // NOLINT
 #include <tango_support.h>     // NOLINT
+#include <tango-perception/depth_stats.h>
+#include <tango-perception/stats_ring.h>
 
 #define LOG_TAG "cpp_hello_depth_perception"
 #define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
@@ -33,7 +36,10 @@ namespace hello_depth_perception {
 class HelloDepthPerceptionApp {
  public:
   // Class constructor.
-  HelloDepthPerceptionApp() : tango_config_(nullptr) {}
+  HelloDepthPerceptionApp()
+      : tango_config_(nullptr),
+        max_point_cloud_elements_(0),
+        last_log_timestamp_(0.0) {}
 
   // Class destructor.
   ~HelloDepthPerceptionApp() {
@@ -68,11 +74,35 @@ class HelloDepthPerceptionApp {
   // Tango Service.
   void OnPause();
 
+  // Tango service point cloud callback. Computes the statistics of the point
+  // cloud, stores them in the stats ring and logs them once a second.
+  //
+  // @param point_cloud, the point cloud returned by the service.
+  void OnPointCloudAvailable(const TangoPointCloud* point_cloud);
+
+  // Return a human readable summary of the recent depth statistics. Safe to
+  // call from any thread.
+  std::string GetDepthStatsSummary() const;
+
  private:
+  // Number of frames of statistics kept for the UI, a few seconds of depth.
+  static const size_t kDepthStatsHistory = 32;
+
   // Tango configuration file, this object is for configuring Tango Service
   // setup before connecting to service. For instance, we turn on the depth
   // sensing in this example.
   TangoConfig tango_config_;
+
+  // Number of points in a fully covered point cloud.
+  int32_t max_point_cloud_elements_;
+
+  // Statistics of the most recent point clouds, written by the point cloud
+  // callback and read by the UI without locking.
+  tango_perception::StatsRing<tango_perception::DepthStats, kDepthStatsHistory>
+      depth_stats_ring_;
+
+  // Timestamp of the last logged statistics, owned by the callback thread.
+  double last_log_timestamp_;
 };
 }  // namespace hello_depth_perception
 
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <cstdio>
 #include <cstdlib>
 
 #include <tango_support.h>
@@ -24,30 +25,23 @@ namespace {
 // The minimum Tango Core version required from this application.
 constexpr int kTangoCoreMinimumVersion = 9377;
 
-// This function logs point cloud data from OnPointCloudAvailable callbacks.
+// Depth covered by the depth histogram, in meters.
+constexpr float kDepthHistogramRange = 8.0f;
+
+// Interval between two log lines, in seconds.
+constexpr double kLogInterval = 1.0;
+
+// This function routes OnPointCloudAvailable callbacks to the application
+// object for handling.
 //
 // @param context, this will be a pointer to a HelloDepthPerceptionApp
-//        instance on which to call callbacks. This parameter is hidden
-//        since it is not used.
-// @param *point_cloud, point cloud data to log.
-void OnPointCloudAvailable(void* /*context*/,
-                           const TangoPointCloud* point_cloud) {
-  // Number of points in the point cloud.
-  float average_depth;
-
-  // Calculate the average depth.
-  average_depth = 0;
-  // Each xyzc point has 4 coordinates.
-  for (size_t i = 0; i < point_cloud->num_points; ++i) {
-    average_depth += point_cloud->points[i][2];
-  }
-  if (point_cloud->num_points) {
-    average_depth /= point_cloud->num_points;
-  }
-
-  // Log the number of points and average depth.
-  LOGI("HelloDepthPerceptionApp: Point count: %d. Average depth (m): %.3f",
-       point_cloud->num_points, average_depth);
+//        instance on which to call callbacks.
+// @param *point_cloud, point cloud data to route.
+void OnPointCloudAvailableRouter(void* context,
+                                 const TangoPointCloud* point_cloud) {
+  hello_depth_perception::HelloDepthPerceptionApp* app =
+      static_cast<hello_depth_perception::HelloDepthPerceptionApp*>(context);
+  app->OnPointCloudAvailable(point_cloud);
 }
 }  // anonymous namespace
 
@@ -110,10 +104,20 @@ void HelloDepthPerceptionApp::OnTangoServiceConnected(JNIEnv* env,
     std::exit(EXIT_SUCCESS);
   }
 
-  // Attach the OnPointCloudAvailable callback to the OnPointCloudAvailable
-  // function defined above. The callback will be called every time a new
-  // point cloud is acquired, after the service is connected.
-  err = TangoService_connectOnPointCloudAvailable(OnPointCloudAvailable);
+  // The maximum number of points is the size of a fully covered frame.
+  err = TangoConfig_getInt32(tango_config_, "max_point_cloud_elements",
+                             &max_point_cloud_elements_);
+  if (err != TANGO_SUCCESS) {
+    LOGE(
+        "HelloDepthPerceptionApp::OnTangoServiceConnected,"
+        "Failed to query maximum number of point cloud elements.");
+    std::exit(EXIT_SUCCESS);
+  }
+
+  // Attach the OnPointCloudAvailable callback to the router function defined
+  // above. The callback will be called every time a new point cloud is
+  // acquired, after the service is connected.
+  err = TangoService_connectOnPointCloudAvailable(OnPointCloudAvailableRouter);
   if (err != TANGO_SUCCESS) {
     LOGE(
         "HelloDepthPerceptionApp::OnTangoServiceConnected,"
@@ -144,4 +148,68 @@ void HelloDepthPerceptionApp::OnPause() {
   tango_config_ = nullptr;
   TangoService_disconnect();
 }
+
+void HelloDepthPerceptionApp::OnPointCloudAvailable(
+    const TangoPointCloud* point_cloud) {
+  tango_perception::DepthStats stats;
+  tango_perception::ComputeDepthStats(point_cloud, kDepthHistogramRange,
+                                      max_point_cloud_elements_, &stats);
+  depth_stats_ring_.Push(stats);
+
+  if (stats.timestamp - last_log_timestamp_ >= kLogInterval) {
+    last_log_timestamp_ = stats.timestamp;
+    LOGI(
+        "HelloDepthPerceptionApp: Point count: %d. Coverage: %.1f%%. "
+        "Depth (m) min: %.3f mean: %.3f max: %.3f stddev: %.3f. "
+        "Mean confidence: %.2f",
+        stats.num_points, 100.0f * stats.coverage, stats.min_depth,
+        stats.mean_depth, stats.max_depth, stats.stddev_depth,
+        stats.mean_confidence);
+  }
+}
+
+std::string HelloDepthPerceptionApp::GetDepthStatsSummary() const {
+  tango_perception::DepthStats history[kDepthStatsHistory];
+  const size_t count =
+      depth_stats_ring_.GetRecent(history, kDepthStatsHistory);
+  if (count == 0) {
+    return "Waiting for depth data...";
+  }
+  const tango_perception::DepthStats& latest = history[count - 1];
+
+  float frame_rate = 0.0f;
+  if (count > 1 && latest.timestamp > history[0].timestamp) {
+    frame_rate = (count - 1) / (latest.timestamp - history[0].timestamp);
+  }
+  float mean_coverage = 0.0f;
+  for (size_t i = 0; i < count; ++i) {
+    mean_coverage += history[i].coverage / count;
+  }
+
+  char buffer[512];
+  int length = std::snprintf(
+      buffer, sizeof(buffer),
+      "Depth rate: %.1f Hz\n"
+      "Points: %u (%u valid)\n"
+      "Coverage: %.1f%% (%.1f%% over %u frames)\n"
+      "Depth (m): min %.2f mean %.2f max %.2f stddev %.3f\n"
+      "Mean confidence: %.2f\n"
+      "Depth histogram (%%, %.1f m bins):",
+      frame_rate, latest.num_points, latest.num_valid_points,
+      100.0f * latest.coverage, 100.0f * mean_coverage,
+      static_cast<unsigned>(count), latest.min_depth, latest.mean_depth,
+      latest.max_depth, latest.stddev_depth, latest.mean_confidence,
+      kDepthHistogramRange / tango_perception::DepthStats::kNumDepthBins);
+  for (int bin = 0; bin < tango_perception::DepthStats::kNumDepthBins &&
+                    length < static_cast<int>(sizeof(buffer));
+       ++bin) {
+    const float percent =
+        latest.num_valid_points > 0
+            ? 100.0f * latest.depth_histogram[bin] / latest.num_valid_points
+            : 0.0f;
+    length += std::snprintf(buffer + length, sizeof(buffer) - length, " %.0f",
+                            percent);
+  }
+  return std::string(buffer);
+}
 }  // namespace hello_depth_perception
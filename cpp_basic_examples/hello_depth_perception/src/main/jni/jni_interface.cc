@@ -40,6 +40,12 @@ Java_com_projecttango_examples_cpp_hellodepthperception_TangoJniNative_onPause(
     JNIEnv*, jobject) {
   app.OnPause();
 }
+
+JNIEXPORT jstring JNICALL
+Java_com_projecttango_examples_cpp_hellodepthperception_TangoJniNative_getDepthStatsSummary(
+    JNIEnv* env, jobject) {
+  return env->NewStringUTF(app.GetDepthStatsSummary().c_str());
+}
 #ifdef __cplusplus
 }
 #endif
@@ -35,6 +35,7 @@ import com.projecttango.examples.cpp.util.TangoInitializationHelper;
 public class HelloVideoActivity extends Activity {
     private GLSurfaceView mSurfaceView;
     private ToggleButton mYuvRenderSwitcher;
+    private ToggleButton mCpuRgbSwitcher;
 
     private ServiceConnection mTangoServiceCoonnection = new ServiceConnection() {
         @Override
@@ -85,6 +86,7 @@ public class HelloVideoActivity extends Activity {
         mSurfaceView.setRenderer(new HelloVideoRenderer());
 
         mYuvRenderSwitcher = (ToggleButton) findViewById(R.id.yuv_switcher);
+        mCpuRgbSwitcher = (ToggleButton) findViewById(R.id.cpu_rgb_switcher);
     }
 
     @Override
@@ -93,6 +95,7 @@ public class HelloVideoActivity extends Activity {
         mSurfaceView.onResume();
         TangoInitializationHelper.bindTangoService(this, mTangoServiceCoonnection);
         TangoJniNative.setYuvMethod(mYuvRenderSwitcher.isChecked());
+        TangoJniNative.setCpuRgbConversion(mCpuRgbSwitcher.isChecked());
     }
 
     @Override
@@ -104,10 +107,11 @@ public class HelloVideoActivity extends Activity {
     }
 
     /**
-     * The render mode toggle button was pressed.
+     * One of the render mode toggle buttons was pressed.
      */
     public void renderModeClicked(View view) {
         TangoJniNative.setYuvMethod(mYuvRenderSwitcher.isChecked());
+        TangoJniNative.setCpuRgbConversion(mCpuRgbSwitcher.isChecked());
     }
 
     /**
@@ -79,6 +79,14 @@ public class TangoJniNative {
      */
     public static native void setYuvMethod(boolean useYuvMethod);
 
+    /**
+     * Select where the YUV buffer rendering method converts frames to RGB.
+     *
+     * @param useCpuRgb If {@code true}, frames are converted on the CPU and uploaded as RGBA,
+     *                  otherwise NV21 is uploaded and converted in the fragment shader.
+     */
+    public static native void setCpuRgbConversion(boolean useCpuRgb);
+
     /**
      * Respond to a display change.
      */
@@ -22,6 +22,7 @@ include $(CLEAR_VARS)
 LOCAL_MODULE    := libhello_video
 LOCAL_SHARED_LIBRARIES := tango_client_api tango_support
 LOCAL_CFLAGS    := -std=c++11
+LOCAL_ARM_NEON  := true
 
 LOCAL_SRC_FILES := jni_interface.cc \
                    hello_video_app.cc \
@@ -29,9 +30,13 @@ LOCAL_SRC_FILES := jni_interface.cc \
                    $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/shaders.cc \
                    $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/transform.cc \
                    $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/util.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/video_overlay.cc
+                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/video_overlay.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/sensor_mailboxes.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/thread_pool.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/yuv_converter.cc
 
 LOCAL_C_INCLUDES := $(PROJECT_ROOT)/tango_gl/include \
+                    $(PROJECT_ROOT)/tango_perception/include \
                     $(PROJECT_ROOT)/third_party/glm
 
 LOCAL_LDLIBS    := -llog -lGLESv2 -L$(SYSROOT)/usr/lib
@@ -20,12 +20,15 @@
 #include <atomic>
 #include <jni.h>
 #include <memory>
-#include <mutex>
 #include <vector>
 
 #include <tango_client_api.h>  // NOLINT
 #include <tango-gl/util.h>
 #include <tango-gl/video_overlay.h>
+#include <tango-perception/image_view.h>
+#include <tango-perception/sensor_mailboxes.h>
+#include <tango-perception/thread_pool.h>
+#include <tango-perception/yuv_converter.h>
 
 namespace hello_video {
 
@@ -37,6 +40,8 @@ class HelloVideoApp {
     kTextureId
   };
 
+  HelloVideoApp();
+
   // OnCreate() callback is called when this Android application's
   // OnCreate function is called from UI thread. In the OnCreate
   // function, we are only checking the Tango Core's version.
@@ -76,6 +81,10 @@ class HelloVideoApp {
     current_texture_method_ = method;
   }
 
+  // In the YUV method, convert frames to RGB on the CPU and upload the
+  // result, instead of uploading NV21 for the overlay shader to convert.
+  void SetCpuRgbConversion(bool use_cpu_rgb) { use_cpu_rgb_ = use_cpu_rgb; }
+
   // YUV data callback.
   void OnFrameAvailable(const TangoImageBuffer* buffer);
 
@@ -96,21 +105,37 @@ class HelloVideoApp {
   // video_overlay_ Render the camera video feedback onto the screen.
   tango_gl::VideoOverlay* video_overlay_drawable_;
   tango_gl::VideoOverlay* yuv_drawable_;
+  tango_gl::VideoOverlay* rgb_drawable_;
 
   TextureMethod current_texture_method_;
 
-  std::vector<uint8_t> yuv_buffer_;
-  std::vector<uint8_t> yuv_temp_buffer_;
-  std::vector<GLubyte> rgb_buffer_;
-
+  // Hands camera frames from OnFrameAvailable() to the GL thread through
+  // three preallocated frame slots. The callback copies each frame once into
+  // a free slot and the GL thread uploads from its slot in place, so neither
+  // side takes a lock. Created with the first frame, once its size is known,
+  // before is_yuv_texture_available_ is set, and kept for the lifetime of
+  // the app since the GL thread may be reading from it at any time.
+  std::unique_ptr<tango_perception::ImageBufferMailbox> yuv_mailbox_;
   std::atomic<bool> is_yuv_texture_available_;
-  std::atomic<bool> swap_buffer_signal_;
-  std::mutex yuv_buffer_mutex_;
 
-  size_t yuv_width_;
-  size_t yuv_height_;
-  size_t yuv_size_;
-  size_t uv_buffer_offset_;
+  // Whether the drawable of the current YUV path holds the latest frame, and
+  // which path that is. Only used on the GL thread.
+  bool is_yuv_texture_uploaded_;
+  bool was_cpu_rgb_;
+
+  // CPU conversion of the YUV method. use_cpu_rgb_ is set from the UI
+  // thread; the rest is only used on the GL thread. The pool is declared
+  // before the converter, which runs its row bands on it.
+  std::atomic<bool> use_cpu_rgb_;
+  tango_perception::ThreadPool thread_pool_;
+  tango_perception::YuvToRgbConverter yuv_converter_;
+  std::vector<uint8_t> rgba_buffer_;
+  int rgb_texture_width_;
+  int rgb_texture_height_;
+
+  // Timestamp of the camera buffer last pushed to video_overlay_drawable_
+  // through TangoService_lockCameraBuffer().
+  double locked_buffer_timestamp_;
 
   bool is_service_connected_;
   bool is_texture_id_set_;
@@ -118,8 +143,8 @@ class HelloVideoApp {
 
   TangoSupport_Rotation display_rotation_;
 
-  void AllocateTexture(GLuint texture_id, int width, int height);
   void RenderYuv();
+  void RenderCpuRgb(const TangoImageBuffer& frame, bool new_frame);
   void RenderTextureId();
   void DeleteDrawables();
 };
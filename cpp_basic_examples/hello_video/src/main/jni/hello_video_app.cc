@@ -26,28 +26,15 @@ void OnFrameAvailableRouter(void* context, TangoCameraId,
       static_cast<hello_video::HelloVideoApp*>(context);
   app->OnFrameAvailable(buffer);
 }
-
-// We could do this conversion in a fragment shader if all we care about is
-// rendering, but we show it here as an example of how people can use RGB data
-// on the CPU.
-inline void Yuv2Rgb(uint8_t y_value, uint8_t u_value, uint8_t v_value,
-                    uint8_t* r, uint8_t* g, uint8_t* b) {
-  float float_r = y_value + (1.370705 * (v_value - 128));
-  float float_g =
-      y_value - (0.698001 * (v_value - 128)) - (0.337633 * (u_value - 128));
-  float float_b = y_value + (1.732446 * (u_value - 128));
-
-  float_r = float_r * !(float_r < 0);
-  float_g = float_g * !(float_g < 0);
-  float_b = float_b * !(float_b < 0);
-
-  *r = float_r * (!(float_r > 255)) + 255 * (float_r > 255);
-  *g = float_g * (!(float_g > 255)) + 255 * (float_g > 255);
-  *b = float_b * (!(float_b > 255)) + 255 * (float_b > 255);
-}
 }  // namespace
 
 namespace hello_video {
+HelloVideoApp::HelloVideoApp()
+    : use_cpu_rgb_(false),
+      yuv_converter_(&thread_pool_),
+      rgb_texture_width_(0),
+      rgb_texture_height_(0) {}
+
 void HelloVideoApp::OnCreate(JNIEnv* env, jobject caller_activity) {
   // Check the installed version of the TangoCore.  If it is too old, then
   // it will not support the most up to date features.
@@ -61,11 +48,14 @@ void HelloVideoApp::OnCreate(JNIEnv* env, jobject caller_activity) {
 
   // Initialize variables
   is_yuv_texture_available_ = false;
-  swap_buffer_signal_ = false;
+  is_yuv_texture_uploaded_ = false;
+  was_cpu_rgb_ = false;
+  locked_buffer_timestamp_ = 0.0;
   is_service_connected_ = false;
   is_texture_id_set_ = false;
   video_overlay_drawable_ = NULL;
   yuv_drawable_ = NULL;
+  rgb_drawable_ = NULL;
   is_video_overlay_rotation_set_ = false;
 }
 
@@ -136,15 +126,12 @@ void HelloVideoApp::OnPause() {
   // Disconnect from the Tango service
   TangoService_disconnect();
 
-  // Free buffer data
-  is_yuv_texture_available_ = false;
-  swap_buffer_signal_ = false;
+  // The GL thread may still be reading a slot of yuv_mailbox_, so the
+  // mailbox is kept until the app is destroyed and reused after resuming.
+  locked_buffer_timestamp_ = 0.0;
   is_service_connected_ = false;
   is_video_overlay_rotation_set_ = false;
   is_texture_id_set_ = false;
-  rgb_buffer_.clear();
-  yuv_buffer_.clear();
-  yuv_temp_buffer_.clear();
   this->DeleteDrawables();
 }
 
@@ -163,44 +150,46 @@ void HelloVideoApp::OnFrameAvailable(const TangoImageBuffer* buffer) {
     return;
   }
 
-  // The memory needs to be allocated after we get the first frame because we
-  // need to know the size of the image.
+  // The frame slots need to be allocated after we get the first frame
+  // because we need to know the size of the image. The mailbox lives as long
+  // as the app, and a frame of another size grows the slots as it passes
+  // through. The textures are allocated on the GL thread with the first
+  // upload.
   if (!is_yuv_texture_available_) {
-    yuv_width_ = buffer->width;
-    yuv_height_ = buffer->height;
-    uv_buffer_offset_ = yuv_width_ * yuv_height_;
-
-    yuv_size_ = yuv_width_ * yuv_height_ + yuv_width_ * yuv_height_ / 2;
-
-    // Reserve and resize the buffer size for RGB and YUV data.
-    yuv_buffer_.resize(yuv_size_);
-    yuv_temp_buffer_.resize(yuv_size_);
-    rgb_buffer_.resize(yuv_width_ * yuv_height_ * 3);
-
-    AllocateTexture(yuv_drawable_->GetTextureId(), yuv_width_, yuv_height_);
+    yuv_mailbox_.reset(new tango_perception::ImageBufferMailbox(
+        buffer->format, buffer->width, buffer->height, buffer->stride));
     is_yuv_texture_available_ = true;
   }
 
-  std::lock_guard<std::mutex> lock(yuv_buffer_mutex_);
-  memcpy(&yuv_temp_buffer_[0], buffer->data, yuv_size_);
-  swap_buffer_signal_ = true;
+  // The service reuses buffer once this callback returns, so the frame is
+  // copied once into a free slot and published to the GL thread.
+  yuv_mailbox_->Update(buffer);
 }
 
 void HelloVideoApp::DeleteDrawables() {
   delete video_overlay_drawable_;
   delete yuv_drawable_;
+  delete rgb_drawable_;
   video_overlay_drawable_ = NULL;
   yuv_drawable_ = NULL;
+  rgb_drawable_ = NULL;
 }
 
 void HelloVideoApp::OnSurfaceCreated() {
-  if (video_overlay_drawable_ != NULL || yuv_drawable_ != NULL) {
+  if (video_overlay_drawable_ != NULL || yuv_drawable_ != NULL ||
+      rgb_drawable_ != NULL) {
     this->DeleteDrawables();
   }
 
   video_overlay_drawable_ =
       new tango_gl::VideoOverlay(GL_TEXTURE_EXTERNAL_OES, display_rotation_);
-  yuv_drawable_ = new tango_gl::VideoOverlay(GL_TEXTURE_2D, display_rotation_);
+  locked_buffer_timestamp_ = 0.0;
+  yuv_drawable_ = new tango_gl::VideoOverlay(
+      tango_gl::VideoOverlay::kTextureNv21, display_rotation_);
+  rgb_drawable_ = new tango_gl::VideoOverlay(GL_TEXTURE_2D, display_rotation_);
+  rgb_texture_width_ = 0;
+  rgb_texture_height_ = 0;
+  is_yuv_texture_uploaded_ = false;
 }
 
 void HelloVideoApp::OnSurfaceChanged(int width, int height) {
@@ -234,6 +223,7 @@ void HelloVideoApp::OnDrawFrame() {
   if (!is_video_overlay_rotation_set_) {
     video_overlay_drawable_->SetDisplayRotation(display_rotation_);
     yuv_drawable_->SetDisplayRotation(display_rotation_);
+    rgb_drawable_->SetDisplayRotation(display_rotation_);
     is_video_overlay_rotation_set_ = true;
   }
 
@@ -247,59 +237,116 @@ void HelloVideoApp::OnDrawFrame() {
   }
 }
 
-void HelloVideoApp::AllocateTexture(GLuint texture_id, int width, int height) {
-  glBindTexture(GL_TEXTURE_2D, texture_id);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB,
-               GL_UNSIGNED_BYTE, rgb_buffer_.data());
-}
-
 void HelloVideoApp::RenderYuv() {
   if (!is_yuv_texture_available_) {
     return;
   }
-  {
-    std::lock_guard<std::mutex> lock(yuv_buffer_mutex_);
-    if (swap_buffer_signal_) {
-      std::swap(yuv_buffer_, yuv_temp_buffer_);
-      swap_buffer_signal_ = false;
-    }
-  }
 
-  for (size_t i = 0; i < yuv_height_; ++i) {
-    for (size_t j = 0; j < yuv_width_; ++j) {
-      size_t x_index = j;
-      if (j % 2 != 0) {
-        x_index = j - 1;
-      }
+  // The slot stays ours until the next GetLatest(), so it is read in place.
+  bool new_frame = false;
+  const TangoImageBuffer* frame = yuv_mailbox_->GetLatest(&new_frame);
+  if (frame == nullptr) {
+    return;
+  }
 
-      size_t rgb_index = (i * yuv_width_ + j) * 3;
-
-      // The YUV texture format is NV21,
-      // yuv_buffer_ buffer layout:
-      //   [y0, y1, y2, ..., yn, v0, u0, v1, u1, ..., v(n/4), u(n/4)]
-      Yuv2Rgb(
-          yuv_buffer_[i * yuv_width_ + j],
-          yuv_buffer_[uv_buffer_offset_ + (i / 2) * yuv_width_ + x_index + 1],
-          yuv_buffer_[uv_buffer_offset_ + (i / 2) * yuv_width_ + x_index],
-          &rgb_buffer_[rgb_index], &rgb_buffer_[rgb_index + 1],
-          &rgb_buffer_[rgb_index + 2]);
-    }
+  // Switching paths leaves the other drawable with an older frame.
+  const bool use_cpu_rgb = use_cpu_rgb_;
+  if (use_cpu_rgb != was_cpu_rgb_) {
+    is_yuv_texture_uploaded_ = false;
+    was_cpu_rgb_ = use_cpu_rgb;
+  }
+  if (use_cpu_rgb) {
+    RenderCpuRgb(*frame, new_frame);
+    return;
   }
 
-  glBindTexture(GL_TEXTURE_2D, yuv_drawable_->GetTextureId());
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, yuv_width_, yuv_height_, 0, GL_RGB,
-               GL_UNSIGNED_BYTE, rgb_buffer_.data());
+  // The YUV texture format is NV21, frame layout:
+  //   [y0, y1, y2, ..., yn, v0, u0, v1, u1, ..., v(n/4), u(n/4)]
+  // Both planes are uploaded as they are, at 1.5 bytes per pixel, and the
+  // overlay converts them to RGB in its fragment shader. Rows may be padded
+  // beyond the width; the overlay crops the padding. A frame that was
+  // already uploaded is not uploaded again, unless the overlay was recreated
+  // with the surface since.
+  tango_perception::YuvPlanes planes;
+  if ((new_frame || !is_yuv_texture_uploaded_) &&
+      tango_perception::GetYuvPlanes(*frame, &planes)) {
+    yuv_drawable_->UpdateNv21Texture(planes.y.GetData(), planes.v.GetData(),
+                                     planes.y.GetWidth(),
+                                     planes.y.GetHeight(),
+                                     planes.y.GetRowStride());
+    is_yuv_texture_uploaded_ = true;
+  }
 
   yuv_drawable_->Render(glm::mat4(1.0f), glm::mat4(1.0f));
 }
 
+void HelloVideoApp::RenderCpuRgb(const TangoImageBuffer& frame,
+                                 bool new_frame) {
+  // We could do this conversion in a fragment shader if all we care about
+  // is rendering, as the NV21 path does, but we show it here as an example
+  // of how people can use RGB data on the CPU. The converter works on the
+  // planes in place, padded rows included, and writes packed RGBA, which is
+  // uploaded to a plain texture.
+  tango_perception::YuvPlanes planes;
+  if ((new_frame || !is_yuv_texture_uploaded_) &&
+      tango_perception::GetYuvPlanes(frame, &planes)) {
+    const int width = planes.y.GetWidth();
+    const int height = planes.y.GetHeight();
+    rgba_buffer_.resize(static_cast<size_t>(width) * height * 4);
+    yuv_converter_.Convert(
+        planes, tango_perception::ImageView<uint8_t>(
+                    rgba_buffer_.data(), width, height, width * 4, 4));
+
+    glBindTexture(GL_TEXTURE_2D, rgb_drawable_->GetTextureId());
+    if (width != rgb_texture_width_ || height != rgb_texture_height_) {
+      // OpenGL ES 2 only samples textures whose size is not a power of two
+      // with clamped wrapping.
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
+                   GL_UNSIGNED_BYTE, rgba_buffer_.data());
+      rgb_texture_width_ = width;
+      rgb_texture_height_ = height;
+    } else {
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA,
+                      GL_UNSIGNED_BYTE, rgba_buffer_.data());
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    is_yuv_texture_uploaded_ = true;
+  }
+
+  rgb_drawable_->Render(glm::mat4(1.0f), glm::mat4(1.0f));
+}
+
 void HelloVideoApp::RenderTextureId() {
+  // Lock the most recent camera buffer so the service holds on to it until
+  // the frame using it has been drawn, and point the texture straight at it.
+  // The texture is only updated when a new buffer arrived.
   double timestamp;
-  // TangoService_updateTexture() updates target camera's
-  // texture and timestamp.
-  int ret = TangoService_updateTexture(TANGO_CAMERA_COLOR, &timestamp);
+  TangoBufferId buffer;
+  int ret = TangoService_lockCameraBuffer(TANGO_CAMERA_COLOR, &timestamp,
+                                          &buffer);
+  if (ret == TANGO_SUCCESS) {
+    if (timestamp != locked_buffer_timestamp_) {
+      ret = TangoService_updateTextureExternalOesForBuffer(
+          TANGO_CAMERA_COLOR, video_overlay_drawable_->GetTextureId(),
+          buffer);
+      if (ret != TANGO_SUCCESS) {
+        LOGE(
+            "HelloVideoApp: Failed to update the texture for a locked buffer "
+            "with error code: %d",
+            ret);
+      }
+      locked_buffer_timestamp_ = timestamp;
+    }
+    video_overlay_drawable_->Render(glm::mat4(1.0f), glm::mat4(1.0f));
+    TangoService_unlockCameraBuffer(TANGO_CAMERA_COLOR, buffer);
+    return;
+  }
+
+  // Without a locked buffer, TangoService_updateTexture() updates target
+  // camera's texture and timestamp.
+  ret = TangoService_updateTexture(TANGO_CAMERA_COLOR, &timestamp);
   if (ret != TANGO_SUCCESS) {
     LOGE(
         "HelloVideoApp: Failed to update the texture id with error code: "
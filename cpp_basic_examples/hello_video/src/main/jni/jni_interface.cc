@@ -70,6 +70,12 @@ Java_com_projecttango_examples_cpp_hellovideo_TangoJniNative_setYuvMethod(
   }
 }
 
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_hellovideo_TangoJniNative_setCpuRgbConversion(
+    JNIEnv*, jobject, jboolean use_cpu_rgb) {
+  app.SetCpuRgbConversion(use_cpu_rgb);
+}
+
 JNIEXPORT void JNICALL
 Java_com_projecttango_examples_cpp_hellovideo_TangoJniNative_onDisplayChanged(
     JNIEnv* /*env*/, jobject /*obj*/, jint display_rotation) {
@@ -27,6 +27,7 @@ LOCAL_SRC_FILES := marker_detection_app.cc \
                    jni_interface.cc \
                    scene.cc \
                    marker_object.cc \
+                   marker_tracker.cc \
                    $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/bounding_box.cc \
                    $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/camera.cc \
                    $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/conversions.cc \
@@ -40,9 +41,14 @@ LOCAL_SRC_FILES := marker_detection_app.cc \
                    $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/texture.cc \
                    $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/transform.cc \
                    $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/util.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/video_overlay.cc
+                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/video_overlay.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/camera_projection.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/frame_quality.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/image_pyramid.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/sensor_mailboxes.cc
 
 LOCAL_C_INCLUDES := $(PROJECT_ROOT)/tango_gl/include \
+                    $(PROJECT_ROOT)/tango_perception/include \
                     $(PROJECT_ROOT)/third_party/glm/ \
                     $(PROJECT_ROOT)/third_party/libpng/include/
 
@@ -14,8 +14,9 @@
  * limitations under the License.
  */
 #include <sstream>
+#include <algorithm>
+#include <chrono>
 #include <string>
-#include <thread>
 
 #include <tango-gl/conversions.h>
 #include <tango_support.h>
@@ -32,9 +33,19 @@ const int kTangoCoreMinimumVersion = 9377;
 const float kArCameraNearClippingPlane = 0.1f;
 const float kArCameraFarClippingPlane = 100.0f;
 
-// Marker detecting frequency, in frames per second.
+// Highest marker detecting frequency, in frames per second.
 const int kMarkerDetectionFPS = 30;
 
+// Largest share of a core that marker detection may keep busy. When
+// detections take longer, they are requested less often.
+const double kMaxMarkerDetectionDutyCycle = 0.5;
+
+// Weight of the latest detection in the average detection latency.
+const double kMarkerDetectionLatencyWeight = 0.2;
+
+// Consumer index of marker detection in the image regions.
+const int kMarkerDetectionRegionConsumer = 0;
+
 // This function routes texture callbacks to the application object for
 // handling.
 //
@@ -73,9 +84,36 @@ void MarkerDetectionApp::OnFrameAvailable(const TangoImageBuffer* buffer) {
   if (image_buffer_manager_ == nullptr) {
     return;
   }
+  UpdateImageBufferCopyRegion(buffer->height);
   TangoSupport_updateImageBuffer(image_buffer_manager_, buffer);
 }
 
+void MarkerDetectionApp::UpdateImageBufferCopyRegion(uint32_t height) {
+  uint32_t begin_row, end_row;
+  bool needs_chroma;
+  if (!image_regions_.GetUnion(height, &begin_row, &end_row, &needs_chroma)) {
+    begin_row = 0;
+    end_row = height;
+    needs_chroma = true;
+  }
+  // The manager copies at least two rows.
+  if (end_row < begin_row + 2) {
+    end_row = std::min(begin_row + 2, height);
+    begin_row = end_row - 2;
+  }
+  if (begin_row == copy_begin_row_ && end_row == copy_end_row_ &&
+      needs_chroma == copy_chroma_) {
+    return;
+  }
+  if (TangoSupport_setImageBufferCopyRegion(image_buffer_manager_,
+                                            needs_chroma ? 0 : 1, begin_row,
+                                            end_row - 1) == TANGO_SUCCESS) {
+    copy_begin_row_ = begin_row;
+    copy_end_row_ = end_row;
+    copy_chroma_ = needs_chroma;
+  }
+}
+
 void MarkerDetectionApp::OnCreate(JNIEnv* env, jobject activity,
                                   int display_rotation) {
   // Check the installed version of the TangoCore against minimum required
@@ -100,6 +138,10 @@ void MarkerDetectionApp::OnCreate(JNIEnv* env, jobject activity,
   display_rotation_ = static_cast<TangoSupport_Rotation>(display_rotation);
   is_video_overlay_rotation_dirty_ = true;
   prev_marker_detection_timestamp_ = 0;
+  marker_detection_latency_ = 0.0;
+  marker_detection_interval_ = 1.0 / kMarkerDetectionFPS;
+  has_marker_detection_request_ = false;
+  stop_marker_detection_ = false;
 }
 
 void MarkerDetectionApp::OnTangoServiceConnected(JNIEnv* env, jobject iBinder) {
@@ -115,6 +157,7 @@ void MarkerDetectionApp::OnTangoServiceConnected(JNIEnv* env, jobject iBinder) {
   TangoConnect();
   SetupIntrinsics();
   SetupImageBufferManager();
+  StartMarkerDetectionThread();
 
   is_service_connected_ = true;
   UpdateViewportAndProjectionMatrix();
@@ -235,13 +278,22 @@ TangoErrorType MarkerDetectionApp::SetupIntrinsics() {
         "code: %d",
         ret);
   }
+  frame_quality_scorer_.SetCameraIntrinsics(color_camera_intrinsics_);
+  main_scene_.SetCameraIntrinsics(color_camera_intrinsics_);
 
   return ret;
 }
 
 // Image buffer manager helps to cache image buffers in background.
 TangoErrorType MarkerDetectionApp::SetupImageBufferManager() {
+  // ARTag detection reads only the luma plane.
+  image_regions_.Set(kMarkerDetectionRegionConsumer, 0,
+                     color_camera_intrinsics_.height, false);
   if (image_buffer_manager_ == nullptr) {
+    // The manager starts out copying full frames.
+    copy_begin_row_ = 0;
+    copy_end_row_ = color_camera_intrinsics_.height;
+    copy_chroma_ = true;
     TangoErrorType status = TangoSupport_createImageBufferManager(
         TANGO_HAL_PIXEL_FORMAT_YCrCb_420_SP, color_camera_intrinsics_.width,
         color_camera_intrinsics_.height, &image_buffer_manager_);
@@ -257,6 +309,8 @@ TangoErrorType MarkerDetectionApp::SetupImageBufferManager() {
 }
 
 void MarkerDetectionApp::OnPause() {
+  // The detection thread uses the service and the scene, so it stops first.
+  StopMarkerDetectionThread();
   TangoDisconnect();
   DeleteResources();
 }
@@ -439,35 +493,113 @@ TangoErrorType MarkerDetectionApp::GetColorCameraExtrinsics(
 }
 
 void MarkerDetectionApp::DetectMarkers(double timestamp) {
-  // Marker detection is a time-consuming process. This is to make sure marker
-  // detection process runs at a frequency no higher than a pre-defined FPS.
-  if (timestamp < prev_marker_detection_timestamp_ + 1.0 / kMarkerDetectionFPS)
+  {
+    // Marker detection is a time-consuming process. This is to make sure
+    // marker detection runs at a frequency no higher than a pre-defined FPS,
+    // or than the measured detection latency allows.
+    std::lock_guard<std::mutex> lock(marker_detection_mutex_);
+    if (timestamp <
+        prev_marker_detection_timestamp_ + marker_detection_interval_) {
+      return;
+    }
+    prev_marker_detection_timestamp_ = timestamp;
+    has_marker_detection_request_ = true;
+  }
+  marker_detection_requested_.notify_one();
+}
+
+void MarkerDetectionApp::StartMarkerDetectionThread() {
+  if (marker_detection_thread_.joinable()) {
+    return;
+  }
+  stop_marker_detection_ = false;
+  has_marker_detection_request_ = false;
+  prev_marker_detection_timestamp_ = 0.0;
+  marker_detection_latency_ = 0.0;
+  marker_detection_interval_ = 1.0 / kMarkerDetectionFPS;
+  frame_quality_scorer_.Reset();
+  marker_detection_thread_ =
+      std::thread(&MarkerDetectionApp::MarkerDetectionThread, this);
+}
+
+void MarkerDetectionApp::StopMarkerDetectionThread() {
+  if (!marker_detection_thread_.joinable()) {
     return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(marker_detection_mutex_);
+    stop_marker_detection_ = true;
+  }
+  marker_detection_requested_.notify_one();
+  marker_detection_thread_.join();
+}
 
-  prev_marker_detection_timestamp_ = timestamp;
-
-  // Start the secondary thread
-  std::thread t([this]() {
-    if (marker_detection_thread_mutex_.try_lock()) {
-      // Get latest image buffer.
-      TangoImageBuffer* image_buffer = nullptr;
-      TangoErrorType status = TangoSupport_getLatestImageBuffer(
-          image_buffer_manager_, &image_buffer);
-      if (status == TANGO_SUCCESS) {
-        // Get camera extrinsics matrix.
-        glm::mat4 camera_extrinsics_matrix;
-        status = GetColorCameraExtrinsics(image_buffer->timestamp,
-                                          &camera_extrinsics_matrix);
-        if (status == TANGO_SUCCESS) {
-          main_scene_.DetectMarkers(*image_buffer, camera_extrinsics_matrix);
-        }
+void MarkerDetectionApp::MarkerDetectionThread() {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(marker_detection_mutex_);
+      marker_detection_requested_.wait(lock, [this] {
+        return stop_marker_detection_ || has_marker_detection_request_;
+      });
+      if (stop_marker_detection_) {
+        return;
       }
-      marker_detection_thread_mutex_.unlock();
+      has_marker_detection_request_ = false;
+    }
+
+    const std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    if (!DetectMarkersInLatestImage()) {
+      continue;
     }
-  });
+    const double latency = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - start)
+                               .count();
+
+    std::lock_guard<std::mutex> lock(marker_detection_mutex_);
+    marker_detection_latency_ =
+        marker_detection_latency_ == 0.0
+            ? latency
+            : marker_detection_latency_ +
+                  kMarkerDetectionLatencyWeight *
+                      (latency - marker_detection_latency_);
+    marker_detection_interval_ =
+        std::max(1.0 / kMarkerDetectionFPS,
+                 marker_detection_latency_ / kMaxMarkerDetectionDutyCycle);
+  }
+}
+
+bool MarkerDetectionApp::DetectMarkersInLatestImage() {
+  // Get latest image buffer.
+  TangoImageBuffer* image_buffer = nullptr;
+  TangoErrorType status =
+      TangoSupport_getLatestImageBuffer(image_buffer_manager_, &image_buffer);
+  if (status != TANGO_SUCCESS) {
+    return false;
+  }
 
-  // Let the thread run independently from the rendering thread.
-  t.detach();
+  // Get camera extrinsics matrix.
+  glm::mat4 camera_extrinsics_matrix;
+  status = GetColorCameraExtrinsics(image_buffer->timestamp,
+                                    &camera_extrinsics_matrix);
+  if (status != TANGO_SUCCESS ||
+      !IsFrameUsable(*image_buffer, camera_extrinsics_matrix)) {
+    return false;
+  }
+  main_scene_.DetectMarkers(*image_buffer, camera_extrinsics_matrix);
+  return true;
+}
+
+bool MarkerDetectionApp::IsFrameUsable(const TangoImageBuffer& image_buffer,
+                                       const glm::mat4& world_T_camera) {
+  std::shared_ptr<tango_perception::ImagePyramid> pyramid =
+      image_pyramids_.Get(image_buffer);
+  if (pyramid == nullptr) {
+    return true;
+  }
+  const tango_perception::FrameQuality quality = frame_quality_scorer_.Score(
+      image_buffer, pyramid.get(), glm::quat_cast(world_T_camera));
+  return quality.is_usable;
 }
 
 void MarkerDetectionApp::DeleteResources() {
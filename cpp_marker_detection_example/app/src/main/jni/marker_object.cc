@@ -15,7 +15,6 @@
  */
 
 #include <tango-gl/shaders.h>
-#include <tango-gl/conversions.h>
 #include "tango-marker-detection/marker_object.h"
 
 namespace {
@@ -43,7 +42,7 @@ static const glm::vec4 kBoxColor = glm::vec4(0.f, 1.f, 1.f, 1.f);
 
 namespace tango_marker_detection {
 
-MarkerObject::MarkerObject(float marker_size) : visible_(false) {
+MarkerObject::MarkerObject(float marker_size) {
   // Create shader program.
   box_shader_program_ = tango_gl::util::CreateProgram(
       tango_gl::shaders::GetBasicVertexShader().c_str(),
@@ -92,19 +91,17 @@ MarkerObject::MarkerObject(float marker_size) : visible_(false) {
 
 MarkerObject::~MarkerObject() {}
 
-void MarkerObject::Render(tango_gl::Camera* camera) const {
-  if (!visible_) {
-    return;
-  }
-
+void MarkerObject::Render(tango_gl::Camera* camera,
+                          const MarkerPose& marker) const {
   // Render bounding box
-  DrawBoundingBox(camera);
+  DrawBoundingBox(camera, marker);
 
   // Render three axes
-  DrawAxes(camera);
+  DrawAxes(camera, marker);
 }
 
-void MarkerObject::DrawBoundingBox(tango_gl::Camera* camera) const {
+void MarkerObject::DrawBoundingBox(tango_gl::Camera* camera,
+                                   const MarkerPose& marker) const {
   glUseProgram(box_shader_program_);
   glLineWidth(3.f);
 
@@ -119,21 +116,22 @@ void MarkerObject::DrawBoundingBox(tango_gl::Camera* camera) const {
 
   glEnableVertexAttribArray(box_attrib_vertices_);
   glVertexAttribPointer(box_attrib_vertices_, 3, GL_FLOAT, GL_FALSE,
-                        sizeof(glm::vec3), &box_vertices_[0]);
+                        sizeof(glm::vec3), &marker.corners[0]);
 
-  glDrawArrays(GL_LINE_LOOP, 0, box_vertices_.size());
+  glDrawArrays(GL_LINE_LOOP, 0, 4);
 
   glDisableVertexAttribArray(box_attrib_vertices_);
   glUseProgram(0);
 }
 
-void MarkerObject::DrawAxes(tango_gl::Camera* camera) const {
+void MarkerObject::DrawAxes(tango_gl::Camera* camera,
+                            const MarkerPose& marker) const {
   glUseProgram(axis_shader_program_);
   glLineWidth(10.f);
 
   // Compute model-view-projection matrix
-  glm::mat4 mvp_mat =
-      camera->GetProjectionMatrix() * camera->GetViewMatrix() * world_T_local_;
+  glm::mat4 mvp_mat = camera->GetProjectionMatrix() *
+                      camera->GetViewMatrix() * marker.world_T_local;
 
   glUniformMatrix4fv(axis_uniform_mvp_, 1, GL_FALSE, glm::value_ptr(mvp_mat));
 
@@ -151,23 +149,4 @@ void MarkerObject::DrawAxes(tango_gl::Camera* camera) const {
   glDisableVertexAttribArray(axis_attrib_colors_);
   glUseProgram(0);
 }
-
-void MarkerObject::Update(const TangoMarkers_Marker& marker) {
-  // Update axes model transform with marker pose.
-  world_T_local_ = tango_gl::conversions::TransformFromArrays(
-      marker.translation, marker.orientation);
-
-  // Update vertices of bounding box with marker corners.
-  box_vertices_.resize(4);
-  for (int i = 0; i < 4; ++i) {
-    box_vertices_[i] =
-        glm::vec3(
-          marker.corners_3d[i][0],
-          marker.corners_3d[i][1],
-          marker.corners_3d[i][2]);
-  }
-
-  // Make the marker visible.
-  visible_ = true;
-}
 }  // namespace tango_marker_detection
@@ -0,0 +1,387 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include <tango-gl/conversions.h>
+#include <tango-perception/image_view.h>
+
+#include "tango-marker-detection/marker_tracker.h"
+
+namespace {
+// Longest time between full image detections, in seconds.
+const double kFullScanInterval = 1.0;
+
+// Padding around the predicted corners of a marker, as a fraction of its
+// projected size and at least in pixels. It has to cover the motion of the
+// marker in the image that the camera pose does not predict.
+const float kRegionPadding = 0.5f;
+const float kMinRegionPadding = 16.0f;
+
+// Regions smaller than this, in pixels, hold too little of the marker.
+const int kMinRegionSize = 16;
+
+// Largest RMS distance of the detected corners from the refined pose, in
+// pixels.
+const double kMaxReprojectionError = 2.0;
+
+// Gauss-Newton iterations of the pose refinement.
+const int kPoseIterations = 5;
+
+// Value of the chroma of cropped images. The detector reads only luma.
+const uint8_t kNeutralChroma = 128;
+
+// Rotation matrix for a rotation vector (axis times angle in radians).
+glm::dmat3 RotationFromVector(const glm::dvec3& rotation) {
+  const double angle = glm::length(rotation);
+  if (angle < 1e-12) {
+    return glm::dmat3(1.0);
+  }
+  const glm::dvec3 axis = rotation / angle;
+  const double c = std::cos(angle);
+  const double s = std::sin(angle);
+  const double t = 1.0 - c;
+  // glm matrices are column major.
+  return glm::dmat3(t * axis.x * axis.x + c, t * axis.x * axis.y + s * axis.z,
+                    t * axis.x * axis.z - s * axis.y,
+                    t * axis.x * axis.y - s * axis.z, t * axis.y * axis.y + c,
+                    t * axis.y * axis.z + s * axis.x,
+                    t * axis.x * axis.z + s * axis.y,
+                    t * axis.y * axis.z - s * axis.x, t * axis.z * axis.z + c);
+}
+
+// Solve the 6x6 system a x = b by Gaussian elimination with partial
+// pivoting. Returns false if the system is singular.
+bool Solve6(double a[6][6], double b[6], double x[6]) {
+  for (int column = 0; column < 6; ++column) {
+    int pivot = column;
+    for (int row = column + 1; row < 6; ++row) {
+      if (std::fabs(a[row][column]) > std::fabs(a[pivot][column])) {
+        pivot = row;
+      }
+    }
+    if (std::fabs(a[pivot][column]) < 1e-12) {
+      return false;
+    }
+    if (pivot != column) {
+      std::swap(a[pivot], a[column]);
+      std::swap(b[pivot], b[column]);
+    }
+    for (int row = column + 1; row < 6; ++row) {
+      const double factor = a[row][column] / a[column][column];
+      for (int k = column; k < 6; ++k) {
+        a[row][k] -= factor * a[column][k];
+      }
+      b[row] -= factor * b[column];
+    }
+  }
+  for (int row = 5; row >= 0; --row) {
+    double value = b[row];
+    for (int k = row + 1; k < 6; ++k) {
+      value -= a[row][k] * x[k];
+    }
+    x[row] = value / a[row][row];
+  }
+  return true;
+}
+}  // namespace
+
+namespace tango_marker_detection {
+
+MarkerTracker::MarkerTracker()
+    : is_track_lost_(false),
+      full_scan_timestamp_(0.0),
+      is_region_detection_supported_(true) {}
+
+void MarkerTracker::SetCameraIntrinsics(
+    const TangoCameraIntrinsics& intrinsics) {
+  projection_.SetCameraIntrinsics(intrinsics);
+  Reset();
+}
+
+bool MarkerTracker::NeedsFullScan(double timestamp) const {
+  return !is_region_detection_supported_ || tracks_.empty() ||
+         is_track_lost_ || timestamp < full_scan_timestamp_ ||
+         timestamp >= full_scan_timestamp_ + kFullScanInterval;
+}
+
+void MarkerTracker::ClearTracks(double timestamp) {
+  tracks_.clear();
+  is_track_lost_ = false;
+  full_scan_timestamp_ = timestamp;
+}
+
+void MarkerTracker::AddTrack(int marker_id, const TangoMarkers_Marker& marker) {
+  MarkerTrack track;
+  track.id = marker_id;
+  track.world_T_marker = tango_gl::conversions::TransformFromArrays(
+      marker.translation, marker.orientation);
+  const glm::mat4 marker_T_world = glm::inverse(track.world_T_marker);
+  for (int i = 0; i < 4; ++i) {
+    track.corners[i] = glm::vec3(
+        marker_T_world * glm::vec4(marker.corners_3d[i][0],
+                                   marker.corners_3d[i][1],
+                                   marker.corners_3d[i][2], 1.0f));
+  }
+  tracks_.push_back(track);
+}
+
+bool MarkerTracker::Track(const TangoImageBuffer& image_buffer,
+                          const glm::mat4& world_T_camera,
+                          std::vector<TrackedMarker>* markers) {
+  markers->clear();
+  if (image_buffer.format != TANGO_HAL_PIXEL_FORMAT_YCrCb_420_SP) {
+    return false;
+  }
+
+  const glm::mat4 camera_T_world = glm::inverse(world_T_camera);
+  const int width = static_cast<int>(image_buffer.width);
+  const int height = static_cast<int>(image_buffer.height);
+
+  // The detector is only asked for corners, so any output frame will do.
+  const double translation[3] = {0.0, 0.0, 0.0};
+  const double orientation[4] = {0.0, 0.0, 0.0, 1.0};
+  TangoMarkers_DetectParam param;
+  param.type = TANGO_MARKERS_MARKER_ARTAG;
+  param.marker_size = 1.0;
+
+  for (size_t i = 0; i < tracks_.size();) {
+    MarkerTrack& track = tracks_[i];
+
+    bool is_found = false;
+    int x, y, region_width, region_height;
+    if (GetRegion(track, camera_T_world, width, height, &x, &y, &region_width,
+                  &region_height)) {
+      TangoImageBuffer region;
+      CropImage(image_buffer, x, y, region_width, region_height, &region);
+
+      TangoMarkers_MarkerList list;
+      if (TangoMarkers_detectMarkers(&region, TANGO_CAMERA_COLOR, translation,
+                                     orientation, &param,
+                                     &list) != TANGO_SUCCESS) {
+        LOGE("MarkerTracker: Detection in image regions failed, tracking is "
+             "disabled.");
+        is_region_detection_supported_ = false;
+        return false;
+      }
+
+      for (int j = 0; j < list.marker_count && !is_found; ++j) {
+        const TangoMarkers_Marker& detected = list.markers[j];
+        if (atoi(detected.content) != track.id) {
+          continue;
+        }
+
+        glm::vec2 pixels[4];
+        for (int k = 0; k < 4; ++k) {
+          pixels[k] = glm::vec2(detected.corners_2d[k][0] + x,
+                                detected.corners_2d[k][1] + y);
+        }
+        glm::mat4 camera_T_marker = camera_T_world * track.world_T_marker;
+        if (!RefinePose(track, pixels, &camera_T_marker)) {
+          continue;
+        }
+        is_found = true;
+        track.world_T_marker = world_T_camera * camera_T_marker;
+
+        TrackedMarker tracked;
+        tracked.id = track.id;
+        TangoMarkers_Marker& marker = tracked.marker;
+        marker.type = detected.type;
+        marker.timestamp = image_buffer.timestamp;
+        marker.content = nullptr;
+        marker.content_size = 0;
+        for (int k = 0; k < 4; ++k) {
+          const glm::vec3 corner = glm::vec3(
+              track.world_T_marker * glm::vec4(track.corners[k], 1.0f));
+          marker.corners_2d[k][0] = pixels[k].x;
+          marker.corners_2d[k][1] = pixels[k].y;
+          marker.corners_3d[k][0] = corner.x;
+          marker.corners_3d[k][1] = corner.y;
+          marker.corners_3d[k][2] = corner.z;
+        }
+        const glm::quat q = glm::quat_cast(track.world_T_marker);
+        marker.translation[0] = track.world_T_marker[3][0];
+        marker.translation[1] = track.world_T_marker[3][1];
+        marker.translation[2] = track.world_T_marker[3][2];
+        marker.orientation[0] = q.x;
+        marker.orientation[1] = q.y;
+        marker.orientation[2] = q.z;
+        marker.orientation[3] = q.w;
+        markers->push_back(tracked);
+      }
+
+      // Release memory allocated by TangoMarkers_detectMarkers().
+      TangoMarkers_freeMarkerList(&list);
+    }
+
+    if (is_found) {
+      ++i;
+    } else {
+      tracks_.erase(tracks_.begin() + i);
+      is_track_lost_ = true;
+    }
+  }
+  return true;
+}
+
+void MarkerTracker::Reset() {
+  tracks_.clear();
+  is_track_lost_ = false;
+  full_scan_timestamp_ = 0.0;
+  is_region_detection_supported_ = true;
+}
+
+bool MarkerTracker::GetRegion(const MarkerTrack& track,
+                              const glm::mat4& camera_T_world, int width,
+                              int height, int* x, int* y, int* region_width,
+                              int* region_height) const {
+  const glm::mat4 camera_T_marker = camera_T_world * track.world_T_marker;
+  glm::vec2 min_pixel(static_cast<float>(width), static_cast<float>(height));
+  glm::vec2 max_pixel(0.0f);
+  for (int i = 0; i < 4; ++i) {
+    glm::vec2 pixel;
+    if (!projection_.Project(
+            glm::vec3(camera_T_marker * glm::vec4(track.corners[i], 1.0f)),
+            &pixel)) {
+      return false;
+    }
+    min_pixel = glm::min(min_pixel, pixel);
+    max_pixel = glm::max(max_pixel, pixel);
+  }
+
+  const glm::vec2 size = max_pixel - min_pixel;
+  const float padding =
+      std::max(kMinRegionPadding, kRegionPadding * std::max(size.x, size.y));
+
+  // NV21 chroma covers 2x2 pixels, so the region starts and ends on even
+  // pixels.
+  const int begin_x =
+      std::max(0, static_cast<int>(std::floor(min_pixel.x - padding))) & ~1;
+  const int begin_y =
+      std::max(0, static_cast<int>(std::floor(min_pixel.y - padding))) & ~1;
+  const int end_x =
+      std::min(width, static_cast<int>(std::ceil(max_pixel.x + padding)));
+  const int end_y =
+      std::min(height, static_cast<int>(std::ceil(max_pixel.y + padding)));
+  *x = begin_x;
+  *y = begin_y;
+  *region_width = (end_x - begin_x) & ~1;
+  *region_height = (end_y - begin_y) & ~1;
+  return *region_width >= kMinRegionSize && *region_height >= kMinRegionSize;
+}
+
+void MarkerTracker::CropImage(const TangoImageBuffer& image_buffer, int x,
+                              int y, int width, int height,
+                              TangoImageBuffer* region) {
+  const size_t luma_size = static_cast<size_t>(width) * height;
+  region_buffer_.resize(luma_size + luma_size / 2);
+
+  tango_perception::CopyImage(
+      tango_perception::GetLumaPlane(image_buffer).Crop(x, y, width, height),
+      tango_perception::ImageView<uint8_t>(region_buffer_.data(), width,
+                                           height, width));
+  std::memset(region_buffer_.data() + luma_size, kNeutralChroma,
+              luma_size / 2);
+
+  *region = image_buffer;
+  region->width = width;
+  region->height = height;
+  region->stride = width;
+  region->data = region_buffer_.data();
+}
+
+bool MarkerTracker::RefinePose(const MarkerTrack& track,
+                               const glm::vec2 pixels[4],
+                               glm::mat4* camera_T_marker) const {
+  glm::dvec2 observed[4];
+  glm::dvec3 corners[4];
+  for (int i = 0; i < 4; ++i) {
+    observed[i] = glm::dvec2(projection_.Unproject(pixels[i]));
+    corners[i] = glm::dvec3(track.corners[i]);
+  }
+
+  glm::dmat3 rotation = glm::dmat3(glm::mat3(*camera_T_marker));
+  glm::dvec3 translation = glm::dvec3((*camera_T_marker)[3]);
+
+  // Gauss-Newton on the distance of the projected corners from the
+  // observed ones, in normalized image coordinates. The rotation is updated
+  // by a rotation vector applied on the left.
+  double squared_error = 0.0;
+  for (int iteration = 0; iteration <= kPoseIterations; ++iteration) {
+    double jtj[6][6] = {};
+    double jtr[6] = {};
+    squared_error = 0.0;
+    for (int i = 0; i < 4; ++i) {
+      const glm::dvec3 rotated = rotation * corners[i];
+      const glm::dvec3 point = rotated + translation;
+      if (point.z <= 0.0) {
+        return false;
+      }
+      const double inverse_z = 1.0 / point.z;
+      const glm::dvec2 residual =
+          glm::dvec2(point) * inverse_z - observed[i];
+      squared_error += glm::dot(residual, residual);
+      if (iteration == kPoseIterations) {
+        continue;
+      }
+
+      // Derivatives of the two residuals by the camera point, and by the
+      // rotation vector and the translation.
+      const glm::dvec3 d_point[2] = {
+          glm::dvec3(inverse_z, 0.0, -point.x * inverse_z * inverse_z),
+          glm::dvec3(0.0, inverse_z, -point.y * inverse_z * inverse_z)};
+      for (int r = 0; r < 2; ++r) {
+        const glm::dvec3 d_rotation = glm::cross(rotated, d_point[r]);
+        const double jacobian[6] = {d_rotation.x, d_rotation.y,
+                                    d_rotation.z, d_point[r].x,
+                                    d_point[r].y, d_point[r].z};
+        for (int a = 0; a < 6; ++a) {
+          for (int b = 0; b < 6; ++b) {
+            jtj[a][b] += jacobian[a] * jacobian[b];
+          }
+          jtr[a] -= jacobian[a] * residual[r];
+        }
+      }
+    }
+    if (iteration == kPoseIterations) {
+      break;
+    }
+
+    double step[6];
+    if (!Solve6(jtj, jtr, step)) {
+      return false;
+    }
+    rotation = RotationFromVector(glm::dvec3(step[0], step[1], step[2])) *
+               rotation;
+    translation += glm::dvec3(step[3], step[4], step[5]);
+  }
+
+  const TangoCameraIntrinsics& intrinsics = projection_.GetIntrinsics();
+  const double pixel_error =
+      std::sqrt(squared_error / 4.0) * 0.5 * (intrinsics.fx + intrinsics.fy);
+  if (pixel_error > kMaxReprojectionError) {
+    return false;
+  }
+
+  *camera_T_marker = glm::mat4(glm::mat3(rotation));
+  (*camera_T_marker)[3] = glm::vec4(glm::vec3(translation), 1.0f);
+  return true;
+}
+
+}  // namespace tango_marker_detection
@@ -16,6 +16,7 @@
 
 #include <math.h>
 
+#include <tango-gl/conversions.h>
 #include <tango-gl/tango-gl.h>
 #include <tango_markers.h>
 
@@ -44,7 +45,15 @@ const double kMarkerEdgeLength = 0.1397;
 
 namespace tango_marker_detection {
 
-Scene::Scene() : is_content_initialized_(false) {}
+Scene::Scene() : is_content_initialized_(false) {
+  detected_markers_.reserve(kMaxMarkerId + 1);
+  detected_marker_indices_.assign(kMaxMarkerId + 1, -1);
+
+  // Reserve every slot up front, so publishing never allocates.
+  for (int i = 0; i < 3; ++i) {
+    marker_mailbox_.GetSlot(i)->reserve(kMaxMarkerId + 1);
+  }
+}
 
 Scene::~Scene() {}
 
@@ -57,16 +66,8 @@ void Scene::InitGLContent(AAssetManager* aasset_manager) {
       std::unique_ptr<tango_gl::VideoOverlay>(new tango_gl::VideoOverlay());
   camera_ = std::unique_ptr<tango_gl::Camera>(new tango_gl::Camera());
 
-  // Initialize objects with nullptr.
-  {
-    // Lock objects_ during initialization.
-    std::lock_guard<std::mutex> lock(objects_mutex_);
-    objects_.resize(kMaxMarkerId + 1);
-    for (int i = 0; i <= kMaxMarkerId; ++i) {
-      objects_[i] =
-          std::unique_ptr<MarkerObject>(new MarkerObject(kMarkerEdgeLength));
-    }
-  }
+  marker_object_ =
+      std::unique_ptr<MarkerObject>(new MarkerObject(kMarkerEdgeLength));
 
   is_content_initialized_ = true;
 }
@@ -75,15 +76,16 @@ void Scene::DeleteResources() {
   if (is_content_initialized_) {
     is_content_initialized_ = false;
 
-    // Lock objects_ during deleting.
-    std::lock_guard<std::mutex> lock(objects_mutex_);
-    for (int i = 0; i <= kMaxMarkerId; ++i) {
-      objects_[i] = nullptr;
-    }
-
+    marker_object_ = nullptr;
     video_overlay_ = nullptr;
     camera_ = nullptr;
   }
+  tracker_.Reset();
+
+  // Markers are detected again after resuming.
+  detected_markers_.clear();
+  detected_marker_indices_.assign(kMaxMarkerId + 1, -1);
+  PublishMarkers();
 }
 
 void Scene::SetupViewport(int w, int h) {
@@ -126,20 +128,33 @@ void Scene::Render() {
   video_overlay_->Render(glm::mat4(1.0f), glm::mat4(1.0f));
   glEnable(GL_DEPTH_TEST);
 
-  // Render all objects.
-  {
-    // Lock objects_ during rendering.
-    std::lock_guard<std::mutex> lock(objects_mutex_);
-    for (int i = 0; i <= kMaxMarkerId; ++i) {
-      objects_[i]->Render(camera_.get());
+  // Render the detected markers. The list stays unchanged until the next
+  // GetLatest(), however long rendering takes.
+  const std::vector<MarkerPose>* markers = marker_mailbox_.GetLatest();
+  if (markers != nullptr) {
+    for (const MarkerPose& marker : *markers) {
+      marker_object_->Render(camera_.get(), marker);
     }
   }
 }
 
+void Scene::SetCameraIntrinsics(const TangoCameraIntrinsics& intrinsics) {
+  tracker_.SetCameraIntrinsics(intrinsics);
+}
+
 void Scene::DetectMarkers(const TangoImageBuffer& image_buffer,
                           const glm::mat4& world_T_camera) {
   if (!is_content_initialized_) return;
 
+  if (!tracker_.NeedsFullScan(image_buffer.timestamp) &&
+      tracker_.Track(image_buffer, world_T_camera, &tracked_markers_)) {
+    for (const MarkerTracker::TrackedMarker& tracked : tracked_markers_) {
+      UpdateMarker(tracked.id, tracked.marker);
+    }
+    PublishMarkers();
+    return;
+  }
+
   double translation[3];
   double orientation[4];
   DecomposeMatrix(world_T_camera, translation, orientation);
@@ -152,25 +167,49 @@ void Scene::DetectMarkers(const TangoImageBuffer& image_buffer,
   if (TANGO_SUCCESS ==
       TangoMarkers_detectMarkers(&image_buffer, TANGO_CAMERA_COLOR, translation,
                                  orientation, &param, &list)) {
-    // Lock objects_ during updating.
-    std::lock_guard<std::mutex> lock(objects_mutex_);
-
+    tracker_.ClearTracks(image_buffer.timestamp);
     for (int i = 0; i < list.marker_count; ++i) {
       int marker_id = atoi(list.markers[i].content);
       if (marker_id >= 0 && marker_id <= kMaxMarkerId) {
         // Reposition the object to the newly calculated location and apply
         // the marker orientation as the rotation.
-        objects_[marker_id]->Update(list.markers[i]);
+        UpdateMarker(marker_id, list.markers[i]);
+        tracker_.AddTrack(marker_id, list.markers[i]);
       } else {
         LOGE("Marker id is out of range!");
       }
     }
 
+    PublishMarkers();
+
     // Release memory allocated by TangoMarkers_detectMarkers().
     TangoMarkers_freeMarkerList(&list);
   }
 }
 
+void Scene::UpdateMarker(int marker_id, const TangoMarkers_Marker& marker) {
+  int& index = detected_marker_indices_[marker_id];
+  if (index < 0) {
+    index = static_cast<int>(detected_markers_.size());
+    detected_markers_.push_back(MarkerPose());
+    detected_markers_.back().id = marker_id;
+  }
+
+  MarkerPose& pose = detected_markers_[index];
+  pose.world_T_local = tango_gl::conversions::TransformFromArrays(
+      marker.translation, marker.orientation);
+  for (int i = 0; i < 4; ++i) {
+    pose.corners[i] = glm::vec3(marker.corners_3d[i][0],
+                                marker.corners_3d[i][1],
+                                marker.corners_3d[i][2]);
+  }
+}
+
+void Scene::PublishMarkers() {
+  *marker_mailbox_.GetBackBuffer() = detected_markers_;
+  marker_mailbox_.Publish();
+}
+
 void Scene::SetVideoOverlayRotation(int display_rotation) {
   if (is_content_initialized_) {
     video_overlay_->SetDisplayRotation(
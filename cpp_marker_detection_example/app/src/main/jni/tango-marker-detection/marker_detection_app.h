@@ -18,12 +18,18 @@
 #define CPP_MARKER_DETECTION_EXAMPLE_TANGO_MARKER_DETECTION_MARKER_DETECTION_APP_H_
 
 #include <atomic>
+#include <condition_variable>
 #include <jni.h>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 
 #include <tango_client_api.h>
 #include <tango-gl/util.h>
+#include <tango-perception/frame_quality.h>
+#include <tango-perception/image_pyramid.h>
+#include <tango-perception/sensor_mailboxes.h>
 
 #include <tango-marker-detection/scene.h>
 
@@ -123,6 +129,10 @@ class MarkerDetectionApp {
   // Setup image buffer manager.
   TangoErrorType SetupImageBufferManager();
 
+  // Limit the copies of image_buffer_manager_ to the union of the regions
+  // declared in image_regions_. Called on the frame callback thread.
+  void UpdateImageBufferCopyRegion(uint32_t height);
+
   // Get the transformation matrix of the virtual AR camera
   // @param timestamp the timestamp.
   // @param display_rotation the Android display rotation.
@@ -139,13 +149,40 @@ class MarkerDetectionApp {
   TangoErrorType GetColorCameraExtrinsics(double timestamp,
                                           glm::mat4* camera_extrinsics_matrix);
 
-  // Detect marker in a secondary thread.
+  // Request marker detection on the latest camera image from the marker
+  // detection thread.
   // @param timestamp timestamp of the current video overlay image.
   void DetectMarkers(double timestamp);
 
+  // Start and stop the marker detection thread. A stopped thread has
+  // finished any detection it was running.
+  void StartMarkerDetectionThread();
+  void StopMarkerDetectionThread();
+
+  // Loop of the marker detection thread.
+  void MarkerDetectionThread();
+
+  // Run marker detection on the latest camera image.
+  // @return false if no detection ran, e.g. for a blurred image.
+  bool DetectMarkersInLatestImage();
+
+  // Score a camera image with frame_quality_scorer_. Blurred images are not
+  // worth a detection pass. Called on the marker detection thread.
+  // @param image_buffer the camera image.
+  // @param world_T_camera the color camera extrinsics at the image timestamp.
+  bool IsFrameUsable(const TangoImageBuffer& image_buffer,
+                     const glm::mat4& world_T_camera);
+
   // A manger to keep track of the camera image.
   TangoSupport_ImageBufferManager* image_buffer_manager_;
 
+  // Rows of the camera image that the consumers of image_buffer_manager_
+  // need, and the copy region last applied to it by the frame callback.
+  tango_perception::ImageRegions image_regions_;
+  uint32_t copy_begin_row_;
+  uint32_t copy_end_row_;
+  bool copy_chroma_;
+
   // main_scene_ includes all drawable objects.
   Scene main_scene_;
 
@@ -175,11 +212,28 @@ class MarkerDetectionApp {
   std::atomic<bool> is_gl_initialized_;
   std::atomic<bool> is_video_overlay_rotation_dirty_;
 
-  // timestamp of last marker detection.
+  // Marker detection runs on marker_detection_thread_ while the service is
+  // connected. DetectMarkers() leaves a request in a single slot that the
+  // thread serves with the latest camera image, so requests made during a
+  // detection collapse into one.
+  std::thread marker_detection_thread_;
+  std::mutex marker_detection_mutex_;
+  std::condition_variable marker_detection_requested_;
+
+  // Protected by marker_detection_mutex_.
+  bool has_marker_detection_request_;
+  bool stop_marker_detection_;
+  // timestamp of last marker detection request.
   double prev_marker_detection_timestamp_;
-
-  // Mutex to prevent re-entry of marker detection thread.
-  std::mutex marker_detection_thread_mutex_;
+  // Average detection latency in seconds, and the shortest interval between
+  // detection requests derived from it.
+  double marker_detection_latency_;
+  double marker_detection_interval_;
+
+  // Luma pyramids of the images marker detection runs on, and the quality
+  // scores computed from them. Used by the marker detection thread.
+  tango_perception::ImagePyramidCache image_pyramids_;
+  tango_perception::FrameQualityScorer frame_quality_scorer_;
 
   // The width and height of the viewport.
   int viewport_width_;
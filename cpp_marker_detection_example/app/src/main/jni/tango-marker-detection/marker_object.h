@@ -21,10 +21,19 @@
 #include <tango-gl/camera.h>
 #include <tango-gl/util.h>
 
-#include <tango_markers.h>
-
 namespace tango_marker_detection {
 
+// Pose and corners of a detected marker. A plain value, so it can be handed
+// between threads by copy.
+struct MarkerPose {
+  int id;
+  // Transformation from marker local frame to world frame.
+  glm::mat4 world_T_local;
+  // Marker corners in world frame, in the order of
+  // TangoMarkers_Marker::corners_3d.
+  glm::vec3 corners[4];
+};
+
 // Marker object renders the bounding box and the coordinate axes of the local
 // frame of a marker.
 class MarkerObject {
@@ -34,20 +43,17 @@ class MarkerObject {
   explicit MarkerObject(float marker_size);
   ~MarkerObject();
 
-  // Render the marker object.
+  // Render the marker object for one marker.
   // @param camera the camera object to setup the view matrix.
-  void Render(tango_gl::Camera* camera) const;
-
-  // Update the object with the information from a marker.
-  // @param marker a marker detected from input image.
-  void Update(const TangoMarkers_Marker& marker);
+  // @param marker the pose and corners of the marker.
+  void Render(tango_gl::Camera* camera, const MarkerPose& marker) const;
 
  protected:
-  void DrawBoundingBox(tango_gl::Camera* camera) const;
-  void DrawAxes(tango_gl::Camera* camera) const;
+  void DrawBoundingBox(tango_gl::Camera* camera,
+                       const MarkerPose& marker) const;
+  void DrawAxes(tango_gl::Camera* camera, const MarkerPose& marker) const;
 
  private:
-  bool visible_;
 
   // Shader program and variables for displaying bounding box.
   GLuint box_shader_program_;
@@ -55,9 +61,6 @@ class MarkerObject {
   GLuint box_attrib_vertices_;
   GLuint box_uniform_color_;
 
-  // Vertex array of bounding box.
-  std::vector<glm::vec3> box_vertices_;
-
   // Shader program and variables for displaying axes of marker local frame.
   GLuint axis_shader_program_;
   GLuint axis_uniform_mvp_;
@@ -67,9 +70,6 @@ class MarkerObject {
   // Vertex array and color array of axes.
   std::vector<glm::vec3> axis_vertices_;
   std::vector<glm::vec4> axis_colors_;
-
-  // Transformation from marker local frame to world frame.
-  glm::mat4 world_T_local_;
 };
 }  // namespace tango_marker_detection
 
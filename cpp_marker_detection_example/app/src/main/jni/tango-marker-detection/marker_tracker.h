@@ -0,0 +1,121 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CPP_MARKER_DETECTION_EXAMPLE_TANGO_MARKER_DETECTION_MARKER_TRACKER_H_
+#define CPP_MARKER_DETECTION_EXAMPLE_TANGO_MARKER_DETECTION_MARKER_TRACKER_H_
+
+#include <cstdint>
+#include <vector>
+
+#include <tango_client_api.h>
+#include <tango_markers.h>
+#include <tango-gl/util.h>
+#include <tango-perception/camera_projection.h>
+
+namespace tango_marker_detection {
+
+// MarkerTracker follows markers found by a full image detection from frame
+// to frame, so the full image only needs to be scanned now and then.
+//
+// For every tracked marker the corners are reprojected with the current
+// camera pose, and the marker is detected again in a padded region around
+// them. The region is copied into a small image of its own, so only its
+// pixels are searched. The detected corners are moved back to full image
+// pixels, and the marker pose is refined from them starting at the
+// predicted pose; this applies the principal point of the full image, which
+// the detector would not know about for the cropped image.
+//
+// A marker that is not found in its region, or whose corners do not fit
+// the refined pose, is dropped, and NeedsFullScan() asks for a full image
+// detection to find it again.
+//
+// The tracker is used by one thread at a time.
+class MarkerTracker {
+ public:
+  // A marker found by Track(), with its pose and corners in the world
+  // frame. The content of marker is not set.
+  struct TrackedMarker {
+    int id;
+    TangoMarkers_Marker marker;
+  };
+
+  MarkerTracker();
+
+  // Set the intrinsics of the camera the images come from.
+  void SetCameraIntrinsics(const TangoCameraIntrinsics& intrinsics);
+
+  // Whether the next detection should scan the full image: no marker is
+  // tracked, a track was lost, or the last full scan is too old to have
+  // found markers that came into view since.
+  bool NeedsFullScan(double timestamp) const;
+
+  // Replace the tracks with the markers of a full image detection. Call
+  // ClearTracks() and then AddTrack() for every marker found.
+  // @param timestamp timestamp of the image that was scanned.
+  void ClearTracks(double timestamp);
+  // @param marker a marker detected with the world frame as output frame.
+  void AddTrack(int marker_id, const TangoMarkers_Marker& marker);
+
+  // Detect the tracked markers in regions around their predicted corners.
+  // @param image_buffer the image, NV21.
+  // @param world_T_camera the transformation from camera to world frame.
+  // @param markers output, the markers that are still tracked.
+  // @return false if the image can not be tracked in, e.g. for an
+  //   unsupported format; run a full detection instead.
+  bool Track(const TangoImageBuffer& image_buffer,
+             const glm::mat4& world_T_camera,
+             std::vector<TrackedMarker>* markers);
+
+  // Drop all tracks.
+  void Reset();
+
+ private:
+  struct MarkerTrack {
+    int id;
+    glm::mat4 world_T_marker;
+    // Corners in the marker frame.
+    glm::vec3 corners[4];
+  };
+
+  // Pixel bounds of the region to search for a track in, or false if the
+  // marker is out of view.
+  bool GetRegion(const MarkerTrack& track, const glm::mat4& camera_T_world,
+                 int width, int height, int* x, int* y, int* region_width,
+                 int* region_height) const;
+
+  // Copy a region of an NV21 image into region_buffer_.
+  void CropImage(const TangoImageBuffer& image_buffer, int x, int y,
+                 int width, int height, TangoImageBuffer* region);
+
+  // Refine camera_T_marker so the corners of track project to pixels.
+  // @return false if the refined pose does not fit the pixels.
+  bool RefinePose(const MarkerTrack& track, const glm::vec2 pixels[4],
+                  glm::mat4* camera_T_marker) const;
+
+  tango_perception::CameraProjection projection_;
+
+  std::vector<MarkerTrack> tracks_;
+  bool is_track_lost_;
+  double full_scan_timestamp_;
+
+  // Cleared when the detector rejects cropped images.
+  bool is_region_detection_supported_;
+
+  std::vector<uint8_t> region_buffer_;
+};
+}  // namespace tango_marker_detection
+
+#endif  // CPP_MARKER_DETECTION_EXAMPLE_TANGO_MARKER_DETECTION_MARKER_TRACKER_H_
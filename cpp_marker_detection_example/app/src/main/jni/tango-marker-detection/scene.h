@@ -22,15 +22,17 @@
 #include <memory>
 #include <vector>
 #include <math.h>
-#include <mutex>
 
 #include <android/asset_manager.h>
 
 #include <tango_client_api.h>
+#include <tango_markers.h>
 #include <tango-gl/camera.h>
 #include <tango-gl/video_overlay.h>
+#include <tango-perception/latest_value_mailbox.h>
 
 #include <tango-marker-detection/marker_object.h>
+#include <tango-marker-detection/marker_tracker.h>
 
 namespace tango_marker_detection {
 
@@ -44,7 +46,8 @@ class Scene {
   // Allocate OpenGL resources for rendering.
   void InitGLContent(AAssetManager* aasset_manager);
 
-  // Release non-OpenGL resources.
+  // Release non-OpenGL resources and forget the detected markers. Must not
+  // run concurrently with DetectMarkers().
   void DeleteResources();
 
   // Setup GL view port.
@@ -72,25 +75,47 @@ class Scene {
   // Set video overlay's orientation based on current device orientation.
   void SetVideoOverlayRotation(int display_rotation);
 
-  // Detect markers within the input image buffer.
+  // Set the intrinsics of the camera DetectMarkers() gets images from.
+  void SetCameraIntrinsics(const TangoCameraIntrinsics& intrinsics);
+
+  // Detect markers within the input image buffer. Markers found before are
+  // tracked in regions around their predicted location, and the full image
+  // is only scanned when MarkerTracker asks for it.
   // @param image_buffer pointer to the input image buffer.
   // @param world_T_camera the transformation from camera to world frame.
   void DetectMarkers(const TangoImageBuffer& image_buffer,
                      const glm::mat4& world_T_camera);
 
  private:
+  // Store the pose of a detected marker in detected_markers_.
+  void UpdateMarker(int marker_id, const TangoMarkers_Marker& marker);
+
+  // Hand a copy of detected_markers_ to Render().
+  void PublishMarkers();
+
   // Video overlay drawable object to display the camera image.
   std::unique_ptr<tango_gl::VideoOverlay> video_overlay_;
 
   // Camera object that allows user to use touch input to interact with.
   std::unique_ptr<tango_gl::Camera> camera_;
 
-  // Marker objects.
-  std::vector<std::unique_ptr<MarkerObject>> objects_;
+  // Draws the detected markers. Only used on the GL thread.
+  std::unique_ptr<MarkerObject> marker_object_;
+
+  // Markers detected so far, and the index of every marker id in it or -1.
+  // Owned by the thread calling DetectMarkers().
+  std::vector<MarkerPose> detected_markers_;
+  std::vector<int> detected_marker_indices_;
+
+  // Hands copies of detected_markers_ to Render(). Neither side blocks the
+  // other, and Render() draws a consistent set of markers.
+  tango_perception::LatestValueMailbox<std::vector<MarkerPose>>
+      marker_mailbox_;
 
-  // Mutex for protecting mesh objects. Mesh objects are shared between the
-  // rendering thread and TangoService callback thread.
-  std::mutex objects_mutex_;
+  // Tracks markers between full image detections. Only used by
+  // DetectMarkers().
+  MarkerTracker tracker_;
+  std::vector<MarkerTracker::TrackedMarker> tracked_markers_;
 
   // Check if resources is allocated.
   std::atomic<bool> is_content_initialized_;
@@ -25,6 +25,7 @@ LOCAL_CFLAGS    := -std=c++11
 
 LOCAL_C_INCLUDES := $(PROJECT_ROOT)/tango-service-sdk/include/ \
                     $(PROJECT_ROOT)/tango_gl/include \
+                    $(PROJECT_ROOT)/tango_perception/include \
                     $(PROJECT_ROOT)/third_party/glm/ \
                     $(PROJECT_ROOT)/third_party/libpng/include/
 
@@ -41,7 +42,9 @@ LOCAL_SRC_FILES := jni_interface.cc \
                    $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/tango_gl.cc \
                    $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/transform.cc \
                    $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/texture.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/util.cc
+                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/util.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/frame_quality.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/image_pyramid.cc
 
 LOCAL_LDLIBS    := -llog -lGLESv2 -L$(SYSROOT)/usr/lib -lz -landroid
 include $(BUILD_SHARED_LIBRARY)
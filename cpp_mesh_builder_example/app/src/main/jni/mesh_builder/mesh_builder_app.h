@@ -28,6 +28,8 @@
 #include <tango-gl/util.h>
 #include <tango_3d_reconstruction_api.h>
 #include <tango_support.h>
+#include <tango-perception/frame_quality.h>
+#include <tango-perception/image_pyramid.h>
 
 #include "mesh_builder/scene.h"
 
@@ -180,6 +182,11 @@ class MeshBuilderApp {
   // thread and TangoService callback binder thread.
   std::mutex binder_mutex_;
 
+  // Luma pyramids of the color images and their quality scores, which keep
+  // blurred images out of the mesh colors. Protected by binder_mutex_.
+  tango_perception::ImagePyramidCache image_pyramids_;
+  tango_perception::FrameQualityScorer frame_quality_scorer_;
+
   // main_scene_ includes all drawable object for visualizing Tango device's
   // movement.
   Scene main_scene_;
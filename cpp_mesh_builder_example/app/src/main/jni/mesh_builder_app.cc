@@ -158,6 +158,16 @@ void MeshBuilderApp::onFrameAvailable(TangoCameraId id,
   Tango3DR_Pose t3dr_image_pose;
   extract3DRPose(image_matrix, &t3dr_image_pose);
 
+  // A blurred image would smear its colors over the mesh, so the cloud of
+  // such a frame updates the geometry only.
+  std::shared_ptr<tango_perception::ImagePyramid> pyramid =
+      image_pyramids_.Get(*buffer);
+  const bool use_color =
+      pyramid == nullptr ||
+      frame_quality_scorer_
+          .Score(*buffer, pyramid.get(), glm::quat_cast(image_matrix))
+          .is_usable;
+
   Tango3DR_PointCloud t3dr_depth;
   TangoSupport_getLatestPointCloud(point_cloud_manager_, &front_cloud_);
   t3dr_depth.timestamp = front_cloud_->timestamp;
@@ -169,8 +179,9 @@ void MeshBuilderApp::onFrameAvailable(TangoCameraId id,
 
   Tango3DR_GridIndexArray t3dr_updated;
   Tango3DR_Status t3dr_err = Tango3DR_updateFromPointCloud(
-      t3dr_context_, &t3dr_depth, &t3dr_depth_pose, &t3dr_image,
-      &t3dr_image_pose, &t3dr_updated);
+      t3dr_context_, &t3dr_depth, &t3dr_depth_pose,
+      use_color ? &t3dr_image : nullptr,
+      use_color ? &t3dr_image_pose : nullptr, &t3dr_updated);
   if (t3dr_err != TANGO_3DR_SUCCESS) {
     LOGE("MeshBuilderApp: Tango3DR_update failed with error code %d", t3dr_err);
     return;
@@ -399,6 +410,9 @@ void MeshBuilderApp::TangoConnect() {
   t3dr_intrinsics_.cy = intrinsics.cy;
   std::copy(std::begin(intrinsics.distortion), std::end(intrinsics.distortion),
             std::begin(t3dr_intrinsics_.distortion));
+
+  std::lock_guard<std::mutex> lock(binder_mutex_);
+  frame_quality_scorer_.SetCameraIntrinsics(intrinsics);
 }
 
 void MeshBuilderApp::TangoDisconnect() {
@@ -21,6 +21,7 @@ LOCAL_MODULE := libcpp_plane_fitting_example
 LOCAL_SHARED_LIBRARIES := tango_client_api tango_support
 LOCAL_CFLAGS := -std=c++11
 LOCAL_C_INCLUDES := $(PROJECT_ROOT)/tango_gl/include \
+                    $(PROJECT_ROOT)/tango_perception/include \
                     $(PROJECT_ROOT)/third_party/glm
 LOCAL_SRC_FILES := jni_interface.cc \
                    plane_fitting.cc \
@@ -36,7 +37,9 @@ LOCAL_SRC_FILES := jni_interface.cc \
                    $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/shaders.cc \
                    $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/transform.cc \
                    $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/util.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/video_overlay.cc
+                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/video_overlay.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/camera_projection.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/projected_point_grid.cc
 LOCAL_LDLIBS := -lGLESv2 -llog -L$(SYSROOT)/usr/lib
 include $(BUILD_SHARED_LIBRARY)
 
@@ -16,6 +16,7 @@
 
 #include "tango-plane-fitting/plane_fitting_application.h"
 
+#include <algorithm>
 #include <limits>
 #include <glm/gtc/matrix_access.hpp>
 #include <glm/gtx/quaternion.hpp>
@@ -33,6 +34,10 @@ namespace {
 constexpr int kTangoCoreMinimumVersion = 9377;
 constexpr float kCubeScale = 0.05f;
 
+// Radius in color camera pixels of the neighborhood of a touch that the
+// plane is fit to.
+constexpr float kPlaneFitRadius = 80.0f;
+
 const glm::mat4 kDepthTOpenGl(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f,
                               0.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
 
@@ -248,6 +253,7 @@ void PlaneFittingApplication::TangoConnect() {
         "camera.");
     std::exit(EXIT_SUCCESS);
   }
+  point_grid_.SetCameraIntrinsics(color_camera_intrinsics_);
 
   // Initialize TangoSupport context.
   TangoSupport_initialize(TangoService_getPoseAtTime,
@@ -432,12 +438,43 @@ void PlaneFittingApplication::OnTouchEvent(float x, float y) {
   double zero_vector[3] = {0.0f, 0.0f, 0.0f};
   double identity_quaternion[4] = {0.0f, 0.0f, 0.0f, 1.0f};
 
+  // Bucket a new point cloud by where its points land on the display, in the
+  // unrotated color camera turned to the display.
+  const TangoSupport_Rotation color_to_display_rotation =
+      static_cast<TangoSupport_Rotation>(
+          (static_cast<int>(display_rotation_) -
+           static_cast<int>(TangoSupport_getAndroidColorCameraRotation()) + 4) %
+          4);
+  if (!point_grid_.IsBuiltFor(point_cloud, color_to_display_rotation)) {
+    point_grid_.Build(point_cloud,
+                      glm::inverse(tango_gl::conversions::TransformFromArrays(
+                          pose_depth_T_color.translation,
+                          pose_depth_T_color.orientation)),
+                      color_to_display_rotation);
+  }
+
+  // Fit the plane to the points near the touch only, gathered from the few
+  // grid cells around it.
+  touch_point_indices_.clear();
+  point_grid_.FindInRadius(glm::value_ptr(uv), kPlaneFitRadius,
+                           &touch_point_indices_);
+  touch_points_.resize(4 * touch_point_indices_.size());
+  for (size_t i = 0; i < touch_point_indices_.size(); ++i) {
+    const float* point = point_cloud->points[touch_point_indices_[i]];
+    std::copy(point, point + 4, touch_points_.begin() + 4 * i);
+  }
+  TangoPointCloud touch_point_cloud = *point_cloud;
+  touch_point_cloud.num_points =
+      static_cast<uint32_t>(touch_point_indices_.size());
+  touch_point_cloud.points =
+      reinterpret_cast<float(*)[4]>(touch_points_.data());
+
   glm::dvec4 out_plane_model;
   glm::dvec3 out_plane_intersect;
 
   if (TangoSupport_fitPlaneModelNearPoint(
-          point_cloud, zero_vector, identity_quaternion, glm::value_ptr(uv),
-          display_rotation_, pose_depth_T_color.translation,
+          &touch_point_cloud, zero_vector, identity_quaternion,
+          glm::value_ptr(uv), display_rotation_, pose_depth_T_color.translation,
           pose_depth_T_color.orientation, glm::value_ptr(out_plane_intersect),
           glm::value_ptr(out_plane_model)) != TANGO_SUCCESS) {
     // Assuming errors have already been reported.
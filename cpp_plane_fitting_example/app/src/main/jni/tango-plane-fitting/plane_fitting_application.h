@@ -20,11 +20,13 @@
 #include <jni.h>
 
 #include <atomic>
+#include <vector>
 #include <tango_client_api.h>
 #include <tango-gl/cube.h>
 #include <tango-gl/axis.h>
 #include <tango-gl/util.h>
 #include <tango-gl/video_overlay.h>
+#include <tango-perception/projected_point_grid.h>
 
 namespace tango_plane_fitting {
 
@@ -152,6 +154,14 @@ class PlaneFittingApplication {
   // Point data manager.
   TangoSupport_PointCloudManager* point_cloud_manager_;
 
+  // The latest point cloud bucketed by display position, rebuilt on the first
+  // touch after a new cloud arrives.
+  tango_perception::ProjectedPointGrid point_grid_;
+
+  // The points near a touch, which are all the plane fit looks at.
+  std::vector<uint32_t> touch_point_indices_;
+  std::vector<float> touch_points_;
+
   // Both of these orientation is used for handling display rotation in portrait
   // or landscape.
   TangoSupport_Rotation display_rotation_;
@@ -30,11 +30,14 @@ import android.view.MotionEvent;
 import android.view.View;
 import android.view.View.OnClickListener;
 import android.view.WindowManager;
+import android.widget.Button;
 import android.widget.TextView;
 import android.widget.Toast;
 
 import com.projecttango.examples.cpp.util.TangoInitializationHelper;
 
+import java.io.File;
+
 /**
  * The main activity of the application. This activity shows debug information
  * and a glSurfaceView that renders graphic content.
@@ -71,6 +74,10 @@ public class PointcloudActivity extends Activity implements OnClickListener {
   // Handles the debug text UI update loop.
   private Handler mHandler = new Handler();
 
+  // Starts and stops recording of the point clouds.
+  private Button mRecordButton;
+  private boolean mIsRecording = false;
+
   // Tango Service connection.
   ServiceConnection mTangoServiceConnection = new ServiceConnection() {
     public void onServiceConnected(ComponentName name, IBinder service) {
@@ -100,6 +107,9 @@ public class PointcloudActivity extends Activity implements OnClickListener {
     findViewById(R.id.first_person_button).setOnClickListener(this);
     findViewById(R.id.third_person_button).setOnClickListener(this);
     findViewById(R.id.top_down_button).setOnClickListener(this);
+    mRecordButton = (Button) findViewById(R.id.record_button);
+    mRecordButton.setOnClickListener(this);
+    refreshRecordButton();
 
     // OpenGL view where all of the graphics are drawn.
     mGLView = (GLSurfaceView) findViewById(R.id.gl_surface_view);
@@ -127,6 +137,8 @@ public class PointcloudActivity extends Activity implements OnClickListener {
     super.onPause();
     mGLView.onPause();
     TangoJNINative.onPause();
+    mIsRecording = false;
+    refreshRecordButton();
 
     // Stop the debug text UI update loop.
     mHandler.removeCallbacksAndMessages(null);
@@ -146,11 +158,36 @@ public class PointcloudActivity extends Activity implements OnClickListener {
     case R.id.top_down_button:
       TangoJNINative.setCamera(2);
       break;
+    case R.id.record_button:
+      toggleRecording();
+      break;
     default:
       return;
     }
   }
 
+  private void toggleRecording() {
+    if (mIsRecording) {
+      TangoJNINative.stopRecording();
+      mIsRecording = false;
+    } else {
+      // Recordings go to the app's external files directory so they can be
+      // pulled with adb for offline processing.
+      File file = new File(getExternalFilesDir(null),
+                           "point_clouds_" + System.currentTimeMillis() + ".tpc");
+      mIsRecording = TangoJNINative.startRecording(file.getPath());
+      if (mIsRecording) {
+        Toast.makeText(this, file.getPath(), Toast.LENGTH_SHORT).show();
+      }
+    }
+    refreshRecordButton();
+  }
+
+  private void refreshRecordButton() {
+    int textId = mIsRecording ? R.string.stop_recording : R.string.record;
+    mRecordButton.setText(textId);
+  }
+
   @Override
   public boolean onTouchEvent(MotionEvent event) {
     // Pass the touch event to the native layer for camera control.
@@ -76,4 +76,10 @@ public class TangoJNINative {
                                          float x0, float y0, float x1, float y1);
 
   public static native void setScreenRotation(int rotationIndex);
+
+  // Start recording point clouds to the given file, returns false on failure.
+  public static native boolean startRecording(String path);
+
+  // Finish the current recording.
+  public static native void stopRecording();
 }
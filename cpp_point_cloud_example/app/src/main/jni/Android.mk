@@ -24,6 +24,7 @@ LOCAL_CFLAGS    := -std=c++11
 
 LOCAL_C_INCLUDES := $(PROJECT_ROOT)/tango-service-sdk/include/ \
                     $(PROJECT_ROOT)/tango_gl/include \
+                    $(PROJECT_ROOT)/tango_perception/include \
                     $(PROJECT_ROOT)/third_party/glm/
 
 LOCAL_SRC_FILES := jni_interface.cc \
@@ -41,7 +42,12 @@ LOCAL_SRC_FILES := jni_interface.cc \
                    $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/shaders.cc \
                    $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/trace.cc \
                    $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/transform.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/util.cc
+                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/util.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/chunk_file.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/icp.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/point_cloud_index.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/point_cloud_recorder.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/thread_pool.cc
 
 LOCAL_LDLIBS    := -llog -lGLESv2 -L$(SYSROOT)/usr/lib
 include $(BUILD_SHARED_LIBRARY)
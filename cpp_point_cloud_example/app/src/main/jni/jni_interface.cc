@@ -83,6 +83,21 @@ Java_com_projecttango_examples_cpp_pointcloud_TangoJNINative_setScreenRotation(
     JNIEnv*, jobject, int rotation_index) {
   app.SetScreenRotation(rotation_index);
 }
+
+JNIEXPORT jboolean JNICALL
+Java_com_projecttango_examples_cpp_pointcloud_TangoJNINative_startRecording(
+    JNIEnv* env, jobject, jstring path) {
+  const char* path_chars = env->GetStringUTFChars(path, nullptr);
+  std::string path_string(path_chars);
+  env->ReleaseStringUTFChars(path, path_chars);
+  return app.StartRecording(path_string);
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_pointcloud_TangoJNINative_stopRecording(
+    JNIEnv*, jobject) {
+  app.StopRecording();
+}
 #ifdef __cplusplus
 }
 #endif
@@ -14,6 +14,9 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <cmath>
+
 #include <tango-gl/conversions.h>
 #include <tango_support.h>
 #include <tango_transform_helpers.h>
@@ -25,6 +28,10 @@ const int kVersionStringLength = 128;
 // The minimum Tango Core version required from this application.
 constexpr int kTangoCoreMinimumVersion = 9377;
 
+// Drift check corrections above these are logged, in meters and degrees.
+const float kDriftLogTranslation = 0.01f;
+const float kDriftLogRotation = 1.0f;
+
 // This function routes onPointCloudAvailable callbacks to the application
 // object for handling.
 //
@@ -42,10 +49,83 @@ void onPointCloudAvailableRouter(void* context,
 namespace tango_point_cloud {
 void PointCloudApp::onPointCloudAvailable(const TangoPointCloud* point_cloud) {
   TangoSupport_updatePointCloud(point_cloud_manager_, point_cloud);
+
+  if (point_cloud_recorder_.IsOpen()) {
+    // Record the depth camera pose so the clouds can be registered offline.
+    // Clouds without a valid pose could not be, so they are skipped.
+    TangoPoseData pose;
+    if (TangoSupport_getPoseAtTime(
+            point_cloud->timestamp, TANGO_COORDINATE_FRAME_START_OF_SERVICE,
+            TANGO_COORDINATE_FRAME_CAMERA_DEPTH, TANGO_SUPPORT_ENGINE_TANGO,
+            TANGO_SUPPORT_ENGINE_TANGO, TANGO_SUPPORT_ROTATION_IGNORED,
+            &pose) == TANGO_SUCCESS &&
+        pose.status_code == TANGO_POSE_VALID) {
+      point_cloud_recorder_.Record(point_cloud, pose);
+    }
+  }
+
+  CheckDrift(point_cloud);
+}
+
+void PointCloudApp::CheckDrift(const TangoPointCloud* point_cloud) {
+  if (!is_depth_intrinsics_valid_) {
+    return;
+  }
+
+  TangoSupport_MatrixTransformData matrix_transform;
+  TangoSupport_getMatrixTransformAtTime(
+      point_cloud->timestamp, TANGO_COORDINATE_FRAME_START_OF_SERVICE,
+      TANGO_COORDINATE_FRAME_CAMERA_DEPTH, TANGO_SUPPORT_ENGINE_TANGO,
+      TANGO_SUPPORT_ENGINE_TANGO, TANGO_SUPPORT_ROTATION_IGNORED,
+      &matrix_transform);
+  if (matrix_transform.status_code != TANGO_POSE_VALID) {
+    has_icp_target_ = false;
+    return;
+  }
+  const glm::mat4 start_service_T_depth =
+      glm::make_mat4(matrix_transform.matrix);
+
+  if (has_icp_target_) {
+    const glm::mat4 target_T_source =
+        glm::inverse(start_service_T_target_depth_) * start_service_T_depth;
+    tango_perception::PointToPlaneIcp::Result result;
+    if (icp_.Align(point_cloud, target_T_source, &result)) {
+      // The correction ICP applied on top of motion tracking.
+      const glm::mat4 correction =
+          glm::inverse(target_T_source) * result.target_T_source;
+      const float translation = glm::length(glm::vec3(correction[3]));
+      const float trace = correction[0][0] + correction[1][1] +
+                          correction[2][2];
+      const float rotation = glm::degrees(
+          std::acos(glm::clamp((trace - 1.0f) * 0.5f, -1.0f, 1.0f)));
+      ++num_drift_checks_;
+      max_drift_translation_ = std::max(max_drift_translation_, translation);
+      max_drift_rotation_ = std::max(max_drift_rotation_, rotation);
+      if (translation > kDriftLogTranslation || rotation > kDriftLogRotation) {
+        LOGI(
+            "PointCloudApp: ICP corrected motion tracking by %.1f mm and "
+            "%.2f degrees at %lf (rms %.1f mm, %d correspondences).",
+            translation * 1000.0f, rotation, point_cloud->timestamp,
+            result.rms_error * 1000.0f, result.num_correspondences);
+      }
+    }
+  }
+
+  icp_.SetTarget(point_cloud, depth_intrinsics_);
+  start_service_T_target_depth_ = start_service_T_depth;
+  has_icp_target_ = true;
 }
 
 PointCloudApp::PointCloudApp()
-    : screen_rotation_(0),
+    : point_cloud_manager_(nullptr),
+      max_point_cloud_elements_(0),
+      icp_(tango_perception::PointToPlaneIcp::Options(), &thread_pool_),
+      is_depth_intrinsics_valid_(false),
+      has_icp_target_(false),
+      num_drift_checks_(0),
+      max_drift_translation_(0.0f),
+      max_drift_rotation_(0.0f),
+      screen_rotation_(0),
       is_service_connected_(false),
       is_gl_initialized_(false) {}
 
@@ -129,15 +209,14 @@ void PointCloudApp::TangoSetupConfig() {
   }
 
   if (point_cloud_manager_ == nullptr) {
-    int32_t max_point_cloud_elements;
     ret = TangoConfig_getInt32(tango_config_, "max_point_cloud_elements",
-                               &max_point_cloud_elements);
+                               &max_point_cloud_elements_);
     if (ret != TANGO_SUCCESS) {
       LOGE("Failed to query maximum number of point cloud elements.");
       std::exit(EXIT_SUCCESS);
     }
 
-    ret = TangoSupport_createPointCloudManager(max_point_cloud_elements,
+    ret = TangoSupport_createPointCloudManager(max_point_cloud_elements_,
                                                &point_cloud_manager_);
     if (ret != TANGO_SUCCESS) {
       std::exit(EXIT_SUCCESS);
@@ -174,11 +253,37 @@ void PointCloudApp::TangoConnect() {
   // Initialize TangoSupport context.
   TangoSupport_initialize(TangoService_getPoseAtTime,
                           TangoService_getCameraIntrinsics);
+
+  // The drift check organizes each point cloud in the depth camera image.
+  err = TangoService_getCameraIntrinsics(TANGO_CAMERA_DEPTH,
+                                         &depth_intrinsics_);
+  if (err != TANGO_SUCCESS) {
+    LOGE(
+        "PointCloudApp: Failed to get the intrinsics for the depth camera, "
+        "the drift check is disabled.");
+    return;
+  }
+  is_depth_intrinsics_valid_ = true;
 }
 
 void PointCloudApp::OnPause() {
   TangoDisconnect();
+  StopRecording();
   DeleteResources();
+
+  // Callbacks are disconnected, so the drift check state is ours to reset.
+  if (num_drift_checks_ > 0) {
+    LOGI(
+        "PointCloudApp: Checked drift on %d point clouds, largest ICP "
+        "correction %.1f mm and %.2f degrees.",
+        num_drift_checks_, max_drift_translation_ * 1000.0f,
+        max_drift_rotation_);
+  }
+  is_depth_intrinsics_valid_ = false;
+  has_icp_target_ = false;
+  num_drift_checks_ = 0;
+  max_drift_translation_ = 0.0f;
+  max_drift_rotation_ = 0.0f;
 }
 
 void PointCloudApp::TangoDisconnect() {
@@ -275,4 +380,28 @@ void PointCloudApp::OnTouchEvent(int touch_count,
 void PointCloudApp::SetScreenRotation(int screen_rotation) {
   screen_rotation_ = screen_rotation;
 }
+
+bool PointCloudApp::StartRecording(const std::string& path) {
+  if (!is_service_connected_) {
+    return false;
+  }
+  if (!point_cloud_recorder_.Open(path, max_point_cloud_elements_)) {
+    LOGE("PointCloudApp: Failed to create recording %s", path.c_str());
+    return false;
+  }
+  return true;
+}
+
+void PointCloudApp::StopRecording() {
+  if (!point_cloud_recorder_.IsOpen()) {
+    return;
+  }
+  point_cloud_recorder_.Close();
+  LOGI(
+      "PointCloudApp: Recorded %u point clouds in %llu bytes, dropped %u.",
+      point_cloud_recorder_.GetNumFramesWritten(),
+      static_cast<unsigned long long>(  // NOLINT
+          point_cloud_recorder_.GetNumBytesWritten()),
+      point_cloud_recorder_.GetNumFramesDropped());
+}
 }  // namespace tango_point_cloud
@@ -25,6 +25,9 @@
 #include <tango_client_api.h>  // NOLINT
 #include <tango-gl/util.h>
 #include <tango_support.h>
+#include <tango-perception/icp.h>
+#include <tango-perception/point_cloud_recorder.h>
+#include <tango-perception/thread_pool.h>
 
 #include <tango-point-cloud/scene.h>
 
@@ -104,6 +107,17 @@ class PointCloudApp {
   //    http://developer.android.com/reference/android/view/Surface.html#TANGO_SUPPORT_ROTATION_0
   void SetScreenRotation(int rotation_index);
 
+  // Start recording incoming point clouds and their poses to a file.
+  //
+  // @param path: Path of the recording, see
+  //    tango_perception::PointCloudRecorder for the format.
+  // @return false if the service is not connected or the file could not be
+  //    created.
+  bool StartRecording(const std::string& path);
+
+  // Finish the current recording, if any.
+  void StopRecording();
+
  private:
   // Setup the configuration file for the Tango Service.
   void TangoSetupConfig();
@@ -123,9 +137,32 @@ class PointCloudApp {
   // Release all non-OpenGL allocated resources.
   void DeleteResources();
 
+  // Align point_cloud against the previous point cloud with ICP, starting
+  // from the relative pose reported by motion tracking, and log how far ICP
+  // had to move it. point_cloud becomes the target for the next check.
+  void CheckDrift(const TangoPointCloud* point_cloud);
+
   // Point data manager.
   TangoSupport_PointCloudManager* point_cloud_manager_;
 
+  // Capacity of a point cloud, queried from the config.
+  int32_t max_point_cloud_elements_;
+
+  // Writes point clouds to a file while recording.
+  tango_perception::PointCloudRecorder point_cloud_recorder_;
+
+  // Frame to frame drift check, only used on the point cloud callback
+  // thread. The depth intrinsics are written once after connecting.
+  tango_perception::ThreadPool thread_pool_;
+  tango_perception::PointToPlaneIcp icp_;
+  TangoCameraIntrinsics depth_intrinsics_;
+  std::atomic<bool> is_depth_intrinsics_valid_;
+  bool has_icp_target_;
+  glm::mat4 start_service_T_target_depth_;
+  int num_drift_checks_;
+  float max_drift_translation_;
+  float max_drift_rotation_;
+
   // main_scene_ includes all drawable object for visualizing Tango device's
   // movement and point cloud.
   Scene main_scene_;
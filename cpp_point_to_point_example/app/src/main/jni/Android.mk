@@ -18,9 +18,10 @@ PROJECT_ROOT := $(LOCAL_PATH)/$(PROJECT_ROOT_FROM_JNI)
 
 include $(CLEAR_VARS)
 LOCAL_MODULE := cpp_point_to_point_example
-LOCAL_SHARED_LIBRARIES := tango_client_api tango_depth_interpolation tango_support tango_transform_helpers
+LOCAL_SHARED_LIBRARIES := tango_client_api tango_support tango_transform_helpers
 LOCAL_CFLAGS := -std=c++11
 LOCAL_C_INCLUDES := $(PROJECT_ROOT)/tango_gl/include \
+                    $(PROJECT_ROOT)/tango_perception/include \
                     $(PROJECT_ROOT)/third_party/glm
 LOCAL_SRC_FILES := jni_interface.cc \
                    point_to_point_application.cc \
@@ -32,7 +33,16 @@ LOCAL_SRC_FILES := jni_interface.cc \
                    $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/shaders.cc \
                    $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/transform.cc \
                    $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/util.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/video_overlay.cc
+                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/video_overlay.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/camera_projection.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/depth_image_cache.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/depth_interpolator.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/depth_registration.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/depth_splatter.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/point_cloud_index.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/projected_point_grid.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/sensor_mailboxes.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/thread_pool.cc
 
 LOCAL_LDLIBS := -lGLESv2 -llog -L$(SYSROOT)/usr/lib
 include $(BUILD_SHARED_LIBRARY)
@@ -40,5 +50,4 @@ include $(BUILD_SHARED_LIBRARY)
 $(call import-add-path,$(PROJECT_ROOT))
 $(call import-module,tango_client_api)
 $(call import-module,tango_support)
-$(call import-module,tango_depth_interpolation)
 $(call import-module,tango_transform_helpers)
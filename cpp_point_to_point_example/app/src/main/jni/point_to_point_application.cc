@@ -16,6 +16,7 @@
 
 #include "tango-point-to-point/point_to_point_application.h"
 
+#include <algorithm>
 #include <cmath>
 #include <sstream>
 
@@ -32,6 +33,25 @@ namespace {
 // The minimum Tango Core version required from this application.
 constexpr int kTangoCoreMinimumVersion = 9377;
 
+// How far from a touch, in color camera pixels, a point is still picked when
+// the depth image has no depth under the touch.
+constexpr float kTouchSearchRadius = 40.0f;
+
+// Consumer index of the depth image cache in the image regions of
+// image_buffer_mailbox_.
+constexpr int kDepthImageRegionConsumer = 0;
+
+// Points of a lower confidence are not accumulated in the point index.
+constexpr float kPointIndexMinConfidence = 0.5f;
+
+// The point index starts over beyond this many points, about 32 MB.
+constexpr size_t kMaxIndexedPoints = 2000000;
+
+// A measured point is snapped to the mean of the accumulated points within
+// kSnapRadius meters, if there are at least kMinSnapNeighbors of them.
+constexpr float kSnapRadius = 0.01f;
+constexpr size_t kMinSnapNeighbors = 8;
+
 /**
  * This function will route callbacks to our application object via the context
  * parameter.
@@ -82,11 +102,11 @@ glm::mat4 ProjectionMatrixForCameraIntrinsics(
 
 void PointToPointApplication::OnPointCloudAvailable(
     const TangoPointCloud* point_cloud) {
-  TangoSupport_updatePointCloud(point_cloud_manager_, point_cloud);
+  point_cloud_mailbox_->Update(point_cloud);
 }
 
 void PointToPointApplication::OnFrameAvailable(const TangoImageBuffer* buffer) {
-  TangoSupport_updateImageBuffer(image_buffer_manager_, buffer);
+  image_buffer_mailbox_->Update(buffer);
 }
 
 PointToPointApplication::PointToPointApplication()
@@ -94,6 +114,7 @@ PointToPointApplication::PointToPointApplication()
       screen_height_(0.0f),
       last_gpu_timestamp_(0.0),
       tap_number_(0),
+      algorithm_(UpsampleAlgorithm::kNearest),
       point_modifier_flag_(true),
       measured_point0_(MeasuredPoint(glm::vec3(0.0f, 0.0f, 0.0f), 0.0)),
       measured_point1_(MeasuredPoint(glm::vec3(0.0f, 0.0f, 0.0f), 0.0)),
@@ -106,12 +127,6 @@ PointToPointApplication::PointToPointApplication()
 
 PointToPointApplication::~PointToPointApplication() {
   TangoConfig_free(tango_config_);
-  TangoSupport_freePointCloudManager(point_cloud_manager_);
-  point_cloud_manager_ = nullptr;
-  TangoDepthInterpolation_freeDepthInterpolator(interpolator_);
-  interpolator_ = nullptr;
-  TangoSupport_freeImageBufferManager(image_buffer_manager_);
-  image_buffer_manager_ = nullptr;
 }
 
 void PointToPointApplication::OnCreate(JNIEnv* env, jobject activity) {
@@ -213,7 +228,7 @@ void PointToPointApplication::TangoSetupConfig() {
 }
 
 void PointToPointApplication::TangoConnectCallbacks() {
-  if (point_cloud_manager_ == nullptr) {
+  if (!point_cloud_mailbox_) {
     int32_t max_point_cloud_elements;
     TangoErrorType ret = TangoConfig_getInt32(
         tango_config_, "max_point_cloud_elements", &max_point_cloud_elements);
@@ -224,11 +239,8 @@ void PointToPointApplication::TangoConnectCallbacks() {
       std::exit(EXIT_SUCCESS);
     }
 
-    ret = TangoSupport_createPointCloudManager(max_point_cloud_elements,
-                                               &point_cloud_manager_);
-    if (ret != TANGO_SUCCESS) {
-      std::exit(EXIT_SUCCESS);
-    }
+    point_cloud_mailbox_.reset(
+        new tango_perception::PointCloudMailbox(max_point_cloud_elements));
   }
 
   // Register for depth notification.
@@ -269,6 +281,47 @@ void PointToPointApplication::TangoConnect() {
         "camera.");
     std::exit(EXIT_SUCCESS);
   }
+  if (!depth_registration_) {
+    // The color camera is rigidly attached to the depth camera, so the pair
+    // is registered with the extrinsics at the depth timestamp.
+    depth_registration_.reset(new tango_perception::DepthRegistration(
+        color_camera_intrinsics_,
+        [](double /*color_timestamp*/, double depth_timestamp,
+           glm::mat4* color_T_depth) {
+          TangoPoseData pose_color_T_depth;
+          if (TangoSupport_getPoseAtTime(
+                  depth_timestamp, TANGO_COORDINATE_FRAME_CAMERA_COLOR,
+                  TANGO_COORDINATE_FRAME_CAMERA_DEPTH,
+                  TANGO_SUPPORT_ENGINE_TANGO, TANGO_SUPPORT_ENGINE_TANGO,
+                  TANGO_SUPPORT_ROTATION_IGNORED,
+                  &pose_color_T_depth) != TANGO_SUCCESS) {
+            LOGE(
+                "PointToPointApplication: Could not get depth camera pose "
+                "for timestamp %f.",
+                depth_timestamp);
+            return false;
+          }
+          *color_T_depth = tango_gl::conversions::TransformFromArrays(
+              pose_color_T_depth.translation, pose_color_T_depth.orientation);
+          return true;
+        },
+        &thread_pool_));
+  }
+  if (!depth_image_cache_) {
+    depth_image_cache_.reset(new tango_perception::DepthImageCache(
+        color_camera_intrinsics_, &thread_pool_));
+  }
+  point_grid_.SetCameraIntrinsics(color_camera_intrinsics_);
+
+  // The image_buffer_mailbox_ hands the latest image to the GL thread. It
+  // must exist before the frame callback is connected, so the stride is not
+  // known yet; padded frames are repacked at the width.
+  if (!image_buffer_mailbox_) {
+    image_buffer_mailbox_.reset(new tango_perception::ImageBufferMailbox(
+        TANGO_HAL_PIXEL_FORMAT_YCrCb_420_SP, color_camera_intrinsics_.width,
+        color_camera_intrinsics_.height, color_camera_intrinsics_.width));
+  }
+  UpdateImageRegion();
 
   // Register for image notification.
   ret = TangoService_connectOnFrameAvailable(TANGO_CAMERA_COLOR, this,
@@ -281,28 +334,6 @@ void PointToPointApplication::TangoConnect() {
   // Initialize TangoSupport context.
   TangoSupport_initialize(TangoService_getPoseAtTime,
                           TangoService_getCameraIntrinsics);
-
-  // The image_buffer_manager_ contains the image data and allows reading and
-  // writing of data in a thread safe way.
-  if (!image_buffer_manager_) {
-    ret = TangoSupport_createImageBufferManager(
-        TANGO_HAL_PIXEL_FORMAT_YCrCb_420_SP, color_camera_intrinsics_.width,
-        color_camera_intrinsics_.height, &image_buffer_manager_);
-
-    if (ret != TANGO_SUCCESS) {
-      LOGE("PointToPointApplication: Failed to create image buffer manager");
-      std::exit(EXIT_SUCCESS);
-    }
-  }
-
-  // The interpolator_ contains camera intrinsics and references to data buffers
-  // allowing for effective upsampling of the depth data to camera image
-  // resolution.
-  ret = TangoDepthInterpolation_createDepthInterpolator(&interpolator_);
-  if (ret != TANGO_SUCCESS) {
-    LOGE("PointToPointApplication: Failed to set up interpolator.");
-    std::exit(EXIT_SUCCESS);
-  }
 }
 
 void PointToPointApplication::OnPause() {
@@ -310,6 +341,8 @@ void PointToPointApplication::OnPause() {
   is_gl_initialized_ = false;
   TangoDisconnect();
   DeleteResources();
+  // The start of service frame of the next connection is another one.
+  point_index_.Clear();
 }
 
 void PointToPointApplication::TangoDisconnect() { TangoService_disconnect(); }
@@ -328,11 +361,21 @@ void PointToPointApplication::OnSurfaceCreated() {
 }
 
 void PointToPointApplication::SetUpsampleViaBilateralFiltering(bool on) {
-  if (on) {
-    algorithm_ = UpsampleAlgorithm::kBilateral;
+  algorithm_ = on ? UpsampleAlgorithm::kBilateral : UpsampleAlgorithm::kNearest;
+  UpdateImageRegion();
+}
+
+void PointToPointApplication::UpdateImageRegion() {
+  if (!image_buffer_mailbox_) {
     return;
   }
-  algorithm_ = UpsampleAlgorithm::kNearest;
+  // The bilateral upsampling reads the luma of the whole frame; the nearest
+  // neighbor upsampling reads no pixels, so frames are not copied at all.
+  const uint32_t rows = algorithm_ == UpsampleAlgorithm::kBilateral
+                            ? color_camera_intrinsics_.height
+                            : 0;
+  image_buffer_mailbox_->GetRegions()->Set(kDepthImageRegionConsumer, 0, rows,
+                                           false);
 }
 
 void PointToPointApplication::OnSurfaceChanged(int width, int height) {
@@ -387,6 +430,16 @@ void PointToPointApplication::OnDrawFrame() {
     return;
   }
 
+  // Register and upsample every new point cloud once, in the background.
+  bool new_point_cloud = false;
+  const TangoPointCloud* point_cloud =
+      point_cloud_mailbox_->GetLatest(&new_point_cloud);
+  if (new_point_cloud) {
+    RegisterPointCloud(point_cloud);
+    AddToPointIndex(point_cloud);
+  }
+  UpdateDepthImageCache();
+
   glEnable(GL_CULL_FACE);
 
   glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -470,80 +523,164 @@ void PointToPointApplication::OnDrawFrame() {
   }
 }
 
-void PointToPointApplication::DeleteResources() {
-  delete video_overlay_;
-  delete segment_;
-  video_overlay_ = nullptr;
-  segment_ = nullptr;
+void PointToPointApplication::RegisterPointCloud(
+    const TangoPointCloud* point_cloud) {
+  // Get the latest color image since we need it for the bilateral upsample.
+  const TangoImageBuffer* image = nullptr;
+  if (algorithm_ == UpsampleAlgorithm::kBilateral) {
+    image = image_buffer_mailbox_->GetLatest();
+    if (image == nullptr) {
+      return;
+    }
+  }
+  depth_registration_->Submit(point_cloud, image, point_cloud->timestamp);
 }
 
-// We assume the Java layer ensures this function is called on the GL thread.
-void PointToPointApplication::OnTouchEvent(float x, float y) {
-  if (!is_gl_initialized_ || !is_service_connected_) {
+void PointToPointApplication::UpdateDepthImageCache() {
+  std::shared_ptr<const tango_perception::RegisteredDepthFrame> frame =
+      depth_registration_->GetLatest();
+  // cached_depth_frame_ keeps the last frame from being recycled, so a frame
+  // at the same address is the same frame.
+  if (frame == nullptr || frame == cached_depth_frame_) {
     return;
   }
+  depth_image_cache_->Update(
+      frame, algorithm_ == UpsampleAlgorithm::kBilateral
+                 ? tango_perception::DepthImageCache::kBilateral
+                 : tango_perception::DepthImageCache::kNearestNeighbor);
+  cached_depth_frame_ = frame;
+}
 
-  // Get the latest point cloud.
-  TangoPointCloud* point_cloud = nullptr;
-  TangoSupport_getLatestPointCloud(point_cloud_manager_, &point_cloud);
+bool PointToPointApplication::FindNearestPoint(
+    const glm::vec2& uv, TangoSupport_Rotation color_to_display_rotation,
+    float point[3], double* timestamp) {
+  bool new_point_cloud = false;
+  const TangoPointCloud* point_cloud =
+      point_cloud_mailbox_->GetLatest(&new_point_cloud);
   if (point_cloud == nullptr) {
+    return false;
+  }
+  if (new_point_cloud) {
+    // Taken from under OnDrawFrame(), which would otherwise miss it.
+    RegisterPointCloud(point_cloud);
+    AddToPointIndex(point_cloud);
+  }
+
+  if (!point_grid_.IsBuiltFor(point_cloud, color_to_display_rotation)) {
+    TangoPoseData pose_color_T_depth;
+    if (TangoSupport_getPoseAtTime(
+            point_cloud->timestamp, TANGO_COORDINATE_FRAME_CAMERA_COLOR,
+            TANGO_COORDINATE_FRAME_CAMERA_DEPTH, TANGO_SUPPORT_ENGINE_TANGO,
+            TANGO_SUPPORT_ENGINE_TANGO, TANGO_SUPPORT_ROTATION_IGNORED,
+            &pose_color_T_depth) != TANGO_SUCCESS) {
+      return false;
+    }
+    point_grid_.Build(point_cloud,
+                      tango_gl::conversions::TransformFromArrays(
+                          pose_color_T_depth.translation,
+                          pose_color_T_depth.orientation),
+                      color_to_display_rotation);
+  }
+
+  uint32_t index;
+  if (!point_grid_.FindNearest(glm::value_ptr(uv), kTouchSearchRadius,
+                               &index)) {
+    return false;
+  }
+  std::copy(point_cloud->points[index], point_cloud->points[index] + 3,
+            point);
+  *timestamp = point_cloud->timestamp;
+  return true;
+}
+
+void PointToPointApplication::AddToPointIndex(
+    const TangoPointCloud* point_cloud) {
+  TangoSupport_MatrixTransformData world_T_depth;
+  TangoSupport_getMatrixTransformAtTime(
+      point_cloud->timestamp, TANGO_COORDINATE_FRAME_START_OF_SERVICE,
+      TANGO_COORDINATE_FRAME_CAMERA_DEPTH, TANGO_SUPPORT_ENGINE_TANGO,
+      TANGO_SUPPORT_ENGINE_TANGO, TANGO_SUPPORT_ROTATION_IGNORED,
+      &world_T_depth);
+  if (world_T_depth.status_code != TANGO_POSE_VALID) {
     return;
   }
-
-  // Get the latest color image since we need it for the bilateral upsample.
-  TangoImageBuffer* image = nullptr;
-  TangoSupport_getLatestImageBuffer(image_buffer_manager_, &image);
-
-  // We want to use either CPU or GPU image timestamps based on our upsampling
-  // method.
-  double color_image_timestamp = 0.0;
-  if (algorithm_ == UpsampleAlgorithm::kNearest) {
-    color_image_timestamp = last_gpu_timestamp_;  // GPU
-  } else {
-    color_image_timestamp = image->timestamp;  // CPU
+  if (point_index_.Size() > kMaxIndexedPoints) {
+    point_index_.Clear();
   }
+  point_index_.AddPointCloud(point_cloud, glm::make_mat4(world_T_depth.matrix),
+                             kPointIndexMinConfidence);
+}
 
-  // Get poses of point cloud and color camera in OpenGL world space.
-  TangoPoseData pose_depth_T_color;
-  TangoErrorType ret;
-  ret = TangoSupport_getPoseAtTime(
-      color_image_timestamp, TANGO_COORDINATE_FRAME_CAMERA_DEPTH,
-      TANGO_COORDINATE_FRAME_CAMERA_COLOR, TANGO_SUPPORT_ENGINE_TANGO,
+bool PointToPointApplication::SnapToPointIndex(double timestamp,
+                                               glm::vec3* point_depth) {
+  TangoSupport_MatrixTransformData world_T_depth_transform;
+  TangoSupport_getMatrixTransformAtTime(
+      timestamp, TANGO_COORDINATE_FRAME_START_OF_SERVICE,
+      TANGO_COORDINATE_FRAME_CAMERA_DEPTH, TANGO_SUPPORT_ENGINE_TANGO,
       TANGO_SUPPORT_ENGINE_TANGO, TANGO_SUPPORT_ROTATION_IGNORED,
-      &pose_depth_T_color);
-  if (ret != TANGO_SUCCESS) {
-    LOGE(
-        "PointToPointApplication::%s: Count not get color camera pose for "
-        "timestamp %f.",
-        __func__, color_image_timestamp);
+      &world_T_depth_transform);
+  if (world_T_depth_transform.status_code != TANGO_POSE_VALID) {
+    return false;
+  }
+  const glm::mat4 world_T_depth =
+      glm::make_mat4(world_T_depth_transform.matrix);
+  const glm::vec3 point_world =
+      glm::vec3(world_T_depth * glm::vec4(*point_depth, 1.0f));
+  point_index_.FindInRadius(point_world, kSnapRadius, &snap_neighbors_);
+  if (snap_neighbors_.size() < kMinSnapNeighbors) {
+    return false;
+  }
+
+  glm::vec3 sum(0.0f);
+  for (const tango_perception::Neighbor& neighbor : snap_neighbors_) {
+    sum += glm::vec3(neighbor.point);
+  }
+  const glm::vec3 mean = sum / static_cast<float>(snap_neighbors_.size());
+  *point_depth = glm::vec3(glm::inverse(world_T_depth) * glm::vec4(mean, 1.0f));
+  return true;
+}
+
+void PointToPointApplication::DeleteResources() {
+  delete video_overlay_;
+  delete segment_;
+  video_overlay_ = nullptr;
+  segment_ = nullptr;
+}
+
+// We assume the Java layer ensures this function is called on the GL thread.
+void PointToPointApplication::OnTouchEvent(float x, float y) {
+  if (!is_gl_initialized_ || !is_service_connected_) {
     return;
   }
 
-  // Get the point, in OpenGL world space, near the user's click.
-  // - Result coordinate is in OpenGL world space due to base engine choice
-  //   above.
-  glm::vec2 uv = glm::vec2(x / screen_width_, y / screen_height_);
-  double zero_vector[3] = {0.0f, 0.0f, 0.0f};
-  double identity_quaternion[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+  // The depth image cache works in the unrotated color camera, so it needs
+  // the rotation from it to the display rather than the display rotation.
+  const TangoSupport_Rotation color_to_display_rotation =
+      static_cast<TangoSupport_Rotation>(
+          (static_cast<int>(display_rotation_) -
+           static_cast<int>(TangoSupport_getAndroidColorCameraRotation()) + 4) %
+          4);
 
+  // Look up the point under the user's click, in the depth camera frame at
+  // the time of the point cloud.
+  glm::vec2 uv = glm::vec2(x / screen_width_, y / screen_height_);
   float point_depth[3] = {0.0f, 0.0f, 0.0f};
-  if (algorithm_ == UpsampleAlgorithm::kNearest) {
-    ret = TangoDepthInterpolation_getDepthAtPointNearestNeighbor(
-        point_cloud, zero_vector, identity_quaternion, glm::value_ptr(uv),
-        display_rotation_, pose_depth_T_color.translation,
-        pose_depth_T_color.orientation, point_depth);
-  } else {
-    ret = TangoDepthInterpolation_getDepthAtPointBilateral(
-        interpolator_, point_cloud, zero_vector, identity_quaternion, image,
-        glm::value_ptr(uv), display_rotation_, pose_depth_T_color.translation,
-        pose_depth_T_color.orientation, point_depth);
+  double point_cloud_timestamp = 0.0;
+  UpdateDepthImageCache();
+  bool found = depth_image_cache_->GetPointAt(
+      glm::value_ptr(uv), color_to_display_rotation, point_depth,
+      &point_cloud_timestamp);
+  if (!found) {
+    found = FindNearestPoint(uv, color_to_display_rotation, point_depth,
+                             &point_cloud_timestamp);
   }
 
   // If we found a point, send it to update measured list.
-  if (ret == TANGO_SUCCESS) {
-    const glm::vec3 point_depth_vec =
+  if (found) {
+    glm::vec3 point_depth_vec =
         glm::vec3(point_depth[0], point_depth[1], point_depth[2]);
-    UpdateMeasuredPoints(point_depth_vec, color_image_timestamp);
+    SnapToPointIndex(point_cloud_timestamp, &point_depth_vec);
+    UpdateMeasuredPoints(point_depth_vec, point_cloud_timestamp);
   } else {
     LOGE("PointToPointApplication::%s: No depth for this point.", __func__);
   }
@@ -26,11 +26,16 @@
 
 #include <tango_client_api.h>
 #include <tango_support.h>
-#include <tango_depth_interpolation.h>
 #include <tango-gl/line.h>
 #include <tango-gl/segment_drawable.h>
 #include <tango-gl/util.h>
 #include <tango-gl/video_overlay.h>
+#include <tango-perception/depth_image_cache.h>
+#include <tango-perception/depth_registration.h>
+#include <tango-perception/point_cloud_index.h>
+#include <tango-perception/projected_point_grid.h>
+#include <tango-perception/sensor_mailboxes.h>
+#include <tango-perception/thread_pool.h>
 
 namespace tango_point_to_point {
 
@@ -151,6 +156,33 @@ class PointToPointApplication {
   // Set view port and projection matrix. This must be called in the GL thread.
   void SetViewportAndProjectionGLThread();
 
+  // Declare the rows of color frames the upsampling algorithm reads to
+  // image_buffer_mailbox_, which copies only those.
+  void UpdateImageRegion();
+
+  // Queue a new point cloud for registration to the color camera. This must
+  // be called in the GL thread.
+  void RegisterPointCloud(const TangoPointCloud* point_cloud);
+
+  // Queue the latest registered frame for upsampling into depth_image_cache_
+  // if it has not been yet. This must be called in the GL thread.
+  void UpdateDepthImageCache();
+
+  // Find the point of the latest point cloud nearest to a display uv
+  // coordinate with point_grid_. This must be called in the GL thread.
+  bool FindNearestPoint(const glm::vec2& uv,
+                        TangoSupport_Rotation color_to_display_rotation,
+                        float point[3], double* timestamp);
+
+  // Add a new point cloud to point_index_ in the start of service frame.
+  // This must be called in the GL thread.
+  void AddToPointIndex(const TangoPointCloud* point_cloud);
+
+  // Move a measured point, in the depth camera frame at timestamp, to the
+  // mean of the accumulated points around it. Returns false, leaving the
+  // point as it is, if too few points were accumulated there.
+  bool SnapToPointIndex(double timestamp, glm::vec3* point_depth);
+
   TangoConfig tango_config_;
   TangoCameraIntrinsics color_camera_intrinsics_;
 
@@ -167,14 +199,34 @@ class PointToPointApplication {
   // OpenGL projection matrix.
   glm::mat4 projection_matrix_ar_;
 
-  // Point data manager.
-  TangoSupport_PointCloudManager* point_cloud_manager_;
+  // Latest point cloud, handed from the depth callback to the GL thread.
+  std::unique_ptr<tango_perception::PointCloudMailbox> point_cloud_mailbox_;
+
+  // Latest color image, handed from the frame callback to the GL thread.
+  std::unique_ptr<tango_perception::ImageBufferMailbox> image_buffer_mailbox_;
+
+  // Runs the parallel loops of the depth processing below.
+  tango_perception::ThreadPool thread_pool_;
+
+  // Every point cloud projected once into the color camera.
+  std::unique_ptr<tango_perception::DepthRegistration> depth_registration_;
+
+  // Every registered frame upsampled once into a depth image of the color
+  // camera, so that a touch only reads a pixel.
+  std::unique_ptr<tango_perception::DepthImageCache> depth_image_cache_;
+  std::shared_ptr<const tango_perception::RegisteredDepthFrame>
+      cached_depth_frame_;
 
-  // Image data manager.
-  TangoSupport_ImageBufferManager* image_buffer_manager_;
+  // The latest point cloud bucketed by display position, for touches the
+  // depth image has no depth for. Rebuilt on the first such touch after a new
+  // cloud arrives.
+  tango_perception::ProjectedPointGrid point_grid_;
 
-  // The depth interpolator class.
-  TangoDepthInterpolation_Interpolator* interpolator_;
+  // Every point cloud since connecting, in the start of service frame. A
+  // single depth sample is noisy by about a centimeter; a measured point is
+  // snapped to the mean of the samples of all clouds around it.
+  tango_perception::PointCloudIndex point_index_;
+  std::vector<tango_perception::Neighbor> snap_neighbors_;
 
   // To keep track of when segment can be rendered.
   int tap_number_;
@@ -29,12 +29,14 @@ import android.util.Log;
 import android.view.Display;
 import android.view.View;
 import android.view.WindowManager;
+import android.widget.Button;
 import android.widget.CheckBox;
 import android.widget.CompoundButton;
 import android.widget.SeekBar;
 import android.widget.Toast;
 
 import com.projecttango.examples.cpp.util.TangoInitializationHelper;
+import java.io.File;
 
 /**
  * Activity that load up the main screen of the app, this is the launcher activity.
@@ -54,6 +56,13 @@ public class MainActivity extends Activity {
   private SeekBar mDepthOverlaySeekbar;
   private CheckBox mdebugOverlayCheckbox;
   private CheckBox mGPUUpsampleCheckbox;
+  private CheckBox mGuidedUpsampleCheckbox;
+  private CheckBox mFillHolesCheckbox;
+  private CheckBox mTemporalFusionCheckbox;
+
+  // Starts and stops recording of the registered depth.
+  private Button mRecordButton;
+  private boolean mIsRecording = false;
 
     
   // Tango Service connection.
@@ -107,6 +116,27 @@ public class MainActivity extends Activity {
     }
   }
 
+  private class GuidedUpsampleListener implements CheckBox.OnCheckedChangeListener {
+    @Override
+    public void onCheckedChanged(CompoundButton buttonView, boolean isChecked) {
+      TangoJNINative.setGuidedUpsample(isChecked);
+    }
+  }
+
+  private class FillHolesListener implements CheckBox.OnCheckedChangeListener {
+    @Override
+    public void onCheckedChanged(CompoundButton buttonView, boolean isChecked) {
+      TangoJNINative.setFillHoles(isChecked);
+    }
+  }
+
+  private class TemporalFusionListener implements CheckBox.OnCheckedChangeListener {
+    @Override
+    public void onCheckedChanged(CompoundButton buttonView, boolean isChecked) {
+      TangoJNINative.setTemporalFusion(isChecked);
+    }
+  }
+
   @Override
   protected void onCreate(Bundle savedInstanceState) {
     super.onCreate(savedInstanceState);
@@ -150,6 +180,24 @@ public class MainActivity extends Activity {
     mGPUUpsampleCheckbox = (CheckBox) findViewById(R.id.gpu_upsample_checkbox);
     mGPUUpsampleCheckbox.setOnCheckedChangeListener(new GPUUpsampleListener());
 
+    mGuidedUpsampleCheckbox = (CheckBox) findViewById(R.id.guided_upsample_checkbox);
+    mGuidedUpsampleCheckbox.setOnCheckedChangeListener(new GuidedUpsampleListener());
+
+    mFillHolesCheckbox = (CheckBox) findViewById(R.id.fill_holes_checkbox);
+    mFillHolesCheckbox.setOnCheckedChangeListener(new FillHolesListener());
+
+    mTemporalFusionCheckbox = (CheckBox) findViewById(R.id.temporal_fusion_checkbox);
+    mTemporalFusionCheckbox.setOnCheckedChangeListener(new TemporalFusionListener());
+
+    mRecordButton = (Button) findViewById(R.id.record_button);
+    mRecordButton.setOnClickListener(new View.OnClickListener() {
+      @Override
+      public void onClick(View v) {
+        toggleRecording();
+      }
+    });
+    refreshRecordButton();
+
     // OpenGL view where all of the graphics are drawn
     mGLView = (GLSurfaceView) findViewById(R.id.gl_surface_view);
 
@@ -175,9 +223,33 @@ public class MainActivity extends Activity {
     super.onPause();
     mGLView.onPause();
     TangoJNINative.onPause();
+    mIsRecording = false;
+    refreshRecordButton();
     unbindService(mTangoServiceConnection);
   }
 
+  private void toggleRecording() {
+    if (mIsRecording) {
+      TangoJNINative.stopRecording();
+      mIsRecording = false;
+    } else {
+      // Recordings go to the app's external files directory so they can be
+      // pulled with adb for offline processing.
+      File file = new File(getExternalFilesDir(null),
+                           "depth_" + System.currentTimeMillis() + ".tdi");
+      mIsRecording = TangoJNINative.startRecording(file.getPath());
+      if (mIsRecording) {
+        Toast.makeText(this, file.getPath(), Toast.LENGTH_SHORT).show();
+      }
+    }
+    refreshRecordButton();
+  }
+
+  private void refreshRecordButton() {
+    int textId = mIsRecording ? R.string.stop_recording : R.string.record;
+    mRecordButton.setText(textId);
+  }
+
   public void surfaceCreated() {
     TangoJNINative.onGlSurfaceCreated();
   }
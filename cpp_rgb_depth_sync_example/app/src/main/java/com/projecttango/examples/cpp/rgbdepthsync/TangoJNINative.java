@@ -65,5 +65,18 @@ public class TangoJNINative {
 
   public static native void setGPUUpsample(boolean on);
 
+  public static native void setGuidedUpsample(boolean on);
+
+  public static native void setFillHoles(boolean on);
+
+  public static native void setTemporalFusion(boolean on);
+
+  // Start recording registered depth to the given file, returns false on
+  // failure.
+  public static native boolean startRecording(String path);
+
+  // Finish the current recording.
+  public static native void stopRecording();
+
   public static native void onDisplayChanged(int displayRotation, int colorCameraRotation);
 }
@@ -26,6 +26,7 @@ LOCAL_CFLAGS    := -std=c++11
 
 LOCAL_C_INCLUDES := $(PROJECT_ROOT)/tango-service-sdk/include/ \
                     $(PROJECT_ROOT)/tango_gl/include \
+                    $(PROJECT_ROOT)/tango_perception/include \
                     $(PROJECT_ROOT)/third_party/glm/
 
 LOCAL_SRC_FILES := camera_texture_drawable.cc \
@@ -47,7 +48,18 @@ LOCAL_SRC_FILES := camera_texture_drawable.cc \
                    $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/shaders.cc \
                    $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/trace.cc \
                    $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/transform.cc \
-                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/util.cc
+                   $(PROJECT_ROOT_FROM_JNI)/tango_gl/src/util.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/camera_projection.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/chunk_file.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/depth_image_recorder.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/depth_registration.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/depth_splatter.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/guided_depth_upsampler.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/push_pull_hole_filler.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/rvl_codec.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/sensor_mailboxes.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/temporal_depth_fusion.cc \
+                   $(PROJECT_ROOT_FROM_JNI)/tango_perception/src/thread_pool.cc
 
 LOCAL_LDLIBS    := -llog -lGLESv2 -L$(SYSROOT)/usr/lib
 include $(BUILD_SHARED_LIBRARY)
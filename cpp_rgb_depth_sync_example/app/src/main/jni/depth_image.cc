@@ -20,20 +20,46 @@
 #include "rgb-depth-sync/depth_image.h"
 
 namespace {
+// Number of entries of the radial distortion table in the vertex shader.
+// Vertex shaders may index uniform arrays dynamically, and 32 entries keep
+// the interpolation error of the color camera models well below a pixel.
+// Must match the array size and the last index in kPointCloudVertexShader.
+const int kShaderDistortionTableSize = 32;
+
+// The point is moved to the color camera, distorted with the table from
+// tango_perception::CameraProjection, and then projected with the pinhole
+// projection matrix. The distortion keeps the depth of the point, so the
+// depth test still works on the undistorted z.
 const std::string kPointCloudVertexShader =
-    "precision mediump float;\n"
+    "precision highp float;\n"
     "\n"
     "attribute vec4 vertex;\n"
     "\n"
-    "uniform mat4 mvp;\n"
+    "uniform mat4 color_T_depth;\n"
+    "uniform mat4 projection;\n"
     "uniform float maxdepth;\n"
     "uniform float pointsize;\n"
+    "uniform float distortion_scale[32];\n"
+    "uniform float distortion_index_scale;\n"
+    "uniform vec2 tangential;\n"
     "\n"
     "varying vec4 v_color;\n"
     "\n"
     "void main() {\n"
     "  gl_PointSize = pointsize;\n"
-    "  gl_Position = mvp*vertex;\n"
+    "  vec4 point = color_T_depth * vertex;\n"
+    "  vec2 n = point.xy / max(point.z, 1e-4);\n"
+    "  float r2 = dot(n, n);\n"
+    "  float position = min(r2 * distortion_index_scale, 30.999);\n"
+    "  int index = int(position);\n"
+    "  float scale = mix(distortion_scale[index],\n"
+    "                    distortion_scale[index + 1],\n"
+    "                    position - float(index));\n"
+    "  float xy = 2.0 * n.x * n.y;\n"
+    "  vec2 distorted = n * scale +\n"
+    "      vec2(tangential.x * xy + tangential.y * (r2 + 2.0 * n.x * n.x),\n"
+    "           tangential.y * xy + tangential.x * (r2 + 2.0 * n.y * n.y));\n"
+    "  gl_Position = projection * vec4(distorted * point.z, point.z, 1.0);\n"
     "  float depth = clamp(vertex.z / maxdepth, 0.0, 1.0);\n"
     "  v_color = vec4(depth, depth, depth, 1.0);\n"
     "}\n";
@@ -48,17 +74,22 @@ const std::string kPointCloudFragmentShader =
 
 namespace rgb_depth_sync {
 
-DepthImage::DepthImage()
+DepthImage::DepthImage(tango_perception::ThreadPool* thread_pool)
     : texture_id_(0),
       cpu_texture_id_(0),
       gpu_texture_id_(0),
-      depth_map_buffer_(0),
+      depth_splatter_(thread_pool),
+      guided_upsampler_(thread_pool),
+      hole_filler_(thread_pool),
+      grayscale_is_dense_(false),
+      intrinsics_changed_(false),
       grayscale_display_buffer_(0),
       texture_render_program_(0),
       fbo_handle_(0),
       vertex_buffer_handle_(0),
       vertices_handle_(0),
-      mvp_handle_(0) {}
+      color_T_depth_handle_(0),
+      projection_handle_(0) {}
 
 DepthImage::~DepthImage() {}
 
@@ -71,7 +102,8 @@ void DepthImage::InitializeGL() {
   fbo_handle_ = 0;
   vertex_buffer_handle_ = 0;
   vertices_handle_ = 0;
-  mvp_handle_ = 0;
+  color_T_depth_handle_ = 0;
+  projection_handle_ = 0;
 }
 
 bool DepthImage::CreateOrBindGPUTexture() {
@@ -83,7 +115,10 @@ bool DepthImage::CreateOrBindGPUTexture() {
     texture_render_program_ = tango_gl::util::CreateProgram(
         kPointCloudVertexShader.c_str(), kPointCloudFragmentShader.c_str());
 
-    mvp_handle_ = glGetUniformLocation(texture_render_program_, "mvp");
+    color_T_depth_handle_ =
+        glGetUniformLocation(texture_render_program_, "color_T_depth");
+    projection_handle_ =
+        glGetUniformLocation(texture_render_program_, "projection");
 
     glUseProgram(texture_render_program_);
     // Assume these are constant for the life the program
@@ -117,6 +152,24 @@ bool DepthImage::CreateOrBindGPUTexture() {
   }
 }
 
+void DepthImage::SetDistortionUniforms() {
+  const tango_perception::CameraProjection& camera_projection =
+      depth_splatter_.GetCameraProjection();
+  std::vector<float> distortion_table;
+  float distortion_index_scale;
+  camera_projection.GetDistortionTable(kShaderDistortionTableSize,
+                                       &distortion_table,
+                                       &distortion_index_scale);
+  glUniform1fv(
+      glGetUniformLocation(texture_render_program_, "distortion_scale"),
+      kShaderDistortionTableSize, distortion_table.data());
+  glUniform1f(
+      glGetUniformLocation(texture_render_program_, "distortion_index_scale"),
+      distortion_index_scale);
+  glUniform2f(glGetUniformLocation(texture_render_program_, "tangential"),
+              camera_projection.GetP1(), camera_projection.GetP2());
+}
+
 bool DepthImage::CreateOrBindCPUTexture() {
   if (cpu_texture_id_) {
     glActiveTexture(GL_TEXTURE0);
@@ -139,7 +192,8 @@ bool DepthImage::CreateOrBindCPUTexture() {
 void DepthImage::RenderDepthToTexture(
     const glm::mat4& color_t1_T_depth_t0,
     const TangoPointCloud* render_point_cloud_buffer, bool new_points) {
-  new_points = this->CreateOrBindGPUTexture() || new_points;
+  const bool is_new_program = this->CreateOrBindGPUTexture();
+  new_points = is_new_program || new_points;
 
   glViewport(0, 0, rgb_camera_intrinsics_.width, rgb_camera_intrinsics_.height);
   glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
@@ -148,6 +202,14 @@ void DepthImage::RenderDepthToTexture(
   // Special program needed to color by z-distance
   glUseProgram(texture_render_program_);
 
+  // The lens distortion follows the intrinsics, which can be set again after
+  // the program was created. The CPU path reads them from the splatter, so
+  // both paths project with the same model.
+  const bool intrinsics_changed = intrinsics_changed_.exchange(false);
+  if (is_new_program || intrinsics_changed) {
+    SetDistortionUniforms();
+  }
+
   glDisable(GL_BLEND);
   glEnable(GL_DEPTH_TEST);
 
@@ -166,10 +228,12 @@ void DepthImage::RenderDepthToTexture(
                                  0.0f, 0.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f,
                                  1.0f);
 
-  glm::mat4 mvp_mat =
-      projection_matrix_ar_ * opengl_T_color * color_t1_T_depth_t0;
+  glm::mat4 projection_mat = projection_matrix_ar_ * opengl_T_color;
 
-  glUniformMatrix4fv(mvp_handle_, 1, GL_FALSE, glm::value_ptr(mvp_mat));
+  glUniformMatrix4fv(color_T_depth_handle_, 1, GL_FALSE,
+                     glm::value_ptr(color_t1_T_depth_t0));
+  glUniformMatrix4fv(projection_handle_, 1, GL_FALSE,
+                     glm::value_ptr(projection_mat));
 
   glEnableVertexAttribArray(vertices_handle_);
   glVertexAttribPointer(vertices_handle_, 4, GL_FLOAT, GL_FALSE, 0, nullptr);
@@ -200,58 +264,71 @@ void DepthImage::RenderDepthToTexture(
 // timestamp t0 with respect the rgb camera's frame on timestamp t1.
 void DepthImage::UpdateAndUpsampleDepth(
     const glm::mat4& color_t1_T_depth_t0,
-    const TangoPointCloud* render_point_cloud_buffer) {
-  int depth_image_width = rgb_camera_intrinsics_.width;
-  int depth_image_height = rgb_camera_intrinsics_.height;
-  int depth_image_size = depth_image_width * depth_image_height;
-
-  depth_map_buffer_.resize(depth_image_size);
-  grayscale_display_buffer_.resize(depth_image_size);
-  std::fill(depth_map_buffer_.begin(), depth_map_buffer_.end(), 0);
-  std::fill(grayscale_display_buffer_.begin(), grayscale_display_buffer_.end(),
-            0);
-
-  int point_cloud_size = render_point_cloud_buffer->num_points;
-  for (int i = 0; i < point_cloud_size; ++i) {
-    float x = render_point_cloud_buffer->points[i][0];
-    float y = render_point_cloud_buffer->points[i][1];
-    float z = render_point_cloud_buffer->points[i][2];
-
-    // depth_t0_point is the point in depth camera frame on timestamp t0.
-    // (depth image timestamp).
-    glm::vec4 depth_t0_point = glm::vec4(x, y, z, 1.0);
-
-    // color_t1_point is the point in camera frame on timestamp t1.
-    // (color image timestamp).
-    glm::vec4 color_t1_point = color_t1_T_depth_t0 * depth_t0_point;
-
-    int pixel_x, pixel_y;
-    // get the coordinate on image plane.
-    pixel_x = static_cast<int>((rgb_camera_intrinsics_.fx) *
-                                   (color_t1_point.x / color_t1_point.z) +
-                               rgb_camera_intrinsics_.cx);
-
-    pixel_y = static_cast<int>((rgb_camera_intrinsics_.fy) *
-                                   (color_t1_point.y / color_t1_point.z) +
-                               rgb_camera_intrinsics_.cy);
-
-    // Color value is the GL_LUMINANCE value used for displaying the depth
-    // image.
-    // We can query for depth value in mm from grayscale image buffer by
-    // getting a `pixel_value` at (pixel_x,pixel_y) and calculating
-    // pixel_value * (kMaxDepthDistance / USHRT_MAX)
-    float depth_value = color_t1_point.z;
-    uint8_t grayscale_value =
-        (color_t1_point.z * kMeterToMillimeter) * UCHAR_MAX / kMaxDepthDistance;
-
-    UpSampleDepthAroundPoint(grayscale_value, depth_value, pixel_x, pixel_y,
-                             &grayscale_display_buffer_, &depth_map_buffer_);
+    const TangoPointCloud* render_point_cloud_buffer,
+    const TangoImageBuffer* guide, bool fill_holes) {
+  if (guide != nullptr || fill_holes) {
+    // Every point is splatted to a single pixel and the gaps between them
+    // are filled in afterwards.
+    depth_splatter_.Splat(render_point_cloud_buffer, color_t1_T_depth_t0, 0);
+    FillSparseDepth(depth_splatter_.GetDepthImage(),
+                    guide != nullptr
+                        ? tango_perception::GetLumaPlane(*guide)
+                        : tango_perception::ImageView<const uint8_t>());
+  } else {
+    if (grayscale_is_dense_) {
+      grayscale_display_buffer_.clear();
+      grayscale_is_dense_ = false;
+    }
+
+    // Each point covers a window of (2 * kWindowSize + 1)^2 pixels, and the
+    // nearest point wins where windows overlap. Only the screen tiles touched
+    // by this or the previous point cloud are cleared and rewritten.
+    depth_splatter_.Splat(render_point_cloud_buffer, color_t1_T_depth_t0,
+                          kWindowSize);
+
+    // The GL_LUMINANCE value used for displaying the depth image is the depth
+    // scaled so that kMaxDepthDistance maps to UCHAR_MAX.
+    depth_splatter_.ConvertToGrayscale(
+        static_cast<float>(kMaxDepthDistance) / kMeterToMillimeter,
+        &grayscale_display_buffer_);
   }
+  UploadGrayscaleTexture();
+}
 
+void DepthImage::UpdateFusedDepth(
+    const std::vector<float>& sparse_depth,
+    tango_perception::ImageView<const uint8_t> guide_luma) {
+  FillSparseDepth(sparse_depth, guide_luma);
+  UploadGrayscaleTexture();
+}
+
+void DepthImage::FillSparseDepth(
+    const std::vector<float>& sparse_depth,
+    tango_perception::ImageView<const uint8_t> guide_luma) {
+  const int depth_image_width = rgb_camera_intrinsics_.width;
+  const int depth_image_height = rgb_camera_intrinsics_.height;
+  const float max_depth =
+      static_cast<float>(kMaxDepthDistance) / kMeterToMillimeter;
+
+  // With a guide the guided filter fills the gaps along the edges of the
+  // color image. Otherwise the push-pull pyramid fills them regardless of
+  // how far apart the points are, in a few linear passes.
+  if (guide_luma.IsValid() &&
+      guided_upsampler_.Upsample(guide_luma, sparse_depth, depth_image_width,
+                                 depth_image_height)) {
+    guided_upsampler_.ConvertToGrayscale(max_depth, &grayscale_display_buffer_);
+  } else {
+    hole_filler_.Fill(sparse_depth, depth_image_width, depth_image_height);
+    hole_filler_.ConvertToGrayscale(max_depth, &grayscale_display_buffer_);
+  }
+  grayscale_is_dense_ = true;
+}
+
+void DepthImage::UploadGrayscaleTexture() {
   this->CreateOrBindCPUTexture();
-  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, depth_image_width, depth_image_height,
-                  GL_LUMINANCE, GL_UNSIGNED_BYTE,
-                  grayscale_display_buffer_.data());
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, rgb_camera_intrinsics_.width,
+                  rgb_camera_intrinsics_.height, GL_LUMINANCE,
+                  GL_UNSIGNED_BYTE, grayscale_display_buffer_.data());
   tango_gl::util::CheckGlError("DepthImage glTexSubImage2D");
   glBindTexture(GL_TEXTURE_2D, 0);
 
@@ -265,31 +342,8 @@ void DepthImage::SetCameraIntrinsics(TangoCameraIntrinsics intrinsics) {
   projection_matrix_ar_ = tango_gl::Camera::ProjectionMatrixForCameraIntrinsics(
       intrinsics.width, intrinsics.height, intrinsics.fx, intrinsics.fy,
       intrinsics.cx, intrinsics.cy, kNearClip, kFarClip);
-}
-
-void DepthImage::UpSampleDepthAroundPoint(
-    uint8_t grayscale_value, float depth_value, int pixel_x, int pixel_y,
-    std::vector<uint8_t>* grayscale_buffer,
-    std::vector<float>* depth_map_buffer) {
-
-  int image_width = rgb_camera_intrinsics_.width;
-  int image_height = rgb_camera_intrinsics_.height;
-  int image_size = image_height * image_width;
-  // Set the neighbour pixels to same color.
-  for (int a = -kWindowSize; a <= kWindowSize; ++a) {
-    for (int b = -kWindowSize; b <= kWindowSize; ++b) {
-      if (pixel_x > image_width || pixel_y > image_height || pixel_x < 0 ||
-          pixel_y < 0) {
-        continue;
-      }
-      int pixel_num = (pixel_x + a) + (pixel_y + b) * image_width;
-
-      if (pixel_num > 0 && pixel_num < image_size) {
-        (*grayscale_buffer)[pixel_num] = grayscale_value;
-        (*depth_map_buffer)[pixel_num] = depth_value;
-      }
-    }
-  }
+  depth_splatter_.SetCameraIntrinsics(intrinsics);
+  intrinsics_changed_ = true;
 }
 
 }  // namespace rgb_depth_sync
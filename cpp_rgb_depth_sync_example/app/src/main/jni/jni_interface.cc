@@ -73,6 +73,39 @@ Java_com_projecttango_examples_cpp_rgbdepthsync_TangoJNINative_setGPUUpsample(
   return app.SetGPUUpsample(on);
 }
 
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_rgbdepthsync_TangoJNINative_setGuidedUpsample(
+    JNIEnv*, jobject, jboolean on) {
+  return app.SetGuidedUpsample(on);
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_rgbdepthsync_TangoJNINative_setFillHoles(
+    JNIEnv*, jobject, jboolean on) {
+  return app.SetFillHoles(on);
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_rgbdepthsync_TangoJNINative_setTemporalFusion(
+    JNIEnv*, jobject, jboolean on) {
+  return app.SetTemporalFusion(on);
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_projecttango_examples_cpp_rgbdepthsync_TangoJNINative_startRecording(
+    JNIEnv* env, jobject, jstring path) {
+  const char* path_chars = env->GetStringUTFChars(path, nullptr);
+  std::string path_string(path_chars);
+  env->ReleaseStringUTFChars(path, path_chars);
+  return app.StartRecording(path_string);
+}
+
+JNIEXPORT void JNICALL
+Java_com_projecttango_examples_cpp_rgbdepthsync_TangoJNINative_stopRecording(
+    JNIEnv*, jobject) {
+  app.StopRecording();
+}
+
 JNIEXPORT void JNICALL
 Java_com_projecttango_examples_cpp_rgbdepthsync_TangoJNINative_onDisplayChanged(
     JNIEnv*, jobject, jint display_rotation, jint color_camera_rotation) {
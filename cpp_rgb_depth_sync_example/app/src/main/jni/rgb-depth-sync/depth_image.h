@@ -19,6 +19,12 @@
 
 #include <tango_client_api.h>
 #include <tango-gl/util.h>
+#include <tango-perception/depth_splatter.h>
+#include <tango-perception/guided_depth_upsampler.h>
+#include <tango-perception/image_view.h>
+#include <tango-perception/push_pull_hole_filler.h>
+#include <tango-perception/thread_pool.h>
+#include <atomic>
 #include <thread>
 #include <mutex>
 #include <vector>
@@ -29,7 +35,8 @@ namespace rgb_depth_sync {
 // image plane.
 class DepthImage {
  public:
-  DepthImage();
+  // @param thread_pool: Runs the CPU paths, not owned.
+  explicit DepthImage(tango_perception::ThreadPool* thread_pool);
   ~DepthImage();
 
   // Invalid the GL data structures.
@@ -45,9 +52,31 @@ class DepthImage {
   //    color_t1_point = color_t1_T_depth_t0 * depth_t0_point;
   //
   // @param render_point_cloud_buffer: This contains the latest point cloud data
-  // that gets projected on to the image plane and fills up the depth_map_buffer
+  // that gets projected on to the image plane. Where the windows of several
+  // points overlap, the nearest point wins.
+  //
+  // @param guide: Optional NV21 color frame at the color timestamp t1. When
+  //    given, the projected points are filled in with a guided filter that
+  //    follows the edges of the color image instead of square windows.
+  //
+  // @param fill_holes: Without a guide, fill every hole between the projected
+  //    points with push-pull interpolation instead of square windows.
   void UpdateAndUpsampleDepth(const glm::mat4& color_t1_T_depth_t0,
-                              const TangoPointCloud* render_point_cloud_buffer);
+                              const TangoPointCloud* render_point_cloud_buffer,
+                              const TangoImageBuffer* guide = nullptr,
+                              bool fill_holes = false);
+
+  // Update the depth texture from a sparse depth image in the color camera
+  // frame, such as the fused depth of several point clouds. The gaps are
+  // always filled, along the edges of the guide if one is given and by
+  // push-pull interpolation otherwise.
+  //
+  // @param sparse_depth: Row major depth in meters, zero where unknown.
+  // @param guide_luma: Luma of the color frame matching the depth, or an
+  //    invalid view for no guide.
+  void UpdateFusedDepth(const std::vector<float>& sparse_depth,
+                        tango_perception::ImageView<const uint8_t> guide_luma =
+                            tango_perception::ImageView<const uint8_t>());
 
   // Update the depth texture by direct rendering.
   // @param  color_t1_T_depth_t0: The transformation between the color camera
@@ -71,8 +100,8 @@ class DepthImage {
   GLuint GetTextureId() const { return texture_id_; }
 
   // Set camera's intrinsics.
-  // The intrinsics are used to project the pointcloud to depth image and
-  // and undistort the image to the right size.
+  // The intrinsics, including the lens distortion, are used to project the
+  // pointcloud to depth image on both the CPU and the GPU path.
   void SetCameraIntrinsics(TangoCameraIntrinsics intrinsics);
 
  private:
@@ -81,31 +110,22 @@ class DepthImage {
   // was bound.
   bool CreateOrBindGPUTexture();
 
+  // Upload the lens distortion of the splatter's projection to the uniforms
+  // of texture_render_program_, which must be in use.
+  void SetDistortionUniforms();
+
+  // Fill the gaps of a sparse depth image into grayscale_display_buffer_.
+  void FillSparseDepth(const std::vector<float>& sparse_depth,
+                       tango_perception::ImageView<const uint8_t> guide_luma);
+
+  // Upload grayscale_display_buffer_ to the CPU texture and use it.
+  void UploadGrayscaleTexture();
+
   // Initialize the OpenGL structures needed for the CPU texture generation.
   // Returns true if the texture was created and false if an existing texture
   // was bound.
   bool CreateOrBindCPUTexture();
 
-  // This function takes care of upsampling depth around a given point by
-  // setting the same value in a bounding box. Note:This is a very rudimentary
-  // approach to upsampling depth.
-  //
-  // @param color_value: The value that needs to set for all points in a
-  // bounding box.
-  //
-  // @param pixel_x: The pixel along x axis in the grayscale_buffer around which
-  // depth needs to be upsampled.
-  //
-  // @param pixel_y: The pixel along y axis in the grayscale_buffer around which
-  // depth needs to be upsampled.
-  //
-  // @param grayscale_buffer: The image buffer in which upsampling needs to be
-  // done.
-  void UpSampleDepthAroundPoint(uint8_t color_value, float depth_value,
-                                int pixel_x, int pixel_y,
-                                std::vector<uint8_t>* grayscale_buffer,
-                                std::vector<float>* depth_map_buffer);
-
   // The defined max distance for a depth value.
   static const int kMaxDepthDistance = 4000;
 
@@ -126,7 +146,22 @@ class DepthImage {
   // The backing texture for GPU texture generation.
   GLuint gpu_texture_id_;
 
-  std::vector<float> depth_map_buffer_;
+  // Z-tested, tiled splatting of the point cloud for the CPU path.
+  tango_perception::DepthSplatter depth_splatter_;
+
+  // Edge-aware fill of the splatted points, used when a guide is given.
+  tango_perception::GuidedDepthUpsampler guided_upsampler_;
+
+  // Fill of the holes between the splatted points, used when requested.
+  tango_perception::PushPullHoleFiller hole_filler_;
+
+  // The splatter only rewrites the tiles it touched, so the display buffer
+  // has to be cleared after a dense guided or hole filled frame.
+  bool grayscale_is_dense_;
+
+  // Set by SetCameraIntrinsics(), which runs on another thread than the
+  // rendering, until the GPU path has refreshed its distortion uniforms.
+  std::atomic<bool> intrinsics_changed_;
 
   // Color map buffer is for the texture render purpose, this value is written
   // to the texture id buffer, and display as GL_LUMINANCE value.
@@ -145,7 +180,8 @@ class DepthImage {
   GLuint fbo_handle_;
   GLuint vertex_buffer_handle_;
   GLuint vertices_handle_;
-  GLuint mvp_handle_;
+  GLuint color_T_depth_handle_;
+  GLuint projection_handle_;
 };
 }  // namespace rgb_depth_sync
 
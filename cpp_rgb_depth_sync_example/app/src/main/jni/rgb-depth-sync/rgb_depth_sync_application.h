@@ -18,6 +18,9 @@
 #define CPP_RGB_DEPTH_SYNC_EXAMPLE_RGB_DEPTH_SYNC_RGB_DEPTH_SYNC_APPLICATION_H_
 
 #include <jni.h>
+#include <atomic>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include <tango_client_api.h>
@@ -27,6 +30,11 @@
 #include <rgb-depth-sync/scene.h>
 #include <rgb-depth-sync/util.h>
 #include <tango-gl/util.h>
+#include <tango-perception/depth_image_recorder.h>
+#include <tango-perception/depth_registration.h>
+#include <tango-perception/sensor_mailboxes.h>
+#include <tango-perception/temporal_depth_fusion.h>
+#include <tango-perception/thread_pool.h>
 
 namespace rgb_depth_sync {
 
@@ -90,6 +98,27 @@ class SynchronizationApplication {
   // Set whether to use GPU or CPU upsampling
   void SetGPUUpsample(bool on);
 
+  // Set whether the CPU upsampling follows the edges of the color image.
+  void SetGuidedUpsample(bool on);
+
+  // Set whether the CPU upsampling fills every hole between the points.
+  void SetFillHoles(bool on);
+
+  // Set whether the CPU upsampling fuses the last few point clouds.
+  void SetTemporalFusion(bool on);
+
+  // Start recording every point cloud, registered to the color camera, to a
+  // file.
+  //
+  // @param path: Path of the recording, see
+  //    tango_perception::DepthImageRecorder for the format.
+  // @return false if the service is not connected or the file could not be
+  //    created.
+  bool StartRecording(const std::string& path);
+
+  // Finish the current recording, if any.
+  void StopRecording();
+
   // Callback for display change event, we use this function to detect display
   // orientation change.
   //
@@ -108,6 +137,13 @@ class SynchronizationApplication {
   //
   void OnPointCloudAvailable(const TangoPointCloud* point_cloud);
 
+  // Callback for color camera frames, used as guidance for the guided
+  // upsampling.
+  //
+  // @param buffer The image returned by the service.
+  //
+  void OnFrameAvailable(const TangoImageBuffer* buffer);
+
  private:
   // Setup the configuration file for the Tango Service. .
   void TangoSetupConfig();
@@ -129,9 +165,18 @@ class SynchronizationApplication {
   // Image plane.
   void TangoSetIntrinsics();
 
+  // Queue a registered frame on depth_recorder_ unless its point cloud was
+  // already recorded.
+  void RecordRegisteredDepth(
+      const tango_perception::RegisteredDepthFrame& frame);
+
   // RGB image
   ColorImage color_image_;
 
+  // Runs the parallel loops of the depth image and the registration stage,
+  // so that they do not start a set of threads each.
+  tango_perception::ThreadPool thread_pool_;
+
   // Depth image created by projecting Point Cloud onto RGB image plane.
   DepthImage depth_image_;
 
@@ -143,11 +188,37 @@ class SynchronizationApplication {
   // this example.
   TangoConfig tango_config_;
 
-  // The point_cloud_manager allows for thread safe reading and
-  // writing of the point cloud data.
-  TangoSupport_PointCloudManager* point_cloud_manager_;
+  // Hands the latest point cloud from the callback thread to the render
+  // thread without locking or an extra copy.
+  std::unique_ptr<tango_perception::PointCloudMailbox> point_cloud_mailbox_;
+
+  // Hands the latest NV21 color frame to the render thread. Frames are only
+  // copied while guided upsampling is on.
+  std::unique_ptr<tango_perception::ImageBufferMailbox> image_buffer_mailbox_;
+
+  // The last few point clouds, reprojected into the color camera frame for
+  // temporal fusion. Only used on the GL thread.
+  std::unique_ptr<tango_perception::TemporalDepthFusion> depth_fusion_;
+
+  // Registers each point cloud to its color frame off the GL thread for the
+  // hole filled and guided modes. The last frame drawn is held so that it
+  // is only filled and uploaded once.
+  std::unique_ptr<tango_perception::DepthRegistration> depth_registration_;
+  std::shared_ptr<const tango_perception::RegisteredDepthFrame>
+      registered_frame_;
+  double last_submitted_color_timestamp_;
+
+  // Records the registered depth of each point cloud once, with the pose of
+  // the color camera it is registered to.
+  tango_perception::DepthImageRecorder depth_recorder_;
+  double last_recorded_depth_timestamp_;
+  int color_image_width_;
+  int color_image_height_;
 
   bool gpu_upsample_;
+  std::atomic<bool> guided_upsample_;
+  std::atomic<bool> fill_holes_;
+  std::atomic<bool> temporal_fusion_;
 
   bool is_service_connected_;
   bool is_gl_initialized_;
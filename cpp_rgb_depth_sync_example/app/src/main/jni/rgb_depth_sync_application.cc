@@ -20,6 +20,10 @@
 namespace {
 // The minimum Tango Core version required from this application.
 constexpr int kTangoCoreMinimumVersion = 9377;
+
+// Number of point clouds fused when temporal fusion is on. At 5 Hz this
+// spans the last 0.8 seconds.
+constexpr int kFusedPointClouds = 4;
 }  // namespace
 
 namespace rgb_depth_sync {
@@ -36,17 +40,44 @@ void OnPointCloudAvailableRouter(void* context,
   app->OnPointCloudAvailable(point_cloud);
 }
 
+// This function will route callbacks to our application object via the context
+// parameter.
+// @param context Will be a pointer to a SynchronizationApplication instance  on
+// which to call callbacks.
+// @param buffer The image buffer to pass on.
+void OnFrameAvailableRouter(void* context, TangoCameraId,
+                            const TangoImageBuffer* buffer) {
+  SynchronizationApplication* app =
+      static_cast<SynchronizationApplication*>(context);
+  app->OnFrameAvailable(buffer);
+}
+
 void SynchronizationApplication::OnPointCloudAvailable(
     const TangoPointCloud* point_cloud) {
   // We'll just update the point cloud associated with our depth image.
-  TangoSupport_updatePointCloud(point_cloud_manager_, point_cloud);
+  point_cloud_mailbox_->Update(point_cloud);
+}
+
+void SynchronizationApplication::OnFrameAvailable(
+    const TangoImageBuffer* buffer) {
+  // The frame is only needed as guidance, so skip the copy otherwise.
+  if (guided_upsample_) {
+    image_buffer_mailbox_->Update(buffer);
+  }
 }
 
 SynchronizationApplication::SynchronizationApplication()
     : color_image_(),
-      depth_image_(),
+      depth_image_(&thread_pool_),
       main_scene_(),
+      last_submitted_color_timestamp_(0.0),
+      last_recorded_depth_timestamp_(0.0),
+      color_image_width_(0),
+      color_image_height_(0),
       gpu_upsample_(false),
+      guided_upsample_(false),
+      fill_holes_(false),
+      temporal_fusion_(false),
       is_service_connected_(false),
       is_gl_initialized_(false),
       color_camera_to_display_rotation_(
@@ -56,8 +87,6 @@ SynchronizationApplication::~SynchronizationApplication() {
   if (tango_config_) {
     TangoConfig_free(tango_config_);
   }
-  TangoSupport_freePointCloudManager(point_cloud_manager_);
-  point_cloud_manager_ = nullptr;
 }
 
 void SynchronizationApplication::OnCreate(JNIEnv* env, jobject activity) {
@@ -99,6 +128,9 @@ void SynchronizationApplication::OnTangoServiceConnected(JNIEnv* env,
 void SynchronizationApplication::TangoSetupConfig() {
   SetDepthAlphaValue(0.0);
   SetGPUUpsample(false);
+  SetGuidedUpsample(false);
+  SetFillHoles(false);
+  SetTemporalFusion(false);
 
   if (tango_config_ != nullptr) {
     return;
@@ -155,9 +187,9 @@ void SynchronizationApplication::TangoSetupConfig() {
     std::exit(EXIT_SUCCESS);
   }
 
-  // Use the tango_config to set up the PointCloudManager before we connect
+  // Use the tango_config to set up the point cloud mailbox before we connect
   // the callbacks.
-  if (point_cloud_manager_ == nullptr) {
+  if (!point_cloud_mailbox_) {
     int32_t max_point_cloud_elements;
     err = TangoConfig_getInt32(tango_config_, "max_point_cloud_elements",
                                &max_point_cloud_elements);
@@ -166,11 +198,10 @@ void SynchronizationApplication::TangoSetupConfig() {
       std::exit(EXIT_SUCCESS);
     }
 
-    err = TangoSupport_createPointCloudManager(max_point_cloud_elements,
-                                               &point_cloud_manager_);
-    if (err != TANGO_SUCCESS) {
-      std::exit(EXIT_SUCCESS);
-    }
+    point_cloud_mailbox_.reset(
+        new tango_perception::PointCloudMailbox(max_point_cloud_elements));
+    depth_fusion_.reset(new tango_perception::TemporalDepthFusion(
+        kFusedPointClouds, max_point_cloud_elements));
   }
 }
 
@@ -229,12 +260,56 @@ void SynchronizationApplication::TangoSetIntrinsics() {
   }
 
   depth_image_.SetCameraIntrinsics(color_camera_intrinsics);
+  depth_fusion_->SetCameraIntrinsics(color_camera_intrinsics);
+  color_image_width_ = color_camera_intrinsics.width;
+  color_image_height_ = color_camera_intrinsics.height;
+
+  // The registration stage looks up the relative pose of each pair itself,
+  // on its worker thread.
+  registered_frame_.reset();
+  last_submitted_color_timestamp_ = 0.0;
+  depth_registration_.reset(new tango_perception::DepthRegistration(
+      color_camera_intrinsics,
+      [](double color_timestamp, double depth_timestamp,
+         glm::mat4* color_T_depth) {
+        TangoPoseData pose_color_T_depth;
+        if (TangoSupport_calculateRelativePose(
+                color_timestamp, TANGO_COORDINATE_FRAME_CAMERA_COLOR,
+                depth_timestamp, TANGO_COORDINATE_FRAME_CAMERA_DEPTH,
+                &pose_color_T_depth) != TANGO_SUCCESS) {
+          return false;
+        }
+        *color_T_depth = util::GetMatrixFromPose(&pose_color_T_depth);
+        return true;
+      },
+      &thread_pool_));
+
+  // The image_buffer_mailbox_ hands the latest color frame to the GL thread
+  // for guided upsampling. It must exist before the frame callback is
+  // connected, so the stride is not known yet; padded frames are repacked
+  // at the width.
+  if (!image_buffer_mailbox_) {
+    image_buffer_mailbox_.reset(new tango_perception::ImageBufferMailbox(
+        TANGO_HAL_PIXEL_FORMAT_YCrCb_420_SP, color_camera_intrinsics.width,
+        color_camera_intrinsics.height, color_camera_intrinsics.width));
+  }
+
+  err = TangoService_connectOnFrameAvailable(TANGO_CAMERA_COLOR, this,
+                                             OnFrameAvailableRouter);
+  if (err != TANGO_SUCCESS) {
+    LOGE(
+        "SynchronizationApplication: Failed to connect frame callback with "
+        "errorcode: %d",
+        err);
+    std::exit(EXIT_SUCCESS);
+  }
 }
 
 void SynchronizationApplication::OnPause() {
   is_gl_initialized_ = false;
   is_service_connected_ = false;
   TangoService_disconnect();
+  StopRecording();
 }
 
 void SynchronizationApplication::OnSurfaceCreated() {
@@ -261,12 +336,10 @@ void SynchronizationApplication::OnDrawFrame() {
   double color_timestamp = 0.0;
   double depth_timestamp = 0.0;
   bool new_points = false;
-  TangoPointCloud* pointcloud_buffer;
-
-  if (TangoSupport_getLatestPointCloudAndNewDataFlag(
-          point_cloud_manager_, &pointcloud_buffer, &new_points) !=
-      TANGO_SUCCESS) {
-    LOGE("SynchronizationApplication: Failed to get a point cloud.");
+  const TangoPointCloud* pointcloud_buffer =
+      point_cloud_mailbox_->GetLatest(&new_points);
+  if (pointcloud_buffer == nullptr) {
+    // No point cloud has arrived yet.
     return;
   }
   depth_timestamp = pointcloud_buffer->timestamp;
@@ -279,6 +352,17 @@ void SynchronizationApplication::OnDrawFrame() {
     return;
   }
 
+  // For guided upsampling the depth is aligned with the color frame used as
+  // guidance, which may be one frame older than the texture, so that depth
+  // edges line up with the edges of the guide.
+  const TangoImageBuffer* guide_image = nullptr;
+  if (guided_upsample_ && !gpu_upsample_) {
+    guide_image = image_buffer_mailbox_->GetLatest();
+    if (guide_image != nullptr) {
+      color_timestamp = guide_image->timestamp;
+    }
+  }
+
   // In the following code, we define t0 as the depth timestamp and t1 as the
   // color camera timestamp.
 
@@ -301,23 +385,140 @@ void SynchronizationApplication::OnDrawFrame() {
   glm::mat4 color_image_t1_T_depth_image_t0 =
       util::GetMatrixFromPose(&pose_color_image_t1_T_depth_image_t0);
 
+  // Stale clouds must not be fused after fusion is switched back on.
+  if (!temporal_fusion_ || gpu_upsample_) {
+    depth_fusion_->Clear();
+  }
+  const bool register_depth = !gpu_upsample_ && !temporal_fusion_ &&
+                              (guide_image != nullptr || fill_holes_);
+  if (!register_depth) {
+    // Other modes draw over the texture; redraw the frame on switching back.
+    registered_frame_.reset();
+  }
+
+  // While recording, every point cloud is registered whatever is displayed.
+  // A pair is only submitted once, when either its cloud or its color frame
+  // is new; the render loop usually runs faster than both.
+  std::shared_ptr<const tango_perception::RegisteredDepthFrame> frame;
+  if (register_depth || depth_recorder_.IsOpen()) {
+    if (new_points || color_timestamp != last_submitted_color_timestamp_) {
+      depth_registration_->Submit(pointcloud_buffer, guide_image,
+                                  color_timestamp);
+      last_submitted_color_timestamp_ = color_timestamp;
+    }
+    frame = depth_registration_->GetLatest();
+    if (frame != nullptr) {
+      RecordRegisteredDepth(*frame);
+    }
+  }
+
   if (gpu_upsample_) {
     depth_image_.RenderDepthToTexture(color_image_t1_T_depth_image_t0,
                                       pointcloud_buffer, new_points);
+  } else if (temporal_fusion_) {
+    // Every buffered cloud is brought into the color camera frame at t1
+    // with its own relative pose, in the same way as the latest one above.
+    depth_fusion_->AddPointCloud(pointcloud_buffer);
+    depth_fusion_->Fuse([color_timestamp](double point_cloud_timestamp,
+                                          glm::mat4* color_T_depth) {
+      TangoPoseData pose_color_T_depth;
+      if (TangoSupport_calculateRelativePose(
+              color_timestamp, TANGO_COORDINATE_FRAME_CAMERA_COLOR,
+              point_cloud_timestamp, TANGO_COORDINATE_FRAME_CAMERA_DEPTH,
+              &pose_color_T_depth) != TANGO_SUCCESS) {
+        return false;
+      }
+      *color_T_depth = util::GetMatrixFromPose(&pose_color_T_depth);
+      return true;
+    });
+    depth_image_.UpdateFusedDepth(
+        depth_fusion_->GetDepthImage(),
+        guide_image != nullptr
+            ? tango_perception::GetLumaPlane(*guide_image)
+            : tango_perception::ImageView<const uint8_t>());
+  } else if (register_depth) {
+    // Registration runs behind the render loop, so the depth shown may be a
+    // frame late, but it stays matched to the guide it was registered with.
+    if (frame != nullptr && frame != registered_frame_) {
+      depth_image_.UpdateFusedDepth(frame->depth, frame->luma);
+      registered_frame_ = frame;
+    }
   } else {
     depth_image_.UpdateAndUpsampleDepth(color_image_t1_T_depth_image_t0,
-                                        pointcloud_buffer);
+                                        pointcloud_buffer, nullptr, false);
   }
   main_scene_.Render(color_image_.GetTextureId(), depth_image_.GetTextureId(),
                      color_camera_to_display_rotation_);
 }
 
+void SynchronizationApplication::RecordRegisteredDepth(
+    const tango_perception::RegisteredDepthFrame& frame) {
+  // The same cloud is registered again to every new color frame until the
+  // next cloud arrives; only its first registration is recorded.
+  if (frame.depth_timestamp == last_recorded_depth_timestamp_ ||
+      frame.width != color_image_width_ ||
+      frame.height != color_image_height_) {
+    return;
+  }
+  // A frame without a valid camera pose is useless offline, so it is not
+  // recorded. A later registration of the same cloud is tried again.
+  TangoPoseData pose;
+  if (TangoSupport_getPoseAtTime(
+          frame.color_timestamp, TANGO_COORDINATE_FRAME_START_OF_SERVICE,
+          TANGO_COORDINATE_FRAME_CAMERA_COLOR, TANGO_SUPPORT_ENGINE_TANGO,
+          TANGO_SUPPORT_ENGINE_TANGO, TANGO_SUPPORT_ROTATION_IGNORED,
+          &pose) != TANGO_SUCCESS ||
+      pose.status_code != TANGO_POSE_VALID) {
+    return;
+  }
+  if (depth_recorder_.Record(frame.color_timestamp, frame.depth.data(),
+                             pose)) {
+    last_recorded_depth_timestamp_ = frame.depth_timestamp;
+  }
+}
+
 void SynchronizationApplication::SetDepthAlphaValue(float alpha) {
   main_scene_.SetDepthAlphaValue(alpha);
 }
 
 void SynchronizationApplication::SetGPUUpsample(bool on) { gpu_upsample_ = on; }
 
+void SynchronizationApplication::SetGuidedUpsample(bool on) {
+  guided_upsample_ = on;
+}
+
+void SynchronizationApplication::SetFillHoles(bool on) { fill_holes_ = on; }
+
+void SynchronizationApplication::SetTemporalFusion(bool on) {
+  temporal_fusion_ = on;
+}
+
+bool SynchronizationApplication::StartRecording(const std::string& path) {
+  if (!is_service_connected_) {
+    return false;
+  }
+  if (!depth_recorder_.Open(path, color_image_width_, color_image_height_)) {
+    LOGE("SynchronizationApplication: Failed to create recording %s",
+         path.c_str());
+    return false;
+  }
+  return true;
+}
+
+void SynchronizationApplication::StopRecording() {
+  if (!depth_recorder_.IsOpen()) {
+    return;
+  }
+  depth_recorder_.Close();
+  LOGI(
+      "SynchronizationApplication: Recorded %u depth images in %llu bytes, "
+      "dropped %u.",
+      depth_recorder_.GetNumFramesWritten(),
+      static_cast<unsigned long long>(  // NOLINT
+          depth_recorder_.GetNumBytesWritten()),
+      depth_recorder_.GetNumFramesDropped());
+}
+
 void SynchronizationApplication::OnDisplayChanged(int display_rotation,
                                                   int color_camera_rotation) {
   color_camera_to_display_rotation_ =
@@ -29,6 +29,7 @@ std::string GetColorVertexShader();
 std::string GetVideoOverlayVertexShader();
 std::string GetVideoOverlayFragmentShader();
 std::string GetVideoOverlayTexture2DFragmentShader();
+std::string GetVideoOverlayNv21FragmentShader();
 std::string GetShadedVertexShader();
 }  // namespace shaders
 }  // namespace tango_gl
@@ -18,6 +18,7 @@
 #define TANGO_GL_VIDEO_OVERLAY_H_
 
 #include <array>
+#include <cstdint>
 #include <tango_support.h>
 
 #include "tango-gl/drawable_object.h"
@@ -25,6 +26,11 @@
 namespace tango_gl {
 class VideoOverlay : public DrawableObject {
  public:
+  // Texture type of an overlay of NV21 frames passed to UpdateNv21Texture().
+  // The luma and chroma planes are uploaded as they are and converted to RGB
+  // in the fragment shader.
+  static constexpr GLuint kTextureNv21 = 0;
+
   VideoOverlay();
   explicit VideoOverlay(GLuint texture_type);
   explicit VideoOverlay(TangoSupport_Rotation camera_to_display_rotation);
@@ -36,6 +42,17 @@ class VideoOverlay : public DrawableObject {
   void Render(const glm::mat4& projection_mat, const glm::mat4& view_mat) const;
   GLuint GetTextureId() const { return texture_id_; }
 
+  // Upload an NV21 frame to an overlay of type kTextureNv21. The texture
+  // storage is only reallocated when the size changes.
+  //
+  // @param y_plane: Luma, height rows of stride bytes.
+  // @param vu_plane: Interleaved V and U, height / 2 rows of stride bytes.
+  // @param width: Width of the image, at most stride.
+  // @param stride: Bytes per row of both planes, even. Padded rows are
+  //    uploaded whole and cropped when rendering.
+  void UpdateNv21Texture(const uint8_t* y_plane, const uint8_t* vu_plane,
+                         int width, int height, int stride);
+
   void SetTextureOffset(float screen_width, float screen_height,
                         float image_width, float image_height);
 
@@ -46,12 +63,22 @@ class VideoOverlay : public DrawableObject {
 
   GLuint attrib_texture_coords_;
   GLuint uniform_texture_;
+
+  // The VU plane of kTextureNv21 overlays, texture_id_ holds the Y plane.
+  bool is_nv21_;
+  GLuint chroma_texture_id_;
+  GLuint uniform_chroma_texture_;
+  int nv21_stride_;
+  int nv21_height_;
   GLuint vertex_buffers_[2];
 
   std::array<GLfloat, 8> texture_coords_;
   TangoSupport_Rotation display_rotation_;
   float u_offset_;
   float v_offset_;
+  // Fraction of the texture width holding the image, less than one for
+  // padded NV21 rows.
+  float u_scale_;
 };
 }  // namespace tango_gl
 #endif  // TANGO_GL_VIDEO_OVERLAY_H_
@@ -108,6 +108,24 @@ std::string GetVideoOverlayTexture2DFragmentShader() {
          "}\n";
 }
 
+// Full range BT.601 conversion of a luma texture and a luminance alpha
+// texture holding V and U.
+std::string GetVideoOverlayNv21FragmentShader() {
+  return "precision highp float;\n"
+         "precision highp int;\n"
+         "uniform sampler2D texture;\n"
+         "uniform sampler2D chromaTexture;\n"
+         "varying vec2 f_textureCoords;\n"
+         "void main() {\n"
+         "  float y = texture2D(texture, f_textureCoords).r;\n"
+         "  vec2 vu = texture2D(chromaTexture, f_textureCoords).ra -\n"
+         "            128.0 / 255.0;\n"
+         "  gl_FragColor = vec4(y + 1.402 * vu.x,\n"
+         "                      y - 0.344136 * vu.y - 0.714136 * vu.x,\n"
+         "                      y + 1.772 * vu.y, 1.0);\n"
+         "}\n";
+}
+
 std::string GetShadedVertexShader() {
   return "attribute vec4 vertex;\n"
          "attribute vec3 normal;\n"
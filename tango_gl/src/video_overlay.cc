@@ -27,6 +27,8 @@ const GLushort kIndices[] = {0, 1, 2, 2, 1, 3};
 
 namespace tango_gl {
 
+constexpr GLuint VideoOverlay::kTextureNv21;
+
 VideoOverlay::VideoOverlay()
     : texture_type_(GL_TEXTURE_EXTERNAL_OES),
       display_rotation_(TangoSupport_Rotation::TANGO_SUPPORT_ROTATION_IGNORED),
@@ -61,10 +63,25 @@ VideoOverlay::VideoOverlay(GLuint texture_type,
 }
 
 void VideoOverlay::Initialize() {
+  u_scale_ = 1.0f;
   SetDisplayRotation(display_rotation_);
 
+  // Both planes of NV21 overlays are plain 2D textures.
+  is_nv21_ = texture_type_ == kTextureNv21;
+  if (is_nv21_) {
+    texture_type_ = GL_TEXTURE_2D;
+  }
+  chroma_texture_id_ = 0;
+  uniform_chroma_texture_ = 0;
+  nv21_stride_ = 0;
+  nv21_height_ = 0;
+
   glEnable(GL_VERTEX_PROGRAM_POINT_SIZE);
-  if (texture_type_ == GL_TEXTURE_EXTERNAL_OES) {
+  if (is_nv21_) {
+    shader_program_ = util::CreateProgram(
+        shaders::GetVideoOverlayVertexShader().c_str(),
+        shaders::GetVideoOverlayNv21FragmentShader().c_str());
+  } else if (texture_type_ == GL_TEXTURE_EXTERNAL_OES) {
     shader_program_ =
         util::CreateProgram(shaders::GetVideoOverlayVertexShader().c_str(),
                             shaders::GetVideoOverlayFragmentShader().c_str());
@@ -84,6 +101,22 @@ void VideoOverlay::Initialize() {
   glTexParameteri(texture_type_, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
   uniform_texture_ = glGetUniformLocation(shader_program_, "texture");
 
+  if (is_nv21_) {
+    // The textures are as wide as the row stride and cropped to the image
+    // by the texture coordinates, which must not wrap into the padding.
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glGenTextures(1, &chroma_texture_id_);
+    glBindTexture(GL_TEXTURE_2D, chroma_texture_id_);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    uniform_chroma_texture_ =
+        glGetUniformLocation(shader_program_, "chromaTexture");
+  }
+
   glGenBuffers(2, vertex_buffers_);
   // Allocate vertices buffer.
   glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers_[0]);
@@ -122,9 +155,61 @@ void VideoOverlay::SetDisplayRotation(TangoSupport_Rotation display_rotation) {
   if (r == TANGO_SUCCESS) {
     std::copy(std::begin(output_texture_coords),
               std::end(output_texture_coords), std::begin(texture_coords_));
+    // Crop the row padding of NV21 textures, see UpdateNv21Texture().
+    for (size_t i = 0; i < texture_coords_.size(); i += 2) {
+      texture_coords_[i] *= u_scale_;
+    }
   }
 }
 
+void VideoOverlay::UpdateNv21Texture(const uint8_t* y_plane,
+                                     const uint8_t* vu_plane, int width,
+                                     int height, int stride) {
+  if (!is_nv21_) {
+    LOGE("VideoOverlay: UpdateNv21Texture() needs a kTextureNv21 overlay.");
+    return;
+  }
+  if (stride < width || stride % 2 != 0) {
+    LOGE("VideoOverlay: Invalid NV21 row stride %d for width %d.", stride,
+         width);
+    return;
+  }
+
+  // GLES2 has no GL_UNPACK_ROW_LENGTH, so whole rows including their
+  // padding are uploaded and the texture coordinates crop the padding.
+  // Chroma rows need not be a multiple of 4 bytes.
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  const int chroma_width = stride / 2;
+  const int chroma_height = height / 2;
+  if (stride != nv21_stride_ || height != nv21_height_) {
+    glBindTexture(GL_TEXTURE_2D, texture_id_);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, stride, height, 0,
+                 GL_LUMINANCE, GL_UNSIGNED_BYTE, y_plane);
+    glBindTexture(GL_TEXTURE_2D, chroma_texture_id_);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE_ALPHA, chroma_width,
+                 chroma_height, 0, GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE,
+                 vu_plane);
+    nv21_stride_ = stride;
+    nv21_height_ = height;
+  } else {
+    glBindTexture(GL_TEXTURE_2D, texture_id_);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, stride, height, GL_LUMINANCE,
+                    GL_UNSIGNED_BYTE, y_plane);
+    glBindTexture(GL_TEXTURE_2D, chroma_texture_id_);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, chroma_width, chroma_height,
+                    GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, vu_plane);
+  }
+
+  const float u_scale = static_cast<float>(width) / stride;
+  if (u_scale != u_scale_) {
+    u_scale_ = u_scale;
+    SetDisplayRotation(display_rotation_);
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  util::CheckGlError("VideoOverlay::UpdateNv21Texture");
+}
+
 void VideoOverlay::SetTextureOffset(float screen_width, float screen_height,
                                     float image_width, float image_height) {
   if ((screen_width / screen_height > 1.0f) !=
@@ -162,6 +247,12 @@ void VideoOverlay::Render(const glm::mat4& projection_mat,
   glUniform1i(uniform_texture_, 0);
   glActiveTexture(GL_TEXTURE0);
   glBindTexture(texture_type_, texture_id_);
+  if (is_nv21_) {
+    glUniform1i(uniform_chroma_texture_, 1);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, chroma_texture_id_);
+    glActiveTexture(GL_TEXTURE0);
+  }
 
   glm::mat4 model_mat = GetTransformationMatrix();
   glm::mat4 mvp_mat = projection_mat * view_mat * model_mat;
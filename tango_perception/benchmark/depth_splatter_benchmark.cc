@@ -0,0 +1,213 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares DepthSplatter against the per point loop rgb_depth_sync used
+// before it, which wrote every window in point order and cleared the whole
+// image each frame. Both are checked against a plain z-buffer: the pixels
+// where a farther point hides a nearer one are counted as wrong. Built on
+// the host from the repository root:
+//
+//   g++ -std=c++11 -O2 -pthread -Itango_client_api/include \
+//       -Itango_perception/include -Ithird_party/glm \
+//       tango_perception/benchmark/depth_splatter_benchmark.cc \
+//       tango_perception/src/camera_projection.cc \
+//       tango_perception/src/depth_splatter.cc \
+//       tango_perception/src/thread_pool.cc -o depth_splatter_benchmark
+//
+// Usage: depth_splatter_benchmark [num_threads], by default all hardware
+// threads.
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "tango-perception/depth_splatter.h"
+
+namespace {
+
+const int kNumFrames = 30;
+const uint32_t kNumPoints = 20000;
+// The window radius of rgb_depth_sync.
+const int kWindowRadius = 7;
+const float kMaxDepth = 4.0f;
+
+typedef std::chrono::steady_clock Clock;
+
+double MillisecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+TangoCameraIntrinsics MakeIntrinsics(int width, int height) {
+  TangoCameraIntrinsics intrinsics = {};
+  intrinsics.camera_id = TANGO_CAMERA_COLOR;
+  intrinsics.calibration_type = TANGO_CALIBRATION_UNKNOWN;
+  intrinsics.width = width;
+  intrinsics.height = height;
+  intrinsics.fx = 0.9 * width;
+  intrinsics.fy = 0.9 * width;
+  intrinsics.cx = width / 2.0;
+  intrinsics.cy = height / 2.0;
+  return intrinsics;
+}
+
+// A frame of the depth camera: a back wall with boxes in front of it, so
+// that near and far points overlap once they are splatted.
+std::vector<float> MakePointCloud(std::mt19937* random) {
+  std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+  std::uniform_real_distribution<float> box_depth(0.8f, 2.5f);
+  std::vector<float> points;
+  for (uint32_t i = 0; i < kNumPoints; ++i) {
+    const float x = unit(*random) * 0.6f;
+    const float y = unit(*random) * 0.45f;
+    const float depth = (i % 3 == 0) ? box_depth(*random) : 3.0f;
+    points.push_back(x * depth);
+    points.push_back(y * depth);
+    points.push_back(depth);
+    points.push_back(1.0f);
+  }
+  return points;
+}
+
+// The loop DepthImage::UpdateAndUpsampleDepth ran before DepthSplatter.
+void OldSplat(const TangoPointCloud& point_cloud,
+              const TangoCameraIntrinsics& intrinsics,
+              std::vector<float>* depth_map, std::vector<uint8_t>* grayscale) {
+  const int width = intrinsics.width;
+  const int height = intrinsics.height;
+  const int image_size = width * height;
+  depth_map->resize(image_size);
+  grayscale->resize(image_size);
+  std::fill(depth_map->begin(), depth_map->end(), 0.0f);
+  std::fill(grayscale->begin(), grayscale->end(), 0);
+  for (uint32_t i = 0; i < point_cloud.num_points; ++i) {
+    const float* point = point_cloud.points[i];
+    const int pixel_x =
+        static_cast<int>(intrinsics.fx * (point[0] / point[2]) + intrinsics.cx);
+    const int pixel_y =
+        static_cast<int>(intrinsics.fy * (point[1] / point[2]) + intrinsics.cy);
+    const uint8_t grayscale_value = static_cast<uint8_t>(
+        std::min(point[2] / kMaxDepth, 1.0f) * UCHAR_MAX);
+    for (int a = -kWindowRadius; a <= kWindowRadius; ++a) {
+      for (int b = -kWindowRadius; b <= kWindowRadius; ++b) {
+        if (pixel_x > width || pixel_y > height || pixel_x < 0 ||
+            pixel_y < 0) {
+          continue;
+        }
+        const int pixel = (pixel_x + a) + (pixel_y + b) * width;
+        if (pixel > 0 && pixel < image_size) {
+          (*grayscale)[pixel] = grayscale_value;
+          (*depth_map)[pixel] = point[2];
+        }
+      }
+    }
+  }
+}
+
+// The nearest depth of every pixel, one point at a time.
+void ReferenceSplat(const TangoPointCloud& point_cloud,
+                    const tango_perception::CameraProjection& projection,
+                    int width, int height, std::vector<float>* depth_map) {
+  depth_map->assign(width * height, 0.0f);
+  for (uint32_t i = 0; i < point_cloud.num_points; ++i) {
+    const float* point = point_cloud.points[i];
+    glm::vec2 pixel;
+    if (!projection.Project(glm::vec3(point[0], point[1], point[2]),
+                            &pixel) ||
+        pixel.x < 0.0f || pixel.x >= width || pixel.y < 0.0f ||
+        pixel.y >= height) {
+      continue;
+    }
+    const int pixel_x = static_cast<int>(pixel.x);
+    const int pixel_y = static_cast<int>(pixel.y);
+    for (int y = std::max(0, pixel_y - kWindowRadius);
+         y <= std::min(height - 1, pixel_y + kWindowRadius); ++y) {
+      for (int x = std::max(0, pixel_x - kWindowRadius);
+           x <= std::min(width - 1, pixel_x + kWindowRadius); ++x) {
+        float& depth = (*depth_map)[y * width + x];
+        if (depth == 0.0f || point[2] < depth) {
+          depth = point[2];
+        }
+      }
+    }
+  }
+}
+
+size_t CountMismatches(const std::vector<float>& depth_map,
+                       const std::vector<float>& reference) {
+  size_t mismatches = 0;
+  for (size_t i = 0; i < reference.size(); ++i) {
+    mismatches += depth_map[i] != reference[i];
+  }
+  return mismatches;
+}
+
+void Run(int width, int height, tango_perception::ThreadPool* thread_pool) {
+  const TangoCameraIntrinsics intrinsics = MakeIntrinsics(width, height);
+  std::mt19937 random(1);
+  std::vector<std::vector<float>> clouds;
+  for (int i = 0; i < kNumFrames; ++i) {
+    clouds.push_back(MakePointCloud(&random));
+  }
+  std::vector<TangoPointCloud> point_clouds(kNumFrames);
+  for (int i = 0; i < kNumFrames; ++i) {
+    point_clouds[i].num_points = kNumPoints;
+    point_clouds[i].points = reinterpret_cast<float(*)[4]>(clouds[i].data());
+  }
+
+  std::vector<float> old_depth;
+  std::vector<uint8_t> old_grayscale;
+  Clock::time_point start = Clock::now();
+  for (const TangoPointCloud& point_cloud : point_clouds) {
+    OldSplat(point_cloud, intrinsics, &old_depth, &old_grayscale);
+  }
+  const double old_ms = MillisecondsSince(start) / kNumFrames;
+
+  tango_perception::DepthSplatter splatter(thread_pool);
+  splatter.SetCameraIntrinsics(intrinsics);
+  std::vector<uint8_t> grayscale;
+  const glm::mat4 identity(1.0f);
+  start = Clock::now();
+  for (const TangoPointCloud& point_cloud : point_clouds) {
+    splatter.Splat(&point_cloud, identity, kWindowRadius);
+    splatter.ConvertToGrayscale(kMaxDepth, &grayscale);
+  }
+  const double new_ms = MillisecondsSince(start) / kNumFrames;
+
+  std::vector<float> reference;
+  ReferenceSplat(point_clouds.back(), splatter.GetCameraProjection(), width,
+                 height, &reference);
+  std::printf(
+      "%4dx%-4d %u points: old %5.1f ms, %7zu wrong pixels | "
+      "DepthSplatter %5.1f ms, %zu wrong pixels\n",
+      width, height, kNumPoints, old_ms,
+      CountMismatches(old_depth, reference), new_ms,
+      CountMismatches(splatter.GetDepthImage(), reference));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  tango_perception::ThreadPool thread_pool(argc > 1 ? std::atoi(argv[1]) : 0);
+  std::printf("%d threads\n", thread_pool.GetNumThreads());
+  Run(1920, 1080, &thread_pool);
+  Run(1280, 720, &thread_pool);
+  return 0;
+}
@@ -0,0 +1,212 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Times PointToPlaneIcp on the frame to frame drift check done by
+// cpp_point_cloud_example: two depth camera views of a room, with the
+// relative pose disturbed as drifting motion tracking would. Reports the
+// time per alignment and the pose error left after it. Built on the host
+// from the repository root:
+//
+//   g++ -std=c++11 -O2 -pthread -Itango_client_api/include \
+//       -Itango_perception/include -Ithird_party/glm \
+//       tango_perception/benchmark/icp_benchmark.cc \
+//       tango_perception/src/icp.cc \
+//       tango_perception/src/point_cloud_index.cc \
+//       tango_perception/src/thread_pool.cc -o icp_benchmark
+//
+// Usage: icp_benchmark [num_trials]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "tango-perception/icp.h"
+
+namespace {
+
+const int kDefaultNumTrials = 50;
+
+// Roughly the depth camera of a Tango phone.
+const int kDepthWidth = 224;
+const int kDepthHeight = 172;
+const double kDepthFocal = 215.0;
+
+// A room seen from the inside: walls at x = +-1.2, floor and ceiling at
+// y = 1.2 and y = -1.3 (the depth camera looks along z with y down) and a
+// back wall at z = 3.5.
+const glm::vec3 kRoomMin(-1.2f, -1.3f, -1.0f);
+const glm::vec3 kRoomMax(1.2f, 1.2f, 3.5f);
+
+typedef std::chrono::steady_clock Clock;
+
+TangoCameraIntrinsics MakeIntrinsics() {
+  TangoCameraIntrinsics intrinsics = {};
+  intrinsics.camera_id = TANGO_CAMERA_DEPTH;
+  intrinsics.width = kDepthWidth;
+  intrinsics.height = kDepthHeight;
+  intrinsics.fx = kDepthFocal;
+  intrinsics.fy = kDepthFocal;
+  intrinsics.cx = kDepthWidth / 2.0;
+  intrinsics.cy = kDepthHeight / 2.0;
+  return intrinsics;
+}
+
+// Cast one ray per depth pixel from a camera at room_T_camera and return the
+// hits in the camera frame, with 0.2% depth noise along the ray.
+std::vector<float> RenderRoom(const glm::mat4& room_T_camera,
+                              std::mt19937* random) {
+  std::normal_distribution<float> noise(0.0f, 0.002f);
+  const glm::vec3 origin(room_T_camera[3]);
+  const glm::mat3 rotation(room_T_camera);
+  std::vector<float> points;
+  for (int v = 0; v < kDepthHeight; ++v) {
+    for (int u = 0; u < kDepthWidth; ++u) {
+      const glm::vec3 ray_camera((u + 0.5 - kDepthWidth / 2.0) / kDepthFocal,
+                                 (v + 0.5 - kDepthHeight / 2.0) / kDepthFocal,
+                                 1.0f);
+      const glm::vec3 ray = rotation * ray_camera;
+      float hit = 1e9f;
+      for (int axis = 0; axis < 3; ++axis) {
+        if (ray[axis] > 0.0f) {
+          hit = std::min(hit, (kRoomMax[axis] - origin[axis]) / ray[axis]);
+        } else if (ray[axis] < 0.0f) {
+          hit = std::min(hit, (kRoomMin[axis] - origin[axis]) / ray[axis]);
+        }
+      }
+      const float depth = hit * (1.0f + noise(*random));
+      points.push_back(ray_camera.x * depth);
+      points.push_back(ray_camera.y * depth);
+      points.push_back(ray_camera.z * depth);
+      points.push_back(1.0f);
+    }
+  }
+  return points;
+}
+
+TangoPointCloud MakePointCloud(std::vector<float>* points) {
+  TangoPointCloud point_cloud = {};
+  point_cloud.num_points = static_cast<uint32_t>(points->size() / 4);
+  point_cloud.points = reinterpret_cast<float(*)[4]>(points->data());
+  return point_cloud;
+}
+
+glm::mat4 MakePose(const glm::vec3& rotation, const glm::vec3& translation) {
+  glm::mat4 pose(1.0f);
+  const float angle = glm::length(rotation);
+  if (angle > 0.0f) {
+    const glm::vec3 axis = rotation / angle;
+    const float c = std::cos(angle);
+    const float s = std::sin(angle);
+    const float t = 1.0f - c;
+    const glm::vec3 a = axis;
+    // glm matrices are column major.
+    pose[0] = glm::vec4(t * a.x * a.x + c, t * a.x * a.y + s * a.z,
+                        t * a.x * a.z - s * a.y, 0.0f);
+    pose[1] = glm::vec4(t * a.x * a.y - s * a.z, t * a.y * a.y + c,
+                        t * a.y * a.z + s * a.x, 0.0f);
+    pose[2] = glm::vec4(t * a.x * a.z + s * a.y, t * a.y * a.z - s * a.x,
+                        t * a.z * a.z + c, 0.0f);
+  }
+  pose[3] = glm::vec4(translation, 1.0f);
+  return pose;
+}
+
+// Translation in meters and rotation in degrees of a transform.
+void PoseError(const glm::mat4& error, float* translation, float* rotation) {
+  *translation = glm::length(glm::vec3(error[3]));
+  // atan2 keeps small angles accurate, where acos of the trace rounds.
+  const glm::vec3 axis(error[1][2] - error[2][1], error[2][0] - error[0][2],
+                       error[0][1] - error[1][0]);
+  const float trace = error[0][0] + error[1][1] + error[2][2];
+  *rotation = glm::degrees(
+      std::atan2(glm::length(axis) * 0.5f, (trace - 1.0f) * 0.5f));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const int num_trials = argc > 1 ? std::atoi(argv[1]) : kDefaultNumTrials;
+  const TangoCameraIntrinsics intrinsics = MakeIntrinsics();
+  std::mt19937 random(1);
+  std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+  const tango_perception::PointToPlaneIcp::Options options;
+  tango_perception::ThreadPool thread_pool;
+  tango_perception::PointToPlaneIcp icp(options, &thread_pool);
+  double align_ms = 0.0;
+  float max_before = 0.0f, max_after = 0.0f;
+  float max_rotation_before = 0.0f, max_rotation_after = 0.0f;
+  float sum_before = 0.0f, sum_after = 0.0f;
+  int num_aligned = 0;
+  for (int trial = 0; trial < num_trials; ++trial) {
+    // Two depth frames 200 ms apart on a hand held device.
+    const glm::mat4 room_T_target =
+        MakePose(glm::vec3(unit(random), unit(random), unit(random)) * 0.1f,
+                 glm::vec3(unit(random), unit(random), unit(random)) * 0.2f);
+    const glm::mat4 target_T_source =
+        MakePose(glm::vec3(unit(random), unit(random), unit(random)) * 0.05f,
+                 glm::vec3(unit(random), unit(random), unit(random)) * 0.05f);
+    std::vector<float> target_points = RenderRoom(room_T_target, &random);
+    std::vector<float> source_points =
+        RenderRoom(room_T_target * target_T_source, &random);
+    const TangoPointCloud target = MakePointCloud(&target_points);
+    const TangoPointCloud source = MakePointCloud(&source_points);
+
+    // Motion tracking off by up to 2 cm and 1 degree.
+    const glm::mat4 drift = MakePose(
+        glm::vec3(unit(random), unit(random), unit(random)) * 0.01f,
+        glm::vec3(unit(random), unit(random), unit(random)) * 0.0115f);
+    const glm::mat4 initial = target_T_source * drift;
+
+    const Clock::time_point start = Clock::now();
+    icp.SetTarget(&target, intrinsics);
+    tango_perception::PointToPlaneIcp::Result result;
+    const bool aligned = icp.Align(&source, initial, &result);
+    align_ms += std::chrono::duration<double, std::milli>(Clock::now() - start)
+                    .count();
+
+    float translation, rotation;
+    PoseError(glm::inverse(target_T_source) * initial, &translation,
+              &rotation);
+    sum_before += translation;
+    max_before = std::max(max_before, translation);
+    max_rotation_before = std::max(max_rotation_before, rotation);
+    if (!aligned) {
+      continue;
+    }
+    ++num_aligned;
+    PoseError(glm::inverse(target_T_source) * result.target_T_source,
+              &translation, &rotation);
+    sum_after += translation;
+    max_after = std::max(max_after, translation);
+    max_rotation_after = std::max(max_rotation_after, rotation);
+  }
+
+  std::printf(
+      "%d of %d %dx%d depth frame pairs aligned, %.2f ms each\n"
+      "pose error before: mean %.1f mm, max %.1f mm and %.2f deg\n"
+      "pose error after:  mean %.1f mm, max %.1f mm and %.2f deg\n",
+      num_aligned, num_trials, kDepthWidth, kDepthHeight,
+      align_ms / num_trials, sum_before * 1000.0f / num_trials,
+      max_before * 1000.0f, max_rotation_before,
+      sum_after * 1000.0f / std::max(1, num_aligned), max_after * 1000.0f,
+      max_rotation_after);
+  return 0;
+}
@@ -0,0 +1,171 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares PointCloudIndex against a brute force search over the same
+// points, for insertion, k nearest and radius queries, and checks that both
+// find the same neighbours. Built on the host from the repository root:
+//
+//   g++ -std=c++11 -O2 -pthread -Itango_client_api/include \
+//       -Itango_perception/include -Ithird_party/glm \
+//       tango_perception/benchmark/point_cloud_index_benchmark.cc \
+//       tango_perception/src/point_cloud_index.cc \
+//       -o point_cloud_index_benchmark
+//
+// Usage: point_cloud_index_benchmark [num_points...], by default 10k to 10M.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "tango-perception/point_cloud_index.h"
+
+namespace {
+
+const size_t kPointsPerCloud = 10000;
+const size_t kNumQueries = 200;
+const size_t kNumNeighbors = 5;
+const float kRadius = 0.05f;
+
+typedef std::chrono::steady_clock Clock;
+
+double MillisecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+// Points scattered over the walls and floor of a 5 m room, as depth clouds
+// of a room are.
+std::vector<glm::vec4> MakeRoom(size_t num_points, std::mt19937* random) {
+  std::uniform_real_distribution<float> coordinate(0.0f, 5.0f);
+  std::normal_distribution<float> noise(0.0f, 0.005f);
+  std::vector<glm::vec4> points(num_points);
+  for (size_t i = 0; i < num_points; ++i) {
+    glm::vec3 point(coordinate(*random), coordinate(*random),
+                    coordinate(*random));
+    point[i % 3] = (i % 2 == 0 ? 0.0f : 5.0f) + noise(*random);
+    points[i] = glm::vec4(point, 1.0f);
+  }
+  return points;
+}
+
+float DistanceSquared(const glm::vec4& point, const glm::vec3& query) {
+  const glm::vec3 delta = glm::vec3(point) - query;
+  return glm::dot(delta, delta);
+}
+
+void BruteForceKNearest(const std::vector<glm::vec4>& points,
+                        const glm::vec3& query, size_t k,
+                        std::vector<float>* distances) {
+  distances->clear();
+  for (const glm::vec4& point : points) {
+    distances->push_back(DistanceSquared(point, query));
+  }
+  std::partial_sort(distances->begin(), distances->begin() + k,
+                    distances->end());
+  distances->resize(k);
+}
+
+size_t BruteForceInRadius(const std::vector<glm::vec4>& points,
+                          const glm::vec3& query, float radius) {
+  size_t count = 0;
+  for (const glm::vec4& point : points) {
+    count += DistanceSquared(point, query) <= radius * radius;
+  }
+  return count;
+}
+
+void Run(size_t num_points) {
+  std::mt19937 random(static_cast<uint32_t>(num_points));
+  const std::vector<glm::vec4> points = MakeRoom(num_points, &random);
+  std::vector<glm::vec3> queries;
+  for (size_t i = 0; i < kNumQueries; ++i) {
+    queries.push_back(glm::vec3(points[random() % num_points]));
+  }
+
+  // Insert cloud sized batches, as the depth callback would.
+  tango_perception::PointCloudIndex index;
+  Clock::time_point start = Clock::now();
+  for (size_t begin = 0; begin < num_points; begin += kPointsPerCloud) {
+    const size_t count = std::min(kPointsPerCloud, num_points - begin);
+    index.AddPoints(reinterpret_cast<const float(*)[4]>(&points[begin]),
+                    count);
+  }
+  const double insert_ms = MillisecondsSince(start);
+  start = Clock::now();
+  index.WaitForRebuild();
+  const double rebuild_ms = MillisecondsSince(start);
+
+  std::vector<tango_perception::Neighbor> neighbors;
+  start = Clock::now();
+  index.FindKNearest(queries, kNumNeighbors, &neighbors);
+  const double index_knn_ms = MillisecondsSince(start);
+
+  start = Clock::now();
+  size_t index_radius_count = 0;
+  std::vector<tango_perception::Neighbor> radius_neighbors;
+  for (const glm::vec3& query : queries) {
+    index.FindInRadius(query, kRadius, &radius_neighbors);
+    index_radius_count += radius_neighbors.size();
+  }
+  const double index_radius_ms = MillisecondsSince(start);
+
+  start = Clock::now();
+  size_t mismatches = 0;
+  std::vector<float> distances;
+  for (size_t i = 0; i < queries.size(); ++i) {
+    BruteForceKNearest(points, queries[i], kNumNeighbors, &distances);
+    for (size_t j = 0; j < kNumNeighbors; ++j) {
+      mismatches +=
+          distances[j] != neighbors[i * kNumNeighbors + j].distance_squared;
+    }
+  }
+  const double brute_knn_ms = MillisecondsSince(start);
+
+  start = Clock::now();
+  size_t brute_radius_count = 0;
+  for (const glm::vec3& query : queries) {
+    brute_radius_count += BruteForceInRadius(points, query, kRadius);
+  }
+  const double brute_radius_ms = MillisecondsSince(start);
+  mismatches += index_radius_count != brute_radius_count;
+
+  std::printf(
+      "%9zu points: insert %8.1f ms, pending rebuild %8.1f ms | "
+      "%zu %zu-NN: index %7.2f ms, brute force %9.1f ms | "
+      "%zu radius: index %7.2f ms, brute force %9.1f ms | %s\n",
+      num_points, insert_ms, rebuild_ms, kNumQueries, kNumNeighbors,
+      index_knn_ms, brute_knn_ms, kNumQueries, index_radius_ms,
+      brute_radius_ms, mismatches == 0 ? "results match" : "MISMATCH");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::vector<size_t> sizes;
+  for (int i = 1; i < argc; ++i) {
+    sizes.push_back(std::strtoul(argv[i], nullptr, 10));
+  }
+  if (sizes.empty()) {
+    sizes = {10000, 100000, 1000000, 10000000};
+  }
+  for (size_t num_points : sizes) {
+    Run(num_points);
+  }
+  return 0;
+}
@@ -0,0 +1,192 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the storage PointCloudRecorder needs per point against the 16
+// bytes of a raw XYZC point, on depth camera clouds of a room with increasing
+// depth noise, and the time to encode and decode them. Also checks that the
+// frames read back match the quantized input and that a chunk claiming more
+// points than it can hold is rejected. Built on the host from the repository
+// root:
+//
+//   g++ -std=c++11 -O2 -pthread -Itango_client_api/include \
+//       -Itango_perception/include -Ithird_party/glm \
+//       tango_perception/benchmark/point_cloud_recorder_benchmark.cc \
+//       tango_perception/src/chunk_file.cc \
+//       tango_perception/src/point_cloud_recorder.cc \
+//       -o point_cloud_recorder_benchmark
+//
+// Usage: point_cloud_recorder_benchmark [path of a scratch file]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "tango-perception/point_cloud_recorder.h"
+
+namespace {
+
+const int kNumFrames = 50;
+
+// Roughly the depth camera of a Tango phone, which reports clouds in the row
+// order of its image with the pixels that have no depth left out.
+const int kDepthWidth = 224;
+const int kDepthHeight = 172;
+const float kDepthFocal = 215.0f;
+const float kMaxDepth = 4.0f;
+const float kHoleProbability = 0.1f;
+
+// A room seen from the inside, the depth camera looks along z with y down.
+const float kRoomMin[3] = {-1.5f, -1.3f, -1.0f};
+const float kRoomMax[3] = {1.5f, 1.2f, 5.0f};
+
+typedef std::chrono::steady_clock Clock;
+
+double MillisecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+// A cloud seen from a camera at the origin looking at yaw radians, with
+// depth noise of noise times the depth.
+std::vector<float> RenderRoom(float yaw, float noise,
+                              std::mt19937* random) {
+  std::normal_distribution<float> depth_noise(0.0f, noise);
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  const float c = std::cos(yaw), s = std::sin(yaw);
+  std::vector<float> points;
+  for (int v = 0; v < kDepthHeight; ++v) {
+    for (int u = 0; u < kDepthWidth; ++u) {
+      const float ray_camera[3] = {(u + 0.5f - kDepthWidth / 2) / kDepthFocal,
+                                   (v + 0.5f - kDepthHeight / 2) / kDepthFocal,
+                                   1.0f};
+      const float ray[3] = {c * ray_camera[0] + s * ray_camera[2],
+                            ray_camera[1],
+                            -s * ray_camera[0] + c * ray_camera[2]};
+      float hit = 1e9f;
+      for (int axis = 0; axis < 3; ++axis) {
+        if (ray[axis] != 0.0f) {
+          const float wall = ray[axis] > 0.0f ? kRoomMax[axis] : kRoomMin[axis];
+          hit = std::min(hit, wall / ray[axis]);
+        }
+      }
+      if (hit > kMaxDepth || unit(*random) < kHoleProbability) {
+        continue;
+      }
+      const float depth = hit * (1.0f + depth_noise(*random));
+      points.push_back(ray_camera[0] * depth);
+      points.push_back(ray_camera[1] * depth);
+      points.push_back(depth);
+      points.push_back(1.0f);
+    }
+  }
+  return points;
+}
+
+// Flip the point count of the first chunk to 2^30, which wraps 4 * count in
+// 32 bits.
+bool CorruptPointCount(const std::string& path) {
+  FILE* file = std::fopen(path.c_str(), "r+b");
+  if (file == nullptr) {
+    return false;
+  }
+  // File magic and version, chunk magic and payload size, timestamp.
+  const long offset = 4 * sizeof(uint32_t) + sizeof(double);
+  const uint32_t num_points = 1u << 30;
+  const bool written = std::fseek(file, offset, SEEK_SET) == 0 &&
+                       std::fwrite(&num_points, sizeof(num_points), 1, file) ==
+                           1;
+  std::fclose(file);
+  return written;
+}
+
+void Run(float noise, const std::string& path) {
+  std::mt19937 random(1);
+  std::vector<std::vector<float>> clouds;
+  size_t num_points = 0;
+  for (int i = 0; i < kNumFrames; ++i) {
+    clouds.push_back(RenderRoom(0.02f * i, noise, &random));
+    num_points += clouds.back().size() / 4;
+  }
+
+  TangoPoseData pose = {};
+  pose.status_code = TANGO_POSE_VALID;
+  pose.orientation[3] = 1.0;
+
+  tango_perception::PointCloudRecorder recorder;
+  recorder.Open(path, kDepthWidth * kDepthHeight);
+  Clock::time_point start = Clock::now();
+  for (int i = 0; i < kNumFrames; ++i) {
+    TangoPointCloud point_cloud = {};
+    point_cloud.timestamp = 0.2 * i;
+    point_cloud.num_points = static_cast<uint32_t>(clouds[i].size() / 4);
+    point_cloud.points = reinterpret_cast<float(*)[4]>(clouds[i].data());
+    pose.timestamp = point_cloud.timestamp;
+    // Wait for the writer, so that no frame is dropped.
+    while (!recorder.Record(&point_cloud, pose)) {
+    }
+  }
+  recorder.Close();
+  const double encode_ms = MillisecondsSince(start);
+  const uint64_t num_bytes = recorder.GetNumBytesWritten();
+
+  tango_perception::PointCloudReader reader;
+  size_t mismatches = 0;
+  std::vector<float> points;
+  start = Clock::now();
+  reader.Open(path);
+  for (int i = 0; i < kNumFrames; ++i) {
+    mismatches += !reader.ReadFrame(i, &points, &pose);
+    mismatches += points.size() != clouds[i].size();
+  }
+  const double decode_ms = MillisecondsSince(start);
+  for (int i = 0; i < kNumFrames; ++i) {
+    reader.ReadFrame(i, &points, &pose);
+    for (size_t j = 0; j < std::min(points.size(), clouds[i].size()); ++j) {
+      mismatches += std::abs(points[j] - clouds[i][j]) > 0.0006f;
+    }
+  }
+  reader.Close();
+
+  mismatches += !CorruptPointCount(path);
+  reader.Open(path);
+  mismatches += reader.ReadFrame(0, &points, &pose);
+  reader.Close();
+
+  const double bytes_per_point = static_cast<double>(num_bytes) / num_points;
+  std::printf(
+      "depth noise %4.2f%%: %5.2f bytes per point, %4.1fx smaller than raw | "
+      "encode %5.1f ms, decode %5.1f ms per frame | %s\n",
+      noise * 100.0f, bytes_per_point, 16.0 / bytes_per_point,
+      encode_ms / kNumFrames, decode_ms / kNumFrames,
+      mismatches == 0 ? "round trip ok" : "MISMATCH");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const std::string path =
+      argc > 1 ? argv[1] : "point_cloud_recorder_benchmark.tpc";
+  for (float noise : {0.0f, 0.001f, 0.0025f, 0.005f, 0.01f}) {
+    Run(noise, path);
+  }
+  std::remove(path.c_str());
+  return 0;
+}
@@ -0,0 +1,228 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares YuvToRgbConverter against the per pixel float Yuv2Rgb loop
+// hello_video used before it, on NV21 frames with padded rows. Also checks
+// the result against floating point BT.601, and that the vector path gives
+// the same pixels as ConvertYuvToRgba() on odd sizes and on YV12. Built on
+// the host from the repository root:
+//
+//   g++ -std=c++11 -O2 -pthread -Itango_client_api/include \
+//       -Itango_perception/include -Ithird_party/glm \
+//       tango_perception/benchmark/yuv_converter_benchmark.cc \
+//       tango_perception/src/thread_pool.cc \
+//       tango_perception/src/yuv_converter.cc -o yuv_converter_benchmark
+//
+// Usage: yuv_converter_benchmark [num_threads], by default all hardware
+// threads.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "tango-perception/yuv_converter.h"
+
+namespace {
+
+const int kNumFrames = 30;
+const int kRowPadding = 64;
+
+typedef std::chrono::steady_clock Clock;
+
+double MillisecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+// The conversion HelloVideoApp::RenderYuv did before YuvToRgbConverter.
+inline void Yuv2Rgb(uint8_t y_value, uint8_t u_value, uint8_t v_value,
+                    uint8_t* r, uint8_t* g, uint8_t* b) {
+  float float_r = y_value + (1.370705 * (v_value - 128));
+  float float_g =
+      y_value - (0.698001 * (v_value - 128)) - (0.337633 * (u_value - 128));
+  float float_b = y_value + (1.732446 * (u_value - 128));
+
+  float_r = float_r * !(float_r < 0);
+  float_g = float_g * !(float_g < 0);
+  float_b = float_b * !(float_b < 0);
+
+  *r = float_r * (!(float_r > 255)) + 255 * (float_r > 255);
+  *g = float_g * (!(float_g > 255)) + 255 * (float_g > 255);
+  *b = float_b * (!(float_b > 255)) + 255 * (float_b > 255);
+}
+
+void OldConvert(const std::vector<uint8_t>& yuv_buffer, size_t width,
+                size_t height, std::vector<uint8_t>* rgb_buffer) {
+  const size_t uv_buffer_offset = width * height;
+  for (size_t i = 0; i < height; ++i) {
+    for (size_t j = 0; j < width; ++j) {
+      size_t x_index = j;
+      if (j % 2 != 0) {
+        x_index = j - 1;
+      }
+      size_t rgb_index = (i * width + j) * 3;
+      Yuv2Rgb(yuv_buffer[i * width + j],
+              yuv_buffer[uv_buffer_offset + (i / 2) * width + x_index + 1],
+              yuv_buffer[uv_buffer_offset + (i / 2) * width + x_index],
+              &(*rgb_buffer)[rgb_index], &(*rgb_buffer)[rgb_index + 1],
+              &(*rgb_buffer)[rgb_index + 2]);
+    }
+  }
+}
+
+// A frame of random chroma over a luma gradient, so that every clamp is hit.
+std::vector<uint8_t> MakeFrame(TangoImageFormatType format, int width,
+                               int height, int stride, std::mt19937* random,
+                               TangoImageBuffer* buffer) {
+  std::vector<uint8_t> data(static_cast<size_t>(stride) * height * 3 / 2 +
+                            stride);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<uint8_t>((*random)());
+  }
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      data[y * stride + x] = static_cast<uint8_t>((x + y) & 0xff);
+    }
+  }
+  *buffer = TangoImageBuffer();
+  buffer->width = width;
+  buffer->height = height;
+  buffer->stride = stride;
+  buffer->format = format;
+  buffer->data = data.data();
+  return data;
+}
+
+// Largest difference of any channel from floating point BT.601.
+int MaxErrorToFloat(const tango_perception::YuvPlanes& yuv,
+                    const std::vector<uint8_t>& rgba, int width,
+                    int height) {
+  int max_error = 0;
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      const float luma = yuv.y.At(x, y);
+      const float u = yuv.u.At(x / 2, y / 2) - 128.0f;
+      const float v = yuv.v.At(x / 2, y / 2) - 128.0f;
+      const float expected[3] = {luma + 1.402f * v,
+                                 luma - 0.344136f * u - 0.714136f * v,
+                                 luma + 1.772f * u};
+      for (int c = 0; c < 3; ++c) {
+        const int rounded = static_cast<int>(
+            std::lround(std::min(std::max(expected[c], 0.0f), 255.0f)));
+        const int error = std::abs(rounded - rgba[(y * width + x) * 4 + c]);
+        max_error = std::max(max_error, error);
+      }
+    }
+  }
+  return max_error;
+}
+
+void Run(int width, int height, tango_perception::ThreadPool* thread_pool) {
+  std::mt19937 random(1);
+  const int stride = width + kRowPadding;
+  TangoImageBuffer buffer;
+  const std::vector<uint8_t> data = MakeFrame(
+      TANGO_HAL_PIXEL_FORMAT_YCrCb_420_SP, width, height, stride, &random,
+      &buffer);
+  tango_perception::YuvPlanes yuv;
+  tango_perception::GetYuvPlanes(buffer, &yuv);
+
+  // The old loop needs unpadded rows, as hello_video used to copy them.
+  std::vector<uint8_t> packed(static_cast<size_t>(width) * height * 3 / 2);
+  for (int y = 0; y < height; ++y) {
+    std::copy(yuv.y.GetRow(y), yuv.y.GetRow(y) + width,
+              packed.begin() + y * width);
+  }
+  for (int y = 0; y < height / 2; ++y) {
+    std::copy(yuv.v.GetRow(y), yuv.v.GetRow(y) + width,
+              packed.begin() + (height + y) * width);
+  }
+  std::vector<uint8_t> rgb(static_cast<size_t>(width) * height * 3);
+  Clock::time_point start = Clock::now();
+  for (int i = 0; i < kNumFrames; ++i) {
+    OldConvert(packed, width, height, &rgb);
+  }
+  const double old_ms = MillisecondsSince(start) / kNumFrames;
+
+  std::vector<uint8_t> rgba(static_cast<size_t>(width) * height * 4);
+  const tango_perception::ImageView<uint8_t> rgba_view(rgba.data(), width,
+                                                       height, width * 4, 4);
+  start = Clock::now();
+  for (int i = 0; i < kNumFrames; ++i) {
+    tango_perception::ConvertYuvToRgba(yuv, rgba_view);
+  }
+  const double kernel_ms = MillisecondsSince(start) / kNumFrames;
+
+  tango_perception::YuvToRgbConverter converter(thread_pool);
+  start = Clock::now();
+  for (int i = 0; i < kNumFrames; ++i) {
+    converter.Convert(yuv, rgba_view);
+  }
+  const double new_ms = MillisecondsSince(start) / kNumFrames;
+
+  std::printf(
+      "%4dx%-4d NV21: old %6.2f ms | ConvertYuvToRgba %5.2f ms | "
+      "YuvToRgbConverter %5.2f ms, %d levels from float BT.601\n",
+      width, height, old_ms, kernel_ms, new_ms,
+      MaxErrorToFloat(yuv, rgba, width, height));
+}
+
+// The pixels that differ between the converter and ConvertYuvToRgba().
+size_t CountMismatches(TangoImageFormatType format, int width, int height,
+                       tango_perception::ThreadPool* thread_pool) {
+  std::mt19937 random(static_cast<uint32_t>(width * height));
+  TangoImageBuffer buffer;
+  const std::vector<uint8_t> data =
+      MakeFrame(format, width, height, width + 6, &random, &buffer);
+  tango_perception::YuvPlanes yuv;
+  tango_perception::GetYuvPlanes(buffer, &yuv);
+  std::vector<uint8_t> expected(static_cast<size_t>(width) * height * 4);
+  std::vector<uint8_t> actual(expected.size());
+  tango_perception::ConvertYuvToRgba(
+      yuv, tango_perception::ImageView<uint8_t>(expected.data(), width,
+                                                height, width * 4, 4));
+  tango_perception::YuvToRgbConverter converter(thread_pool);
+  converter.Convert(yuv, tango_perception::ImageView<uint8_t>(
+                             actual.data(), width, height, width * 4, 4));
+  size_t mismatches = 0;
+  for (size_t i = 0; i < expected.size(); ++i) {
+    mismatches += expected[i] != actual[i];
+  }
+  return mismatches;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  tango_perception::ThreadPool thread_pool(argc > 1 ? std::atoi(argv[1]) : 0);
+  std::printf("%d threads\n", thread_pool.GetNumThreads());
+  Run(1920, 1080, &thread_pool);
+  Run(1280, 720, &thread_pool);
+  size_t mismatches = 0;
+  for (TangoImageFormatType format :
+       {TANGO_HAL_PIXEL_FORMAT_YCrCb_420_SP, TANGO_HAL_PIXEL_FORMAT_YV12}) {
+    for (int size : {1, 15, 33, 67}) {
+      mismatches += CountMismatches(format, size, size + 2, &thread_pool);
+    }
+  }
+  std::printf("odd sizes and YV12: %s\n",
+              mismatches == 0 ? "same as ConvertYuvToRgba" : "MISMATCH");
+  return 0;
+}
@@ -0,0 +1,164 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_PERCEPTION_BIT_STREAM_H_
+#define TANGO_PERCEPTION_BIT_STREAM_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tango_perception {
+
+// Map a signed value to an unsigned one so that small magnitudes of either
+// sign get small codes: 0, -1, 1, -2, 2 ... becomes 0, 1, 2, 3, 4 ...
+inline uint32_t ZigZagEncode(int32_t value) {
+  return (static_cast<uint32_t>(value) << 1) ^
+         static_cast<uint32_t>(value >> 31);
+}
+
+inline int32_t ZigZagDecode(uint32_t value) {
+  return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+
+// Appends bits, least significant first, to a byte buffer. The buffer is
+// owned by the caller so it can be reused across frames.
+class BitWriter {
+ public:
+  explicit BitWriter(std::vector<uint8_t>* buffer)
+      : buffer_(buffer), accumulator_(0), num_bits_(0) {}
+
+  // Write the low num_bits (at most 32) of value.
+  void Write(uint32_t value, int num_bits) {
+    accumulator_ |= static_cast<uint64_t>(value) << num_bits_;
+    num_bits_ += num_bits;
+    while (num_bits_ >= 8) {
+      buffer_->push_back(static_cast<uint8_t>(accumulator_));
+      accumulator_ >>= 8;
+      num_bits_ -= 8;
+    }
+  }
+
+  // Write the pending bits, padding the last byte with zeros.
+  void Flush() {
+    if (num_bits_ > 0) {
+      buffer_->push_back(static_cast<uint8_t>(accumulator_));
+    }
+    accumulator_ = 0;
+    num_bits_ = 0;
+  }
+
+ private:
+  std::vector<uint8_t>* buffer_;
+  uint64_t accumulator_;
+  int num_bits_;
+};
+
+// Reads bits written by BitWriter. Reading past the end returns zeros.
+class BitReader {
+ public:
+  BitReader(const uint8_t* data, size_t size)
+      : data_(data), end_(data + size), accumulator_(0), num_bits_(0) {}
+
+  uint32_t Read(int num_bits) {
+    while (num_bits_ < num_bits) {
+      uint64_t byte = data_ < end_ ? *data_++ : 0;
+      accumulator_ |= byte << num_bits_;
+      num_bits_ += 8;
+    }
+    uint32_t value = static_cast<uint32_t>(
+        accumulator_ & ((static_cast<uint64_t>(1) << num_bits) - 1));
+    accumulator_ >>= num_bits;
+    num_bits_ -= num_bits;
+    return value;
+  }
+
+ private:
+  const uint8_t* data_;
+  const uint8_t* end_;
+  uint64_t accumulator_;
+  int num_bits_;
+};
+
+// Adaptive Golomb-Rice coder for zigzagged prediction residuals. The Rice
+// parameter follows the running mean of recent residuals, which gets close to
+// the entropy of the Laplacian-like residuals of depth data at a fraction of
+// the cost of an arithmetic coder.
+class AdaptiveRiceCoder {
+ public:
+  AdaptiveRiceCoder() : sum_(kInitialSum), count_(kInitialCount) {}
+
+  void Encode(uint32_t value, BitWriter* writer) {
+    const int k = GetParameter();
+    const uint32_t quotient = value >> k;
+    if (quotient < kEscapeQuotient) {
+      // Unary quotient as ones terminated by a zero, then k raw bits.
+      writer->Write((1u << quotient) - 1, quotient + 1);
+      if (k > 0) {
+        writer->Write(value & ((1u << k) - 1), k);
+      }
+    } else {
+      writer->Write((1u << kEscapeQuotient) - 1, kEscapeQuotient);
+      writer->Write(value, 32);
+    }
+    Update(value);
+  }
+
+  uint32_t Decode(BitReader* reader) {
+    const int k = GetParameter();
+    uint32_t quotient = 0;
+    while (quotient < kEscapeQuotient && reader->Read(1) == 1) {
+      ++quotient;
+    }
+    uint32_t value;
+    if (quotient < kEscapeQuotient) {
+      value = (quotient << k) | (k > 0 ? reader->Read(k) : 0);
+    } else {
+      value = reader->Read(32);
+    }
+    Update(value);
+    return value;
+  }
+
+ private:
+  static const uint32_t kInitialSum = 4;
+  static const uint32_t kInitialCount = 1;
+  static const uint32_t kMaxCount = 32;
+  static const uint32_t kEscapeQuotient = 24;
+
+  int GetParameter() const {
+    int k = 0;
+    while ((count_ << k) < sum_ && k < 24) {
+      ++k;
+    }
+    return k;
+  }
+
+  void Update(uint32_t value) {
+    sum_ += value > 0xffffu ? 0xffffu : value;
+    if (++count_ == kMaxCount) {
+      sum_ >>= 1;
+      count_ >>= 1;
+    }
+  }
+
+  uint32_t sum_;
+  uint32_t count_;
+};
+
+}  // namespace tango_perception
+
+#endif  // TANGO_PERCEPTION_BIT_STREAM_H_
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_PERCEPTION_CAMERA_PROJECTION_H_
+#define TANGO_PERCEPTION_CAMERA_PROJECTION_H_
+
+#include <algorithm>
+#include <vector>
+
+#include <tango_client_api.h>
+
+#include "glm/glm.hpp"
+
+namespace tango_perception {
+
+// CameraProjection projects camera points to pixels and pixels back to rays
+// with the lens distortion of TangoCameraIntrinsics applied.
+//
+// The radial part of every supported model only depends on the radius, so it
+// is evaluated once per intrinsics change into two tables indexed by the
+// squared normalized radius: rd / ru for projecting and ru / rd for
+// unprojecting. A lookup then costs one multiply and one linear
+// interpolation instead of a polynomial, an arctangent or an iterative
+// inversion. The tangential terms of the five parameter model are cheap and
+// are evaluated directly.
+//
+// The tables cover the field of view of the image with some margin; radii
+// beyond it use the scale of the last entry.
+class CameraProjection {
+ public:
+  // Number of intervals of the lookup tables.
+  static const int kTableSize = 4096;
+
+  CameraProjection();
+
+  // Rebuild the lookup tables for new intrinsics. Unknown calibration types
+  // are treated as a pinhole camera.
+  void SetCameraIntrinsics(const TangoCameraIntrinsics& intrinsics);
+
+  // Project a point in camera coordinates to pixel coordinates.
+  //
+  // @return false if the point is not in front of the camera.
+  bool Project(const glm::vec3& camera_point, glm::vec2* pixel) const;
+
+  // Ray with unit depth, (x, y, 1), through the given pixel.
+  glm::vec3 Unproject(const glm::vec2& pixel) const;
+
+  // Apply the distortion to normalized pinhole coordinates (x / z, y / z).
+  glm::vec2 Distort(const glm::vec2& normalized) const {
+    const float radius_squared = glm::dot(normalized, normalized);
+    return normalized * GetDistortionScale(radius_squared) +
+           GetTangentialOffset(normalized, radius_squared);
+  }
+
+  // rd / ru for a squared undistorted normalized radius.
+  float GetDistortionScale(float radius_squared) const {
+    return Interpolate(distortion_table_,
+                       radius_squared * distortion_index_scale_);
+  }
+
+  // ru / rd for a squared distorted normalized radius.
+  float GetUndistortionScale(float radius_squared) const {
+    return Interpolate(undistortion_table_,
+                       radius_squared * undistortion_index_scale_);
+  }
+
+  // Tangential offset of the five parameter model, zero for the others.
+  glm::vec2 GetTangentialOffset(const glm::vec2& normalized,
+                                float radius_squared) const {
+    const float xy = 2.0f * normalized.x * normalized.y;
+    return glm::vec2(
+        p1_ * xy + p2_ * (radius_squared + 2.0f * normalized.x * normalized.x),
+        p2_ * xy + p1_ * (radius_squared + 2.0f * normalized.y * normalized.y));
+  }
+
+  // Resample the distortion table to size entries for uploading to a shader,
+  // where entry i holds rd / ru at a squared radius of i / index_scale.
+  void GetDistortionTable(int size, std::vector<float>* table,
+                          float* index_scale) const;
+
+  // Tangential coefficients p1 and p2, zero unless the model has them.
+  float GetP1() const { return p1_; }
+  float GetP2() const { return p2_; }
+
+  const TangoCameraIntrinsics& GetIntrinsics() const { return intrinsics_; }
+
+ private:
+  static float Interpolate(const std::vector<float>& table, float position) {
+    position = std::min(std::max(position, 0.0f),
+                        static_cast<float>(kTableSize));
+    const int index = std::min(static_cast<int>(position), kTableSize - 1);
+    const float fraction = position - index;
+    return table[index] + fraction * (table[index + 1] - table[index]);
+  }
+
+  TangoCameraIntrinsics intrinsics_;
+  float p1_;
+  float p2_;
+
+  // kTableSize + 1 samples, evenly spaced in the squared radius.
+  std::vector<float> distortion_table_;
+  std::vector<float> undistortion_table_;
+  float distortion_index_scale_;
+  float undistortion_index_scale_;
+};
+
+}  // namespace tango_perception
+
+#endif  // TANGO_PERCEPTION_CAMERA_PROJECTION_H_
@@ -0,0 +1,168 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_PERCEPTION_CHUNK_FILE_H_
+#define TANGO_PERCEPTION_CHUNK_FILE_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <tango_client_api.h>
+
+namespace tango_perception {
+
+// Chunk files are the container of the sensor recordings, such as those of
+// PointCloudRecorder and DepthImageRecorder. All values are little endian:
+//
+//   file header: file magic, version, header fields of the recording
+//   chunks: chunk magic, payload size, payload starting with a timestamp
+//   index: index magic, chunk count, (timestamp, chunk offset) per chunk
+//   trailer: index offset, trailer magic
+//
+// Every chunk is self-contained, so a reader can seek to any of them. A
+// file that was not closed properly has no index, but all complete chunks
+// can still be found by scanning.
+struct ChunkFileFormat {
+  uint32_t file_magic;
+  uint32_t version;
+  uint32_t chunk_magic;
+  uint32_t index_magic;
+  uint32_t trailer_magic;
+};
+
+// Size of a pose stored by AppendPose().
+const size_t kChunkPoseSize = 3 * sizeof(int32_t) + 8 * sizeof(double);
+
+template <typename T>
+void AppendValue(const T& value, std::vector<uint8_t>* buffer) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+  buffer->insert(buffer->end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+T ConsumeValue(const uint8_t** data) {
+  T value;
+  std::memcpy(&value, *data, sizeof(T));
+  *data += sizeof(T);
+  return value;
+}
+
+// Store the status, frame pair, timestamp, translation and orientation of a
+// pose.
+void AppendPose(const TangoPoseData& pose, std::vector<uint8_t>* buffer);
+
+// Read a pose stored by AppendPose(). Fields that are not stored are zero.
+void ConsumePose(const uint8_t** data, TangoPoseData* pose);
+
+// Writes a chunk file. Used by one thread at a time.
+class ChunkFileWriter {
+ public:
+  explicit ChunkFileWriter(const ChunkFileFormat& format);
+  ~ChunkFileWriter();
+
+  ChunkFileWriter(const ChunkFileWriter&) = delete;
+  ChunkFileWriter& operator=(const ChunkFileWriter&) = delete;
+
+  // Create the file at path and write the file header.
+  //
+  // @param header_fields: Fields of the recording following the version.
+  // @return false if the file could not be created.
+  bool Open(const std::string& path, const std::vector<uint8_t>& header_fields);
+
+  // Start a chunk in buffer, replacing its contents with the chunk prefix
+  // and the timestamp. The caller appends the rest of the payload.
+  void BeginChunk(double timestamp, std::vector<uint8_t>* buffer) const;
+
+  // Write a chunk started with BeginChunk(). A failed write is undone, so
+  // the offsets of later chunks stay right; if that is not possible, no
+  // more chunks are written and the file is left without an index.
+  //
+  // @return false if the chunk was not written.
+  bool WriteChunk(std::vector<uint8_t>* chunk);
+
+  // Write the index and close the file.
+  void Close();
+
+  bool IsOpen() const { return file_ != nullptr; }
+
+  // Bytes of the file written so far.
+  uint64_t GetSize() const { return size_; }
+
+ private:
+  struct IndexEntry {
+    double timestamp;
+    uint64_t offset;
+  };
+
+  bool Write(const std::vector<uint8_t>& data);
+
+  const ChunkFileFormat format_;
+  FILE* file_;
+  uint64_t size_;
+  bool is_broken_;
+  std::vector<IndexEntry> index_;
+  std::vector<uint8_t> index_buffer_;
+};
+
+// Reads a chunk file.
+class ChunkFileReader {
+ public:
+  explicit ChunkFileReader(const ChunkFileFormat& format);
+  ~ChunkFileReader();
+
+  ChunkFileReader(const ChunkFileReader&) = delete;
+  ChunkFileReader& operator=(const ChunkFileReader&) = delete;
+
+  // Open a file and load its index, or rebuild the index by scanning the
+  // chunks if the file was not closed properly.
+  //
+  // @param header_fields: Output, the header fields of the recording.
+  // @param header_fields_size: Size of the header fields of the format.
+  // @return false if the file could not be opened or is of another format.
+  bool Open(const std::string& path, size_t header_fields_size,
+            std::vector<uint8_t>* header_fields);
+  void Close();
+
+  size_t GetNumChunks() const { return index_.size(); }
+  double GetTimestamp(size_t chunk) const { return index_[chunk].timestamp; }
+
+  // Read the payload of a chunk, starting with its timestamp.
+  //
+  // @param chunk: Index of the chunk, less than GetNumChunks().
+  // @return false if the chunk is corrupt or could not be read.
+  bool ReadChunk(size_t chunk, std::vector<uint8_t>* payload);
+
+ private:
+  struct IndexEntry {
+    double timestamp;
+    uint64_t offset;
+  };
+
+  bool ReadIndex();
+  void ScanChunks(long first_chunk_offset);
+
+  const ChunkFileFormat format_;
+  FILE* file_;
+  uint64_t file_size_;
+  std::vector<IndexEntry> index_;
+};
+
+}  // namespace tango_perception
+
+#endif  // TANGO_PERCEPTION_CHUNK_FILE_H_
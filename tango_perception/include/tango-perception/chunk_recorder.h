@@ -0,0 +1,247 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_PERCEPTION_CHUNK_RECORDER_H_
+#define TANGO_PERCEPTION_CHUNK_RECORDER_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tango-perception/chunk_file.h"
+
+namespace tango_perception {
+
+// ChunkRecorder is the frame pool and writer thread shared by the sensor
+// recorders, such as PointCloudRecorder and DepthImageRecorder, which only
+// supply the quantization and coding of their frames.
+//
+// Record() takes a preallocated frame, quantizes into it on the calling
+// thread and queues it; coding and file IO happen on a writer thread, one
+// chunk per frame. If the writer falls behind, frames are dropped rather
+// than blocking the caller.
+//
+// Frame must have a double timestamp member, the timestamp of its chunk.
+template <typename Frame>
+class ChunkRecorder {
+ public:
+  // Append the payload of a frame to a chunk started with its timestamp.
+  // Called on the writer thread.
+  typedef std::function<void(const Frame& frame, std::vector<uint8_t>* chunk)>
+      Encode;
+
+  // @param num_frame_buffers: Number of frames that can be quantized or
+  //    queued at a time.
+  ChunkRecorder(const ChunkFileFormat& format, int num_frame_buffers,
+                const Encode& encode)
+      : file_(format),
+        encode_(encode),
+        is_open_(false),
+        stop_(false),
+        num_records_in_flight_(0),
+        num_frames_written_(0),
+        num_frames_dropped_(0),
+        num_bytes_written_(0) {
+    for (int i = 0; i < num_frame_buffers; ++i) {
+      frames_.push_back(std::unique_ptr<Frame>(new Frame));
+    }
+  }
+
+  ~ChunkRecorder() { Close(); }
+
+  ChunkRecorder(const ChunkRecorder&) = delete;
+  ChunkRecorder& operator=(const ChunkRecorder&) = delete;
+
+  // Create the file at path and start the writer thread.
+  //
+  // @param allocate: Called with every frame buffer before the writer
+  //    starts, to size it for the frames to come.
+  // @return false if the file could not be created.
+  bool Open(const std::string& path, const std::vector<uint8_t>& header_fields,
+            const std::function<void(Frame*)>& allocate) {
+    Close();
+
+    if (!file_.Open(path, header_fields)) {
+      return false;
+    }
+
+    // Close() waited for every Record() call to hand back its frame, and
+    // Record() does not take frames before is_open_ is set, so the frames
+    // can be resized and the queues reset.
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_frames_.clear();
+    queued_frames_.clear();
+    for (const std::unique_ptr<Frame>& frame : frames_) {
+      allocate(frame.get());
+      free_frames_.push_back(frame.get());
+    }
+    stop_ = false;
+    num_frames_written_ = 0;
+    num_frames_dropped_ = 0;
+    num_bytes_written_ = file_.GetSize();
+    is_open_ = true;
+
+    writer_thread_ = std::thread(&ChunkRecorder::WriterThread, this);
+    return true;
+  }
+
+  // Queue a frame. May be called from any thread.
+  //
+  // @param quantize: Called with a free frame, outside the lock, to fill it
+  //    including its timestamp.
+  // @return false if the frame was dropped.
+  template <typename Quantize>
+  bool Record(const Quantize& quantize) {
+    Frame* frame;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!is_open_ || stop_) {
+        return false;
+      }
+      if (free_frames_.empty()) {
+        ++num_frames_dropped_;
+        return false;
+      }
+      frame = free_frames_.back();
+      free_frames_.pop_back();
+      ++num_records_in_flight_;
+    }
+
+    quantize(frame);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      --num_records_in_flight_;
+      if (stop_) {
+        // Close() started while quantizing and the writer may be gone.
+        free_frames_.push_back(frame);
+        ++num_frames_dropped_;
+        if (num_records_in_flight_ == 0) {
+          record_finished_.notify_all();
+        }
+        return false;
+      }
+      queued_frames_.push_back(frame);
+    }
+    frame_queued_.notify_one();
+    return true;
+  }
+
+  // Write the queued frames and the index and close the file. Waits for
+  // Record() calls in progress on other threads.
+  void Close() {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (!is_open_) {
+        return;
+      }
+      stop_ = true;
+      record_finished_.wait(lock,
+                            [this] { return num_records_in_flight_ == 0; });
+    }
+    frame_queued_.notify_one();
+    writer_thread_.join();
+
+    file_.Close();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    num_bytes_written_ = file_.GetSize();
+    is_open_ = false;
+  }
+
+  bool IsOpen() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return is_open_;
+  }
+
+  // Statistics, valid until the next Open().
+  uint32_t GetNumFramesWritten() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return num_frames_written_;
+  }
+  uint32_t GetNumFramesDropped() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return num_frames_dropped_;
+  }
+  uint64_t GetNumBytesWritten() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return num_bytes_written_;
+  }
+
+ private:
+  void WriterThread() {
+    while (true) {
+      Frame* frame;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        frame_queued_.wait(
+            lock, [this] { return stop_ || !queued_frames_.empty(); });
+        if (queued_frames_.empty()) {
+          return;
+        }
+        frame = queued_frames_.front();
+        queued_frames_.pop_front();
+      }
+
+      file_.BeginChunk(frame->timestamp, &encode_buffer_);
+      encode_(*frame, &encode_buffer_);
+      const bool written = file_.WriteChunk(&encode_buffer_);
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (written) {
+        ++num_frames_written_;
+      } else {
+        ++num_frames_dropped_;
+      }
+      num_bytes_written_ = file_.GetSize();
+      free_frames_.push_back(frame);
+    }
+  }
+
+  // Owned by the writer thread while the recorder is open.
+  ChunkFileWriter file_;
+  Encode encode_;
+  std::vector<uint8_t> encode_buffer_;
+
+  std::vector<std::unique_ptr<Frame>> frames_;
+
+  // Guards the queues, the flags and the statistics.
+  mutable std::mutex mutex_;
+  std::condition_variable frame_queued_;
+  std::condition_variable record_finished_;
+  std::vector<Frame*> free_frames_;
+  std::deque<Frame*> queued_frames_;
+  bool is_open_;
+  bool stop_;
+  // Record() calls holding a frame that is in neither queue.
+  int num_records_in_flight_;
+
+  uint32_t num_frames_written_;
+  uint32_t num_frames_dropped_;
+  uint64_t num_bytes_written_;
+
+  std::thread writer_thread_;
+};
+
+}  // namespace tango_perception
+
+#endif  // TANGO_PERCEPTION_CHUNK_RECORDER_H_
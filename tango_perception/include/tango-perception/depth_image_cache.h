@@ -0,0 +1,107 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_PERCEPTION_DEPTH_IMAGE_CACHE_H_
+#define TANGO_PERCEPTION_DEPTH_IMAGE_CACHE_H_
+
+#include <memory>
+#include <vector>
+
+#include <tango_client_api.h>
+#include <tango_support.h>
+
+#include "glm/glm.hpp"
+#include "tango-perception/camera_projection.h"
+#include "tango-perception/depth_interpolator.h"
+#include "tango-perception/depth_registration.h"
+#include "tango-perception/latest_job_worker.h"
+#include "tango-perception/latest_value_mailbox.h"
+#include "tango-perception/thread_pool.h"
+
+namespace tango_perception {
+
+// DepthImageCache upsamples every registered depth frame once into a depth
+// image of the color camera on a worker thread, so that any number of depth
+// lookups against the latest frame cost a single pixel read. This makes it
+// cheap to measure continuously, e.g. under a reticle every frame.
+//
+// The frames come from a DepthRegistration, which has already projected the
+// points and copied the luma, so Update() only queues a reference. Frames
+// run on a LatestJobWorker, so the worker never falls behind. Finished
+// images are handed to the query thread through a LatestValueMailbox.
+class DepthImageCache {
+ public:
+  enum Method { kNearestNeighbor, kBilateral };
+
+  // @param intrinsics: Unrotated intrinsics of the color camera.
+  // @param thread_pool: Runs the interpolation, see DepthInterpolator.
+  DepthImageCache(const TangoCameraIntrinsics& intrinsics,
+                  ThreadPool* thread_pool);
+
+  DepthImageCache(const DepthImageCache&) = delete;
+  DepthImageCache& operator=(const DepthImageCache&) = delete;
+
+  // Queue a registered frame for upsampling. May be called from any thread.
+  // The frame is held until the worker is done with it.
+  //
+  // @param frame: Registered to the color camera of the intrinsics.
+  // @param method: kBilateral falls back to kNearestNeighbor for a frame
+  //    without luma.
+  void Update(const std::shared_ptr<const RegisteredDepthFrame>& frame,
+              Method method);
+
+  // Look up the point under a display uv coordinate in the latest depth
+  // image. Must always be called from the same thread.
+  //
+  // @param color_to_display_rotation: See DepthInterpolator.
+  // @param point: Output point in the depth camera frame.
+  // @param timestamp: Optional output depth timestamp of the frame.
+  // @return false if no image is ready or it has no depth at the point.
+  bool GetPointAt(const float uv[2],
+                  TangoSupport_Rotation color_to_display_rotation,
+                  float point[3], double* timestamp = nullptr);
+
+ private:
+  struct Job {
+    std::shared_ptr<const RegisteredDepthFrame> frame;
+    Method method;
+  };
+
+  struct Result {
+    double timestamp;
+    std::vector<float> depth;
+    glm::mat4 point_cloud_T_color_camera;
+  };
+
+  // Called on the worker thread.
+  void Upsample(Job* job);
+
+  int width_;
+  int height_;
+  CameraProjection projection_;
+
+  // Owned by the worker thread.
+  DepthInterpolator interpolator_;
+
+  LatestValueMailbox<Result> results_;
+
+  // Last, so that it stops before the members Upsample() uses go away.
+  LatestJobWorker<Job> worker_;
+};
+
+}  // namespace tango_perception
+
+#endif  // TANGO_PERCEPTION_DEPTH_IMAGE_CACHE_H_
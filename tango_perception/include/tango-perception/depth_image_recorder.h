@@ -0,0 +1,127 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_PERCEPTION_DEPTH_IMAGE_RECORDER_H_
+#define TANGO_PERCEPTION_DEPTH_IMAGE_RECORDER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <tango_client_api.h>
+
+#include "tango-perception/chunk_file.h"
+#include "tango-perception/chunk_recorder.h"
+
+namespace tango_perception {
+
+// Records depth images, such as the registered depth of DepthRegistration,
+// with their poses to a compact binary file for offline processing.
+//
+// Depth is quantized to millimetres in uint16 and every image is coded
+// losslessly with RvlEncode(). Like the recordings of PointCloudRecorder,
+// frames are stored in the chunks of a chunk file, see ChunkFileWriter, and
+// a file that was not closed properly can still be read up to the last
+// complete frame.
+//
+// Record() only quantizes the image into a preallocated frame buffer; coding
+// and file IO happen on the writer thread of a ChunkRecorder, so full rate
+// depth can be captured without touching storage from the caller. If the
+// writer falls behind, frames are dropped rather than blocking the caller.
+class DepthImageRecorder {
+ public:
+  DepthImageRecorder();
+
+  DepthImageRecorder(const DepthImageRecorder&) = delete;
+  DepthImageRecorder& operator=(const DepthImageRecorder&) = delete;
+
+  // Create the file at path and start the writer thread.
+  //
+  // @param width, height: Size of the depth images that will be recorded.
+  // @return false if the file could not be created.
+  bool Open(const std::string& path, int width, int height);
+
+  // Queue a depth image and the pose of its camera.
+  //
+  // @param depth: width * height depths in meters, row major, zero where
+  //    the depth is unknown.
+  // @return false if the frame was dropped.
+  bool Record(double timestamp, const float* depth, const TangoPoseData& pose);
+
+  // Write the queued frames and the index and close the file. Waits for
+  // Record() calls in progress on other threads.
+  void Close();
+
+  bool IsOpen() const;
+
+  // Statistics, valid until the next Open().
+  uint32_t GetNumFramesWritten() const;
+  uint32_t GetNumFramesDropped() const;
+  uint64_t GetNumBytesWritten() const;
+
+ private:
+  // A quantized frame waiting to be coded.
+  struct Frame {
+    double timestamp;
+    TangoPoseData pose;
+    std::vector<uint16_t> depth;
+  };
+
+  // Code the depth of a frame into a chunk, on the writer thread.
+  static void EncodeFrame(const Frame& frame, std::vector<uint8_t>* chunk);
+
+  ChunkRecorder<Frame> recorder_;
+};
+
+// Reads files written by DepthImageRecorder.
+class DepthImageReader {
+ public:
+  DepthImageReader();
+
+  DepthImageReader(const DepthImageReader&) = delete;
+  DepthImageReader& operator=(const DepthImageReader&) = delete;
+
+  // Open a recording and load its index, or rebuild the index by scanning
+  // the chunks if the recording was not closed properly.
+  bool Open(const std::string& path);
+  void Close();
+
+  int GetWidth() const { return width_; }
+  int GetHeight() const { return height_; }
+  size_t GetNumFrames() const { return file_.GetNumChunks(); }
+  double GetTimestamp(size_t frame) const {
+    return file_.GetTimestamp(frame);
+  }
+
+  // Decode one frame.
+  //
+  // @param frame: Index of the frame, less than GetNumFrames().
+  // @param depth: Output depths in meters, row major, zero where unknown.
+  // @param pose: Output pose recorded with the frame.
+  // @return false if the chunk is corrupt or could not be read.
+  bool ReadFrame(size_t frame, std::vector<float>* depth, TangoPoseData* pose);
+
+ private:
+  ChunkFileReader file_;
+  int width_;
+  int height_;
+  std::vector<uint8_t> chunk_buffer_;
+  std::vector<uint16_t> depth_buffer_;
+};
+
+}  // namespace tango_perception
+
+#endif  // TANGO_PERCEPTION_DEPTH_IMAGE_RECORDER_H_
@@ -0,0 +1,208 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_PERCEPTION_DEPTH_INTERPOLATOR_H_
+#define TANGO_PERCEPTION_DEPTH_INTERPOLATOR_H_
+
+#include <cstdint>
+#include <vector>
+
+#include <tango_client_api.h>
+#include <tango_support.h>
+
+#include "glm/glm.hpp"
+#include "tango-perception/camera_projection.h"
+#include "tango-perception/image_view.h"
+#include "tango-perception/thread_pool.h"
+
+namespace tango_perception {
+
+// Transformation of a Tango pose as a matrix.
+glm::mat4 GetMatrixFromPose(const double translation[3],
+                            const double orientation[4]);
+
+// Pixel coordinates in the color camera image of a display uv coordinate,
+// the same mapping as tango_gl::util::GetColorCameraUVFromDisplay().
+glm::vec2 GetCameraPixelFromDisplayUv(
+    const float uv[2], TangoSupport_Rotation color_to_display_rotation,
+    int width, int height);
+
+// DepthInterpolator is a source implementation of the nearest neighbor and
+// bilateral entry points of tango_depth_interpolation.h. The methods take
+// the same arguments and return the same error codes as their
+// TangoDepthInterpolation_* counterparts, with two differences: the
+// intrinsics are passed in explicitly instead of being queried from the
+// service, and the point queries take the rotation from the color camera to
+// the display rather than the display rotation alone.
+//
+// The points are projected four at a time and, for the image methods,
+// binned into screen tiles that are filled in parallel. The bilateral
+// weights are rational functions, a biweight kernel in space and a Cauchy
+// kernel in luma, so that four pixels are weighted at a time without
+// evaluating exponentials.
+class DepthInterpolator {
+ public:
+  // @param thread_pool: Runs the parallel loops, usually shared by all the
+  //    depth processing of an app. Not owned, must outlive this object.
+  explicit DepthInterpolator(ThreadPool* thread_pool);
+
+  // Set the color camera the points are projected into.
+  void SetCameraIntrinsics(const TangoCameraIntrinsics& intrinsics);
+
+  // @param nearest_radius: Largest distance in pixels from a point to the
+  //    pixels it is used for by the nearest neighbor methods.
+  // @param bilateral_radius: Radius in pixels of the spatial kernel of the
+  //    bilateral methods.
+  // @param luma_sigma: Luma difference, in [0, 255], at which the range
+  //    kernel of the bilateral methods halves the weight of a point.
+  void SetParameters(int nearest_radius, int bilateral_radius,
+                     float luma_sigma);
+
+  // See TangoDepthInterpolation_getDepthAtPointNearestNeighbor().
+  TangoErrorType GetDepthAtPointNearestNeighbor(
+      const TangoPointCloud* point_cloud,
+      const double point_cloud_translation[3],
+      const double point_cloud_orientation[4],
+      const float color_camera_uv_coordinates[2],
+      TangoSupport_Rotation color_to_display_rotation,
+      const double color_camera_translation[3],
+      const double color_camera_orientation[4], float output_point[3]);
+
+  // See TangoDepthInterpolation_getDepthAtPointBilateral().
+  TangoErrorType GetDepthAtPointBilateral(
+      const TangoPointCloud* point_cloud,
+      const double point_cloud_translation[3],
+      const double point_cloud_orientation[4],
+      const TangoImageBuffer* image_buffer,
+      const float color_camera_uv_coordinates[2],
+      TangoSupport_Rotation color_to_display_rotation,
+      const double color_camera_translation[3],
+      const double color_camera_orientation[4], float output_point[3]);
+
+  // See TangoDepthInterpolation_upsampleImageNearestNeighbor(). Every pixel
+  // gets the depth of the nearest projected point within nearest_radius.
+  //
+  // @param depth_buffer: Resized to the image and filled with depth in
+  //    meters, zero where no point is near enough.
+  TangoErrorType UpsampleImageNearestNeighbor(
+      const TangoPointCloud* point_cloud,
+      const TangoPoseData* color_camera_T_point_cloud,
+      std::vector<float>* depth_buffer);
+
+  // See TangoDepthInterpolation_upsampleImageBilateral(). With approximate
+  // set the weights are evaluated on every other row and column only, and
+  // each result is shared by a 2x2 block of pixels.
+  TangoErrorType UpsampleImageBilateral(
+      bool approximate, const TangoPointCloud* point_cloud,
+      const TangoImageBuffer* image_buffer,
+      const TangoPoseData* color_camera_T_point_cloud,
+      std::vector<float>* depth_buffer);
+
+  // Upsample points that were already projected into the color camera, such
+  // as those of a RegisteredDepthFrame, with the bilateral filter of
+  // UpsampleImageBilateral() if luma is valid and the nearest neighbor
+  // filter of UpsampleImageNearestNeighbor() otherwise.
+  //
+  // @param points_x, points_y: Pixel position of every point, inside the
+  //    image.
+  // @param points_depth: Depth in meters of every point.
+  // @param luma: Luma of the color image, the size of the image, or an
+  //    invalid view.
+  TangoErrorType UpsampleProjectedPoints(const std::vector<float>& points_x,
+                                         const std::vector<float>& points_y,
+                                         const std::vector<float>& points_depth,
+                                         ImageView<const uint8_t> luma,
+                                         bool approximate,
+                                         std::vector<float>* depth_buffer);
+
+ private:
+  // Side of the square screen tiles, in pixels.
+  static const int kTileSize = 32;
+  // Row stride of the per tile buffers. The padding lets the last group of
+  // four pixels of a row run past the tile.
+  static const int kTileStride = kTileSize + 4;
+
+  // The luma plane of a supported image. RGBA images are converted into
+  // rgba_luma_, so the view is valid until the next call.
+  ImageView<const uint8_t> GetLuma(const TangoImageBuffer& image_buffer);
+
+  // Project the points and keep those that land in the image. With a valid
+  // luma view the luma under every point is kept as well.
+  void ProjectPoints(const TangoPointCloud* point_cloud,
+                     const glm::mat4& camera_T_points,
+                     ImageView<const uint8_t> luma);
+
+  // Project the points of one task's slice into slices_[task].
+  void ProjectSlice(const TangoPointCloud* point_cloud,
+                    const glm::mat4& camera_T_points,
+                    ImageView<const uint8_t> luma, int task, int num_tasks);
+
+  // Sort the projected points into the tiles within radius of them.
+  void BinPoints(int radius);
+
+  // Back project a display uv coordinate with the given depth and transform
+  // it to the output frame.
+  void GetOutputPoint(const float uv[2], TangoSupport_Rotation rotation,
+                      float depth, const glm::mat4& output_T_camera,
+                      float output_point[3]) const;
+
+  // Fill one tile of depth_buffer.
+  void RenderNearestTile(int tile, float* depth_buffer) const;
+  void RenderBilateralTile(int tile, ImageView<const uint8_t> image_luma,
+                           bool approximate, float* depth_buffer) const;
+
+  // Pixel bounds of a tile, [x0, x1) x [y0, y1).
+  void GetTileBounds(int tile, int* x0, int* y0, int* x1, int* y1) const;
+
+  ThreadPool* thread_pool_;
+  CameraProjection projection_;
+
+  int width_;
+  int height_;
+  int tiles_x_;
+  int tiles_y_;
+
+  int nearest_radius_;
+  int bilateral_radius_;
+  float luma_sigma_;
+
+  // Points in the image: continuous pixel position, depth and luma.
+  std::vector<float> points_x_;
+  std::vector<float> points_y_;
+  std::vector<float> points_depth_;
+  std::vector<float> points_luma_;
+
+  // Per task projection results, concatenated into points_*.
+  struct ProjectedSlice {
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> depth;
+    std::vector<float> luma;
+  };
+  std::vector<ProjectedSlice> slices_;
+
+  // Luma of the last RGBA image.
+  std::vector<uint8_t> rgba_luma_;
+
+  // Point indices sorted by tile; tile t owns
+  // [tile_offsets_[t], tile_offsets_[t + 1]).
+  std::vector<uint32_t> tile_offsets_;
+  std::vector<uint32_t> tile_points_;
+};
+
+}  // namespace tango_perception
+
+#endif  // TANGO_PERCEPTION_DEPTH_INTERPOLATOR_H_
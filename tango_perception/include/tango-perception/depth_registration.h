@@ -0,0 +1,139 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_PERCEPTION_DEPTH_REGISTRATION_H_
+#define TANGO_PERCEPTION_DEPTH_REGISTRATION_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <tango_client_api.h>
+
+#include "glm/glm.hpp"
+#include "tango-perception/depth_splatter.h"
+#include "tango-perception/image_view.h"
+#include "tango-perception/latest_job_worker.h"
+#include "tango-perception/thread_pool.h"
+
+namespace tango_perception {
+
+// A point cloud registered to a color frame. Frames are published by
+// DepthRegistration and are never modified while anyone holds them.
+struct RegisteredDepthFrame {
+  double depth_timestamp;
+  double color_timestamp;
+
+  // Transformation from the depth camera at depth_timestamp to the color
+  // camera at color_timestamp.
+  glm::mat4 color_T_depth;
+
+  // Depth in meters of the nearest point landing on every pixel of the color
+  // camera, row major, zero where no point landed.
+  int width;
+  int height;
+  std::vector<float> depth;
+
+  // The points that landed on the image, in point order: the center of the
+  // pixel each one landed on and its depth in meters. Consumers that
+  // interpolate depth themselves start from these instead of projecting the
+  // cloud again.
+  std::vector<float> points_x;
+  std::vector<float> points_y;
+  std::vector<float> points_depth;
+
+  // Packed luma of the color image of the pair, width by height, or an
+  // invalid view if no image was submitted. The chroma of a YUV image is
+  // dropped and an RGBA image is converted to grayscale. Points into
+  // luma_data.
+  ImageView<const uint8_t> luma;
+  std::vector<uint8_t> luma_data;
+};
+
+// DepthRegistration projects each (depth, color) frame pair into the color
+// camera once, on a worker thread, and shares the result between any number
+// of consumers. Consumers take a reference counted frame with GetLatest()
+// instead of looking up the relative pose and projecting the points
+// themselves.
+//
+// Pairs run on a LatestJobWorker, so a pair that is still queued when the
+// next one is submitted is replaced and the worker never falls behind.
+// Frames are recycled once no consumer holds them, so steady state
+// registration does not allocate.
+class DepthRegistration {
+ public:
+  // Returns the transformation from the depth camera at depth_timestamp to
+  // the color camera at color_timestamp, or false if it is unknown. Called
+  // on the worker thread.
+  typedef std::function<bool(double color_timestamp, double depth_timestamp,
+                             glm::mat4* color_T_depth)>
+      PoseLookup;
+
+  // @param intrinsics: Unrotated intrinsics of the color camera.
+  // @param thread_pool: Runs the projection, see DepthSplatter.
+  DepthRegistration(const TangoCameraIntrinsics& intrinsics,
+                    const PoseLookup& pose_lookup, ThreadPool* thread_pool);
+
+  DepthRegistration(const DepthRegistration&) = delete;
+  DepthRegistration& operator=(const DepthRegistration&) = delete;
+
+  // Queue a frame pair for registration. May be called from any thread.
+  //
+  // @param image_buffer: Optional color image of the pair, whose luma is
+  //    copied into the frame. Without one the pair is registered to
+  //    color_timestamp.
+  void Submit(const TangoPointCloud* point_cloud,
+              const TangoImageBuffer* image_buffer, double color_timestamp);
+
+  // The newest registered frame, or nullptr if none is ready yet. The frame
+  // stays valid for as long as the caller holds it.
+  std::shared_ptr<const RegisteredDepthFrame> GetLatest() const;
+
+ private:
+  // A copy of a frame pair waiting to be registered.
+  struct Job {
+    TangoPointCloud point_cloud;
+    std::vector<float> points;
+    double color_timestamp;
+    ImageView<const uint8_t> luma;
+    std::vector<uint8_t> luma_data;
+  };
+
+  // Called on the worker thread.
+  void Register(Job* job);
+
+  // A frame no consumer holds, or a new one if all are in use.
+  std::shared_ptr<RegisteredDepthFrame> AcquireFrame();
+
+  PoseLookup pose_lookup_;
+
+  // Owned by the worker thread.
+  DepthSplatter splatter_;
+  std::vector<std::shared_ptr<RegisteredDepthFrame>> frames_;
+
+  // Guards latest_.
+  mutable std::mutex mutex_;
+  std::shared_ptr<const RegisteredDepthFrame> latest_;
+
+  // Last, so that it stops before the members Register() uses go away.
+  LatestJobWorker<Job> worker_;
+};
+
+}  // namespace tango_perception
+
+#endif  // TANGO_PERCEPTION_DEPTH_REGISTRATION_H_
@@ -0,0 +1,136 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_PERCEPTION_DEPTH_SPLATTER_H_
+#define TANGO_PERCEPTION_DEPTH_SPLATTER_H_
+
+#include <cstdint>
+#include <vector>
+
+#include <tango_client_api.h>
+
+#include "glm/glm.hpp"
+#include "tango-perception/camera_projection.h"
+#include "tango-perception/thread_pool.h"
+
+namespace tango_perception {
+
+// DepthSplatter renders a point cloud into a dense depth image of another
+// camera, usually the color camera, by drawing every point as a square of
+// constant depth. Where squares overlap the nearest point wins.
+//
+// The work is split in three stages:
+//  - the points are transformed and projected four at a time in parallel,
+//    with the lens distortion looked up from a CameraProjection table,
+//  - the projected squares are binned into fixed size screen tiles,
+//  - the tiles are z-tested and finalized in parallel.
+// Only tiles covered in this frame or the previous one are cleared and
+// rewritten, so the cost follows the number of points rather than the
+// resolution of the image.
+class DepthSplatter {
+ public:
+  // @param thread_pool: Runs the parallel loops, usually shared by all the
+  //    depth processing of an app. Not owned, must outlive this object.
+  explicit DepthSplatter(ThreadPool* thread_pool);
+
+  // Set the camera the points are projected into and clear the depth image.
+  void SetCameraIntrinsics(const TangoCameraIntrinsics& intrinsics);
+
+  // Replace the depth image with the splatted point cloud.
+  //
+  // @param point_cloud: The points to splat.
+  // @param camera_T_points: Transformation from the frame of the points to
+  //    the camera frame.
+  // @param window_radius: Each point covers (2 * window_radius + 1)^2 pixels
+  //    centered on its projection.
+  void Splat(const TangoPointCloud* point_cloud,
+             const glm::mat4& camera_T_points, int window_radius);
+
+  // Depth in meters, row major, zero where no point landed.
+  const std::vector<float>& GetDepthImage() const { return depth_image_; }
+  const CameraProjection& GetCameraProjection() const { return projection_; }
+  int GetWidth() const { return width_; }
+  int GetHeight() const { return height_; }
+
+  // Pixel and depth of every point of the last Splat(), in point order,
+  // with zero depth for points that did not land in the image.
+  const std::vector<int32_t>& GetProjectedX() const { return projected_x_; }
+  const std::vector<int32_t>& GetProjectedY() const { return projected_y_; }
+  const std::vector<float>& GetProjectedDepth() const {
+    return projected_depth_;
+  }
+
+  // Write the depth image as 8 bit luminance, 255 at max_depth and beyond.
+  // Only the tiles changed by the last Splat() are written, so grayscale
+  // should be the buffer passed after the previous Splat(). It is resized
+  // and cleared if it does not match the image size.
+  void ConvertToGrayscale(float max_depth, std::vector<uint8_t>* grayscale);
+
+ private:
+  // Side of the square screen tiles, in pixels.
+  static const int kTileSize = 32;
+
+  // Project the points of one task's slice into projected_*.
+  void ProjectPoints(const TangoPointCloud* point_cloud,
+                     const glm::mat4& camera_T_points, int task,
+                     int num_tasks);
+
+  // Sort the projected points into the tiles their squares overlap.
+  void BinPoints(uint32_t num_points, int window_radius);
+
+  // Clear, z-test and finalize one tile.
+  void RenderTile(int tile, int window_radius);
+
+  // Inclusive range of tiles overlapped by the square of a projected point.
+  void GetTileRange(uint32_t point, int window_radius, int* tile_x0,
+                    int* tile_y0, int* tile_x1, int* tile_y1) const;
+
+  // Pixel bounds of a tile, [x0, x1) x [y0, y1).
+  void GetTileBounds(int tile, int* x0, int* y0, int* x1, int* y1) const;
+
+  ThreadPool* thread_pool_;
+  CameraProjection projection_;
+
+  int width_;
+  int height_;
+  float fx_;
+  float fy_;
+  float cx_;
+  float cy_;
+  int tiles_x_;
+  int tiles_y_;
+
+  std::vector<float> depth_image_;
+
+  // Projected pixel and depth of every point, zero depth if not visible.
+  std::vector<int32_t> projected_x_;
+  std::vector<int32_t> projected_y_;
+  std::vector<float> projected_depth_;
+
+  // Point indices sorted by tile; tile t owns
+  // [tile_offsets_[t], tile_offsets_[t + 1]).
+  std::vector<uint32_t> tile_offsets_;
+  std::vector<uint32_t> tile_points_;
+
+  // Tiles with points in the last frame, and the tiles rendered by the last
+  // Splat(): those with points now or in the frame before.
+  std::vector<uint8_t> tile_was_covered_;
+  std::vector<int> changed_tiles_;
+};
+
+}  // namespace tango_perception
+
+#endif  // TANGO_PERCEPTION_DEPTH_SPLATTER_H_
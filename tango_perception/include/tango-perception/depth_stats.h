@@ -0,0 +1,65 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_PERCEPTION_DEPTH_STATS_H_
+#define TANGO_PERCEPTION_DEPTH_STATS_H_
+
+#include <cstdint>
+
+#include <tango_client_api.h>
+
+namespace tango_perception {
+
+// Summary of one point cloud, cheap enough to compute for every frame.
+struct DepthStats {
+  static const int kNumDepthBins = 16;
+  static const int kNumConfidenceBins = 8;
+
+  double timestamp;
+  uint32_t num_points;
+  // Points with a positive depth. The remaining statistics only cover these.
+  uint32_t num_valid_points;
+  // Fraction of the expected number of points that were valid.
+  float coverage;
+
+  // Depth (z) range, mean and standard deviation in meters.
+  float min_depth;
+  float max_depth;
+  float mean_depth;
+  float stddev_depth;
+  float mean_confidence;
+
+  // Depth histogram with kNumDepthBins equal bins from 0 to the histogram
+  // range given to ComputeDepthStats(). Deeper points go into the last bin.
+  uint32_t depth_histogram[kNumDepthBins];
+  // Confidence histogram with kNumConfidenceBins equal bins from 0 to 1.
+  uint32_t confidence_histogram[kNumConfidenceBins];
+};
+
+// Compute the statistics of point_cloud in a single SIMD pass.
+//
+// @param point_cloud: The point cloud to summarize.
+// @param histogram_range: Depth covered by the depth histogram, meters.
+// @param expected_points: Number of points of a fully covered frame, such as
+//    the "max_point_cloud_elements" config value, used for the coverage.
+// @param stats: Output statistics.
+void ComputeDepthStats(const TangoPointCloud* point_cloud,
+                       float histogram_range, uint32_t expected_points,
+                       DepthStats* stats);
+
+}  // namespace tango_perception
+
+#endif  // TANGO_PERCEPTION_DEPTH_STATS_H_
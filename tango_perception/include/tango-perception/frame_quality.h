@@ -0,0 +1,105 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_PERCEPTION_FRAME_QUALITY_H_
+#define TANGO_PERCEPTION_FRAME_QUALITY_H_
+
+#include <tango_client_api.h>
+
+#include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
+#include "tango-perception/image_pyramid.h"
+
+namespace tango_perception {
+
+// Quality of one camera frame, see FrameQualityScorer.
+struct FrameQuality {
+  // Variance of the Laplacian of the scored pyramid level, in squared luma
+  // levels. Blur lowers it, but so do plain scenes.
+  float sharpness;
+  // Sharpness relative to recent frames taken while the camera was steady,
+  // 1 for a typical frame of the current scene.
+  float relative_sharpness;
+  // Exposure duration in seconds.
+  float exposure;
+  // Rotation speed of the camera in radians per second, zero for the first
+  // frame.
+  float angular_speed;
+  // Motion blur expected from the rotation during the exposure, in pixels
+  // of the full resolution frame.
+  float motion_blur;
+  // True if the frame passes the thresholds of the scorer.
+  bool is_usable;
+};
+
+// FrameQualityScorer rates camera frames so that expensive consumers, such
+// as marker detection or the color updates of 3D reconstruction, can skip
+// frames that cannot help them.
+//
+// Two cheap measures are combined. Motion blur is predicted from the
+// exposure duration of the frame and the rotation speed of the camera
+// between scored frames. Sharpness is the variance of the Laplacian of a
+// downscaled luma level from the frame's ImagePyramid, compared with its
+// running average, so that dull scenes are not mistaken for blurred ones.
+//
+// A scorer keeps the previous pose and the sharpness average, so it rates
+// one stream of frames from one thread.
+class FrameQualityScorer {
+ public:
+  FrameQualityScorer();
+
+  // Set the unrotated intrinsics of the camera that takes the frames.
+  void SetCameraIntrinsics(const TangoCameraIntrinsics& intrinsics);
+
+  // @param level: Pyramid level the sharpness is measured on.
+  // @param max_motion_blur: Largest predicted motion blur of a usable frame,
+  //    in pixels.
+  // @param min_relative_sharpness: Smallest relative sharpness of a usable
+  //    frame.
+  void SetParameters(int level, float max_motion_blur,
+                     float min_relative_sharpness);
+
+  // Rate a frame.
+  //
+  // @param frame: The frame, for its timestamp and exposure.
+  // @param pyramid: Pyramid of the frame, from an ImagePyramidCache.
+  // @param world_R_camera: Orientation of the camera at the frame timestamp
+  //    in any fixed world frame.
+  FrameQuality Score(const TangoImageBuffer& frame, ImagePyramid* pyramid,
+                     const glm::quat& world_R_camera);
+
+  // Forget the previous pose and the sharpness average, e.g. after a pause.
+  void Reset();
+
+ private:
+  float focal_length_;
+
+  int level_;
+  float max_motion_blur_;
+  float min_relative_sharpness_;
+
+  bool has_previous_;
+  double previous_timestamp_;
+  glm::quat previous_world_R_camera_;
+
+  // Running average of the sharpness of steady frames, zero before the
+  // first one.
+  float average_sharpness_;
+};
+
+}  // namespace tango_perception
+
+#endif  // TANGO_PERCEPTION_FRAME_QUALITY_H_
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_PERCEPTION_GUIDED_DEPTH_UPSAMPLER_H_
+#define TANGO_PERCEPTION_GUIDED_DEPTH_UPSAMPLER_H_
+
+#include <cstdint>
+#include <vector>
+
+#include <tango_client_api.h>
+
+#include "tango-perception/image_view.h"
+#include "tango-perception/thread_pool.h"
+
+namespace tango_perception {
+
+// GuidedDepthUpsampler turns sparse depth, such as a point cloud splatted
+// with a window radius of zero, into dense depth that follows the edges of
+// the color image. It implements the guided filter of He et al. with the
+// luma plane of the color camera frame as guidance, normalized so that only
+// pixels with depth contribute.
+//
+// The linear coefficients are computed on a grid subsampled by the scale
+// factor and applied at full resolution ("fast guided filter"). All window
+// sums are running box filters, so the cost is linear in the number of
+// pixels and does not depend on the radius. Rows and columns are spread over
+// a thread pool.
+class GuidedDepthUpsampler {
+ public:
+  // @param thread_pool: Runs the parallel loops, usually shared by all the
+  //    depth processing of an app. Not owned, must outlive this object.
+  explicit GuidedDepthUpsampler(ThreadPool* thread_pool);
+
+  // @param scale: Subsampling of the coefficient grid, in pixels.
+  // @param radius: Window radius on the coefficient grid, so the window
+  //    covers (2 * radius + 1) * scale pixels on each side.
+  // @param epsilon: Regularization of the guide variance, for luma in
+  //    [0, 1]. Edges with a smaller contrast are smoothed over.
+  void SetParameters(int scale, int radius, float epsilon);
+
+  // Fill the depth image from sparse depth.
+  //
+  // @param guide: Color camera frame in NV21, YV12 or RGBA of the same size
+  //    as the depth. Its luma plane is the guidance; RGBA frames are
+  //    converted to luma first.
+  // @param sparse_depth: Row major depth in meters, zero where unknown.
+  // @return false if the guide does not match the depth size or is in
+  //    another format.
+  bool Upsample(const TangoImageBuffer* guide,
+                const std::vector<float>& sparse_depth, int width,
+                int height);
+
+  // As above, guided by a luma image of the same size as the depth, such as
+  // the luma of a RegisteredDepthFrame.
+  //
+  // @return false if the guide is invalid or does not match the depth size.
+  bool Upsample(ImageView<const uint8_t> guide_luma,
+                const std::vector<float>& sparse_depth, int width,
+                int height);
+
+  // Depth in meters, row major, zero where no depth was in reach.
+  const std::vector<float>& GetDepthImage() const { return depth_image_; }
+
+  // Write the depth image as 8 bit luminance, 255 at max_depth and beyond.
+  void ConvertToGrayscale(float max_depth, std::vector<uint8_t>* grayscale);
+
+ private:
+  // Sum up the pixels with depth of every cell of one grid row.
+  void AccumulateCells(ImageView<const uint8_t> guide,
+                       const std::vector<float>& sparse_depth, int grid_row);
+
+  // In place box filter over the grid, zero outside. Every cell holds
+  // stride interleaved channels, a multiple of four.
+  void BoxFilter(std::vector<float>* channels, int stride);
+
+  // Interpolate the coefficients of one grid row to every pixel column.
+  void ExpandRow(int grid_row);
+
+  // Compute the depth of the full resolution rows of one grid row.
+  void ApplyCoefficients(ImageView<const uint8_t> guide, int grid_row);
+
+  ThreadPool* thread_pool_;
+
+  int scale_;
+  int radius_;
+  float epsilon_;
+
+  int width_;
+  int height_;
+  int grid_width_;
+  int grid_height_;
+
+  // Interleaved sums of every cell.
+  std::vector<float> sums_;
+  // Interleaved a, b and a valid flag per cell, then their window means.
+  std::vector<float> coefficients_;
+  // Horizontal pass result of the box filter.
+  std::vector<float> box_temp_;
+
+  // Per grid row: a, b and the validity of every pixel column, width floats
+  // each.
+  std::vector<float> expanded_;
+
+  // Left grid column and interpolation weight of every pixel column.
+  std::vector<int> column_index_;
+  std::vector<float> column_weight_;
+
+  std::vector<float> depth_image_;
+
+  // Luma of an RGBA guide.
+  std::vector<uint8_t> rgba_luma_;
+};
+
+}  // namespace tango_perception
+
+#endif  // TANGO_PERCEPTION_GUIDED_DEPTH_UPSAMPLER_H_
@@ -0,0 +1,206 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_PERCEPTION_ICP_H_
+#define TANGO_PERCEPTION_ICP_H_
+
+#include <functional>
+#include <vector>
+
+#include <tango_client_api.h>
+
+#include "glm/glm.hpp"
+#include "tango-perception/point_cloud_index.h"
+#include "tango-perception/thread_pool.h"
+
+namespace tango_perception {
+
+// A point cloud projected into the image of the depth camera that captured
+// it, with one vertex and one normal per pixel. Pixels without a point have a
+// zero vertex. The normals are estimated from neighbouring pixels, which is
+// what makes projective data association cheap.
+class OrganizedPointCloud {
+ public:
+  OrganizedPointCloud();
+
+  // Project point_cloud into the image described by intrinsics, scaled by
+  // scale (0.5 halves the resolution), and estimate normals. When several
+  // points fall into one pixel the nearest one is kept.
+  void Build(const TangoPointCloud* point_cloud,
+             const TangoCameraIntrinsics& intrinsics, float scale,
+             float min_confidence);
+
+  // Pixel coordinates of a point in the camera frame of this cloud. Returns
+  // false if the point is behind the camera or outside of the image.
+  bool Project(const glm::vec3& point, int* pixel_index) const;
+
+  bool IsValid(int pixel_index) const {
+    return normals_[pixel_index] != glm::vec3(0.0f);
+  }
+  const glm::vec3& GetVertex(int pixel_index) const {
+    return vertices_[pixel_index];
+  }
+  const glm::vec3& GetNormal(int pixel_index) const {
+    return normals_[pixel_index];
+  }
+
+  int GetWidth() const { return width_; }
+  int GetHeight() const { return height_; }
+
+ private:
+  int width_;
+  int height_;
+  float fx_;
+  float fy_;
+  float cx_;
+  float cy_;
+  std::vector<glm::vec3> vertices_;
+  std::vector<glm::vec3> normals_;
+};
+
+// Point-to-plane iterative closest point registration.
+//
+// Each iteration associates source points with target points, linearizes
+// the point-to-plane error around the current estimate and solves the 6x6
+// normal equations for a small rotation and translation. The normal
+// equations are accumulated in SIMD lanes over batches of correspondences,
+// with the batches reduced in parallel on a thread pool.
+//
+// Two kinds of target are supported:
+//  - a single point cloud organized in its depth camera image, associated
+//    by projecting the source points into that image (projective data
+//    association). This is the cheap option for frame to frame drift checks.
+//  - an accumulated PointCloudIndex, associated by nearest neighbour search
+//    with normals from the local neighbourhood.
+class PointToPlaneIcp {
+ public:
+  struct Options {
+    Options();
+
+    // Maximum number of Gauss-Newton iterations.
+    int max_iterations;
+    // Correspondences further apart than this (in meters) are rejected.
+    float max_correspondence_distance;
+    // Points with a lower confidence are ignored.
+    float min_confidence;
+    // The source cloud is subsampled to at most this many points.
+    int max_source_points;
+    // Resolution scale of the organized target relative to the depth camera.
+    float target_scale;
+    // Number of neighbours used to estimate normals of an indexed target.
+    int normal_neighbors;
+    // Iteration stops once an update rotates less than this (radians) and
+    // translates less than convergence_translation (meters).
+    float convergence_rotation;
+    float convergence_translation;
+    // Minimum number of correspondences to trust a solution.
+    int min_correspondences;
+  };
+
+  struct Result {
+    // The refined transformation from the source frame to the target frame.
+    glm::mat4 target_T_source;
+    // Root mean square point-to-plane error of the last iteration, meters.
+    float rms_error;
+    // Number of correspondences in the last iteration.
+    int num_correspondences;
+    int num_iterations;
+    bool converged;
+  };
+
+  // @param thread_pool: Runs the association and the reductions. Not owned,
+  //    must outlive this object.
+  PointToPlaneIcp(const Options& options, ThreadPool* thread_pool);
+
+  // Set the target to a single point cloud captured by the depth camera with
+  // the given intrinsics. The target is organized once and can be aligned
+  // against any number of times.
+  void SetTarget(const TangoPointCloud* target,
+                 const TangoCameraIntrinsics& depth_intrinsics);
+
+  // Align source against the target set with SetTarget().
+  //
+  // @param source: The point cloud to align.
+  // @param initial_target_T_source: Initial guess, usually from the relative
+  //    pose reported by motion tracking.
+  // @param result: The refined transformation and quality measures.
+  // @return true if enough correspondences were found and the solve
+  //    succeeded, even if the iteration limit was hit before convergence.
+  bool Align(const TangoPointCloud* source,
+             const glm::mat4& initial_target_T_source, Result* result);
+
+  // Align source against an accumulated index.
+  bool AlignToIndex(const PointCloudIndex& index,
+                    const TangoPointCloud* source,
+                    const glm::mat4& initial_index_T_source, Result* result);
+
+ private:
+  // Structure of arrays of matched source and target points, ready for the
+  // SIMD accumulation.
+  struct Correspondences {
+    void Clear();
+    void Add(const glm::vec3& source, const glm::vec3& target,
+             const glm::vec3& normal);
+    size_t Size() const { return source_x.size(); }
+
+    std::vector<float> source_x, source_y, source_z;
+    std::vector<float> target_x, target_y, target_z;
+    std::vector<float> normal_x, normal_y, normal_z;
+  };
+
+  // The upper triangle of the 6x6 normal equations, the right hand side and
+  // the error sum.
+  struct LinearSystem {
+    void Clear();
+    void Add(const LinearSystem& other);
+
+    double ata[21];
+    double atb[6];
+    double error;
+    int count;
+  };
+
+  // Pick the source points to use and store them in source_points_.
+  void SelectSourcePoints(const TangoPointCloud* source);
+
+  // Fill correspondences_[task] for a slice of source_points_.
+  void AssociateProjective(const glm::mat4& target_T_source, int task,
+                           int num_tasks);
+  void AssociateIndex(const PointCloudIndex& index,
+                      const glm::mat4& index_T_source, int task,
+                      int num_tasks);
+
+  // The shared Gauss-Newton loop. associate(task, num_tasks, transform)
+  // fills correspondences_[task].
+  bool Solve(const std::function<void(int, int, const glm::mat4&)>& associate,
+             const glm::mat4& initial_target_T_source, Result* result);
+
+  static void Accumulate(const Correspondences& correspondences,
+                         LinearSystem* system);
+
+  Options options_;
+  ThreadPool* thread_pool_;
+  OrganizedPointCloud target_;
+  std::vector<glm::vec3> source_points_;
+
+  // Per task scratch, reused between iterations and calls.
+  std::vector<Correspondences> correspondences_;
+  std::vector<LinearSystem> systems_;
+};
+
+}  // namespace tango_perception
+
+#endif  // TANGO_PERCEPTION_ICP_H_
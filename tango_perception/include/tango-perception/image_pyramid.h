@@ -0,0 +1,112 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_PERCEPTION_IMAGE_PYRAMID_H_
+#define TANGO_PERCEPTION_IMAGE_PYRAMID_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <tango_client_api.h>
+
+#include "tango-perception/image_view.h"
+
+namespace tango_perception {
+
+// ImagePyramid holds the luma of one camera frame at successively halved
+// resolutions. Level 0 is the luma plane of the frame itself, viewed in
+// place. Level n is reduced from level n - 1 with Downscale2x() the first
+// time any consumer asks for it, so every level is built at most once per
+// frame, and is then shared read-only by all consumers of the frame.
+//
+// Pyramids are handed out by ImagePyramidCache.
+class ImagePyramid {
+ public:
+  ImagePyramid();
+
+  ImagePyramid(const ImagePyramid&) = delete;
+  ImagePyramid& operator=(const ImagePyramid&) = delete;
+
+  // The given level, building it and the levels above it if needed. Safe to
+  // call from several threads; a level that is already built is returned
+  // without locking. The view stays valid as long as the pyramid is held.
+  //
+  // @param level: Less than GetNumLevels().
+  ImageView<const uint8_t> GetLevel(int level);
+
+  int GetNumLevels() const { return num_levels_; }
+  double GetTimestamp() const { return timestamp_; }
+  int64_t GetFrameNumber() const { return frame_number_; }
+
+ private:
+  friend class ImagePyramidCache;
+
+  // Start a pyramid over the luma of frame. Levels that would be smaller
+  // than one pixel are dropped.
+  void Reset(const TangoImageBuffer& frame, int num_levels);
+
+  double timestamp_;
+  int64_t frame_number_;
+  int num_levels_;
+
+  // Views of the levels, level 0 into the frame and the others into
+  // storage_. Levels below num_built_levels_ are immutable until Reset().
+  std::vector<ImageView<const uint8_t>> levels_;
+  std::vector<std::vector<uint8_t>> storage_;
+  std::atomic<int> num_built_levels_;
+
+  // Serializes building.
+  std::mutex mutex_;
+};
+
+// ImagePyramidCache attaches an ImagePyramid to camera frames, so that every
+// consumer of a frame, such as marker detection, depth filtering and frame
+// scoring, shares the levels built by the others.
+//
+// Pyramids come from a pool: one that no consumer holds any more is reset
+// for the next frame, keeping the capacity of its level buffers, so no
+// memory is allocated per frame once the pool has warmed up.
+class ImagePyramidCache {
+ public:
+  // @param num_levels: Number of levels including the full resolution.
+  explicit ImagePyramidCache(int num_levels = 4);
+
+  // The pyramid of frame, which must be NV21 or YV12. Calls for the frame
+  // with the same timestamp and data share one pyramid.
+  //
+  // Level 0 and the levels not yet built read the frame, so it must stay
+  // unchanged while the pyramid is held, as the TangoImageBuffer of an
+  // ImageBufferMailbox or TangoSupport_ImageBufferManager does until the
+  // next frame is fetched.
+  //
+  // @return nullptr if the frame is not in a YUV format.
+  std::shared_ptr<ImagePyramid> Get(const TangoImageBuffer& frame);
+
+ private:
+  int num_levels_;
+
+  std::mutex mutex_;
+  std::vector<std::shared_ptr<ImagePyramid>> pyramids_;
+  std::shared_ptr<ImagePyramid> latest_;
+  const uint8_t* latest_data_;
+};
+
+}  // namespace tango_perception
+
+#endif  // TANGO_PERCEPTION_IMAGE_PYRAMID_H_
@@ -0,0 +1,347 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_PERCEPTION_IMAGE_VIEW_H_
+#define TANGO_PERCEPTION_IMAGE_VIEW_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <tango_client_api.h>
+
+#include "tango-perception/simd.h"
+
+namespace tango_perception {
+
+// ImageView is a non-owning view of one plane of an image, such as the luma
+// plane of a TangoImageBuffer or one plane of a TangoImage.
+//
+// Rows are row_stride elements apart and the pixels of a row pixel_stride
+// elements apart, so padded rows, interleaved chroma and crops are all
+// addressed the same way. For camera planes the element is uint8_t and both
+// strides are in bytes, as in the Tango structs. Views are cheap to copy and
+// are passed by value.
+template <typename T>
+class ImageView {
+ public:
+  ImageView()
+      : data_(nullptr), width_(0), height_(0), row_stride_(0),
+        pixel_stride_(0) {}
+
+  ImageView(T* data, int width, int height, int row_stride,
+            int pixel_stride = 1)
+      : data_(data), width_(width), height_(height), row_stride_(row_stride),
+        pixel_stride_(pixel_stride) {}
+
+  // A view of T converts to a view of const T.
+  template <typename U>
+  ImageView(const ImageView<U>& other)  // NOLINT(runtime/explicit)
+      : data_(other.GetData()), width_(other.GetWidth()),
+        height_(other.GetHeight()), row_stride_(other.GetRowStride()),
+        pixel_stride_(other.GetPixelStride()) {}
+
+  T* GetData() const { return data_; }
+  int GetWidth() const { return width_; }
+  int GetHeight() const { return height_; }
+  int GetRowStride() const { return row_stride_; }
+  int GetPixelStride() const { return pixel_stride_; }
+
+  // False for a default constructed view or an unsupported format.
+  bool IsValid() const { return data_ != nullptr; }
+
+  T* GetRow(int y) const {
+    return data_ + static_cast<ptrdiff_t>(y) * row_stride_;
+  }
+
+  T& At(int x, int y) const { return GetRow(y)[x * pixel_stride_]; }
+
+  // A view of the rectangle at (x, y), which must lie inside this view.
+  ImageView Crop(int x, int y, int width, int height) const {
+    return ImageView(&At(x, y), width, height, row_stride_, pixel_stride_);
+  }
+
+ private:
+  T* data_;
+  int width_;
+  int height_;
+  int row_stride_;
+  int pixel_stride_;
+};
+
+// The planes of a YUV 4:2:0 image. The chroma planes are half resolution,
+// rounded up, and may share one buffer: in NV21 v starts at the chroma plane
+// and u one byte later, both with a pixel stride of two.
+struct YuvPlanes {
+  ImageView<const uint8_t> y;
+  ImageView<const uint8_t> u;
+  ImageView<const uint8_t> v;
+};
+
+// Split a camera frame into its planes.
+//
+// TangoImageBuffer stores the chroma of NV21 right after stride * height
+// bytes of luma with the same stride, and the V then U planes of YV12 with
+// half the stride, the layout GetImageBufferDataSize() assumes.
+//
+// @return false if the frame is not NV21 or YV12.
+inline bool GetYuvPlanes(const TangoImageBuffer& image, YuvPlanes* planes) {
+  const int width = static_cast<int>(image.width);
+  const int height = static_cast<int>(image.height);
+  const int stride = static_cast<int>(image.stride);
+  const int chroma_width = (width + 1) / 2;
+  const int chroma_height = (height + 1) / 2;
+  const uint8_t* chroma =
+      image.data + static_cast<size_t>(stride) * image.height;
+  planes->y = ImageView<const uint8_t>(image.data, width, height, stride);
+  switch (image.format) {
+    case TANGO_HAL_PIXEL_FORMAT_YCrCb_420_SP:
+      planes->v = ImageView<const uint8_t>(chroma, chroma_width,
+                                           chroma_height, stride, 2);
+      planes->u = ImageView<const uint8_t>(chroma + 1, chroma_width,
+                                           chroma_height, stride, 2);
+      return true;
+    case TANGO_HAL_PIXEL_FORMAT_YV12: {
+      const int chroma_stride = stride / 2;
+      planes->v = ImageView<const uint8_t>(chroma, chroma_width,
+                                           chroma_height, chroma_stride);
+      planes->u = ImageView<const uint8_t>(
+          chroma + static_cast<size_t>(chroma_stride) * (image.height / 2),
+          chroma_width, chroma_height, chroma_stride);
+      return true;
+    }
+    default:
+      *planes = YuvPlanes();
+      return false;
+  }
+}
+
+// Split a TangoImage into its planes. Planes 0, 1 and 2 are Y, U and V with
+// the row and pixel strides reported by the camera, as in Android's
+// YUV_420_888.
+//
+// @return false if the image is not in a YUV format.
+inline bool GetYuvPlanes(const TangoImage& image, YuvPlanes* planes) {
+  if ((image.format != TANGO_HAL_PIXEL_FORMAT_YCrCb_420_SP &&
+       image.format != TANGO_HAL_PIXEL_FORMAT_YV12) ||
+      image.num_planes < 3) {
+    *planes = YuvPlanes();
+    return false;
+  }
+  const int width = static_cast<int>(image.width);
+  const int height = static_cast<int>(image.height);
+  ImageView<const uint8_t>* views[3] = {&planes->y, &planes->u, &planes->v};
+  for (int plane = 0; plane < 3; ++plane) {
+    const int divisor = plane == 0 ? 1 : 2;
+    *views[plane] = ImageView<const uint8_t>(
+        image.plane_data[plane], (width + divisor - 1) / divisor,
+        (height + divisor - 1) / divisor, image.plane_row_stride[plane],
+        image.plane_pixel_stride[plane]);
+  }
+  return true;
+}
+
+// The luma plane of a YUV camera frame, or an invalid view for other
+// formats.
+inline ImageView<const uint8_t> GetLumaPlane(const TangoImageBuffer& image) {
+  YuvPlanes planes;
+  GetYuvPlanes(image, &planes);
+  return planes.y;
+}
+
+// An RGBA frame as a view of its red channel with a pixel stride of four,
+// so At(x, y) is the first byte of a pixel. Invalid for other formats.
+inline ImageView<const uint8_t> GetRgbaPlane(const TangoImageBuffer& image) {
+  if (image.format != TANGO_HAL_PIXEL_FORMAT_RGBA_8888) {
+    return ImageView<const uint8_t>();
+  }
+  return ImageView<const uint8_t>(image.data, static_cast<int>(image.width),
+                                  static_cast<int>(image.height),
+                                  static_cast<int>(image.stride), 4);
+}
+
+// Copy the overlapping part of two views, for example to crop a region of
+// interest out of a frame with source.Crop(). Rows with a pixel stride of
+// one on both sides are copied with memcpy.
+template <typename S, typename T>
+void CopyImage(ImageView<S> source, ImageView<T> destination) {
+  const int width = std::min(source.GetWidth(), destination.GetWidth());
+  const int height = std::min(source.GetHeight(), destination.GetHeight());
+  const bool packed =
+      source.GetPixelStride() == 1 && destination.GetPixelStride() == 1;
+  for (int y = 0; y < height; ++y) {
+    if (packed) {
+      std::memcpy(destination.GetRow(y), source.GetRow(y), width * sizeof(T));
+      continue;
+    }
+    for (int x = 0; x < width; ++x) {
+      destination.At(x, y) = source.At(x, y);
+    }
+  }
+}
+
+// Halve an 8 bit plane by averaging 2x2 blocks, rounded to nearest. The
+// destination is source.GetWidth() / 2 by source.GetHeight() / 2; an odd
+// last row or column of the source is ignored.
+//
+// Packed rows are reduced 16 source pixels at a time in 32 bit vector lanes:
+// each lane sums the even and odd bytes of both rows in 16 bit fields and
+// narrows the four results to bytes without any shuffles.
+inline void Downscale2x(ImageView<const uint8_t> source,
+                        ImageView<uint8_t> destination) {
+  const int width =
+      std::min(source.GetWidth() / 2, destination.GetWidth());
+  const int height =
+      std::min(source.GetHeight() / 2, destination.GetHeight());
+  const bool packed =
+      source.GetPixelStride() == 1 && destination.GetPixelStride() == 1;
+  const simd::UInt4 even_mask = simd::SplatUInt(0x00ff00ffu);
+  const simd::UInt4 rounding = simd::SplatUInt(0x00020002u);
+  for (int y = 0; y < height; ++y) {
+    const uint8_t* top = source.GetRow(2 * y);
+    const uint8_t* bottom = source.GetRow(2 * y + 1);
+    uint8_t* output = destination.GetRow(y);
+    int x = 0;
+    if (packed) {
+      for (; x + 8 <= width; x += 8) {
+        const simd::UInt4 a = simd::LoadBytes(top + 2 * x);
+        const simd::UInt4 b = simd::LoadBytes(bottom + 2 * x);
+        simd::UInt4 sums = (a & even_mask) + ((a >> 8) & even_mask) +
+                           (b & even_mask) + ((b >> 8) & even_mask) +
+                           rounding;
+        sums = (sums >> 2) & even_mask;
+        sums = (sums | (sums >> 8)) & simd::SplatUInt(0xffffu);
+        for (int lane = 0; lane < 4; ++lane) {
+          const uint16_t pair = static_cast<uint16_t>(sums[lane]);
+          std::memcpy(output + x + 2 * lane, &pair, sizeof(pair));
+        }
+      }
+    }
+    for (; x < width; ++x) {
+      const int x0 = 2 * x * source.GetPixelStride();
+      const int x1 = x0 + source.GetPixelStride();
+      const int sum = top[x0] + top[x1] + bottom[x0] + bottom[x1];
+      output[x * destination.GetPixelStride()] =
+          static_cast<uint8_t>((sum + 2) >> 2);
+    }
+  }
+}
+
+// Convert RGBA pixels, such as GetRgbaPlane(), to BT.601 luma. Four pixels
+// are weighted at a time in 32 bit vector lanes.
+inline void ConvertRgbaToGrayscale(ImageView<const uint8_t> rgba,
+                                   ImageView<uint8_t> grayscale) {
+  const int width = std::min(rgba.GetWidth(), grayscale.GetWidth());
+  const int height = std::min(rgba.GetHeight(), grayscale.GetHeight());
+  const bool packed =
+      rgba.GetPixelStride() == 4 && grayscale.GetPixelStride() == 1;
+  const simd::UInt4 byte_mask = simd::SplatUInt(0xffu);
+  for (int y = 0; y < height; ++y) {
+    const uint8_t* input = rgba.GetRow(y);
+    uint8_t* output = grayscale.GetRow(y);
+    int x = 0;
+    if (packed) {
+      for (; x + 4 <= width; x += 4) {
+        const simd::UInt4 pixels = simd::LoadBytes(input + 4 * x);
+        const simd::UInt4 luma =
+            (77 * (pixels & byte_mask) + 150 * ((pixels >> 8) & byte_mask) +
+             29 * ((pixels >> 16) & byte_mask) + 128) >> 8;
+        for (int lane = 0; lane < 4; ++lane) {
+          output[x + lane] = static_cast<uint8_t>(luma[lane]);
+        }
+      }
+    }
+    for (; x < width; ++x) {
+      const uint8_t* pixel = &rgba.At(x, y);
+      output[x * grayscale.GetPixelStride()] = static_cast<uint8_t>(
+          (77 * pixel[0] + 150 * pixel[1] + 29 * pixel[2] + 128) >> 8);
+    }
+  }
+}
+
+// Convert YUV 4:2:0 planes, NV21 or YV12 alike, to RGBA with alpha 255.
+//
+// Full range BT.601 in 7 bit fixed point. The chroma terms are computed
+// once per 2x2 block and added to its four luma values in one vector, then
+// clamped with vector masks.
+inline void ConvertYuvToRgba(const YuvPlanes& yuv, ImageView<uint8_t> rgba) {
+  const int width = std::min(yuv.y.GetWidth(), rgba.GetWidth());
+  const int height = std::min(yuv.y.GetHeight(), rgba.GetHeight());
+  const simd::Int4 zero = simd::SplatInt(0);
+  const simd::Int4 max_value = simd::SplatInt(255);
+  auto clamp = [&zero, &max_value](simd::Int4 value) {
+    value = value & ~(value < zero);
+    return (value | (value > max_value)) & max_value;
+  };
+  for (int y = 0; y < height; y += 2) {
+    const int y1 = std::min(y + 1, height - 1);
+    for (int x = 0; x < width; x += 2) {
+      const int x1 = std::min(x + 1, width - 1);
+      const int u = yuv.u.At(x / 2, y / 2) - 128;
+      const int v = yuv.v.At(x / 2, y / 2) - 128;
+      const simd::Int4 luma =
+          simd::Int4{yuv.y.At(x, y), yuv.y.At(x1, y), yuv.y.At(x, y1),
+                     yuv.y.At(x1, y1)} * 128 + 64;
+      const simd::Int4 r = clamp((luma + 179 * v) >> 7);
+      const simd::Int4 g = clamp((luma - 44 * u - 91 * v) >> 7);
+      const simd::Int4 b = clamp((luma + 227 * u) >> 7);
+      // Lanes of pixels outside an odd sized image are computed but not
+      // written.
+      const int xs[4] = {x, x1, x, x1};
+      const int ys[4] = {y, y, y1, y1};
+      for (int lane = 0; lane < 4; ++lane) {
+        if (((lane & 1) && x1 == x) || ((lane & 2) && y1 == y)) {
+          continue;
+        }
+        uint8_t* pixel = &rgba.At(xs[lane], ys[lane]);
+        pixel[0] = static_cast<uint8_t>(r[lane]);
+        pixel[1] = static_cast<uint8_t>(g[lane]);
+        pixel[2] = static_cast<uint8_t>(b[lane]);
+        pixel[3] = 255;
+      }
+    }
+  }
+}
+
+// Copy the luma of a camera frame into a packed buffer, converting RGBA
+// frames with ConvertRgbaToGrayscale(), and return a view of the copy. The
+// chroma of YUV frames is not copied. The buffer keeps its capacity, so
+// repeated copies of frames of one size do not allocate.
+//
+// @return an invalid view if the frame has no luma.
+inline ImageView<const uint8_t> CopyLuma(const TangoImageBuffer& image,
+                                         std::vector<uint8_t>* luma) {
+  const int width = static_cast<int>(image.width);
+  const int height = static_cast<int>(image.height);
+  const ImageView<const uint8_t> rgba = GetRgbaPlane(image);
+  const ImageView<const uint8_t> source = GetLumaPlane(image);
+  if (!rgba.IsValid() && !source.IsValid()) {
+    return ImageView<const uint8_t>();
+  }
+  luma->resize(static_cast<size_t>(width) * height);
+  const ImageView<uint8_t> copy(luma->data(), width, height, width);
+  if (rgba.IsValid()) {
+    ConvertRgbaToGrayscale(rgba, copy);
+  } else {
+    CopyImage(source, copy);
+  }
+  return copy;
+}
+
+}  // namespace tango_perception
+
+#endif  // TANGO_PERCEPTION_IMAGE_VIEW_H_
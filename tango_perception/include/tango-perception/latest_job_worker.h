@@ -0,0 +1,111 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_PERCEPTION_LATEST_JOB_WORKER_H_
+#define TANGO_PERCEPTION_LATEST_JOB_WORKER_H_
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace tango_perception {
+
+// LatestJobWorker runs jobs on one worker thread, always the most recent
+// one. A job that is still queued when the next one is submitted is
+// replaced, so the worker never falls behind its producers.
+//
+// Jobs are filled in place: Submit() hands the queued job to a callback
+// under the lock, and the worker swaps it with the job it runs. The two job
+// objects trade places forever, so buffers they own keep their capacity and
+// steady state submission only copies.
+//
+// The worker starts in the constructor and is stopped and joined in the
+// destructor, dropping a queued job. An owner whose run callback uses its
+// other members should declare the worker after them, so it is destroyed
+// first.
+template <typename Job>
+class LatestJobWorker {
+ public:
+  // @param run: Called on the worker thread with each job. May modify the
+  //    job, which is refilled by a later Submit().
+  explicit LatestJobWorker(const std::function<void(Job*)>& run)
+      : run_(run), has_queued_job_(false), stop_(false) {
+    worker_thread_ = std::thread(&LatestJobWorker::WorkerThread, this);
+  }
+
+  ~LatestJobWorker() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    job_queued_.notify_one();
+    worker_thread_.join();
+  }
+
+  LatestJobWorker(const LatestJobWorker&) = delete;
+  LatestJobWorker& operator=(const LatestJobWorker&) = delete;
+
+  // Queue a job, replacing one that is still queued. May be called from any
+  // thread.
+  //
+  // @param fill: Called with the queued job before this returns, to copy
+  //    the inputs into it.
+  template <typename Fill>
+  void Submit(const Fill& fill) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      fill(&queued_job_);
+      has_queued_job_ = true;
+    }
+    job_queued_.notify_one();
+  }
+
+ private:
+  void WorkerThread() {
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        job_queued_.wait(lock, [this] { return stop_ || has_queued_job_; });
+        if (stop_) {
+          return;
+        }
+        std::swap(running_job_, queued_job_);
+        has_queued_job_ = false;
+      }
+      run_(&running_job_);
+    }
+  }
+
+  std::function<void(Job*)> run_;
+
+  // Owned by the worker thread.
+  Job running_job_;
+
+  // Guards queued_job_ and the flags.
+  std::mutex mutex_;
+  std::condition_variable job_queued_;
+  Job queued_job_;
+  bool has_queued_job_;
+  bool stop_;
+
+  std::thread worker_thread_;
+};
+
+}  // namespace tango_perception
+
+#endif  // TANGO_PERCEPTION_LATEST_JOB_WORKER_H_
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_PERCEPTION_LATEST_VALUE_MAILBOX_H_
+#define TANGO_PERCEPTION_LATEST_VALUE_MAILBOX_H_
+
+#include <atomic>
+#include <cstdint>
+
+namespace tango_perception {
+
+// LatestValueMailbox is a lock-free triple buffer that hands the most recent
+// value from one producer thread to one consumer thread.
+//
+// The producer fills the back slot in place and publishes it. The consumer
+// reads the front slot in place. Publishing and acquiring swap a slot with
+// the shared middle slot through a single atomic exchange, so neither side
+// ever blocks or copies a value, and the consumer always sees the newest
+// published value. Values published while the consumer is not looking are
+// simply overwritten.
+//
+// Slots are default constructed. Types that own external storage (such as
+// TangoPointCloud::points) should have their slots set up through GetSlot()
+// before the mailbox is shared between threads.
+template <typename T>
+class LatestValueMailbox {
+ public:
+  LatestValueMailbox()
+      : state_(kInitialMiddle), back_(kInitialBack), front_(kInitialFront),
+        has_value_(false) {}
+
+  LatestValueMailbox(const LatestValueMailbox&) = delete;
+  LatestValueMailbox& operator=(const LatestValueMailbox&) = delete;
+
+  // Access one of the three slots for initialization. Must not be used once
+  // the producer or consumer is running.
+  T* GetSlot(int index) { return &slots_[index]; }
+
+  // Producer side: the slot to fill before calling Publish().
+  T* GetBackBuffer() { return &slots_[back_]; }
+
+  // Producer side: publish the back slot as the newest value.
+  void Publish() {
+    uint8_t previous =
+        state_.exchange(back_ | kNewDataBit, std::memory_order_acq_rel);
+    back_ = previous & kIndexMask;
+  }
+
+  // Producer side: copy value into the back slot and publish it. Only
+  // suitable for types with value semantics, such as TangoPoseData.
+  void Update(const T& value) {
+    *GetBackBuffer() = value;
+    Publish();
+  }
+
+  // Consumer side: return the newest published value, or nullptr if nothing
+  // has been published yet. The returned slot stays valid and unchanged
+  // until the next call to GetLatest().
+  //
+  // @param new_data: Optional output set to true if the value was published
+  //    since the previous call.
+  const T* GetLatest(bool* new_data = nullptr) {
+    bool is_new = false;
+    if (state_.load(std::memory_order_relaxed) & kNewDataBit) {
+      uint8_t previous = state_.exchange(front_, std::memory_order_acq_rel);
+      front_ = previous & kIndexMask;
+      has_value_ = true;
+      is_new = true;
+    }
+    if (new_data != nullptr) {
+      *new_data = is_new;
+    }
+    return has_value_ ? &slots_[front_] : nullptr;
+  }
+
+ private:
+  static const uint8_t kIndexMask = 0x3;
+  static const uint8_t kNewDataBit = 0x4;
+  static const uint8_t kInitialFront = 0;
+  static const uint8_t kInitialMiddle = 1;
+  static const uint8_t kInitialBack = 2;
+
+  T slots_[3];
+
+  // Index of the middle slot, plus kNewDataBit if it holds a value the
+  // consumer has not seen yet.
+  std::atomic<uint8_t> state_;
+
+  // Owned by the producer thread.
+  uint8_t back_;
+
+  // Owned by the consumer thread.
+  uint8_t front_;
+  bool has_value_;
+};
+
+}  // namespace tango_perception
+
+#endif  // TANGO_PERCEPTION_LATEST_VALUE_MAILBOX_H_
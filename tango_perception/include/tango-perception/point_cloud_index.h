@@ -0,0 +1,185 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_PERCEPTION_POINT_CLOUD_INDEX_H_
+#define TANGO_PERCEPTION_POINT_CLOUD_INDEX_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <tango_client_api.h>
+
+#include "glm/glm.hpp"
+
+namespace tango_perception {
+
+// A single result of a nearest neighbour or radius query. The point keeps the
+// TangoPointCloud {X, Y, Z, C} layout, with the confidence stored in w.
+struct Neighbor {
+  glm::vec4 point;
+  float distance_squared;
+};
+
+// A static k-d tree over a set of {X, Y, Z, C} points. The tree owns a copy
+// of its points and reorders them so that every leaf is a contiguous range.
+// Once built it is immutable and may be queried from any number of threads.
+class KdTree {
+ public:
+  // Build a tree over the given points. The points are moved into the tree.
+  explicit KdTree(std::vector<glm::vec4>* points);
+
+  // Number of points in the tree.
+  size_t Size() const { return points_.size(); }
+
+  // All points of the tree, in leaf order.
+  const std::vector<glm::vec4>& GetPoints() const { return points_; }
+
+  // Merge the k nearest points to query into neighbors, which is kept as a
+  // max-heap on distance_squared of at most k elements.
+  void FindKNearest(const glm::vec3& query, size_t k,
+                    std::vector<Neighbor>* neighbors) const;
+
+  // Append all points within radius of query to neighbors.
+  void FindInRadius(const glm::vec3& query, float radius,
+                    std::vector<Neighbor>* neighbors) const;
+
+ private:
+  struct Node {
+    // Range of points_ covered by this node.
+    uint32_t begin;
+    uint32_t end;
+    // Index of the children in nodes_, or -1 for a leaf.
+    int32_t left;
+    int32_t right;
+    // Splitting plane of an inner node.
+    int32_t axis;
+    float split;
+  };
+
+  int32_t Build(uint32_t begin, uint32_t end);
+
+  void SearchKNearest(int32_t node_index, const glm::vec3& query, size_t k,
+                      std::vector<Neighbor>* neighbors) const;
+
+  void SearchInRadius(int32_t node_index, const glm::vec3& query,
+                      float radius_squared,
+                      std::vector<Neighbor>* neighbors) const;
+
+  std::vector<glm::vec4> points_;
+  std::vector<Node> nodes_;
+};
+
+// PointCloudIndex accumulates point clouds in a common frame (usually the
+// start of service or area description frame) and answers nearest neighbour
+// and radius queries against them.
+//
+// Newly inserted points go into a small unindexed pending list that is
+// searched linearly. Once enough points are pending, a worker thread bulk
+// builds them into a k-d tree. Trees of similar size are merged as they are
+// built, so the index holds O(log n) trees and neither insertion nor queries
+// ever wait on a rebuild.
+//
+// All public functions are thread safe.
+class PointCloudIndex {
+ public:
+  PointCloudIndex();
+  ~PointCloudIndex();
+
+  // Transform the points of point_cloud into the index frame and insert them.
+  // Points whose confidence is below min_confidence are skipped.
+  //
+  // @param point_cloud: The point cloud to insert, in the TangoPointCloud
+  //    {X, Y, Z, C} layout.
+  // @param index_T_point_cloud: Transformation from the point cloud frame to
+  //    the frame of the index.
+  // @param min_confidence: Minimum confidence of a point to be inserted.
+  void AddPointCloud(const TangoPointCloud* point_cloud,
+                     const glm::mat4& index_T_point_cloud,
+                     float min_confidence);
+
+  // Insert points that are already expressed in the index frame.
+  void AddPoints(const float (*points)[4], size_t num_points);
+
+  // Find the k nearest points for each of the query points.
+  //
+  // @param queries: Query positions in the index frame.
+  // @param k: Number of neighbours per query.
+  // @param results: Output, resized to queries.size() * k. The neighbours of
+  //    query i are stored at [i * k, (i + 1) * k) sorted by increasing
+  //    distance. If the index holds fewer than k points, the remaining
+  //    entries have an infinite distance_squared.
+  void FindKNearest(const std::vector<glm::vec3>& queries, size_t k,
+                    std::vector<Neighbor>* results) const;
+
+  // Find the nearest point to query. Returns false if the index is empty.
+  bool FindNearest(const glm::vec3& query, Neighbor* result) const;
+
+  // Find all points within radius of query. Results are not sorted.
+  void FindInRadius(const glm::vec3& query, float radius,
+                    std::vector<Neighbor>* results) const;
+
+  // Ask the worker thread to rebuild a single tree over all points,
+  // regardless of how many points are pending.
+  void RequestRebuild();
+
+  // Block until no rebuild is pending or running.
+  void WaitForRebuild();
+
+  // Remove all points.
+  void Clear();
+
+  // Total number of points in the index, including pending points.
+  size_t Size() const;
+
+ private:
+  typedef std::vector<std::shared_ptr<const KdTree>> TreeList;
+
+  // Wake up the worker if enough points are pending. Must be called with
+  // mutex_ held.
+  void MaybeScheduleRebuildLocked();
+
+  void RebuildThread();
+
+  // Number of pending points before they are built into a tree.
+  static const size_t kPendingPointsForRebuild = 8192;
+
+  // Protects all members below.
+  mutable std::mutex mutex_;
+  std::condition_variable rebuild_condition_;
+
+  // Trees in decreasing order of size.
+  TreeList trees_;
+  std::vector<glm::vec4> pending_points_;
+
+  // Incremented on Clear() so that a rebuild started before the clear does
+  // not resurrect removed points.
+  uint64_t generation_;
+
+  bool rebuild_requested_;
+  bool full_rebuild_requested_;
+  bool rebuild_running_;
+  bool stop_requested_;
+
+  std::thread rebuild_thread_;
+};
+
+}  // namespace tango_perception
+
+#endif  // TANGO_PERCEPTION_POINT_CLOUD_INDEX_H_
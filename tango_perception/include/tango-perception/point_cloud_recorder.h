@@ -0,0 +1,128 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_PERCEPTION_POINT_CLOUD_RECORDER_H_
+#define TANGO_PERCEPTION_POINT_CLOUD_RECORDER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <tango_client_api.h>
+
+#include "tango-perception/chunk_file.h"
+#include "tango-perception/chunk_recorder.h"
+
+namespace tango_perception {
+
+// Records point clouds with their poses to a compact binary file for offline
+// processing.
+//
+// Each point is quantized to millimetres in int16 and its confidence to a
+// byte, then every channel is delta coded against the previous point and
+// entropy coded with an adaptive Rice code. Depth camera clouds of a room take
+// 2.5 to 2.8 bytes per point against 16 bytes for the raw floats, 5.7 to 6.5
+// times less, see benchmark/point_cloud_recorder_benchmark.cc.
+//
+// Frames are stored in the chunks of a chunk file, see ChunkFileWriter, so a
+// reader can seek to any frame, and a file that was not closed properly can
+// still be read up to the last complete frame.
+//
+// Record() is meant to be called from the point cloud callback. It only
+// quantizes the points into a preallocated frame buffer; encoding and file
+// IO happen on the writer thread of a ChunkRecorder. If the writer falls
+// behind, frames are dropped rather than blocking the callback.
+class PointCloudRecorder {
+ public:
+  PointCloudRecorder();
+
+  PointCloudRecorder(const PointCloudRecorder&) = delete;
+  PointCloudRecorder& operator=(const PointCloudRecorder&) = delete;
+
+  // Create the file at path and start the writer thread.
+  //
+  // @param max_points: Capacity of the frame buffers, usually the value of
+  //    the "max_point_cloud_elements" config key.
+  // @return false if the file could not be created.
+  bool Open(const std::string& path, uint32_t max_points);
+
+  // Queue a point cloud and the pose of the depth camera at its timestamp.
+  // Returns false if the frame was dropped.
+  bool Record(const TangoPointCloud* point_cloud, const TangoPoseData& pose);
+
+  // Write the queued frames and the index and close the file. Waits for
+  // Record() calls in progress on other threads.
+  void Close();
+
+  bool IsOpen() const;
+
+  // Statistics, valid until the next Open().
+  uint32_t GetNumFramesWritten() const;
+  uint32_t GetNumFramesDropped() const;
+  uint64_t GetNumBytesWritten() const;
+
+ private:
+  // A quantized frame waiting to be encoded.
+  struct Frame {
+    double timestamp;
+    TangoPoseData pose;
+    uint32_t num_points;
+    std::vector<int16_t> xyz;
+    std::vector<uint8_t> confidence;
+  };
+
+  // Code the points of a frame into a chunk, on the writer thread.
+  static void EncodeFrame(const Frame& frame, std::vector<uint8_t>* chunk);
+
+  ChunkRecorder<Frame> recorder_;
+};
+
+// Reads files written by PointCloudRecorder.
+class PointCloudReader {
+ public:
+  PointCloudReader();
+
+  PointCloudReader(const PointCloudReader&) = delete;
+  PointCloudReader& operator=(const PointCloudReader&) = delete;
+
+  // Open a recording and load its index, or rebuild the index by scanning
+  // the chunks if the recording was not closed properly.
+  bool Open(const std::string& path);
+  void Close();
+
+  size_t GetNumFrames() const { return file_.GetNumChunks(); }
+  double GetTimestamp(size_t frame) const {
+    return file_.GetTimestamp(frame);
+  }
+
+  // Decode one frame.
+  //
+  // @param frame: Index of the frame, less than GetNumFrames().
+  // @param points: Output XYZC points in meters, four floats per point, laid
+  //    out like TangoPointCloud::points.
+  // @param pose: Output pose of the depth camera recorded with the frame.
+  // @return false if the chunk is corrupt or could not be read.
+  bool ReadFrame(size_t frame, std::vector<float>* points,
+                 TangoPoseData* pose);
+
+ private:
+  ChunkFileReader file_;
+  std::vector<uint8_t> chunk_buffer_;
+};
+
+}  // namespace tango_perception
+
+#endif  // TANGO_PERCEPTION_POINT_CLOUD_RECORDER_H_
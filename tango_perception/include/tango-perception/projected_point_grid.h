@@ -0,0 +1,113 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_PERCEPTION_PROJECTED_POINT_GRID_H_
+#define TANGO_PERCEPTION_PROJECTED_POINT_GRID_H_
+
+#include <cstdint>
+#include <vector>
+
+#include <tango_client_api.h>
+#include <tango_support.h>
+
+#include "glm/glm.hpp"
+#include "tango-perception/camera_projection.h"
+
+namespace tango_perception {
+
+// ProjectedPointGrid buckets the points of a cloud by where they land on the
+// display, so that touch handlers only look at the few cells around a touch
+// instead of the whole cloud.
+//
+// The grid is built once per cloud in the color camera image rotated to the
+// display, with square cells. Display uv coordinates map straight to cells,
+// and distances are in pixels of the color camera image.
+class ProjectedPointGrid {
+ public:
+  // @param cell_size: Side of the cells in pixels.
+  explicit ProjectedPointGrid(int cell_size = 16);
+
+  // Set the unrotated intrinsics of the color camera.
+  void SetCameraIntrinsics(const TangoCameraIntrinsics& intrinsics);
+
+  // Bucket the points of a cloud that are visible in the color camera.
+  //
+  // @param color_camera_T_point_cloud: Transformation from the point cloud
+  //    to the color camera frame.
+  // @param color_to_display_rotation: Rotation from the color camera to the
+  //    display, see DepthInterpolator.
+  void Build(const TangoPointCloud* point_cloud,
+             const glm::mat4& color_camera_T_point_cloud,
+             TangoSupport_Rotation color_to_display_rotation);
+
+  // True if the grid holds the given cloud, by timestamp, for the given
+  // rotation.
+  bool IsBuiltFor(const TangoPointCloud* point_cloud,
+                  TangoSupport_Rotation color_to_display_rotation) const;
+
+  // Find the point that lands nearest to a display uv coordinate.
+  //
+  // @param radius: Largest distance in pixels.
+  // @param point_index: Output index of the point in the cloud.
+  // @return false if no point is within radius.
+  bool FindNearest(const float uv[2], float radius,
+                   uint32_t* point_index) const;
+
+  // Append the indices of all points within radius pixels of a display uv
+  // coordinate to point_indices, in no particular order.
+  void FindInRadius(const float uv[2], float radius,
+                    std::vector<uint32_t>* point_indices) const;
+
+ private:
+  // Visit the points of the cells overlapping the square of the given
+  // radius around a display uv coordinate. visit(x, y, point) gets the
+  // offset of the point from the query in pixels and its index in the cloud.
+  template <typename Visitor>
+  void ForEachPointNear(const float uv[2], float radius,
+                        const Visitor& visit) const;
+
+  int cell_size_;
+  CameraProjection projection_;
+  int camera_width_;
+  int camera_height_;
+
+  // Size of the rotated image and of the grid over it.
+  int display_width_;
+  int display_height_;
+  int cells_x_;
+  int cells_y_;
+
+  bool is_built_;
+  double timestamp_;
+  TangoSupport_Rotation rotation_;
+
+  // Display pixels of the visible points and their cells, in cloud order.
+  std::vector<float> projected_x_;
+  std::vector<float> projected_y_;
+  std::vector<uint32_t> projected_index_;
+  std::vector<uint32_t> projected_cell_;
+
+  // Points sorted by cell; cell c owns [cell_offsets_[c],
+  // cell_offsets_[c + 1]) of the arrays below.
+  std::vector<uint32_t> cell_offsets_;
+  std::vector<float> cell_x_;
+  std::vector<float> cell_y_;
+  std::vector<uint32_t> cell_points_;
+};
+
+}  // namespace tango_perception
+
+#endif  // TANGO_PERCEPTION_PROJECTED_POINT_GRID_H_
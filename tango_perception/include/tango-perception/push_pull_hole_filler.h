@@ -0,0 +1,110 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_PERCEPTION_PUSH_PULL_HOLE_FILLER_H_
+#define TANGO_PERCEPTION_PUSH_PULL_HOLE_FILLER_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "tango-perception/thread_pool.h"
+
+namespace tango_perception {
+
+// PushPullHoleFiller fills the holes of a sparse depth image with the
+// push-pull algorithm of Gortler et al.
+//
+// The push phase halves the image repeatedly, averaging the known depth of
+// every 2x2 block together with a confidence weight that saturates at one.
+// The pull phase walks back up the pyramid and blends every pixel with the
+// bilinearly interpolated coarser level in proportion to its missing
+// confidence. Known depth is kept exactly and every hole gets the depth of
+// the nearest points, smoothly interpolated. Each level is one linear pass,
+// so the whole pyramid costs less than two passes over the image.
+class PushPullHoleFiller {
+ public:
+  // @param thread_pool: Runs the parallel loops, usually shared by all the
+  //    depth processing of an app. Not owned, must outlive this object.
+  explicit PushPullHoleFiller(ThreadPool* thread_pool);
+
+  // Limit the pyramid depth, which limits how far depth spreads into holes
+  // to about 2^max_levels pixels. Zero, the default, builds the pyramid down
+  // to a single pixel so that every hole is filled.
+  void SetMaxLevels(int max_levels);
+
+  // Fill the depth image from sparse depth.
+  //
+  // @param sparse_depth: Row major depth in meters, zero where unknown.
+  void Fill(const std::vector<float>& sparse_depth, int width, int height);
+
+  // Depth in meters, row major, zero where no depth was in reach.
+  const std::vector<float>& GetDepthImage() const { return depth_image_; }
+
+  // Write the depth image as 8 bit luminance, 255 at max_depth and beyond.
+  void ConvertToGrayscale(float max_depth, std::vector<uint8_t>* grayscale);
+
+ private:
+  // One level of the pyramid, with the confidence weighted depth and the
+  // confidence of every pixel.
+  struct Level {
+    int width;
+    int height;
+    std::vector<float> weighted;
+    std::vector<float> confidence;
+  };
+
+  // Resize the pyramid for an image of the given size.
+  void AllocateLevels(int width, int height);
+
+  // Average the rows [row_begin, row_end) of level index + 1 from level
+  // index, or from the sparse depth for index -1.
+  void PushRows(const std::vector<float>& sparse_depth, int index,
+                int row_begin, int row_end);
+
+  // Blend the rows [row_begin, row_end) of level index with level
+  // index + 1, or write the depth image for index -1.
+  void PullRows(const std::vector<float>& sparse_depth, int index,
+                int row_begin, int row_end, float* row_buffer);
+
+  // Upsample row y of level index + 1 to the width of level index into
+  // weighted and confidence, using temp for the vertical interpolation.
+  void UpsampleRow(int index, int y, float* temp, float* weighted,
+                   float* confidence) const;
+
+  // Run task(row_begin, row_end, band) over bands of the rows of an image.
+  template <typename Task>
+  void ForEachBand(int height, const Task& task);
+
+  ThreadPool* thread_pool_;
+  int max_levels_;
+
+  int width_;
+  int height_;
+
+  // Levels of half, quarter, ... resolution. The full resolution level is
+  // the sparse depth itself.
+  std::vector<Level> levels_;
+
+  // Upsampled rows for every band.
+  std::vector<float> row_buffers_;
+  size_t row_buffer_size_;
+
+  std::vector<float> depth_image_;
+};
+
+}  // namespace tango_perception
+
+#endif  // TANGO_PERCEPTION_PUSH_PULL_HOLE_FILLER_H_
@@ -0,0 +1,49 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_PERCEPTION_RVL_CODEC_H_
+#define TANGO_PERCEPTION_RVL_CODEC_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tango_perception {
+
+// Lossless run length variable length (RVL) coding of 16 bit depth images.
+//
+// Pixels are coded in row major order as alternating runs of zero and
+// non-zero pixels. Run lengths and the zigzagged difference of every
+// non-zero pixel to the previous non-zero pixel are written as variable
+// length codes of 3 bit groups, one nibble per group with a continuation
+// bit. There are no tables or statistics, so coding is a single linear pass
+// that takes about a millisecond per VGA frame on one core, and smooth
+// registered depth usually compresses 3 to 4 times.
+
+// Append the code of num_pixels depth values to output.
+void RvlEncode(const uint16_t* depth, size_t num_pixels,
+               std::vector<uint8_t>* output);
+
+// Decode num_pixels depth values from size bytes of data.
+//
+// @return false if the data is truncated or does not decode to exactly
+//    num_pixels values.
+bool RvlDecode(const uint8_t* data, size_t size, size_t num_pixels,
+               uint16_t* depth);
+
+}  // namespace tango_perception
+
+#endif  // TANGO_PERCEPTION_RVL_CODEC_H_
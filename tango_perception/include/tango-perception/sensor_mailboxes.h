@@ -0,0 +1,135 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_PERCEPTION_SENSOR_MAILBOXES_H_
+#define TANGO_PERCEPTION_SENSOR_MAILBOXES_H_
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <tango_client_api.h>
+
+#include "tango-perception/latest_value_mailbox.h"
+
+namespace tango_perception {
+
+// Latest pose from a pose callback. Use Update() on the callback thread and
+// GetLatest() on the consumer thread.
+typedef LatestValueMailbox<TangoPoseData> PoseMailbox;
+
+// Returns the number of bytes of pixel data in an image of the given format.
+size_t GetImageBufferDataSize(TangoImageFormatType format, uint32_t stride,
+                              uint32_t height);
+
+// ImageRegions collects the rows of camera frames that each consumer needs,
+// such as the area around a tracked marker, so that the frame callback can
+// copy only their union instead of the full frame. Consumers declare their
+// regions from any thread and the callback reads the union without locking.
+class ImageRegions {
+ public:
+  static const int kMaxConsumers = 4;
+
+  ImageRegions();
+
+  // Declare the luma rows [begin_row, end_row) that consumer needs from
+  // later frames, and whether it needs the chroma of those rows as well.
+  // begin_row >= end_row declares that it needs no pixels for now.
+  //
+  // @param consumer: Index chosen by the consumer, less than kMaxConsumers.
+  void Set(int consumer, uint32_t begin_row, uint32_t end_row,
+           bool needs_chroma);
+
+  // Withdraw the declaration of consumer.
+  void Clear(int consumer);
+
+  // The union of the declared regions, clamped to height.
+  //
+  // @return false if no consumer declared a region, in which case frames
+  //    should be copied in full.
+  bool GetUnion(uint32_t height, uint32_t* begin_row, uint32_t* end_row,
+                bool* needs_chroma) const;
+
+ private:
+  // Rows and flags of every consumer packed into one word, see Set().
+  std::atomic<uint64_t> regions_[kMaxConsumers];
+};
+
+// Hands the latest point cloud from the OnPointCloudAvailable callback to a
+// consumer thread. This is a drop-in replacement for
+// TangoSupport_PointCloudManager: all three point buffers are allocated up
+// front, the callback thread only copies the points once and never takes a
+// lock, and the consumer reads the cloud in place.
+class PointCloudMailbox {
+ public:
+  // @param max_points: Capacity of each buffer, usually the value of the
+  //    "max_point_cloud_elements" config key.
+  explicit PointCloudMailbox(uint32_t max_points);
+
+  // Producer side. Points beyond the capacity of the buffers are dropped.
+  void Update(const TangoPointCloud* point_cloud);
+
+  // Consumer side. See LatestValueMailbox::GetLatest().
+  const TangoPointCloud* GetLatest(bool* new_data = nullptr) {
+    return mailbox_.GetLatest(new_data);
+  }
+
+ private:
+  uint32_t max_points_;
+  std::vector<float> storage_[3];
+  LatestValueMailbox<TangoPointCloud> mailbox_;
+};
+
+// Hands the latest camera frame from the OnFrameAvailable callback to a
+// consumer thread. This is a drop-in replacement for
+// TangoSupport_ImageBufferManager with the same threading properties as
+// PointCloudMailbox.
+class ImageBufferMailbox {
+ public:
+  // The buffers are sized for an image of the given format and dimensions.
+  // Frames with a larger stride than the buffers hold are repacked without
+  // their row padding, so only a larger image allocates on the callback
+  // thread.
+  //
+  // @param stride: Bytes per row of the frames, as TangoImageBuffer::stride,
+  //    or an upper bound on it. At least the packed row size is used, e.g.
+  //    4 * width for RGBA.
+  ImageBufferMailbox(TangoImageFormatType format, uint32_t width,
+                     uint32_t height, uint32_t stride);
+
+  // Producer side. Copies the rows declared through GetRegions(), or the
+  // full frame if no consumer declared any.
+  void Update(const TangoImageBuffer* image_buffer);
+
+  // Consumer side. See LatestValueMailbox::GetLatest(). Pixels outside the
+  // declared rows are stale, left over from earlier frames.
+  const TangoImageBuffer* GetLatest(bool* new_data = nullptr) {
+    return mailbox_.GetLatest(new_data);
+  }
+
+  // Consumers declare the rows they need here. A change applies from the
+  // next frame the callback receives.
+  ImageRegions* GetRegions() { return &regions_; }
+
+ private:
+  ImageRegions regions_;
+  std::vector<uint8_t> storage_[3];
+  LatestValueMailbox<TangoImageBuffer> mailbox_;
+};
+
+}  // namespace tango_perception
+
+#endif  // TANGO_PERCEPTION_SENSOR_MAILBOXES_H_
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_PERCEPTION_SIMD_H_
+#define TANGO_PERCEPTION_SIMD_H_
+
+#include <cstdint>
+#include <cstring>
+
+// Small SIMD helpers built on GCC/Clang vector extensions. The compiler lowers
+// these to NEON on armeabi-v7a and arm64-v8a (and to SSE on x86), so kernels
+// written against them share one source for all ABIs.
+namespace tango_perception {
+namespace simd {
+
+typedef float Float4 __attribute__((vector_size(16)));
+typedef int32_t Int4 __attribute__((vector_size(16)));
+typedef uint32_t UInt4 __attribute__((vector_size(16)));
+
+inline Float4 Splat(float value) { return Float4{value, value, value, value}; }
+
+inline Int4 SplatInt(int32_t value) { return Int4{value, value, value, value}; }
+
+inline UInt4 SplatUInt(uint32_t value) {
+  return UInt4{value, value, value, value};
+}
+
+// Unaligned load and store of four floats.
+inline Float4 Load(const float* data) {
+  Float4 value;
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+inline void Store(float* data, Float4 value) {
+  std::memcpy(data, &value, sizeof(value));
+}
+
+// Unaligned load of 16 bytes as four 32 bit lanes. Byte 0 is the least
+// significant byte of lane 0 on every supported ABI (all little endian).
+inline UInt4 LoadBytes(const uint8_t* data) {
+  UInt4 value;
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+inline float HorizontalSum(Float4 value) {
+  return (value[0] + value[1]) + (value[2] + value[3]);
+}
+
+// Per-lane mask ? a : b, where mask comes from a vector comparison.
+inline Float4 Select(Int4 mask, Float4 a, Float4 b) {
+  Int4 a_bits, b_bits;
+  std::memcpy(&a_bits, &a, sizeof(a_bits));
+  std::memcpy(&b_bits, &b, sizeof(b_bits));
+  Int4 result_bits = (a_bits & mask) | (b_bits & ~mask);
+  Float4 result;
+  std::memcpy(&result, &result_bits, sizeof(result));
+  return result;
+}
+
+inline Float4 Min(Float4 a, Float4 b) { return Select(a < b, a, b); }
+
+inline Float4 Max(Float4 a, Float4 b) { return Select(a > b, a, b); }
+
+// Per-lane floor for values in [0, 2^22), without a scalar conversion per
+// lane. Adding 2^23 rounds the value to an integer held in the low mantissa
+// bits; lanes that were rounded up are then corrected by one.
+inline Int4 FloorToInt(Float4 value) {
+  const Float4 offset = Splat(8388608.0f);
+  const Float4 shifted = value + offset;
+  const Float4 rounded = shifted - offset;
+  Int4 bits;
+  std::memcpy(&bits, &shifted, sizeof(bits));
+  return (bits - SplatInt(0x4b000000)) + (rounded > value);
+}
+
+}  // namespace simd
+}  // namespace tango_perception
+
+#endif  // TANGO_PERCEPTION_SIMD_H_
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_PERCEPTION_STATS_RING_H_
+#define TANGO_PERCEPTION_STATS_RING_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace tango_perception {
+
+// StatsRing keeps the last N values pushed by one producer thread and lets
+// any number of reader threads copy them out without locks.
+//
+// Every slot is guarded by its own sequence number (a seqlock): the producer
+// marks the slot as busy, writes the value and marks it as complete. Readers
+// copy the value and retry or skip it if the sequence changed in between, so
+// the producer never waits for a reader. T must be trivially copyable.
+template <typename T, size_t N>
+class StatsRing {
+ public:
+  StatsRing() : count_(0) {
+    for (Slot& slot : slots_) {
+      slot.sequence.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  StatsRing(const StatsRing&) = delete;
+  StatsRing& operator=(const StatsRing&) = delete;
+
+  // Producer side: append value, overwriting the oldest one once full.
+  void Push(const T& value) {
+    const uint64_t index = count_.load(std::memory_order_relaxed);
+    Slot& slot = slots_[index % N];
+    slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.value = value;
+    slot.sequence.store(2 * index + 2, std::memory_order_release);
+    count_.store(index + 1, std::memory_order_release);
+  }
+
+  // Total number of values pushed so far.
+  uint64_t GetCount() const { return count_.load(std::memory_order_acquire); }
+
+  // Copy the newest value. Returns false if nothing has been pushed yet.
+  bool GetLatest(T* value) const {
+    while (true) {
+      const uint64_t count = GetCount();
+      if (count == 0) {
+        return false;
+      }
+      if (Read(count - 1, value)) {
+        return true;
+      }
+    }
+  }
+
+  // Copy up to max_count of the newest values, oldest first. Values that are
+  // overwritten while copying are left out.
+  //
+  // @return the number of values copied.
+  size_t GetRecent(T* values, size_t max_count) const {
+    const uint64_t count = GetCount();
+    const size_t wanted = static_cast<size_t>(
+        std::min<uint64_t>(count, std::min<uint64_t>(max_count, N)));
+    // Copy newest first so that an overrun by the producer only loses the
+    // oldest values.
+    size_t copied = 0;
+    while (copied < wanted && Read(count - 1 - copied, &values[copied])) {
+      ++copied;
+    }
+    std::reverse(values, values + copied);
+    return copied;
+  }
+
+ private:
+  struct Slot {
+    std::atomic<uint64_t> sequence;
+    T value;
+  };
+
+  // Copy the value pushed as number index if it is still in its slot.
+  bool Read(uint64_t index, T* value) const {
+    const Slot& slot = slots_[index % N];
+    const uint64_t expected = 2 * index + 2;
+    if (slot.sequence.load(std::memory_order_acquire) != expected) {
+      return false;
+    }
+    *value = slot.value;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.sequence.load(std::memory_order_relaxed) == expected;
+  }
+
+  Slot slots_[N];
+  std::atomic<uint64_t> count_;
+};
+
+}  // namespace tango_perception
+
+#endif  // TANGO_PERCEPTION_STATS_RING_H_
@@ -0,0 +1,130 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_PERCEPTION_TEMPORAL_DEPTH_FUSION_H_
+#define TANGO_PERCEPTION_TEMPORAL_DEPTH_FUSION_H_
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <tango_client_api.h>
+
+#include "glm/glm.hpp"
+#include "tango-perception/camera_projection.h"
+
+namespace tango_perception {
+
+// TemporalDepthFusion keeps the last few point clouds and reprojects all of
+// them into the current camera frame, which gives several times as many
+// depth samples per frame as the latest cloud alone.
+//
+// Samples landing on the same pixel are merged by a confidence weighted
+// average. Clouds are visited from the newest to the oldest and every
+// sample is weighted by the point confidence and by an exponential decay
+// with its age. A sample that disagrees with the depth already in a pixel
+// is dropped, so that older clouds only add to what the newer ones did not
+// see and never blur a moved object into its background.
+//
+// All buffers are allocated up front. Only the pixels written by the last
+// Fuse() are cleared by the next one.
+class TemporalDepthFusion {
+ public:
+  // Returns the transformation from the depth camera frame at the given
+  // point cloud timestamp to the camera frame, or false if it is unknown.
+  typedef std::function<bool(double point_cloud_timestamp,
+                             glm::mat4* camera_T_points)>
+      TransformLookup;
+
+  // @param history_size: Number of point clouds kept.
+  // @param max_points: Capacity of each point cloud, usually the value of the
+  //    "max_point_cloud_elements" config key.
+  TemporalDepthFusion(int history_size, uint32_t max_points);
+
+  // Set the camera the points are projected into.
+  void SetCameraIntrinsics(const TangoCameraIntrinsics& intrinsics);
+
+  // Copy a point cloud into the history, replacing the oldest one. A cloud
+  // with the timestamp of the newest one is ignored.
+  void AddPointCloud(const TangoPointCloud* point_cloud);
+
+  // Forget all point clouds.
+  void Clear();
+
+  // Replace the depth image with the fused point clouds.
+  //
+  // @param lookup: Transformation of each point cloud into the camera.
+  //    Clouds without a transformation are skipped.
+  // @return Number of point clouds fused.
+  int Fuse(const TransformLookup& lookup);
+
+  // Depth in meters, row major, zero where no point landed.
+  const std::vector<float>& GetDepthImage() const { return depth_image_; }
+
+ private:
+  struct Frame {
+    double timestamp;
+    uint32_t num_points;
+    std::vector<float> points;
+  };
+
+  // A projected point.
+  struct Sample {
+    uint32_t pixel;
+    float depth;
+    float weight;
+    // True for the first cloud fused.
+    bool is_newest;
+  };
+
+  // Project one point cloud into samples_ with the given weight.
+  void ProjectFrame(const Frame& frame, const glm::mat4& camera_T_points,
+                    float age_weight, bool is_newest);
+
+  // Sort samples_ into sorted_samples_ by bands of image rows, keeping the
+  // order within a band.
+  void SortSamplesByBand();
+
+  // Merge one sample into its pixel.
+  void AccumulateSample(const Sample& sample);
+
+  uint32_t max_points_;
+  CameraProjection projection_;
+  int width_;
+  int height_;
+
+  // Ring buffer of point clouds, newest_ is the index of the latest one.
+  std::vector<Frame> frames_;
+  int newest_;
+  int num_frames_;
+
+  // Samples of all clouds, newest first, then sorted by band. Merging the
+  // samples band by band keeps the pixel sums they touch in cache, while
+  // the order within a pixel still goes from the newest to the oldest.
+  std::vector<Sample> samples_;
+  std::vector<Sample> sorted_samples_;
+  std::vector<uint32_t> band_offsets_;
+
+  // Interleaved sums of weighted depth and weight per pixel.
+  std::vector<float> sums_;
+  std::vector<float> depth_image_;
+  // Pixels written by the last Fuse().
+  std::vector<uint32_t> touched_pixels_;
+};
+
+}  // namespace tango_perception
+
+#endif  // TANGO_PERCEPTION_TEMPORAL_DEPTH_FUSION_H_
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_PERCEPTION_THREAD_POOL_H_
+#define TANGO_PERCEPTION_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tango_perception {
+
+// ThreadPool runs data parallel loops on a fixed set of worker threads. The
+// calling thread takes part in the work, so a pool of N threads starts N - 1
+// workers. ParallelFor() calls from different threads are serialized.
+class ThreadPool {
+ public:
+  // @param num_threads: Total number of threads including the caller. Zero
+  //    uses the number of hardware threads.
+  explicit ThreadPool(int num_threads = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Total number of threads taking part in ParallelFor(), including the
+  // caller.
+  int GetNumThreads() const { return static_cast<int>(workers_.size()) + 1; }
+
+  // Run task(i) for every i in [0, num_tasks) and return once all of them
+  // have finished. Tasks are handed out dynamically, so using a few more
+  // tasks than threads balances uneven work.
+  void ParallelFor(int num_tasks, const std::function<void(int)>& task);
+
+ private:
+  void WorkerThread();
+
+  // Run tasks of the current job until none are left.
+  void RunTasks();
+
+  std::vector<std::thread> workers_;
+
+  // Serializes ParallelFor() callers.
+  std::mutex call_mutex_;
+
+  // Protects the job description and the counters below.
+  std::mutex mutex_;
+  std::condition_variable job_condition_;
+  std::condition_variable done_condition_;
+  const std::function<void(int)>* task_;
+  int num_tasks_;
+  uint64_t job_generation_;
+  int busy_workers_;
+  bool stop_requested_;
+
+  std::atomic<int> next_task_;
+};
+
+}  // namespace tango_perception
+
+#endif  // TANGO_PERCEPTION_THREAD_POOL_H_
@@ -0,0 +1,55 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TANGO_PERCEPTION_YUV_CONVERTER_H_
+#define TANGO_PERCEPTION_YUV_CONVERTER_H_
+
+#include <cstdint>
+
+#include "tango-perception/image_view.h"
+#include "tango-perception/thread_pool.h"
+
+namespace tango_perception {
+
+// YuvToRgbConverter converts camera frames to RGBA on the CPU, for code that
+// needs the color pixels rather than a texture to draw.
+//
+// The full range BT.601 coefficients are applied in 7 bit fixed point. The
+// chroma terms are computed once per 2x2 block and added to its four luma
+// values. NV21 frames are converted 16 pixels at a time with NEON or SSE2
+// where available; the remaining columns and other layouts go through
+// ConvertYuvToRgba(), which gives the same result. Bands of rows are
+// converted in parallel. Results match the floating point conversion to
+// within one level.
+class YuvToRgbConverter {
+ public:
+  // @param thread_pool: Runs the row bands, usually shared with the rest of
+  //    the app. Not owned, must outlive this object.
+  explicit YuvToRgbConverter(ThreadPool* thread_pool);
+
+  // Convert the overlapping part of a frame and an RGBA image, such as the
+  // planes of GetYuvPlanes().
+  //
+  // @param rgba: Output with a pixel stride of 4; alpha is set to 255.
+  void Convert(const YuvPlanes& yuv, ImageView<uint8_t> rgba);
+
+ private:
+  ThreadPool* thread_pool_;
+};
+
+}  // namespace tango_perception
+
+#endif  // TANGO_PERCEPTION_YUV_CONVERTER_H_
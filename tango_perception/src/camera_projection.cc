@@ -0,0 +1,262 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-perception/camera_projection.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Factor applied to the radius of the image corners, so that splats and
+// points just outside the image still get a sensible distortion.
+const double kRadiusMargin = 1.25;
+
+// Largest undistorted radius searched for the field of view, about 87
+// degrees off axis, which covers the corners of the fisheye camera.
+const double kMaxUndistortedRadius = 20.0;
+
+// Step of the search for the radius where a model stops being monotonic.
+const double kMonotonicSearchStep = 1e-3;
+
+// Radius at which the ratio rd / ru is evaluated for the first table entry.
+const double kSmallRadius = 1e-6;
+
+const int kBisectionIterations = 40;
+
+// Fixed point iterations that remove the tangential terms when unprojecting.
+const int kTangentialIterations = 5;
+
+// Radial distortion models, mapping the undistorted normalized radius ru to
+// the distorted one rd.
+struct RadialModel {
+  TangoCalibrationType type;
+  double k1;
+  double k2;
+  double k3;
+  double w;
+
+  double Distort(double ru) const {
+    switch (type) {
+      case TANGO_CALIBRATION_EQUIDISTANT:
+        if (std::abs(w) < 1e-9) {
+          return ru;
+        }
+        return std::atan(2.0 * ru * std::tan(w / 2.0)) / w;
+      case TANGO_CALIBRATION_POLYNOMIAL_2_PARAMETERS:
+      case TANGO_CALIBRATION_POLYNOMIAL_3_PARAMETERS:
+      case TANGO_CALIBRATION_POLYNOMIAL_5_PARAMETERS: {
+        const double r2 = ru * ru;
+        return ru * (1.0 + r2 * (k1 + r2 * (k2 + r2 * k3)));
+      }
+      default:
+        return ru;
+    }
+  }
+};
+
+RadialModel GetRadialModel(const TangoCameraIntrinsics& intrinsics) {
+  RadialModel model;
+  model.type = intrinsics.calibration_type;
+  model.k1 = model.k2 = model.k3 = model.w = 0.0;
+  const double* d = intrinsics.distortion;
+  switch (intrinsics.calibration_type) {
+    case TANGO_CALIBRATION_EQUIDISTANT:
+      model.w = d[0];
+      break;
+    case TANGO_CALIBRATION_POLYNOMIAL_2_PARAMETERS:
+      model.k1 = d[0];
+      model.k2 = d[1];
+      break;
+    case TANGO_CALIBRATION_POLYNOMIAL_3_PARAMETERS:
+      model.k1 = d[0];
+      model.k2 = d[1];
+      model.k3 = d[2];
+      break;
+    case TANGO_CALIBRATION_POLYNOMIAL_5_PARAMETERS:
+      model.k1 = d[0];
+      model.k2 = d[1];
+      model.k3 = d[4];
+      break;
+    default:
+      break;
+  }
+  return model;
+}
+
+// Largest radius up to which the model is increasing, and thus invertible.
+double FindMonotonicLimit(const RadialModel& model) {
+  double previous = 0.0;
+  for (double ru = kMonotonicSearchStep; ru <= kMaxUndistortedRadius;
+       ru += kMonotonicSearchStep) {
+    const double rd = model.Distort(ru);
+    if (!(rd > previous)) {
+      return ru - kMonotonicSearchStep;
+    }
+    previous = rd;
+  }
+  return kMaxUndistortedRadius;
+}
+
+// Inverse of the model on [0, limit], clamped to limit.
+double Undistort(const RadialModel& model, double rd, double limit) {
+  if (rd >= model.Distort(limit)) {
+    return limit;
+  }
+  double low = 0.0;
+  double high = limit;
+  for (int i = 0; i < kBisectionIterations; ++i) {
+    const double middle = 0.5 * (low + high);
+    if (model.Distort(middle) < rd) {
+      low = middle;
+    } else {
+      high = middle;
+    }
+  }
+  return 0.5 * (low + high);
+}
+
+// Ratio rd / ru, continued to the limit at the center.
+double DistortionScale(const RadialModel& model, double ru) {
+  ru = std::max(ru, kSmallRadius);
+  return model.Distort(ru) / ru;
+}
+
+}  // namespace
+
+namespace tango_perception {
+
+const int CameraProjection::kTableSize;
+
+CameraProjection::CameraProjection()
+    : p1_(0.0f),
+      p2_(0.0f),
+      distortion_table_(kTableSize + 1, 1.0f),
+      undistortion_table_(kTableSize + 1, 1.0f),
+      distortion_index_scale_(0.0f),
+      undistortion_index_scale_(0.0f) {
+  std::memset(&intrinsics_, 0, sizeof(intrinsics_));
+}
+
+void CameraProjection::SetCameraIntrinsics(
+    const TangoCameraIntrinsics& intrinsics) {
+  intrinsics_ = intrinsics;
+  const bool has_tangential =
+      intrinsics.calibration_type == TANGO_CALIBRATION_POLYNOMIAL_5_PARAMETERS;
+  p1_ = has_tangential ? static_cast<float>(intrinsics.distortion[2]) : 0.0f;
+  p2_ = has_tangential ? static_cast<float>(intrinsics.distortion[3]) : 0.0f;
+
+  const RadialModel model = GetRadialModel(intrinsics);
+  const double limit = FindMonotonicLimit(model);
+
+  // The distorted field of view is given by the image corners.
+  double max_distorted_radius = 0.0;
+  if (intrinsics.fx > 0.0 && intrinsics.fy > 0.0) {
+    const double corners_x[2] = {-intrinsics.cx,
+                                 intrinsics.width - intrinsics.cx};
+    const double corners_y[2] = {-intrinsics.cy,
+                                 intrinsics.height - intrinsics.cy};
+    for (double x : corners_x) {
+      for (double y : corners_y) {
+        const double nx = x / intrinsics.fx;
+        const double ny = y / intrinsics.fy;
+        max_distorted_radius =
+            std::max(max_distorted_radius, std::sqrt(nx * nx + ny * ny));
+      }
+    }
+  }
+  max_distorted_radius =
+      std::min(max_distorted_radius * kRadiusMargin, model.Distort(limit));
+  const double max_undistorted_radius =
+      Undistort(model, max_distorted_radius, limit);
+
+  if (max_distorted_radius <= 0.0 || max_undistorted_radius <= 0.0) {
+    std::fill(distortion_table_.begin(), distortion_table_.end(), 1.0f);
+    std::fill(undistortion_table_.begin(), undistortion_table_.end(), 1.0f);
+    distortion_index_scale_ = 0.0f;
+    undistortion_index_scale_ = 0.0f;
+    return;
+  }
+
+  const double max_undistorted_squared =
+      max_undistorted_radius * max_undistorted_radius;
+  const double max_distorted_squared =
+      max_distorted_radius * max_distorted_radius;
+  for (int i = 0; i <= kTableSize; ++i) {
+    const double fraction = static_cast<double>(i) / kTableSize;
+    const double ru = std::sqrt(fraction * max_undistorted_squared);
+    distortion_table_[i] = static_cast<float>(DistortionScale(model, ru));
+
+    const double rd = std::max(std::sqrt(fraction * max_distorted_squared),
+                               kSmallRadius);
+    undistortion_table_[i] =
+        static_cast<float>(Undistort(model, rd, limit) / rd);
+  }
+  distortion_index_scale_ =
+      static_cast<float>(kTableSize / max_undistorted_squared);
+  undistortion_index_scale_ =
+      static_cast<float>(kTableSize / max_distorted_squared);
+}
+
+bool CameraProjection::Project(const glm::vec3& camera_point,
+                               glm::vec2* pixel) const {
+  if (!(camera_point.z > 0.0f)) {
+    return false;
+  }
+  const glm::vec2 distorted = Distort(glm::vec2(camera_point) / camera_point.z);
+  pixel->x = static_cast<float>(intrinsics_.fx) * distorted.x +
+             static_cast<float>(intrinsics_.cx);
+  pixel->y = static_cast<float>(intrinsics_.fy) * distorted.y +
+             static_cast<float>(intrinsics_.cy);
+  return true;
+}
+
+glm::vec3 CameraProjection::Unproject(const glm::vec2& pixel) const {
+  const glm::vec2 distorted(
+      (pixel.x - static_cast<float>(intrinsics_.cx)) /
+          static_cast<float>(intrinsics_.fx),
+      (pixel.y - static_cast<float>(intrinsics_.cy)) /
+          static_cast<float>(intrinsics_.fy));
+  glm::vec2 normalized =
+      distorted * GetUndistortionScale(glm::dot(distorted, distorted));
+  if (p1_ != 0.0f || p2_ != 0.0f) {
+    for (int i = 0; i < kTangentialIterations; ++i) {
+      const float radius_squared = glm::dot(normalized, normalized);
+      normalized =
+          (distorted - GetTangentialOffset(normalized, radius_squared)) /
+          GetDistortionScale(radius_squared);
+    }
+  }
+  return glm::vec3(normalized, 1.0f);
+}
+
+void CameraProjection::GetDistortionTable(int size, std::vector<float>* table,
+                                          float* index_scale) const {
+  table->resize(size);
+  if (size < 2) {
+    std::fill(table->begin(), table->end(), 1.0f);
+    *index_scale = 0.0f;
+    return;
+  }
+  const float step = static_cast<float>(kTableSize) / (size - 1);
+  for (int i = 0; i < size; ++i) {
+    (*table)[i] = Interpolate(distortion_table_, i * step);
+  }
+  *index_scale = distortion_index_scale_ / step;
+}
+
+}  // namespace tango_perception
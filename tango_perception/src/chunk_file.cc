@@ -0,0 +1,282 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-perception/chunk_file.h"
+
+#include <unistd.h>
+
+namespace {
+
+const size_t kChunkPrefixSize = 2 * sizeof(uint32_t);
+const size_t kIndexPrefixSize = 2 * sizeof(uint32_t);
+const size_t kIndexEntrySize = sizeof(double) + sizeof(uint64_t);
+const size_t kTrailerSize = sizeof(uint64_t) + sizeof(uint32_t);
+
+template <typename T>
+bool ReadValue(FILE* file, T* value) {
+  return std::fread(value, sizeof(T), 1, file) == 1;
+}
+
+}  // namespace
+
+namespace tango_perception {
+
+void AppendPose(const TangoPoseData& pose, std::vector<uint8_t>* buffer) {
+  AppendValue(int32_t(pose.status_code), buffer);
+  AppendValue(int32_t(pose.frame.base), buffer);
+  AppendValue(int32_t(pose.frame.target), buffer);
+  AppendValue(pose.timestamp, buffer);
+  for (int i = 0; i < 3; ++i) {
+    AppendValue(pose.translation[i], buffer);
+  }
+  for (int i = 0; i < 4; ++i) {
+    AppendValue(pose.orientation[i], buffer);
+  }
+}
+
+void ConsumePose(const uint8_t** data, TangoPoseData* pose) {
+  std::memset(pose, 0, sizeof(*pose));
+  pose->status_code =
+      static_cast<TangoPoseStatusType>(ConsumeValue<int32_t>(data));
+  pose->frame.base =
+      static_cast<TangoCoordinateFrameType>(ConsumeValue<int32_t>(data));
+  pose->frame.target =
+      static_cast<TangoCoordinateFrameType>(ConsumeValue<int32_t>(data));
+  pose->timestamp = ConsumeValue<double>(data);
+  for (int i = 0; i < 3; ++i) {
+    pose->translation[i] = ConsumeValue<double>(data);
+  }
+  for (int i = 0; i < 4; ++i) {
+    pose->orientation[i] = ConsumeValue<double>(data);
+  }
+}
+
+ChunkFileWriter::ChunkFileWriter(const ChunkFileFormat& format)
+    : format_(format), file_(nullptr), size_(0), is_broken_(false) {}
+
+ChunkFileWriter::~ChunkFileWriter() { Close(); }
+
+bool ChunkFileWriter::Open(const std::string& path,
+                           const std::vector<uint8_t>& header_fields) {
+  Close();
+
+  file_ = std::fopen(path.c_str(), "wb");
+  if (file_ == nullptr) {
+    return false;
+  }
+  size_ = 0;
+  is_broken_ = false;
+  index_.clear();
+
+  std::vector<uint8_t> header;
+  AppendValue(format_.file_magic, &header);
+  AppendValue(format_.version, &header);
+  header.insert(header.end(), header_fields.begin(), header_fields.end());
+  if (!Write(header)) {
+    std::fclose(file_);
+    file_ = nullptr;
+    return false;
+  }
+  return true;
+}
+
+void ChunkFileWriter::BeginChunk(double timestamp,
+                                 std::vector<uint8_t>* buffer) const {
+  buffer->clear();
+  AppendValue(format_.chunk_magic, buffer);
+  AppendValue(uint32_t(0), buffer);  // Payload size, set by WriteChunk().
+  AppendValue(timestamp, buffer);
+}
+
+bool ChunkFileWriter::WriteChunk(std::vector<uint8_t>* chunk) {
+  const uint32_t payload_size =
+      static_cast<uint32_t>(chunk->size() - kChunkPrefixSize);
+  std::memcpy(&(*chunk)[sizeof(uint32_t)], &payload_size,
+              sizeof(payload_size));
+
+  const uint64_t offset = size_;
+  if (!Write(*chunk)) {
+    return false;
+  }
+  double timestamp;
+  std::memcpy(&timestamp, &(*chunk)[kChunkPrefixSize], sizeof(timestamp));
+  index_.push_back({timestamp, offset});
+  return true;
+}
+
+void ChunkFileWriter::Close() {
+  if (file_ == nullptr) {
+    return;
+  }
+
+  if (!is_broken_) {
+    index_buffer_.clear();
+    AppendValue(format_.index_magic, &index_buffer_);
+    AppendValue(static_cast<uint32_t>(index_.size()), &index_buffer_);
+    for (const IndexEntry& entry : index_) {
+      AppendValue(entry.timestamp, &index_buffer_);
+      AppendValue(entry.offset, &index_buffer_);
+    }
+    AppendValue(size_, &index_buffer_);
+    AppendValue(format_.trailer_magic, &index_buffer_);
+    Write(index_buffer_);
+
+    // Drop what undone writes left beyond the end, so the trailer is last.
+    if (std::fflush(file_) == 0) {
+      ftruncate(fileno(file_), static_cast<off_t>(size_));
+    }
+  }
+
+  std::fclose(file_);
+  file_ = nullptr;
+}
+
+bool ChunkFileWriter::Write(const std::vector<uint8_t>& data) {
+  if (is_broken_) {
+    return false;
+  }
+  if (std::fwrite(data.data(), 1, data.size(), file_) == data.size()) {
+    size_ += data.size();
+    return true;
+  }
+
+  // A short write still moves the file position. Go back to the end of the
+  // last complete write, so the next one lands where size_ says.
+  std::clearerr(file_);
+  if (std::fseek(file_, static_cast<long>(size_), SEEK_SET) != 0) {
+    is_broken_ = true;
+  }
+  return false;
+}
+
+ChunkFileReader::ChunkFileReader(const ChunkFileFormat& format)
+    : format_(format), file_(nullptr), file_size_(0) {}
+
+ChunkFileReader::~ChunkFileReader() { Close(); }
+
+bool ChunkFileReader::Open(const std::string& path, size_t header_fields_size,
+                           std::vector<uint8_t>* header_fields) {
+  Close();
+  file_ = std::fopen(path.c_str(), "rb");
+  if (file_ == nullptr) {
+    return false;
+  }
+  // Sizes and offsets read from the file are checked against its size
+  // before anything is allocated for them.
+  const long file_size =
+      std::fseek(file_, 0, SEEK_END) == 0 ? std::ftell(file_) : -1;
+  if (file_size < 0 || std::fseek(file_, 0, SEEK_SET) != 0) {
+    Close();
+    return false;
+  }
+  file_size_ = static_cast<uint64_t>(file_size);
+  uint32_t magic, version;
+  header_fields->resize(header_fields_size);
+  if (!ReadValue(file_, &magic) || !ReadValue(file_, &version) ||
+      magic != format_.file_magic || version != format_.version ||
+      std::fread(header_fields->data(), 1, header_fields_size, file_) !=
+          header_fields_size) {
+    Close();
+    return false;
+  }
+  if (!ReadIndex()) {
+    ScanChunks(static_cast<long>(2 * sizeof(uint32_t) + header_fields_size));
+  }
+  return true;
+}
+
+void ChunkFileReader::Close() {
+  if (file_ != nullptr) {
+    std::fclose(file_);
+    file_ = nullptr;
+  }
+  file_size_ = 0;
+  index_.clear();
+}
+
+bool ChunkFileReader::ReadChunk(size_t chunk, std::vector<uint8_t>* payload) {
+  if (file_ == nullptr || chunk >= index_.size()) {
+    return false;
+  }
+  const uint64_t offset = index_[chunk].offset;
+  uint32_t magic, payload_size;
+  if (offset > file_size_ - kChunkPrefixSize ||
+      std::fseek(file_, static_cast<long>(offset), SEEK_SET) != 0 ||
+      !ReadValue(file_, &magic) || !ReadValue(file_, &payload_size) ||
+      magic != format_.chunk_magic || payload_size < sizeof(double) ||
+      payload_size > file_size_ - offset - kChunkPrefixSize) {
+    return false;
+  }
+  payload->resize(payload_size);
+  return std::fread(payload->data(), 1, payload_size, file_) == payload_size;
+}
+
+bool ChunkFileReader::ReadIndex() {
+  uint64_t index_offset;
+  uint32_t magic;
+  if (std::fseek(file_, -static_cast<long>(kTrailerSize), SEEK_END) != 0 ||
+      !ReadValue(file_, &index_offset) || !ReadValue(file_, &magic) ||
+      magic != format_.trailer_magic) {
+    return false;
+  }
+  // The index sits between the chunks and the trailer.
+  const uint64_t index_end = file_size_ - kTrailerSize;
+  uint32_t num_chunks;
+  if (index_end < kIndexPrefixSize ||
+      index_offset > index_end - kIndexPrefixSize ||
+      std::fseek(file_, static_cast<long>(index_offset), SEEK_SET) != 0 ||
+      !ReadValue(file_, &magic) || !ReadValue(file_, &num_chunks) ||
+      magic != format_.index_magic ||
+      num_chunks > (index_end - index_offset - kIndexPrefixSize) /
+                       kIndexEntrySize) {
+    return false;
+  }
+  index_.resize(num_chunks);
+  for (IndexEntry& entry : index_) {
+    if (!ReadValue(file_, &entry.timestamp) ||
+        !ReadValue(file_, &entry.offset)) {
+      index_.clear();
+      return false;
+    }
+  }
+  return true;
+}
+
+void ChunkFileReader::ScanChunks(long first_chunk_offset) {
+  index_.clear();
+  const long file_size = static_cast<long>(file_size_);
+  long offset = first_chunk_offset;
+  while (offset + static_cast<long>(kChunkPrefixSize + sizeof(double)) <=
+         file_size) {
+    uint32_t magic, payload_size;
+    double timestamp;
+    if (std::fseek(file_, offset, SEEK_SET) != 0 ||
+        !ReadValue(file_, &magic) || !ReadValue(file_, &payload_size) ||
+        !ReadValue(file_, &timestamp) || magic != format_.chunk_magic) {
+      break;
+    }
+    const long next = offset + static_cast<long>(kChunkPrefixSize) +
+                      static_cast<long>(payload_size);
+    if (next > file_size) {
+      // Truncated by a crash while writing.
+      break;
+    }
+    index_.push_back({timestamp, static_cast<uint64_t>(offset)});
+    offset = next;
+  }
+}
+
+}  // namespace tango_perception
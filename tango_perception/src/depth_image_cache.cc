@@ -0,0 +1,85 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-perception/depth_image_cache.h"
+
+#include <algorithm>
+
+namespace tango_perception {
+
+DepthImageCache::DepthImageCache(const TangoCameraIntrinsics& intrinsics,
+                                 ThreadPool* thread_pool)
+    : width_(intrinsics.width),
+      height_(intrinsics.height),
+      interpolator_(thread_pool),
+      worker_([this](Job* job) { Upsample(job); }) {
+  projection_.SetCameraIntrinsics(intrinsics);
+  interpolator_.SetCameraIntrinsics(intrinsics);
+}
+
+void DepthImageCache::Update(
+    const std::shared_ptr<const RegisteredDepthFrame>& frame, Method method) {
+  worker_.Submit([&](Job* job) {
+    job->frame = frame;
+    job->method = method;
+  });
+}
+
+bool DepthImageCache::GetPointAt(
+    const float uv[2], TangoSupport_Rotation color_to_display_rotation,
+    float point[3], double* timestamp) {
+  const Result* result = results_.GetLatest();
+  if (result == nullptr) {
+    return false;
+  }
+  const glm::vec2 pixel = GetCameraPixelFromDisplayUv(
+      uv, color_to_display_rotation, width_, height_);
+  const int x = std::min(std::max(static_cast<int>(pixel.x), 0), width_ - 1);
+  const int y = std::min(std::max(static_cast<int>(pixel.y), 0), height_ - 1);
+  const float depth = result->depth[y * width_ + x];
+  if (depth == 0.0f) {
+    return false;
+  }
+
+  const glm::vec4 output_point =
+      result->point_cloud_T_color_camera *
+      glm::vec4(projection_.Unproject(pixel) * depth, 1.0f);
+  point[0] = output_point.x;
+  point[1] = output_point.y;
+  point[2] = output_point.z;
+  if (timestamp != nullptr) {
+    *timestamp = result->timestamp;
+  }
+  return true;
+}
+
+void DepthImageCache::Upsample(Job* job) {
+  const RegisteredDepthFrame& frame = *job->frame;
+  Result* result = results_.GetBackBuffer();
+  if (frame.width == width_ && frame.height == height_ &&
+      interpolator_.UpsampleProjectedPoints(
+          frame.points_x, frame.points_y, frame.points_depth,
+          job->method == kBilateral ? frame.luma : ImageView<const uint8_t>(),
+          false, &result->depth) == TANGO_SUCCESS) {
+    result->timestamp = frame.depth_timestamp;
+    result->point_cloud_T_color_camera = glm::inverse(frame.color_T_depth);
+    results_.Publish();
+  }
+  // Hand the frame back to the registration for reuse.
+  job->frame.reset();
+}
+
+}  // namespace tango_perception
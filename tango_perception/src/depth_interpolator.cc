@@ -0,0 +1,711 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-perception/depth_interpolator.h"
+
+#include <algorithm>
+
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/quaternion.hpp"
+#include "tango-perception/image_view.h"
+#include "tango-perception/simd.h"
+
+namespace {
+
+// Number of tasks per thread for the projection, to balance uneven threads.
+const int kTasksPerThread = 4;
+
+// Points per projection task are rounded to a multiple of the SIMD width.
+const uint32_t kSimdWidth = 4;
+
+const int kDefaultNearestRadius = 8;
+const int kDefaultBilateralRadius = 10;
+const float kDefaultLumaSigma = 16.0f;
+
+// Pixels whose total bilateral weight is below this get no depth.
+const float kMinWeight = 1e-6f;
+
+// The bilateral methods need the luma plane; RGBA images are converted
+// first.
+bool IsSupportedImage(const TangoImageBuffer* image_buffer, int width,
+                      int height) {
+  if (image_buffer == nullptr || image_buffer->data == nullptr ||
+      static_cast<int>(image_buffer->width) != width ||
+      static_cast<int>(image_buffer->height) != height) {
+    return false;
+  }
+  switch (image_buffer->format) {
+    case TANGO_HAL_PIXEL_FORMAT_YCrCb_420_SP:
+    case TANGO_HAL_PIXEL_FORMAT_YV12:
+    case TANGO_HAL_PIXEL_FORMAT_RGBA_8888:
+      return true;
+    default:
+      return false;
+  }
+}
+
+}  // namespace
+
+namespace tango_perception {
+
+glm::mat4 GetMatrixFromPose(const double translation[3],
+                            const double orientation[4]) {
+  const glm::quat rotation(static_cast<float>(orientation[3]),
+                           static_cast<float>(orientation[0]),
+                           static_cast<float>(orientation[1]),
+                           static_cast<float>(orientation[2]));
+  const glm::vec3 offset(static_cast<float>(translation[0]),
+                         static_cast<float>(translation[1]),
+                         static_cast<float>(translation[2]));
+  return glm::translate(glm::mat4(1.0f), offset) * glm::mat4_cast(rotation);
+}
+
+glm::vec2 GetCameraPixelFromDisplayUv(
+    const float uv[2], TangoSupport_Rotation color_to_display_rotation,
+    int width, int height) {
+  glm::vec2 camera_uv;
+  switch (color_to_display_rotation) {
+    case TANGO_SUPPORT_ROTATION_90:
+      camera_uv = glm::vec2(1.0f - uv[1], uv[0]);
+      break;
+    case TANGO_SUPPORT_ROTATION_180:
+      camera_uv = glm::vec2(1.0f - uv[0], 1.0f - uv[1]);
+      break;
+    case TANGO_SUPPORT_ROTATION_270:
+      camera_uv = glm::vec2(uv[1], 1.0f - uv[0]);
+      break;
+    default:
+      camera_uv = glm::vec2(uv[0], uv[1]);
+      break;
+  }
+  return glm::vec2(camera_uv.x * width, camera_uv.y * height);
+}
+
+DepthInterpolator::DepthInterpolator(ThreadPool* thread_pool)
+    : thread_pool_(thread_pool),
+      width_(0),
+      height_(0),
+      tiles_x_(0),
+      tiles_y_(0),
+      nearest_radius_(kDefaultNearestRadius),
+      bilateral_radius_(kDefaultBilateralRadius),
+      luma_sigma_(kDefaultLumaSigma) {}
+
+void DepthInterpolator::SetCameraIntrinsics(
+    const TangoCameraIntrinsics& intrinsics) {
+  projection_.SetCameraIntrinsics(intrinsics);
+  width_ = intrinsics.width;
+  height_ = intrinsics.height;
+  tiles_x_ = (width_ + kTileSize - 1) / kTileSize;
+  tiles_y_ = (height_ + kTileSize - 1) / kTileSize;
+  tile_offsets_.assign(tiles_x_ * tiles_y_ + 1, 0);
+}
+
+void DepthInterpolator::SetParameters(int nearest_radius, int bilateral_radius,
+                                      float luma_sigma) {
+  nearest_radius_ = std::max(nearest_radius, 1);
+  bilateral_radius_ = std::max(bilateral_radius, 1);
+  luma_sigma_ = std::max(luma_sigma, 1.0f);
+}
+
+TangoErrorType DepthInterpolator::GetDepthAtPointNearestNeighbor(
+    const TangoPointCloud* point_cloud,
+    const double point_cloud_translation[3],
+    const double point_cloud_orientation[4],
+    const float color_camera_uv_coordinates[2],
+    TangoSupport_Rotation color_to_display_rotation,
+    const double color_camera_translation[3],
+    const double color_camera_orientation[4], float output_point[3]) {
+  if (point_cloud == nullptr || point_cloud_translation == nullptr ||
+      point_cloud_orientation == nullptr ||
+      color_camera_uv_coordinates == nullptr ||
+      color_camera_translation == nullptr ||
+      color_camera_orientation == nullptr || output_point == nullptr ||
+      width_ == 0 || height_ == 0) {
+    return TANGO_INVALID;
+  }
+  std::fill(output_point, output_point + 3, 0.0f);
+
+  const glm::mat4 output_T_camera =
+      GetMatrixFromPose(color_camera_translation, color_camera_orientation);
+  const glm::mat4 output_T_points =
+      GetMatrixFromPose(point_cloud_translation, point_cloud_orientation);
+  ProjectPoints(point_cloud, glm::inverse(output_T_camera) * output_T_points,
+                ImageView<const uint8_t>());
+
+  // Four squared distances at a time; the best of every lane is merged at
+  // the end.
+  using simd::Float4;
+  const glm::vec2 pixel =
+      GetCameraPixelFromDisplayUv(color_camera_uv_coordinates,
+                                  color_to_display_rotation, width_, height_);
+  const Float4 pixel_x = simd::Splat(pixel.x);
+  const Float4 pixel_y = simd::Splat(pixel.y);
+  const float radius_squared =
+      static_cast<float>(nearest_radius_ * nearest_radius_);
+  Float4 best_distance = simd::Splat(radius_squared);
+  Float4 best_depth = simd::Splat(0.0f);
+  const size_t num_points = points_depth_.size();
+  size_t i = 0;
+  for (; i + kSimdWidth <= num_points; i += kSimdWidth) {
+    const Float4 dx = simd::Load(&points_x_[i]) - pixel_x;
+    const Float4 dy = simd::Load(&points_y_[i]) - pixel_y;
+    const Float4 distance = dx * dx + dy * dy;
+    const simd::Int4 closer = distance < best_distance;
+    best_distance = simd::Select(closer, distance, best_distance);
+    best_depth = simd::Select(closer, simd::Load(&points_depth_[i]),
+                              best_depth);
+  }
+  float distance = radius_squared;
+  float depth = 0.0f;
+  for (uint32_t lane = 0; lane < kSimdWidth; ++lane) {
+    if (best_distance[lane] < distance) {
+      distance = best_distance[lane];
+      depth = best_depth[lane];
+    }
+  }
+  for (; i < num_points; ++i) {
+    const float dx = points_x_[i] - pixel.x;
+    const float dy = points_y_[i] - pixel.y;
+    if (dx * dx + dy * dy < distance) {
+      distance = dx * dx + dy * dy;
+      depth = points_depth_[i];
+    }
+  }
+
+  if (depth == 0.0f) {
+    return TANGO_ERROR;
+  }
+  GetOutputPoint(color_camera_uv_coordinates, color_to_display_rotation, depth,
+                 output_T_camera, output_point);
+  return TANGO_SUCCESS;
+}
+
+TangoErrorType DepthInterpolator::GetDepthAtPointBilateral(
+    const TangoPointCloud* point_cloud,
+    const double point_cloud_translation[3],
+    const double point_cloud_orientation[4],
+    const TangoImageBuffer* image_buffer,
+    const float color_camera_uv_coordinates[2],
+    TangoSupport_Rotation color_to_display_rotation,
+    const double color_camera_translation[3],
+    const double color_camera_orientation[4], float output_point[3]) {
+  if (point_cloud == nullptr || point_cloud_translation == nullptr ||
+      point_cloud_orientation == nullptr ||
+      color_camera_uv_coordinates == nullptr ||
+      color_camera_translation == nullptr ||
+      color_camera_orientation == nullptr || output_point == nullptr ||
+      width_ == 0 || height_ == 0 ||
+      !IsSupportedImage(image_buffer, width_, height_)) {
+    return TANGO_INVALID;
+  }
+  std::fill(output_point, output_point + 3, 0.0f);
+
+  const glm::mat4 output_T_camera =
+      GetMatrixFromPose(color_camera_translation, color_camera_orientation);
+  const glm::mat4 output_T_points =
+      GetMatrixFromPose(point_cloud_translation, point_cloud_orientation);
+  const ImageView<const uint8_t> luma_plane = GetLuma(*image_buffer);
+  ProjectPoints(point_cloud, glm::inverse(output_T_camera) * output_T_points,
+                luma_plane);
+
+  const glm::vec2 pixel =
+      GetCameraPixelFromDisplayUv(color_camera_uv_coordinates,
+                                  color_to_display_rotation, width_, height_);
+  const int pixel_x = std::min(static_cast<int>(pixel.x), width_ - 1);
+  const int pixel_y = std::min(static_cast<int>(pixel.y), height_ - 1);
+  const float luma =
+      luma_plane.At(std::max(pixel_x, 0), std::max(pixel_y, 0));
+
+  using simd::Float4;
+  const Float4 zero = simd::Splat(0.0f);
+  const Float4 one = simd::Splat(1.0f);
+  const Float4 pixel_x4 = simd::Splat(pixel.x);
+  const Float4 pixel_y4 = simd::Splat(pixel.y);
+  const Float4 luma4 = simd::Splat(luma);
+  const Float4 inverse_radius_squared = simd::Splat(
+      1.0f / static_cast<float>(bilateral_radius_ * bilateral_radius_));
+  const Float4 sigma_squared = simd::Splat(luma_sigma_ * luma_sigma_);
+  Float4 depth_sum = zero;
+  Float4 weight_sum = zero;
+  const size_t num_points = points_depth_.size();
+  size_t i = 0;
+  for (; i + kSimdWidth <= num_points; i += kSimdWidth) {
+    const Float4 dx = simd::Load(&points_x_[i]) - pixel_x4;
+    const Float4 dy = simd::Load(&points_y_[i]) - pixel_y4;
+    const Float4 spatial = simd::Max(
+        one - (dx * dx + dy * dy) * inverse_radius_squared, zero);
+    const Float4 dl = simd::Load(&points_luma_[i]) - luma4;
+    const Float4 weight =
+        spatial * spatial * sigma_squared / (sigma_squared + dl * dl);
+    depth_sum += weight * simd::Load(&points_depth_[i]);
+    weight_sum += weight;
+  }
+  float depth = simd::HorizontalSum(depth_sum);
+  float weight = simd::HorizontalSum(weight_sum);
+  for (; i < num_points; ++i) {
+    const float dx = points_x_[i] - pixel.x;
+    const float dy = points_y_[i] - pixel.y;
+    const float spatial = std::max(
+        1.0f - (dx * dx + dy * dy) * inverse_radius_squared[0], 0.0f);
+    const float dl = points_luma_[i] - luma;
+    const float point_weight = spatial * spatial * sigma_squared[0] /
+                               (sigma_squared[0] + dl * dl);
+    depth += point_weight * points_depth_[i];
+    weight += point_weight;
+  }
+
+  if (weight <= kMinWeight) {
+    return TANGO_ERROR;
+  }
+  GetOutputPoint(color_camera_uv_coordinates, color_to_display_rotation,
+                 depth / weight, output_T_camera, output_point);
+  return TANGO_SUCCESS;
+}
+
+TangoErrorType DepthInterpolator::UpsampleImageNearestNeighbor(
+    const TangoPointCloud* point_cloud,
+    const TangoPoseData* color_camera_T_point_cloud,
+    std::vector<float>* depth_buffer) {
+  if (point_cloud == nullptr || color_camera_T_point_cloud == nullptr ||
+      depth_buffer == nullptr || width_ == 0 || height_ == 0) {
+    return TANGO_INVALID;
+  }
+  ProjectPoints(point_cloud,
+                GetMatrixFromPose(color_camera_T_point_cloud->translation,
+                             color_camera_T_point_cloud->orientation),
+                ImageView<const uint8_t>());
+  BinPoints(nearest_radius_);
+
+  depth_buffer->resize(static_cast<size_t>(width_) * height_);
+  float* output = depth_buffer->data();
+  thread_pool_->ParallelFor(tiles_x_ * tiles_y_, [&](int tile) {
+    RenderNearestTile(tile, output);
+  });
+  return TANGO_SUCCESS;
+}
+
+TangoErrorType DepthInterpolator::UpsampleImageBilateral(
+    bool approximate, const TangoPointCloud* point_cloud,
+    const TangoImageBuffer* image_buffer,
+    const TangoPoseData* color_camera_T_point_cloud,
+    std::vector<float>* depth_buffer) {
+  if (point_cloud == nullptr || color_camera_T_point_cloud == nullptr ||
+      depth_buffer == nullptr || width_ == 0 || height_ == 0 ||
+      !IsSupportedImage(image_buffer, width_, height_)) {
+    return TANGO_INVALID;
+  }
+  const ImageView<const uint8_t> luma = GetLuma(*image_buffer);
+  ProjectPoints(point_cloud,
+                GetMatrixFromPose(color_camera_T_point_cloud->translation,
+                             color_camera_T_point_cloud->orientation),
+                luma);
+  BinPoints(bilateral_radius_);
+
+  depth_buffer->resize(static_cast<size_t>(width_) * height_);
+  float* output = depth_buffer->data();
+  thread_pool_->ParallelFor(tiles_x_ * tiles_y_, [&](int tile) {
+    RenderBilateralTile(tile, luma, approximate, output);
+  });
+  return TANGO_SUCCESS;
+}
+
+TangoErrorType DepthInterpolator::UpsampleProjectedPoints(
+    const std::vector<float>& points_x, const std::vector<float>& points_y,
+    const std::vector<float>& points_depth, ImageView<const uint8_t> luma,
+    bool approximate, std::vector<float>* depth_buffer) {
+  if (depth_buffer == nullptr || width_ == 0 || height_ == 0 ||
+      points_x.size() != points_depth.size() ||
+      points_y.size() != points_depth.size() ||
+      (luma.IsValid() &&
+       (luma.GetWidth() != width_ || luma.GetHeight() != height_))) {
+    return TANGO_INVALID;
+  }
+  points_x_ = points_x;
+  points_y_ = points_y;
+  points_depth_ = points_depth;
+  points_luma_.clear();
+  if (luma.IsValid()) {
+    for (size_t i = 0; i < points_depth.size(); ++i) {
+      points_luma_.push_back(luma.At(static_cast<int>(points_x[i]),
+                                     static_cast<int>(points_y[i])));
+    }
+  }
+  BinPoints(luma.IsValid() ? bilateral_radius_ : nearest_radius_);
+
+  depth_buffer->resize(static_cast<size_t>(width_) * height_);
+  float* output = depth_buffer->data();
+  thread_pool_->ParallelFor(tiles_x_ * tiles_y_, [&](int tile) {
+    if (luma.IsValid()) {
+      RenderBilateralTile(tile, luma, approximate, output);
+    } else {
+      RenderNearestTile(tile, output);
+    }
+  });
+  return TANGO_SUCCESS;
+}
+
+ImageView<const uint8_t> DepthInterpolator::GetLuma(
+    const TangoImageBuffer& image_buffer) {
+  if (image_buffer.format != TANGO_HAL_PIXEL_FORMAT_RGBA_8888) {
+    return GetLumaPlane(image_buffer);
+  }
+  rgba_luma_.resize(static_cast<size_t>(width_) * height_);
+  const ImageView<uint8_t> luma(rgba_luma_.data(), width_, height_, width_);
+  ConvertRgbaToGrayscale(GetRgbaPlane(image_buffer), luma);
+  return luma;
+}
+
+void DepthInterpolator::ProjectPoints(const TangoPointCloud* point_cloud,
+                                      const glm::mat4& camera_T_points,
+                                      ImageView<const uint8_t> luma) {
+  const int num_tasks = thread_pool_->GetNumThreads() * kTasksPerThread;
+  slices_.resize(num_tasks);
+  thread_pool_->ParallelFor(num_tasks, [&](int task) {
+    ProjectSlice(point_cloud, camera_T_points, luma, task, num_tasks);
+  });
+
+  points_x_.clear();
+  points_y_.clear();
+  points_depth_.clear();
+  points_luma_.clear();
+  for (const ProjectedSlice& slice : slices_) {
+    points_x_.insert(points_x_.end(), slice.x.begin(), slice.x.end());
+    points_y_.insert(points_y_.end(), slice.y.begin(), slice.y.end());
+    points_depth_.insert(points_depth_.end(), slice.depth.begin(),
+                         slice.depth.end());
+    points_luma_.insert(points_luma_.end(), slice.luma.begin(),
+                        slice.luma.end());
+  }
+}
+
+void DepthInterpolator::ProjectSlice(const TangoPointCloud* point_cloud,
+                                     const glm::mat4& camera_T_points,
+                                     ImageView<const uint8_t> luma,
+                                     int task, int num_tasks) {
+  using simd::Float4;
+  using simd::Int4;
+
+  ProjectedSlice& slice = slices_[task];
+  slice.x.clear();
+  slice.y.clear();
+  slice.depth.clear();
+  slice.luma.clear();
+
+  const uint32_t num_points = point_cloud->num_points;
+  uint32_t chunk = (num_points + num_tasks - 1) / num_tasks;
+  chunk = (chunk + kSimdWidth - 1) / kSimdWidth * kSimdWidth;
+  const uint32_t begin = std::min(num_points, task * chunk);
+  const uint32_t end = std::min(num_points, begin + chunk);
+
+  const TangoCameraIntrinsics& intrinsics = projection_.GetIntrinsics();
+  const glm::mat4& m = camera_T_points;
+  const Float4 zero = simd::Splat(0.0f);
+  const Float4 width = simd::Splat(static_cast<float>(width_));
+  const Float4 height = simd::Splat(static_cast<float>(height_));
+  const Float4 two = simd::Splat(2.0f);
+  const Float4 fx = simd::Splat(static_cast<float>(intrinsics.fx));
+  const Float4 fy = simd::Splat(static_cast<float>(intrinsics.fy));
+  const Float4 cx = simd::Splat(static_cast<float>(intrinsics.cx));
+  const Float4 cy = simd::Splat(static_cast<float>(intrinsics.cy));
+  const Float4 tangential_p1 = simd::Splat(projection_.GetP1());
+  const Float4 tangential_p2 = simd::Splat(projection_.GetP2());
+
+  auto keep = [&](float u, float v, float depth) {
+    slice.x.push_back(u);
+    slice.y.push_back(v);
+    slice.depth.push_back(depth);
+    if (luma.IsValid()) {
+      slice.luma.push_back(luma.At(static_cast<int>(u), static_cast<int>(v)));
+    }
+  };
+
+  uint32_t i = begin;
+  for (; i + kSimdWidth <= end; i += kSimdWidth) {
+    const float* p0 = point_cloud->points[i];
+    const float* p1 = point_cloud->points[i + 1];
+    const float* p2 = point_cloud->points[i + 2];
+    const float* p3 = point_cloud->points[i + 3];
+    const Float4 x = {p0[0], p1[0], p2[0], p3[0]};
+    const Float4 y = {p0[1], p1[1], p2[1], p3[1]};
+    const Float4 z = {p0[2], p1[2], p2[2], p3[2]};
+
+    // glm matrices are column major: m[column][row].
+    auto transform_row = [&](int row) {
+      return simd::Splat(m[0][row]) * x + simd::Splat(m[1][row]) * y +
+             simd::Splat(m[2][row]) * z + simd::Splat(m[3][row]);
+    };
+    const Float4 camera_x = transform_row(0);
+    const Float4 camera_y = transform_row(1);
+    const Float4 camera_z = transform_row(2);
+
+    const Int4 in_front = camera_z > zero;
+    const Float4 inverse_z =
+        simd::Select(in_front, simd::Splat(1.0f) / camera_z, zero);
+    const Float4 normalized_x = camera_x * inverse_z;
+    const Float4 normalized_y = camera_y * inverse_z;
+    const Float4 radius_squared =
+        normalized_x * normalized_x + normalized_y * normalized_y;
+    const Float4 scale = {projection_.GetDistortionScale(radius_squared[0]),
+                          projection_.GetDistortionScale(radius_squared[1]),
+                          projection_.GetDistortionScale(radius_squared[2]),
+                          projection_.GetDistortionScale(radius_squared[3])};
+    const Float4 xy = two * normalized_x * normalized_y;
+    const Float4 distorted_x =
+        normalized_x * scale + tangential_p1 * xy +
+        tangential_p2 * (radius_squared + two * normalized_x * normalized_x);
+    const Float4 distorted_y =
+        normalized_y * scale + tangential_p2 * xy +
+        tangential_p1 * (radius_squared + two * normalized_y * normalized_y);
+    const Float4 u = fx * distorted_x + cx;
+    const Float4 v = fy * distorted_y + cy;
+    const Int4 visible =
+        in_front & (u >= zero) & (u < width) & (v >= zero) & (v < height);
+    for (uint32_t lane = 0; lane < kSimdWidth; ++lane) {
+      if (visible[lane]) {
+        keep(u[lane], v[lane], camera_z[lane]);
+      }
+    }
+  }
+
+  for (; i < end; ++i) {
+    const glm::vec4 camera_point =
+        m * glm::vec4(point_cloud->points[i][0], point_cloud->points[i][1],
+                      point_cloud->points[i][2], 1.0f);
+    glm::vec2 pixel;
+    if (projection_.Project(glm::vec3(camera_point), &pixel) &&
+        pixel.x >= 0.0f && pixel.x < width_ && pixel.y >= 0.0f &&
+        pixel.y < height_) {
+      keep(pixel.x, pixel.y, camera_point.z);
+    }
+  }
+}
+
+void DepthInterpolator::BinPoints(int radius) {
+  // Counting sort as in DepthSplatter: count the points per tile, turn the
+  // counts into offsets, then place the point indices. A point reaches the
+  // pixels whose centers are within radius of it.
+  const uint32_t num_points = static_cast<uint32_t>(points_depth_.size());
+  auto get_tile_range = [&](uint32_t i, int* tile_x0, int* tile_y0,
+                            int* tile_x1, int* tile_y1) {
+    const int x = static_cast<int>(points_x_[i]);
+    const int y = static_cast<int>(points_y_[i]);
+    *tile_x0 = std::max(x - radius - 1, 0) / kTileSize;
+    *tile_y0 = std::max(y - radius - 1, 0) / kTileSize;
+    *tile_x1 = std::min(x + radius, width_ - 1) / kTileSize;
+    *tile_y1 = std::min(y + radius, height_ - 1) / kTileSize;
+  };
+
+  std::fill(tile_offsets_.begin(), tile_offsets_.end(), 0);
+  for (uint32_t i = 0; i < num_points; ++i) {
+    int tile_x0, tile_y0, tile_x1, tile_y1;
+    get_tile_range(i, &tile_x0, &tile_y0, &tile_x1, &tile_y1);
+    for (int tile_y = tile_y0; tile_y <= tile_y1; ++tile_y) {
+      for (int tile_x = tile_x0; tile_x <= tile_x1; ++tile_x) {
+        ++tile_offsets_[tile_y * tiles_x_ + tile_x + 1];
+      }
+    }
+  }
+
+  const int num_tiles = tiles_x_ * tiles_y_;
+  for (int tile = 0; tile < num_tiles; ++tile) {
+    tile_offsets_[tile + 1] += tile_offsets_[tile];
+  }
+  tile_points_.resize(tile_offsets_[num_tiles]);
+
+  for (uint32_t i = 0; i < num_points; ++i) {
+    int tile_x0, tile_y0, tile_x1, tile_y1;
+    get_tile_range(i, &tile_x0, &tile_y0, &tile_x1, &tile_y1);
+    for (int tile_y = tile_y0; tile_y <= tile_y1; ++tile_y) {
+      for (int tile_x = tile_x0; tile_x <= tile_x1; ++tile_x) {
+        tile_points_[tile_offsets_[tile_y * tiles_x_ + tile_x]++] = i;
+      }
+    }
+  }
+  for (int tile = num_tiles; tile > 0; --tile) {
+    tile_offsets_[tile] = tile_offsets_[tile - 1];
+  }
+  tile_offsets_[0] = 0;
+}
+
+void DepthInterpolator::GetOutputPoint(const float uv[2],
+                                       TangoSupport_Rotation rotation,
+                                       float depth,
+                                       const glm::mat4& output_T_camera,
+                                       float output_point[3]) const {
+  const glm::vec3 camera_point =
+      projection_.Unproject(
+      GetCameraPixelFromDisplayUv(uv, rotation, width_, height_)) * depth;
+  const glm::vec4 point = output_T_camera * glm::vec4(camera_point, 1.0f);
+  output_point[0] = point.x;
+  output_point[1] = point.y;
+  output_point[2] = point.z;
+}
+
+void DepthInterpolator::GetTileBounds(int tile, int* x0, int* y0, int* x1,
+                                      int* y1) const {
+  *x0 = (tile % tiles_x_) * kTileSize;
+  *y0 = (tile / tiles_x_) * kTileSize;
+  *x1 = std::min(*x0 + kTileSize, width_);
+  *y1 = std::min(*y0 + kTileSize, height_);
+}
+
+void DepthInterpolator::RenderNearestTile(int tile,
+                                          float* depth_buffer) const {
+  using simd::Float4;
+
+  int tile_x0, tile_y0, tile_x1, tile_y1;
+  GetTileBounds(tile, &tile_x0, &tile_y0, &tile_x1, &tile_y1);
+
+  // Squared distance to and depth of the nearest point so far. Starting at
+  // the squared radius leaves pixels without a point in reach at zero.
+  float best_distance[kTileSize * kTileStride];
+  float best_depth[kTileSize * kTileStride];
+  const float radius = static_cast<float>(nearest_radius_);
+  std::fill(best_distance, best_distance + kTileSize * kTileStride,
+            radius * radius);
+  std::fill(best_depth, best_depth + kTileSize * kTileStride, 0.0f);
+
+  const Float4 lane_offsets = {0.5f, 1.5f, 2.5f, 3.5f};
+  for (uint32_t k = tile_offsets_[tile]; k < tile_offsets_[tile + 1]; ++k) {
+    const uint32_t i = tile_points_[k];
+    const float point_x = points_x_[i];
+    const float point_y = points_y_[i];
+    // Pixel x has its center at x + 0.5.
+    const int x0 = std::max(static_cast<int>(point_x - radius), tile_x0);
+    const int x1 = std::min(static_cast<int>(point_x + radius) + 1, tile_x1);
+    const int y0 = std::max(static_cast<int>(point_y - radius), tile_y0);
+    const int y1 = std::min(static_cast<int>(point_y + radius) + 1, tile_y1);
+    const Float4 depth4 = simd::Splat(points_depth_[i]);
+    // Groups of four may run into the padding; the pixels past the tile are
+    // never read back.
+    for (int y = y0; y < y1; ++y) {
+      const float dy = y + 0.5f - point_y;
+      const Float4 dy_squared = simd::Splat(dy * dy);
+      float* distance_row = best_distance + (y - tile_y0) * kTileStride;
+      float* depth_row = best_depth + (y - tile_y0) * kTileStride;
+      for (int x = x0; x < x1; x += 4) {
+        const Float4 dx =
+            simd::Splat(static_cast<float>(x) - point_x) + lane_offsets;
+        const Float4 distance = dx * dx + dy_squared;
+        const int offset = x - tile_x0;
+        const Float4 best = simd::Load(distance_row + offset);
+        const simd::Int4 closer = distance < best;
+        simd::Store(distance_row + offset,
+                    simd::Select(closer, distance, best));
+        simd::Store(depth_row + offset,
+                    simd::Select(closer, depth4,
+                                 simd::Load(depth_row + offset)));
+      }
+    }
+  }
+
+  for (int y = tile_y0; y < tile_y1; ++y) {
+    const float* depth_row = best_depth + (y - tile_y0) * kTileStride;
+    std::copy(depth_row, depth_row + (tile_x1 - tile_x0),
+              depth_buffer + y * width_ + tile_x0);
+  }
+}
+
+void DepthInterpolator::RenderBilateralTile(
+    int tile, ImageView<const uint8_t> image_luma, bool approximate,
+    float* depth_buffer) const {
+  using simd::Float4;
+
+  int tile_x0, tile_y0, tile_x1, tile_y1;
+  GetTileBounds(tile, &tile_x0, &tile_y0, &tile_x1, &tile_y1);
+
+  // The weights are evaluated on a grid of samples, every pixel or every
+  // other pixel of the tile. Sample (i, j) sits at the center of pixel
+  // (tile_x0 + step * i, tile_y0 + step * j).
+  const int step = approximate ? 2 : 1;
+  const int samples_x = (tile_x1 - tile_x0 + step - 1) / step;
+  const int samples_y = (tile_y1 - tile_y0 + step - 1) / step;
+  float luma[kTileSize * kTileStride];
+  float depth_sums[kTileSize * kTileStride];
+  float weight_sums[kTileSize * kTileStride];
+  std::fill(luma, luma + kTileSize * kTileStride, 0.0f);
+  std::fill(depth_sums, depth_sums + kTileSize * kTileStride, 0.0f);
+  std::fill(weight_sums, weight_sums + kTileSize * kTileStride, 0.0f);
+  for (int j = 0; j < samples_y; ++j) {
+    for (int i = 0; i < samples_x; ++i) {
+      luma[j * kTileStride + i] =
+          image_luma.At(tile_x0 + step * i, tile_y0 + step * j);
+    }
+  }
+
+  const float radius = static_cast<float>(bilateral_radius_);
+  const float inverse_radius_squared = 1.0f / (radius * radius);
+  const Float4 zero = simd::Splat(0.0f);
+  const Float4 one = simd::Splat(1.0f);
+  const Float4 inverse_radius_squared4 = simd::Splat(inverse_radius_squared);
+  const Float4 sigma_squared = simd::Splat(luma_sigma_ * luma_sigma_);
+  const Float4 lane_offsets = {0.0f, 1.0f * step, 2.0f * step, 3.0f * step};
+  const float origin_x = tile_x0 + 0.5f;
+  const float origin_y = tile_y0 + 0.5f;
+  const float inverse_step = 1.0f / step;
+  for (uint32_t k = tile_offsets_[tile]; k < tile_offsets_[tile + 1]; ++k) {
+    const uint32_t p = tile_points_[k];
+    const float point_x = points_x_[p];
+    const float point_y = points_y_[p];
+    // Samples whose centers are within radius of the point.
+    const int i0 = std::max(
+        static_cast<int>((point_x - radius - origin_x) * inverse_step + 1.0f),
+        0);
+    const int i1 = std::min(
+        static_cast<int>((point_x + radius - origin_x) * inverse_step + 1.0f),
+        samples_x);
+    const int j0 = std::max(
+        static_cast<int>((point_y - radius - origin_y) * inverse_step + 1.0f),
+        0);
+    const int j1 = std::min(
+        static_cast<int>((point_y + radius - origin_y) * inverse_step + 1.0f),
+        samples_y);
+    const Float4 depth4 = simd::Splat(points_depth_[p]);
+    const Float4 point_luma = simd::Splat(points_luma_[p]);
+    // Groups of four may run into the padding, whose sums are never read.
+    for (int j = j0; j < j1; ++j) {
+      const float dy = origin_y + step * j - point_y;
+      const Float4 dy_squared = simd::Splat(dy * dy);
+      const int row = j * kTileStride;
+      for (int i = i0; i < i1; i += 4) {
+        const Float4 dx =
+            simd::Splat(origin_x + step * i - point_x) + lane_offsets;
+        const Float4 spatial = simd::Max(
+            one - (dx * dx + dy_squared) * inverse_radius_squared4, zero);
+        const Float4 dl = simd::Load(luma + row + i) - point_luma;
+        const Float4 weight =
+            spatial * spatial * sigma_squared / (sigma_squared + dl * dl);
+        simd::Store(depth_sums + row + i,
+                    simd::Load(depth_sums + row + i) + weight * depth4);
+        simd::Store(weight_sums + row + i,
+                    simd::Load(weight_sums + row + i) + weight);
+      }
+    }
+  }
+
+  for (int y = tile_y0; y < tile_y1; ++y) {
+    const int row = (y - tile_y0) / step * kTileStride;
+    float* output_row = depth_buffer + y * width_;
+    for (int x = tile_x0; x < tile_x1; ++x) {
+      const int sample = row + (x - tile_x0) / step;
+      const float weight = weight_sums[sample];
+      output_row[x] = weight > kMinWeight ? depth_sums[sample] / weight : 0.0f;
+    }
+  }
+}
+
+}  // namespace tango_perception
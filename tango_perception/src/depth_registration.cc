@@ -0,0 +1,112 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-perception/depth_registration.h"
+
+#include <atomic>
+
+namespace tango_perception {
+
+DepthRegistration::DepthRegistration(const TangoCameraIntrinsics& intrinsics,
+                                     const PoseLookup& pose_lookup,
+                                     ThreadPool* thread_pool)
+    : pose_lookup_(pose_lookup),
+      splatter_(thread_pool),
+      worker_([this](Job* job) { Register(job); }) {
+  splatter_.SetCameraIntrinsics(intrinsics);
+}
+
+void DepthRegistration::Submit(const TangoPointCloud* point_cloud,
+                               const TangoImageBuffer* image_buffer,
+                               double color_timestamp) {
+  // The buffers keep their capacity, so after the first few pairs this only
+  // copies.
+  worker_.Submit([&](Job* job) {
+    job->point_cloud = *point_cloud;
+    const float* points = point_cloud->points[0];
+    job->points.assign(points, points + 4 * point_cloud->num_points);
+    job->color_timestamp = color_timestamp;
+    job->luma = image_buffer != nullptr
+                    ? CopyLuma(*image_buffer, &job->luma_data)
+                    : ImageView<const uint8_t>();
+  });
+}
+
+std::shared_ptr<const RegisteredDepthFrame> DepthRegistration::GetLatest()
+    const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return latest_;
+}
+
+std::shared_ptr<RegisteredDepthFrame> DepthRegistration::AcquireFrame() {
+  // Only the worker hands out references, through latest_, so a frame held
+  // by frames_ alone stays free until the worker publishes it again.
+  for (const std::shared_ptr<RegisteredDepthFrame>& frame : frames_) {
+    if (frame.use_count() == 1) {
+      // Order the writes to the frame after the reads of its last consumer.
+      std::atomic_thread_fence(std::memory_order_acquire);
+      return frame;
+    }
+  }
+  frames_.push_back(std::make_shared<RegisteredDepthFrame>());
+  return frames_.back();
+}
+
+void DepthRegistration::Register(Job* job) {
+  // The copy owns the points; point the Tango struct back at them.
+  job->point_cloud.points = reinterpret_cast<float(*)[4]>(job->points.data());
+
+  glm::mat4 color_T_depth;
+  if (!pose_lookup_(job->color_timestamp, job->point_cloud.timestamp,
+                    &color_T_depth)) {
+    return;
+  }
+  splatter_.Splat(&job->point_cloud, color_T_depth, 0);
+
+  std::shared_ptr<RegisteredDepthFrame> frame = AcquireFrame();
+  frame->depth_timestamp = job->point_cloud.timestamp;
+  frame->color_timestamp = job->color_timestamp;
+  frame->color_T_depth = color_T_depth;
+  frame->width = splatter_.GetWidth();
+  frame->height = splatter_.GetHeight();
+  frame->depth = splatter_.GetDepthImage();
+
+  const std::vector<int32_t>& projected_x = splatter_.GetProjectedX();
+  const std::vector<int32_t>& projected_y = splatter_.GetProjectedY();
+  const std::vector<float>& projected_depth = splatter_.GetProjectedDepth();
+  frame->points_x.clear();
+  frame->points_y.clear();
+  frame->points_depth.clear();
+  for (size_t i = 0; i < projected_depth.size(); ++i) {
+    if (projected_depth[i] != 0.0f) {
+      frame->points_x.push_back(projected_x[i] + 0.5f);
+      frame->points_y.push_back(projected_y[i] + 0.5f);
+      frame->points_depth.push_back(projected_depth[i]);
+    }
+  }
+
+  // Swapping hands the luma over without a copy, and the view stays valid
+  // since the buffer moves with it. The job gets the old buffer of the frame
+  // to fill next time.
+  frame->luma_data.swap(job->luma_data);
+  frame->luma = job->luma;
+  job->luma = ImageView<const uint8_t>();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  latest_ = frame;
+}
+
+}  // namespace tango_perception
@@ -0,0 +1,352 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-perception/depth_splatter.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "tango-perception/simd.h"
+
+namespace {
+
+// Number of tasks per thread for the projection, to balance uneven threads.
+const int kTasksPerThread = 4;
+
+// Points per projection task are rounded to a multiple of the SIMD width.
+const uint32_t kSimdWidth = 4;
+
+}  // namespace
+
+namespace tango_perception {
+
+DepthSplatter::DepthSplatter(ThreadPool* thread_pool)
+    : thread_pool_(thread_pool),
+      width_(0),
+      height_(0),
+      fx_(0.0f),
+      fy_(0.0f),
+      cx_(0.0f),
+      cy_(0.0f),
+      tiles_x_(0),
+      tiles_y_(0) {}
+
+void DepthSplatter::SetCameraIntrinsics(
+    const TangoCameraIntrinsics& intrinsics) {
+  projection_.SetCameraIntrinsics(intrinsics);
+  width_ = intrinsics.width;
+  height_ = intrinsics.height;
+  fx_ = static_cast<float>(intrinsics.fx);
+  fy_ = static_cast<float>(intrinsics.fy);
+  cx_ = static_cast<float>(intrinsics.cx);
+  cy_ = static_cast<float>(intrinsics.cy);
+  tiles_x_ = (width_ + kTileSize - 1) / kTileSize;
+  tiles_y_ = (height_ + kTileSize - 1) / kTileSize;
+
+  depth_image_.assign(width_ * height_, 0.0f);
+  tile_offsets_.assign(tiles_x_ * tiles_y_ + 1, 0);
+  tile_was_covered_.assign(tiles_x_ * tiles_y_, 0);
+  changed_tiles_.clear();
+}
+
+void DepthSplatter::Splat(const TangoPointCloud* point_cloud,
+                          const glm::mat4& camera_T_points,
+                          int window_radius) {
+  if (width_ == 0 || height_ == 0) {
+    return;
+  }
+
+  const uint32_t num_points = point_cloud->num_points;
+  projected_x_.resize(num_points);
+  projected_y_.resize(num_points);
+  projected_depth_.resize(num_points);
+
+  const int num_tasks = thread_pool_->GetNumThreads() * kTasksPerThread;
+  thread_pool_->ParallelFor(num_tasks, [&](int task) {
+    ProjectPoints(point_cloud, camera_T_points, task, num_tasks);
+  });
+
+  BinPoints(num_points, window_radius);
+
+  // Render every tile that has points now or had points last frame; the
+  // latter only need clearing.
+  changed_tiles_.clear();
+  const int num_tiles = tiles_x_ * tiles_y_;
+  for (int tile = 0; tile < num_tiles; ++tile) {
+    const bool covered = tile_offsets_[tile + 1] > tile_offsets_[tile];
+    if (covered || tile_was_covered_[tile]) {
+      changed_tiles_.push_back(tile);
+    }
+    tile_was_covered_[tile] = covered;
+  }
+  thread_pool_->ParallelFor(
+      static_cast<int>(changed_tiles_.size()),
+      [&](int index) { RenderTile(changed_tiles_[index], window_radius); });
+}
+
+void DepthSplatter::ProjectPoints(const TangoPointCloud* point_cloud,
+                                  const glm::mat4& camera_T_points, int task,
+                                  int num_tasks) {
+  using simd::Float4;
+  using simd::Int4;
+
+  const uint32_t num_points = point_cloud->num_points;
+  uint32_t chunk = (num_points + num_tasks - 1) / num_tasks;
+  chunk = (chunk + kSimdWidth - 1) / kSimdWidth * kSimdWidth;
+  const uint32_t begin = std::min(num_points, task * chunk);
+  const uint32_t end = std::min(num_points, begin + chunk);
+
+  const glm::mat4& m = camera_T_points;
+  const Float4 zero = simd::Splat(0.0f);
+  const Float4 width = simd::Splat(static_cast<float>(width_));
+  const Float4 height = simd::Splat(static_cast<float>(height_));
+  const Float4 two = simd::Splat(2.0f);
+  const Float4 tangential_p1 = simd::Splat(projection_.GetP1());
+  const Float4 tangential_p2 = simd::Splat(projection_.GetP2());
+
+  uint32_t i = begin;
+  for (; i + kSimdWidth <= end; i += kSimdWidth) {
+    const float* p0 = point_cloud->points[i];
+    const float* p1 = point_cloud->points[i + 1];
+    const float* p2 = point_cloud->points[i + 2];
+    const float* p3 = point_cloud->points[i + 3];
+    const Float4 x = {p0[0], p1[0], p2[0], p3[0]};
+    const Float4 y = {p0[1], p1[1], p2[1], p3[1]};
+    const Float4 z = {p0[2], p1[2], p2[2], p3[2]};
+
+    // glm matrices are column major: m[column][row].
+    auto transform_row = [&](int row) {
+      return simd::Splat(m[0][row]) * x + simd::Splat(m[1][row]) * y +
+             simd::Splat(m[2][row]) * z + simd::Splat(m[3][row]);
+    };
+    const Float4 camera_x = transform_row(0);
+    const Float4 camera_y = transform_row(1);
+    const Float4 camera_z = transform_row(2);
+
+    // Points behind the camera get a zero pixel and are rejected below.
+    const Int4 in_front = camera_z > zero;
+    const Float4 inverse_z =
+        simd::Select(in_front, simd::Splat(1.0f) / camera_z, zero);
+    const Float4 normalized_x = camera_x * inverse_z;
+    const Float4 normalized_y = camera_y * inverse_z;
+    const Float4 radius_squared =
+        normalized_x * normalized_x + normalized_y * normalized_y;
+    // The radial distortion is a table lookup per lane; the tangential terms
+    // are zero unless the model has them.
+    const Float4 scale = {projection_.GetDistortionScale(radius_squared[0]),
+                          projection_.GetDistortionScale(radius_squared[1]),
+                          projection_.GetDistortionScale(radius_squared[2]),
+                          projection_.GetDistortionScale(radius_squared[3])};
+    const Float4 xy = two * normalized_x * normalized_y;
+    const Float4 distorted_x =
+        normalized_x * scale + tangential_p1 * xy +
+        tangential_p2 * (radius_squared + two * normalized_x * normalized_x);
+    const Float4 distorted_y =
+        normalized_y * scale + tangential_p2 * xy +
+        tangential_p1 * (radius_squared + two * normalized_y * normalized_y);
+    const Float4 u = simd::Splat(fx_) * distorted_x + simd::Splat(cx_);
+    const Float4 v = simd::Splat(fy_) * distorted_y + simd::Splat(cy_);
+    const Int4 visible =
+        in_front & (u >= zero) & (u < width) & (v >= zero) & (v < height);
+
+    const Int4 pixel_x = simd::FloorToInt(simd::Select(visible, u, zero));
+    const Int4 pixel_y = simd::FloorToInt(simd::Select(visible, v, zero));
+    const Float4 depth = simd::Select(visible, camera_z, zero);
+    for (uint32_t lane = 0; lane < kSimdWidth; ++lane) {
+      projected_x_[i + lane] = pixel_x[lane];
+      projected_y_[i + lane] = pixel_y[lane];
+      projected_depth_[i + lane] = depth[lane];
+    }
+  }
+
+  for (; i < end; ++i) {
+    const glm::vec4 camera_point =
+        m * glm::vec4(point_cloud->points[i][0], point_cloud->points[i][1],
+                      point_cloud->points[i][2], 1.0f);
+    projected_x_[i] = 0;
+    projected_y_[i] = 0;
+    projected_depth_[i] = 0.0f;
+    glm::vec2 pixel;
+    if (!projection_.Project(glm::vec3(camera_point), &pixel)) {
+      continue;
+    }
+    if (pixel.x >= 0.0f && pixel.x < width_ && pixel.y >= 0.0f &&
+        pixel.y < height_) {
+      projected_x_[i] = static_cast<int32_t>(pixel.x);
+      projected_y_[i] = static_cast<int32_t>(pixel.y);
+      projected_depth_[i] = camera_point.z;
+    }
+  }
+}
+
+void DepthSplatter::BinPoints(uint32_t num_points, int window_radius) {
+  // Counting sort: count the points per tile, turn the counts into offsets,
+  // then place the point indices.
+  std::fill(tile_offsets_.begin(), tile_offsets_.end(), 0);
+  for (uint32_t i = 0; i < num_points; ++i) {
+    if (projected_depth_[i] == 0.0f) {
+      continue;
+    }
+    int tile_x0, tile_y0, tile_x1, tile_y1;
+    GetTileRange(i, window_radius, &tile_x0, &tile_y0, &tile_x1, &tile_y1);
+    for (int tile_y = tile_y0; tile_y <= tile_y1; ++tile_y) {
+      for (int tile_x = tile_x0; tile_x <= tile_x1; ++tile_x) {
+        ++tile_offsets_[tile_y * tiles_x_ + tile_x + 1];
+      }
+    }
+  }
+
+  const int num_tiles = tiles_x_ * tiles_y_;
+  for (int tile = 0; tile < num_tiles; ++tile) {
+    tile_offsets_[tile + 1] += tile_offsets_[tile];
+  }
+  tile_points_.resize(tile_offsets_[num_tiles]);
+
+  // Fill using the start offsets, which shifts every offset up by one tile;
+  // shifting them back down afterwards restores the starts.
+  for (uint32_t i = 0; i < num_points; ++i) {
+    if (projected_depth_[i] == 0.0f) {
+      continue;
+    }
+    int tile_x0, tile_y0, tile_x1, tile_y1;
+    GetTileRange(i, window_radius, &tile_x0, &tile_y0, &tile_x1, &tile_y1);
+    for (int tile_y = tile_y0; tile_y <= tile_y1; ++tile_y) {
+      for (int tile_x = tile_x0; tile_x <= tile_x1; ++tile_x) {
+        tile_points_[tile_offsets_[tile_y * tiles_x_ + tile_x]++] = i;
+      }
+    }
+  }
+  for (int tile = num_tiles; tile > 0; --tile) {
+    tile_offsets_[tile] = tile_offsets_[tile - 1];
+  }
+  tile_offsets_[0] = 0;
+}
+
+void DepthSplatter::GetTileRange(uint32_t point, int window_radius,
+                                 int* tile_x0, int* tile_y0, int* tile_x1,
+                                 int* tile_y1) const {
+  const int x = projected_x_[point];
+  const int y = projected_y_[point];
+  *tile_x0 = std::max(x - window_radius, 0) / kTileSize;
+  *tile_y0 = std::max(y - window_radius, 0) / kTileSize;
+  *tile_x1 = std::min(x + window_radius, width_ - 1) / kTileSize;
+  *tile_y1 = std::min(y + window_radius, height_ - 1) / kTileSize;
+}
+
+void DepthSplatter::GetTileBounds(int tile, int* x0, int* y0, int* x1,
+                                  int* y1) const {
+  *x0 = (tile % tiles_x_) * kTileSize;
+  *y0 = (tile / tiles_x_) * kTileSize;
+  *x1 = std::min(*x0 + kTileSize, width_);
+  *y1 = std::min(*y0 + kTileSize, height_);
+}
+
+void DepthSplatter::RenderTile(int tile, int window_radius) {
+  using simd::Float4;
+
+  int tile_x0, tile_y0, tile_x1, tile_y1;
+  GetTileBounds(tile, &tile_x0, &tile_y0, &tile_x1, &tile_y1);
+
+  // The tile is cleared to infinity so that the z-test is a plain minimum,
+  // and infinity is turned back into zero once all points are in.
+  const float kInfinity = std::numeric_limits<float>::infinity();
+  const Float4 infinity4 = simd::Splat(kInfinity);
+  float* const image = depth_image_.data();
+  const int stride = width_;
+  const int tile_width = tile_x1 - tile_x0;
+  for (int y = tile_y0; y < tile_y1; ++y) {
+    float* row = image + y * stride;
+    if (tile_width < 4) {
+      std::fill(row + tile_x0, row + tile_x1, kInfinity);
+      continue;
+    }
+    for (int x = tile_x0; x < tile_x1; x += 4) {
+      simd::Store(row + std::min(x, tile_x1 - 4), infinity4);
+    }
+  }
+
+  for (uint32_t k = tile_offsets_[tile]; k < tile_offsets_[tile + 1]; ++k) {
+    const uint32_t i = tile_points_[k];
+    const int x0 = std::max(projected_x_[i] - window_radius, tile_x0);
+    const int x1 = std::min(projected_x_[i] + window_radius + 1, tile_x1);
+    const int y0 = std::max(projected_y_[i] - window_radius, tile_y0);
+    const int y1 = std::min(projected_y_[i] + window_radius + 1, tile_y1);
+    const float depth = projected_depth_[i];
+    const Float4 depth4 = simd::Splat(depth);
+    if (x1 - x0 < 4) {
+      for (int y = y0; y < y1; ++y) {
+        float* row = image + y * stride;
+        for (int x = x0; x < x1; ++x) {
+          row[x] = std::min(row[x], depth);
+        }
+      }
+      continue;
+    }
+    // The minimum is idempotent, so the last group of four may overlap the
+    // previous one instead of falling back to scalar code.
+    for (int y = y0; y < y1; ++y) {
+      float* row = image + y * stride;
+      for (int x = x0; x < x1; x += 4) {
+        const int group = std::min(x, x1 - 4);
+        simd::Store(row + group, simd::Min(simd::Load(row + group), depth4));
+      }
+    }
+  }
+
+  const Float4 zero = simd::Splat(0.0f);
+  for (int y = tile_y0; y < tile_y1; ++y) {
+    float* row = image + y * stride;
+    int x = tile_x0;
+    for (; x + 4 <= tile_x1; x += 4) {
+      const Float4 depth = simd::Load(row + x);
+      simd::Store(row + x, simd::Select(depth == infinity4, zero, depth));
+    }
+    for (; x < tile_x1; ++x) {
+      if (row[x] == kInfinity) {
+        row[x] = 0.0f;
+      }
+    }
+  }
+}
+
+void DepthSplatter::ConvertToGrayscale(float max_depth,
+                                       std::vector<uint8_t>* grayscale) {
+  const size_t image_size = static_cast<size_t>(width_) * height_;
+  if (grayscale->size() != image_size) {
+    grayscale->assign(image_size, 0);
+  }
+  uint8_t* output = grayscale->data();
+  const float scale = 255.0f / max_depth;
+  thread_pool_->ParallelFor(
+      static_cast<int>(changed_tiles_.size()), [&](int index) {
+        int x0, y0, x1, y1;
+        GetTileBounds(changed_tiles_[index], &x0, &y0, &x1, &y1);
+        const float* depth_image = depth_image_.data();
+        const int stride = width_;
+        for (int y = y0; y < y1; ++y) {
+          const float* depth_row = depth_image + y * stride;
+          uint8_t* output_row = output + y * stride;
+          // Kept scalar and branch free so that the compiler can vectorize
+          // the conversion and the narrowing to bytes.
+          for (int x = x0; x < x1; ++x) {
+            output_row[x] = static_cast<uint8_t>(
+                static_cast<int>(std::min(depth_row[x] * scale, 255.0f)));
+          }
+        }
+      });
+}
+
+}  // namespace tango_perception
@@ -0,0 +1,181 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-perception/depth_stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "tango-perception/simd.h"
+
+namespace {
+
+const int kNumDepthBins = tango_perception::DepthStats::kNumDepthBins;
+const int kNumConfidenceBins =
+    tango_perception::DepthStats::kNumConfidenceBins;
+const int kNumJointBins = kNumDepthBins * kNumConfidenceBins;
+
+// The float lane sums are moved into doubles every this many groups of four
+// points, which keeps the rounding error of the mean and variance small.
+const int kFlushInterval = 256;
+
+}  // namespace
+
+namespace tango_perception {
+
+const int DepthStats::kNumDepthBins;
+const int DepthStats::kNumConfidenceBins;
+
+void ComputeDepthStats(const TangoPointCloud* point_cloud,
+                       float histogram_range, uint32_t expected_points,
+                       DepthStats* stats) {
+  using simd::Float4;
+  using simd::Int4;
+
+  const float kInfinity = std::numeric_limits<float>::infinity();
+  const float depth_scale = kNumDepthBins / histogram_range;
+  const float max_depth_bin = kNumDepthBins - 1;
+  const float confidence_scale = kNumConfidenceBins;
+  const float max_confidence_bin = kNumConfidenceBins - 1;
+
+  // One joint depth and confidence histogram per SIMD lane, so that
+  // neighbouring points falling into the same bin do not wait on each
+  // other's increments.
+  uint32_t joint_histograms[4][kNumJointBins];
+  std::memset(joint_histograms, 0, sizeof(joint_histograms));
+
+  const Float4 zero = simd::Splat(0.0f);
+  Float4 min_depth = simd::Splat(kInfinity);
+  Float4 max_depth = simd::Splat(-kInfinity);
+  Float4 depth_sum = zero;
+  Float4 depth_squared_sum = zero;
+  Float4 confidence_sum = zero;
+  Int4 valid_count = simd::SplatInt(0);
+  double total_depth = 0.0;
+  double total_depth_squared = 0.0;
+  double total_confidence = 0.0;
+
+  const uint32_t num_points = point_cloud->num_points;
+  const uint32_t num_simd_points = num_points & ~3u;
+  int groups = 0;
+  for (uint32_t i = 0; i < num_simd_points; i += 4) {
+    const float* p = point_cloud->points[i];
+    const Float4 z = {p[2], p[6], p[10], p[14]};
+    const Float4 c = {p[3], p[7], p[11], p[15]};
+    const Int4 valid = z > zero;
+
+    min_depth = simd::Min(min_depth, simd::Select(valid, z, min_depth));
+    max_depth = simd::Max(max_depth, simd::Select(valid, z, max_depth));
+    const Float4 valid_z = simd::Select(valid, z, zero);
+    const Float4 valid_c = simd::Select(valid, c, zero);
+    depth_sum += valid_z;
+    depth_squared_sum += valid_z * valid_z;
+    confidence_sum += valid_c;
+    // Comparison masks are -1 in true lanes.
+    valid_count -= valid;
+
+    // Both bins are computed for all four lanes at once and combined into one
+    // index of a joint histogram, so each lane costs a single increment.
+    const Int4 depth_bin = simd::FloorToInt(simd::Min(
+        valid_z * simd::Splat(depth_scale), simd::Splat(max_depth_bin)));
+    const Int4 confidence_bin = simd::FloorToInt(
+        simd::Min(simd::Max(valid_c * simd::Splat(confidence_scale), zero),
+                  simd::Splat(max_confidence_bin)));
+    const Int4 bin =
+        depth_bin * simd::SplatInt(kNumConfidenceBins) + confidence_bin;
+    // Invalid lanes land in bin zero and add nothing.
+    const Int4 increment = valid & simd::SplatInt(1);
+    for (int lane = 0; lane < 4; ++lane) {
+      joint_histograms[lane][bin[lane]] += increment[lane];
+    }
+
+    if (++groups == kFlushInterval) {
+      total_depth += simd::HorizontalSum(depth_sum);
+      total_depth_squared += simd::HorizontalSum(depth_squared_sum);
+      total_confidence += simd::HorizontalSum(confidence_sum);
+      depth_sum = depth_squared_sum = confidence_sum = zero;
+      groups = 0;
+    }
+  }
+  total_depth += simd::HorizontalSum(depth_sum);
+  total_depth_squared += simd::HorizontalSum(depth_squared_sum);
+  total_confidence += simd::HorizontalSum(confidence_sum);
+
+  float min_value = std::min(std::min(min_depth[0], min_depth[1]),
+                             std::min(min_depth[2], min_depth[3]));
+  float max_value = std::max(std::max(max_depth[0], max_depth[1]),
+                             std::max(max_depth[2], max_depth[3]));
+  uint32_t num_valid =
+      valid_count[0] + valid_count[1] + valid_count[2] + valid_count[3];
+
+  // The remaining points, at most three.
+  for (uint32_t i = num_simd_points; i < num_points; ++i) {
+    const float z = point_cloud->points[i][2];
+    const float c = point_cloud->points[i][3];
+    if (!(z > 0.0f)) {
+      continue;
+    }
+    min_value = std::min(min_value, z);
+    max_value = std::max(max_value, z);
+    total_depth += z;
+    total_depth_squared += z * z;
+    total_confidence += c;
+    ++num_valid;
+    const int depth_bin =
+        static_cast<int>(std::min(z * depth_scale, max_depth_bin));
+    const int confidence_bin = static_cast<int>(
+        std::min(std::max(c * confidence_scale, 0.0f), max_confidence_bin));
+    ++joint_histograms[0][depth_bin * kNumConfidenceBins + confidence_bin];
+  }
+
+  std::memset(stats->depth_histogram, 0, sizeof(stats->depth_histogram));
+  std::memset(stats->confidence_histogram, 0,
+              sizeof(stats->confidence_histogram));
+  for (int bin = 0; bin < kNumJointBins; ++bin) {
+    const uint32_t count = joint_histograms[0][bin] + joint_histograms[1][bin] +
+                           joint_histograms[2][bin] + joint_histograms[3][bin];
+    stats->depth_histogram[bin / kNumConfidenceBins] += count;
+    stats->confidence_histogram[bin % kNumConfidenceBins] += count;
+  }
+
+  stats->timestamp = point_cloud->timestamp;
+  stats->num_points = num_points;
+  stats->num_valid_points = num_valid;
+  stats->coverage =
+      expected_points > 0
+          ? std::min(static_cast<float>(num_valid) / expected_points, 1.0f)
+          : 0.0f;
+  if (num_valid > 0) {
+    const double mean = total_depth / num_valid;
+    const double variance = total_depth_squared / num_valid - mean * mean;
+    stats->min_depth = min_value;
+    stats->max_depth = max_value;
+    stats->mean_depth = static_cast<float>(mean);
+    stats->stddev_depth =
+        static_cast<float>(std::sqrt(std::max(variance, 0.0)));
+    stats->mean_confidence = static_cast<float>(total_confidence / num_valid);
+  } else {
+    stats->min_depth = 0.0f;
+    stats->max_depth = 0.0f;
+    stats->mean_depth = 0.0f;
+    stats->stddev_depth = 0.0f;
+    stats->mean_confidence = 0.0f;
+  }
+}
+
+}  // namespace tango_perception
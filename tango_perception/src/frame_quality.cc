@@ -0,0 +1,141 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-perception/frame_quality.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const int kDefaultLevel = 1;
+const float kDefaultMaxMotionBlur = 2.0f;
+const float kDefaultMinRelativeSharpness = 0.5f;
+
+// Frames further apart give no useful rotation speed.
+const double kMaxPoseInterval = 0.5;
+
+// Weight of a new steady frame in the running sharpness average. Steady
+// frames that still fail the sharpness threshold pull the average down
+// slowly, so that it follows the camera into duller scenes without being
+// dragged down by a few defocused frames.
+const float kSharpnessAverageWeight = 0.1f;
+const float kUnsharpAverageWeight = 0.02f;
+
+// Variance of the 4-neighbour Laplacian over the interior of a plane.
+float GetLaplacianVariance(tango_perception::ImageView<const uint8_t> image) {
+  const int width = image.GetWidth();
+  const int height = image.GetHeight();
+  if (width < 3 || height < 3) {
+    return 0.0f;
+  }
+  int64_t sum = 0;
+  int64_t sum_squares = 0;
+  for (int y = 1; y + 1 < height; ++y) {
+    const uint8_t* above = image.GetRow(y - 1);
+    const uint8_t* row = image.GetRow(y);
+    const uint8_t* below = image.GetRow(y + 1);
+    for (int x = 1; x + 1 < width; ++x) {
+      const int32_t laplacian =
+          4 * row[x] - row[x - 1] - row[x + 1] - above[x] - below[x];
+      sum += laplacian;
+      sum_squares += laplacian * laplacian;
+    }
+  }
+  const double count = static_cast<double>(width - 2) * (height - 2);
+  const double mean = sum / count;
+  return static_cast<float>(sum_squares / count - mean * mean);
+}
+
+}  // namespace
+
+namespace tango_perception {
+
+FrameQualityScorer::FrameQualityScorer()
+    : focal_length_(0.0f),
+      level_(kDefaultLevel),
+      max_motion_blur_(kDefaultMaxMotionBlur),
+      min_relative_sharpness_(kDefaultMinRelativeSharpness) {
+  Reset();
+}
+
+void FrameQualityScorer::SetCameraIntrinsics(
+    const TangoCameraIntrinsics& intrinsics) {
+  focal_length_ = static_cast<float>(std::max(intrinsics.fx, intrinsics.fy));
+}
+
+void FrameQualityScorer::SetParameters(int level, float max_motion_blur,
+                                       float min_relative_sharpness) {
+  level_ = std::max(level, 0);
+  max_motion_blur_ = max_motion_blur;
+  min_relative_sharpness_ = min_relative_sharpness;
+}
+
+void FrameQualityScorer::Reset() {
+  has_previous_ = false;
+  previous_timestamp_ = 0.0;
+  previous_world_R_camera_ = glm::quat();
+  average_sharpness_ = 0.0f;
+}
+
+FrameQuality FrameQualityScorer::Score(const TangoImageBuffer& frame,
+                                       ImagePyramid* pyramid,
+                                       const glm::quat& world_R_camera) {
+  FrameQuality quality;
+  quality.exposure = frame.exposure_duration_ns * 1e-9f;
+
+  quality.angular_speed = 0.0f;
+  const double interval = frame.timestamp - previous_timestamp_;
+  if (has_previous_ && interval > 0.0 && interval < kMaxPoseInterval) {
+    // Angle of the relative rotation, from the cosine of its half angle.
+    const float cos_half_angle = std::min(
+        std::abs(glm::dot(previous_world_R_camera_, world_R_camera)), 1.0f);
+    quality.angular_speed =
+        2.0f * std::acos(cos_half_angle) / static_cast<float>(interval);
+  }
+  has_previous_ = true;
+  previous_timestamp_ = frame.timestamp;
+  previous_world_R_camera_ = world_R_camera;
+
+  // A point at the image center sweeps focal length pixels per radian.
+  quality.motion_blur =
+      quality.angular_speed * quality.exposure * focal_length_;
+
+  const int level = std::min(level_, pyramid->GetNumLevels() - 1);
+  quality.sharpness = GetLaplacianVariance(pyramid->GetLevel(level));
+
+  // Only steady frames set the sharpness a scene should have.
+  const bool is_steady = quality.motion_blur <= max_motion_blur_;
+  quality.relative_sharpness =
+      average_sharpness_ > 0.0f ? quality.sharpness / average_sharpness_
+                                : 1.0f;
+  const bool is_sharp = quality.relative_sharpness >= min_relative_sharpness_;
+  if (is_steady) {
+    if (average_sharpness_ <= 0.0f) {
+      average_sharpness_ = quality.sharpness;
+    } else {
+      const float weight =
+          is_sharp ? kSharpnessAverageWeight : kUnsharpAverageWeight;
+      average_sharpness_ +=
+          weight * (quality.sharpness - average_sharpness_);
+    }
+  }
+
+  quality.is_usable = is_steady && is_sharp;
+  return quality;
+}
+
+}  // namespace tango_perception
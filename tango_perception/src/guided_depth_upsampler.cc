@@ -0,0 +1,397 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-perception/guided_depth_upsampler.h"
+
+#include <algorithm>
+
+#include "tango-perception/simd.h"
+
+namespace {
+
+using tango_perception::simd::Float4;
+
+const int kDefaultScale = 4;
+const int kDefaultRadius = 4;
+const float kDefaultEpsilon = 1e-3f;
+
+// Sums kept per grid cell, or per window of cells after box filtering.
+enum Channel {
+  kCount,
+  kGuide,
+  kDepth,
+  kGuideSquared,
+  kGuideDepth,
+};
+
+// Channels per cell are padded to whole SIMD vectors, so that the box
+// filter can run on four channels at a time.
+const int kSumStride = 8;
+
+// Coefficients per cell: a, b and a validity weight, plus padding.
+const int kCoefficientStride = 4;
+
+// Validity of a cell whose coefficients were copied from a neighbour. Such
+// cells are only used to interpolate next to valid ones.
+const float kBorrowed = 0.5f;
+
+// Number of column blocks per thread for the vertical box filter pass.
+const int kTasksPerThread = 4;
+
+// Running box sum along a row of cells of num_vectors * 4 channels, clipped
+// at both ends.
+template <int num_vectors>
+void BoxFilterRow(const float* input, float* output, int length, int radius) {
+  const int stride = num_vectors * 4;
+  Float4 sums[num_vectors];
+  for (int v = 0; v < num_vectors; ++v) {
+    sums[v] = tango_perception::simd::Splat(0.0f);
+  }
+  for (int i = 0; i < std::min(radius, length); ++i) {
+    for (int v = 0; v < num_vectors; ++v) {
+      sums[v] += tango_perception::simd::Load(input + i * stride + v * 4);
+    }
+  }
+  for (int i = 0; i < length; ++i) {
+    if (i + radius < length) {
+      const float* added = input + (i + radius) * stride;
+      for (int v = 0; v < num_vectors; ++v) {
+        sums[v] += tango_perception::simd::Load(added + v * 4);
+      }
+    }
+    for (int v = 0; v < num_vectors; ++v) {
+      tango_perception::simd::Store(output + i * stride + v * 4, sums[v]);
+    }
+    if (i - radius >= 0) {
+      const float* removed = input + (i - radius) * stride;
+      for (int v = 0; v < num_vectors; ++v) {
+        sums[v] -= tango_perception::simd::Load(removed + v * 4);
+      }
+    }
+  }
+}
+
+}  // namespace
+
+namespace tango_perception {
+
+GuidedDepthUpsampler::GuidedDepthUpsampler(ThreadPool* thread_pool)
+    : thread_pool_(thread_pool),
+      scale_(kDefaultScale),
+      radius_(kDefaultRadius),
+      epsilon_(kDefaultEpsilon),
+      width_(0),
+      height_(0),
+      grid_width_(0),
+      grid_height_(0) {}
+
+void GuidedDepthUpsampler::SetParameters(int scale, int radius,
+                                         float epsilon) {
+  scale_ = std::max(scale, 1);
+  radius_ = std::max(radius, 0);
+  epsilon_ = epsilon;
+}
+
+bool GuidedDepthUpsampler::Upsample(const TangoImageBuffer* guide,
+                                    const std::vector<float>& sparse_depth,
+                                    int width, int height) {
+  if (guide == nullptr || static_cast<int>(guide->width) != width ||
+      static_cast<int>(guide->height) != height) {
+    return false;
+  }
+  ImageView<const uint8_t> luma = GetLumaPlane(*guide);
+  if (guide->format == TANGO_HAL_PIXEL_FORMAT_RGBA_8888) {
+    rgba_luma_.resize(static_cast<size_t>(width) * height);
+    const ImageView<uint8_t> converted(rgba_luma_.data(), width, height,
+                                       width);
+    ConvertRgbaToGrayscale(GetRgbaPlane(*guide), converted);
+    luma = converted;
+  }
+  return Upsample(luma, sparse_depth, width, height);
+}
+
+bool GuidedDepthUpsampler::Upsample(ImageView<const uint8_t> luma,
+                                    const std::vector<float>& sparse_depth,
+                                    int width, int height) {
+  if (!luma.IsValid() || luma.GetWidth() != width ||
+      luma.GetHeight() != height ||
+      sparse_depth.size() != static_cast<size_t>(width) * height) {
+    return false;
+  }
+  width_ = width;
+  height_ = height;
+  grid_width_ = (width + scale_ - 1) / scale_;
+  grid_height_ = (height + scale_ - 1) / scale_;
+  const size_t num_cells = static_cast<size_t>(grid_width_) * grid_height_;
+  sums_.resize(num_cells * kSumStride);
+  coefficients_.resize(num_cells * kCoefficientStride);
+  expanded_.resize(static_cast<size_t>(grid_height_) * width * 3);
+  depth_image_.resize(static_cast<size_t>(width) * height);
+
+  // Grid cell centers are at (i + 0.5) * scale pixels.
+  column_index_.resize(width);
+  column_weight_.resize(width);
+  for (int x = 0; x < width; ++x) {
+    const float grid_x = std::max((x + 0.5f) / scale_ - 0.5f, 0.0f);
+    column_index_[x] = std::min(static_cast<int>(grid_x), grid_width_ - 1);
+    column_weight_[x] = std::min(grid_x - column_index_[x], 1.0f);
+  }
+
+  thread_pool_->ParallelFor(grid_height_, [&](int grid_row) {
+    AccumulateCells(luma, sparse_depth, grid_row);
+  });
+  BoxFilter(&sums_, kSumStride);
+
+  // Per window linear model depth = a * guide + b, fitted to the pixels with
+  // depth only.
+  const float epsilon = epsilon_;
+  thread_pool_->ParallelFor(grid_height_, [&](int grid_row) {
+    for (int x = 0; x < grid_width_; ++x) {
+      const size_t cell = static_cast<size_t>(grid_row) * grid_width_ + x;
+      const float* sums = &sums_[cell * kSumStride];
+      float* coefficients = &coefficients_[cell * kCoefficientStride];
+      if (sums[kCount] < 1.0f) {
+        std::fill(coefficients, coefficients + kCoefficientStride, 0.0f);
+        continue;
+      }
+      const float inverse_count = 1.0f / sums[kCount];
+      const float mean_guide = sums[kGuide] * inverse_count;
+      const float mean_depth = sums[kDepth] * inverse_count;
+      const float variance = std::max(
+          sums[kGuideSquared] * inverse_count - mean_guide * mean_guide, 0.0f);
+      const float covariance =
+          sums[kGuideDepth] * inverse_count - mean_guide * mean_depth;
+      const float a = covariance / (variance + epsilon);
+      coefficients[0] = a;
+      coefficients[1] = mean_depth - a * mean_guide;
+      coefficients[2] = 1.0f;
+    }
+  });
+
+  // Average the coefficients of all windows covering a cell.
+  BoxFilter(&coefficients_, kCoefficientStride);
+  for (size_t cell = 0; cell < num_cells; ++cell) {
+    float* coefficients = &coefficients_[cell * kCoefficientStride];
+    if (coefficients[2] > 0.0f) {
+      // a is applied to 8 bit luma from here on.
+      coefficients[0] /= coefficients[2] * 255.0f;
+      coefficients[1] /= coefficients[2];
+      coefficients[2] = 1.0f;
+    }
+  }
+
+  // Let empty cells next to valid ones borrow their coefficients, so that
+  // the bilinear interpolation at the border of the depth does not blend
+  // towards zero.
+  for (int y = 0; y < grid_height_; ++y) {
+    for (int x = 0; x < grid_width_; ++x) {
+      float* coefficients =
+          &coefficients_[(y * grid_width_ + x) * kCoefficientStride];
+      if (coefficients[2] != 0.0f) {
+        continue;
+      }
+      for (int dy = -1; dy <= 1 && coefficients[2] == 0.0f; ++dy) {
+        for (int dx = -1; dx <= 1; ++dx) {
+          const int nx = x + dx;
+          const int ny = y + dy;
+          if (nx < 0 || ny < 0 || nx >= grid_width_ || ny >= grid_height_) {
+            continue;
+          }
+          const float* neighbour =
+              &coefficients_[(ny * grid_width_ + nx) * kCoefficientStride];
+          if (neighbour[2] == 1.0f) {
+            coefficients[0] = neighbour[0];
+            coefficients[1] = neighbour[1];
+            coefficients[2] = kBorrowed;
+            break;
+          }
+        }
+      }
+    }
+  }
+
+  thread_pool_->ParallelFor(grid_height_,
+                           [&](int grid_row) { ExpandRow(grid_row); });
+  thread_pool_->ParallelFor(grid_height_, [&](int grid_row) {
+    ApplyCoefficients(luma, grid_row);
+  });
+  return true;
+}
+
+void GuidedDepthUpsampler::AccumulateCells(
+    ImageView<const uint8_t> guide, const std::vector<float>& sparse_depth,
+    int grid_row) {
+  const float kGuideScale = 1.0f / 255.0f;
+  float* row_sums = &sums_[static_cast<size_t>(grid_row) * grid_width_ *
+                           kSumStride];
+  std::fill(row_sums, row_sums + grid_width_ * kSumStride, 0.0f);
+
+  const int y1 = std::min(height_, (grid_row + 1) * scale_);
+  for (int y = grid_row * scale_; y < y1; ++y) {
+    const float* depth_row = &sparse_depth[static_cast<size_t>(y) * width_];
+    const uint8_t* guide_row = guide.GetRow(y);
+    for (int cell = 0; cell < grid_width_; ++cell) {
+      float* sums = row_sums + cell * kSumStride;
+      const int x1 = std::min(width_, (cell + 1) * scale_);
+      for (int x = cell * scale_; x < x1; ++x) {
+        const float depth = depth_row[x];
+        if (depth <= 0.0f) {
+          continue;
+        }
+        const float luma = guide_row[x] * kGuideScale;
+        sums[kCount] += 1.0f;
+        sums[kGuide] += luma;
+        sums[kDepth] += depth;
+        sums[kGuideSquared] += luma * luma;
+        sums[kGuideDepth] += luma * depth;
+      }
+    }
+  }
+}
+
+void GuidedDepthUpsampler::BoxFilter(std::vector<float>* channels,
+                                     int stride) {
+  const int row_size = grid_width_ * stride;
+  box_temp_.resize(channels->size());
+  thread_pool_->ParallelFor(grid_height_, [&](int y) {
+    const size_t offset = static_cast<size_t>(y) * row_size;
+    const float* input = &(*channels)[offset];
+    float* output = &box_temp_[offset];
+    if (stride == kSumStride) {
+      BoxFilterRow<kSumStride / 4>(input, output, grid_width_, radius_);
+    } else {
+      BoxFilterRow<kCoefficientStride / 4>(input, output, grid_width_,
+                                           radius_);
+    }
+  });
+
+  // The vertical pass keeps one running sum per column of a block and walks
+  // down whole rows, which keeps the memory accesses sequential.
+  const int num_vectors = row_size / 4;
+  const int num_tasks = thread_pool_->GetNumThreads() * kTasksPerThread;
+  const int block = (num_vectors + num_tasks - 1) / num_tasks;
+  thread_pool_->ParallelFor(num_tasks, [&](int task) {
+    const int begin = std::min(num_vectors, task * block) * 4;
+    const int end = std::min(num_vectors * 4, begin + block * 4);
+    const float* input = box_temp_.data();
+    float* output = channels->data();
+    std::vector<Float4> sums((end - begin) / 4, simd::Splat(0.0f));
+    for (int y = 0; y < std::min(radius_, grid_height_); ++y) {
+      const float* row = input + static_cast<size_t>(y) * row_size;
+      for (int i = begin; i < end; i += 4) {
+        sums[(i - begin) / 4] += simd::Load(row + i);
+      }
+    }
+    for (int y = 0; y < grid_height_; ++y) {
+      const float* added = input + static_cast<size_t>(y + radius_) * row_size;
+      const float* removed =
+          input + static_cast<size_t>(y - radius_) * row_size;
+      float* row = output + static_cast<size_t>(y) * row_size;
+      const bool add = y + radius_ < grid_height_;
+      const bool remove = y - radius_ >= 0;
+      for (int i = begin; i < end; i += 4) {
+        Float4& sum = sums[(i - begin) / 4];
+        if (add) {
+          sum += simd::Load(added + i);
+        }
+        simd::Store(row + i, sum);
+        if (remove) {
+          sum -= simd::Load(removed + i);
+        }
+      }
+    }
+  });
+}
+
+void GuidedDepthUpsampler::ExpandRow(int grid_row) {
+  const float* cells = &coefficients_[static_cast<size_t>(grid_row) *
+                                      grid_width_ * kCoefficientStride];
+  float* a = &expanded_[static_cast<size_t>(grid_row) * width_ * 3];
+  float* b = a + width_;
+  float* mask = b + width_;
+  for (int x = 0; x < width_; ++x) {
+    const float* left = cells + column_index_[x] * kCoefficientStride;
+    const float* right =
+        cells + std::min(column_index_[x] + 1, grid_width_ - 1) *
+                    kCoefficientStride;
+    const float weight = column_weight_[x];
+    a[x] = left[0] + weight * (right[0] - left[0]);
+    b[x] = left[1] + weight * (right[1] - left[1]);
+    // Pixels are only filled where their own cell had depth in reach.
+    mask[x] = cells[(x / scale_) * kCoefficientStride + 2] == 1.0f;
+  }
+}
+
+void GuidedDepthUpsampler::ApplyCoefficients(ImageView<const uint8_t> guide,
+                                             int grid_row) {
+  const float inverse_scale = 1.0f / scale_;
+  const Float4 zero = simd::Splat(0.0f);
+  const float* mask =
+      &expanded_[static_cast<size_t>(grid_row) * width_ * 3 + 2 * width_];
+
+  const int y1 = std::min(height_, (grid_row + 1) * scale_);
+  for (int y = grid_row * scale_; y < y1; ++y) {
+    // Cell centers are at (i + 0.5) * scale.
+    const float grid_y = std::max((y + 0.5f) * inverse_scale - 0.5f, 0.0f);
+    const int row0 = std::min(static_cast<int>(grid_y), grid_height_ - 1);
+    const int row1 = std::min(row0 + 1, grid_height_ - 1);
+    const float weight_y = std::min(grid_y - row0, 1.0f);
+    const float* a0 = &expanded_[static_cast<size_t>(row0) * width_ * 3];
+    const float* b0 = a0 + width_;
+    const float* a1 = &expanded_[static_cast<size_t>(row1) * width_ * 3];
+    const float* b1 = a1 + width_;
+
+    // The coefficients are prescaled for 8 bit luma.
+    const uint8_t* guide_row = guide.GetRow(y);
+    float* depth_row = &depth_image_[static_cast<size_t>(y) * width_];
+    const Float4 weight = simd::Splat(weight_y);
+    int x = 0;
+    for (; x + 4 <= width_; x += 4) {
+      const Float4 top_a = simd::Load(a0 + x);
+      const Float4 top_b = simd::Load(b0 + x);
+      const Float4 a = top_a + weight * (simd::Load(a1 + x) - top_a);
+      const Float4 b = top_b + weight * (simd::Load(b1 + x) - top_b);
+      const Float4 luma = {static_cast<float>(guide_row[x]),
+                           static_cast<float>(guide_row[x + 1]),
+                           static_cast<float>(guide_row[x + 2]),
+                           static_cast<float>(guide_row[x + 3])};
+      simd::Store(depth_row + x,
+                  simd::Max(a * luma + b, zero) * simd::Load(mask + x));
+    }
+    for (; x < width_; ++x) {
+      const float a = a0[x] + weight_y * (a1[x] - a0[x]);
+      const float b = b0[x] + weight_y * (b1[x] - b0[x]);
+      depth_row[x] = std::max(a * guide_row[x] + b, 0.0f) * mask[x];
+    }
+  }
+}
+
+void GuidedDepthUpsampler::ConvertToGrayscale(
+    float max_depth, std::vector<uint8_t>* grayscale) {
+  grayscale->resize(depth_image_.size());
+  uint8_t* output = grayscale->data();
+  const float scale = 255.0f / max_depth;
+  thread_pool_->ParallelFor(height_, [&](int y) {
+    const float* depth_row = &depth_image_[static_cast<size_t>(y) * width_];
+    uint8_t* output_row = output + static_cast<size_t>(y) * width_;
+    for (int x = 0; x < width_; ++x) {
+      output_row[x] = static_cast<uint8_t>(
+          static_cast<int>(std::min(depth_row[x] * scale, 255.0f)));
+    }
+  });
+}
+
+}  // namespace tango_perception
@@ -0,0 +1,570 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-perception/icp.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "tango-perception/simd.h"
+
+namespace {
+// Neighbouring pixels whose depth differs by more than this fraction of the
+// center depth are treated as a depth discontinuity when estimating normals.
+const float kMaxRelativeDepthJump = 0.05f;
+
+// Correspondences are accumulated in single precision for this many SIMD
+// groups before being folded into the double precision system.
+const size_t kGroupsPerFlush = 256;
+
+// Number of tasks per thread, to balance uneven association work.
+const int kTasksPerThread = 2;
+
+// Solve the symmetric positive definite 6x6 system given by its packed upper
+// triangle with a Cholesky decomposition. Returns false if the system is
+// singular, which happens when the correspondences do not constrain all six
+// degrees of freedom (for example a single plane).
+bool SolveCholesky6(const double ata[21], const double atb[6], double x[6]) {
+  double a[6][6];
+  int k = 0;
+  for (int i = 0; i < 6; ++i) {
+    for (int j = i; j < 6; ++j) {
+      a[i][j] = ata[k];
+      a[j][i] = ata[k];
+      ++k;
+    }
+  }
+
+  double l[6][6] = {};
+  for (int j = 0; j < 6; ++j) {
+    double sum = a[j][j];
+    for (int p = 0; p < j; ++p) {
+      sum -= l[j][p] * l[j][p];
+    }
+    if (sum <= 1e-12) {
+      return false;
+    }
+    l[j][j] = std::sqrt(sum);
+    for (int i = j + 1; i < 6; ++i) {
+      double value = a[i][j];
+      for (int p = 0; p < j; ++p) {
+        value -= l[i][p] * l[j][p];
+      }
+      l[i][j] = value / l[j][j];
+    }
+  }
+
+  // Forward substitution for L y = -atb, then back substitution L^T x = y.
+  double y[6];
+  for (int i = 0; i < 6; ++i) {
+    double value = -atb[i];
+    for (int p = 0; p < i; ++p) {
+      value -= l[i][p] * y[p];
+    }
+    y[i] = value / l[i][i];
+  }
+  for (int i = 5; i >= 0; --i) {
+    double value = y[i];
+    for (int p = i + 1; p < 6; ++p) {
+      value -= l[p][i] * x[p];
+    }
+    x[i] = value / l[i][i];
+  }
+  return true;
+}
+
+// Rotation matrix for a rotation vector (axis times angle in radians).
+glm::mat3 RotationFromVector(const glm::vec3& rotation) {
+  float angle = glm::length(rotation);
+  if (angle < 1e-12f) {
+    return glm::mat3(1.0f);
+  }
+  glm::vec3 axis = rotation / angle;
+  float c = std::cos(angle);
+  float s = std::sin(angle);
+  float t = 1.0f - c;
+  // glm matrices are column major.
+  return glm::mat3(t * axis.x * axis.x + c, t * axis.x * axis.y + s * axis.z,
+                   t * axis.x * axis.z - s * axis.y,
+                   t * axis.x * axis.y - s * axis.z, t * axis.y * axis.y + c,
+                   t * axis.y * axis.z + s * axis.x,
+                   t * axis.x * axis.z + s * axis.y,
+                   t * axis.y * axis.z - s * axis.x, t * axis.z * axis.z + c);
+}
+
+// Normal of a point neighbourhood: the eigenvector of the covariance with the
+// smallest eigenvalue. Returns false for degenerate neighbourhoods.
+bool NormalFromCovariance(const double cov[6], glm::vec3* normal) {
+  // cov holds xx, xy, xz, yy, yz, zz.
+  double a00 = cov[0], a01 = cov[1], a02 = cov[2];
+  double a11 = cov[3], a12 = cov[4], a22 = cov[5];
+
+  // Closed form eigenvalues of a symmetric 3x3 matrix.
+  double q = (a00 + a11 + a22) / 3.0;
+  double p1 = a01 * a01 + a02 * a02 + a12 * a12;
+  double p2 = (a00 - q) * (a00 - q) + (a11 - q) * (a11 - q) +
+              (a22 - q) * (a22 - q) + 2.0 * p1;
+  double p = std::sqrt(p2 / 6.0);
+  if (p < 1e-12) {
+    return false;
+  }
+  double b00 = (a00 - q) / p, b01 = a01 / p, b02 = a02 / p;
+  double b11 = (a11 - q) / p, b12 = a12 / p, b22 = (a22 - q) / p;
+  double r = (b00 * (b11 * b22 - b12 * b12) - b01 * (b01 * b22 - b12 * b02) +
+              b02 * (b01 * b12 - b11 * b02)) /
+             2.0;
+  r = std::max(-1.0, std::min(1.0, r));
+  double phi = std::acos(r) / 3.0;
+  double smallest = q + 2.0 * p * std::cos(phi + 2.0 * M_PI / 3.0);
+
+  // The eigenvector is orthogonal to the rows of cov - smallest * I; take the
+  // best conditioned cross product of two rows.
+  glm::dvec3 row0(a00 - smallest, a01, a02);
+  glm::dvec3 row1(a01, a11 - smallest, a12);
+  glm::dvec3 row2(a02, a12, a22 - smallest);
+  glm::dvec3 candidates[3] = {glm::cross(row0, row1), glm::cross(row0, row2),
+                              glm::cross(row1, row2)};
+  int best = 0;
+  for (int i = 1; i < 3; ++i) {
+    if (glm::dot(candidates[i], candidates[i]) >
+        glm::dot(candidates[best], candidates[best])) {
+      best = i;
+    }
+  }
+  double length = glm::length(candidates[best]);
+  if (length < 1e-12) {
+    return false;
+  }
+  *normal = glm::vec3(candidates[best] / length);
+  return true;
+}
+}  // namespace
+
+namespace tango_perception {
+
+OrganizedPointCloud::OrganizedPointCloud()
+    : width_(0), height_(0), fx_(0.0f), fy_(0.0f), cx_(0.0f), cy_(0.0f) {}
+
+void OrganizedPointCloud::Build(const TangoPointCloud* point_cloud,
+                                const TangoCameraIntrinsics& intrinsics,
+                                float scale, float min_confidence) {
+  width_ = std::max(1, static_cast<int>(intrinsics.width * scale));
+  height_ = std::max(1, static_cast<int>(intrinsics.height * scale));
+  fx_ = static_cast<float>(intrinsics.fx) * scale;
+  fy_ = static_cast<float>(intrinsics.fy) * scale;
+  cx_ = static_cast<float>(intrinsics.cx) * scale;
+  cy_ = static_cast<float>(intrinsics.cy) * scale;
+
+  const size_t size = static_cast<size_t>(width_) * height_;
+  vertices_.assign(size, glm::vec3(0.0f));
+  normals_.assign(size, glm::vec3(0.0f));
+
+  for (uint32_t i = 0; i < point_cloud->num_points; ++i) {
+    const float* point = point_cloud->points[i];
+    if (point[3] < min_confidence) {
+      continue;
+    }
+    glm::vec3 vertex(point[0], point[1], point[2]);
+    int pixel_index;
+    if (!Project(vertex, &pixel_index)) {
+      continue;
+    }
+    glm::vec3& stored = vertices_[pixel_index];
+    if (stored.z == 0.0f || vertex.z < stored.z) {
+      stored = vertex;
+    }
+  }
+
+  // Normals from central differences of the four direct neighbours.
+  for (int y = 1; y < height_ - 1; ++y) {
+    for (int x = 1; x < width_ - 1; ++x) {
+      const int index = y * width_ + x;
+      const glm::vec3& center = vertices_[index];
+      if (center.z == 0.0f) {
+        continue;
+      }
+      const glm::vec3& left = vertices_[index - 1];
+      const glm::vec3& right = vertices_[index + 1];
+      const glm::vec3& up = vertices_[index - width_];
+      const glm::vec3& down = vertices_[index + width_];
+      const float max_jump = kMaxRelativeDepthJump * center.z;
+      if (left.z == 0.0f || right.z == 0.0f || up.z == 0.0f ||
+          down.z == 0.0f || std::abs(left.z - center.z) > max_jump ||
+          std::abs(right.z - center.z) > max_jump ||
+          std::abs(up.z - center.z) > max_jump ||
+          std::abs(down.z - center.z) > max_jump) {
+        continue;
+      }
+      glm::vec3 normal = glm::cross(right - left, down - up);
+      float length = glm::length(normal);
+      if (length <= 0.0f) {
+        continue;
+      }
+      normal /= length;
+      // Orient towards the camera.
+      if (glm::dot(normal, center) > 0.0f) {
+        normal = -normal;
+      }
+      normals_[index] = normal;
+    }
+  }
+}
+
+bool OrganizedPointCloud::Project(const glm::vec3& point,
+                                  int* pixel_index) const {
+  if (point.z <= 0.0f) {
+    return false;
+  }
+  float u = fx_ * point.x / point.z + cx_;
+  float v = fy_ * point.y / point.z + cy_;
+  if (!(u >= 0.0f && v >= 0.0f && u < width_ && v < height_)) {
+    return false;
+  }
+  *pixel_index = static_cast<int>(v) * width_ + static_cast<int>(u);
+  return true;
+}
+
+PointToPlaneIcp::Options::Options()
+    : max_iterations(10),
+      max_correspondence_distance(0.05f),
+      min_confidence(0.5f),
+      max_source_points(4096),
+      target_scale(1.0f),
+      normal_neighbors(8),
+      convergence_rotation(1e-4f),
+      convergence_translation(1e-4f),
+      min_correspondences(64) {}
+
+PointToPlaneIcp::PointToPlaneIcp(const Options& options,
+                                 ThreadPool* thread_pool)
+    : options_(options), thread_pool_(thread_pool) {
+  int num_tasks = thread_pool_->GetNumThreads() * kTasksPerThread;
+  correspondences_.resize(num_tasks);
+  systems_.resize(num_tasks);
+}
+
+void PointToPlaneIcp::Correspondences::Clear() {
+  source_x.clear();
+  source_y.clear();
+  source_z.clear();
+  target_x.clear();
+  target_y.clear();
+  target_z.clear();
+  normal_x.clear();
+  normal_y.clear();
+  normal_z.clear();
+}
+
+void PointToPlaneIcp::Correspondences::Add(const glm::vec3& source,
+                                           const glm::vec3& target,
+                                           const glm::vec3& normal) {
+  source_x.push_back(source.x);
+  source_y.push_back(source.y);
+  source_z.push_back(source.z);
+  target_x.push_back(target.x);
+  target_y.push_back(target.y);
+  target_z.push_back(target.z);
+  normal_x.push_back(normal.x);
+  normal_y.push_back(normal.y);
+  normal_z.push_back(normal.z);
+}
+
+void PointToPlaneIcp::LinearSystem::Clear() {
+  std::fill(ata, ata + 21, 0.0);
+  std::fill(atb, atb + 6, 0.0);
+  error = 0.0;
+  count = 0;
+}
+
+void PointToPlaneIcp::LinearSystem::Add(const LinearSystem& other) {
+  for (int i = 0; i < 21; ++i) {
+    ata[i] += other.ata[i];
+  }
+  for (int i = 0; i < 6; ++i) {
+    atb[i] += other.atb[i];
+  }
+  error += other.error;
+  count += other.count;
+}
+
+void PointToPlaneIcp::SetTarget(const TangoPointCloud* target,
+                                const TangoCameraIntrinsics& depth_intrinsics) {
+  target_.Build(target, depth_intrinsics, options_.target_scale,
+                options_.min_confidence);
+}
+
+bool PointToPlaneIcp::Align(const TangoPointCloud* source,
+                            const glm::mat4& initial_target_T_source,
+                            Result* result) {
+  SelectSourcePoints(source);
+  return Solve(
+      [this](int task, int num_tasks, const glm::mat4& target_T_source) {
+        AssociateProjective(target_T_source, task, num_tasks);
+      },
+      initial_target_T_source, result);
+}
+
+bool PointToPlaneIcp::AlignToIndex(const PointCloudIndex& index,
+                                   const TangoPointCloud* source,
+                                   const glm::mat4& initial_index_T_source,
+                                   Result* result) {
+  SelectSourcePoints(source);
+  return Solve(
+      [this, &index](int task, int num_tasks, const glm::mat4& index_T_source) {
+        AssociateIndex(index, index_T_source, task, num_tasks);
+      },
+      initial_index_T_source, result);
+}
+
+void PointToPlaneIcp::SelectSourcePoints(const TangoPointCloud* source) {
+  source_points_.clear();
+  const uint32_t stride = std::max<uint32_t>(
+      1, source->num_points / std::max(1, options_.max_source_points));
+  for (uint32_t i = 0; i < source->num_points; i += stride) {
+    const float* point = source->points[i];
+    if (point[3] >= options_.min_confidence && point[2] > 0.0f) {
+      source_points_.push_back(glm::vec3(point[0], point[1], point[2]));
+    }
+  }
+}
+
+void PointToPlaneIcp::AssociateProjective(const glm::mat4& target_T_source,
+                                          int task, int num_tasks) {
+  Correspondences& correspondences = correspondences_[task];
+  correspondences.Clear();
+
+  const glm::mat3 rotation(target_T_source);
+  const glm::vec3 translation(target_T_source[3]);
+  const float max_distance_squared = options_.max_correspondence_distance *
+                                     options_.max_correspondence_distance;
+  const size_t begin = source_points_.size() * task / num_tasks;
+  const size_t end = source_points_.size() * (task + 1) / num_tasks;
+  for (size_t i = begin; i < end; ++i) {
+    glm::vec3 point = rotation * source_points_[i] + translation;
+    int pixel_index;
+    if (!target_.Project(point, &pixel_index) ||
+        !target_.IsValid(pixel_index)) {
+      continue;
+    }
+    const glm::vec3& vertex = target_.GetVertex(pixel_index);
+    glm::vec3 difference = point - vertex;
+    if (glm::dot(difference, difference) > max_distance_squared) {
+      continue;
+    }
+    correspondences.Add(point, vertex, target_.GetNormal(pixel_index));
+  }
+}
+
+void PointToPlaneIcp::AssociateIndex(const PointCloudIndex& index,
+                                     const glm::mat4& index_T_source,
+                                     int task, int num_tasks) {
+  Correspondences& correspondences = correspondences_[task];
+  correspondences.Clear();
+
+  const size_t begin = source_points_.size() * task / num_tasks;
+  const size_t end = source_points_.size() * (task + 1) / num_tasks;
+  if (begin == end) {
+    return;
+  }
+
+  const glm::mat3 rotation(index_T_source);
+  const glm::vec3 translation(index_T_source[3]);
+  std::vector<glm::vec3> queries;
+  queries.reserve(end - begin);
+  for (size_t i = begin; i < end; ++i) {
+    queries.push_back(rotation * source_points_[i] + translation);
+  }
+
+  const size_t k = static_cast<size_t>(std::max(3, options_.normal_neighbors));
+  std::vector<Neighbor> neighbors;
+  index.FindKNearest(queries, k, &neighbors);
+
+  const float max_distance_squared = options_.max_correspondence_distance *
+                                     options_.max_correspondence_distance;
+  for (size_t i = 0; i < queries.size(); ++i) {
+    const Neighbor* first = &neighbors[i * k];
+    if (first[0].distance_squared > max_distance_squared) {
+      continue;
+    }
+
+    // Fit a plane to the neighbourhood of the closest point.
+    glm::dvec3 centroid(0.0);
+    int count = 0;
+    for (size_t j = 0; j < k; ++j) {
+      if (first[j].distance_squared ==
+          std::numeric_limits<float>::infinity()) {
+        break;
+      }
+      centroid += glm::dvec3(first[j].point);
+      ++count;
+    }
+    if (count < 3) {
+      continue;
+    }
+    centroid /= count;
+    double covariance[6] = {};
+    for (int j = 0; j < count; ++j) {
+      glm::dvec3 d = glm::dvec3(first[j].point) - centroid;
+      covariance[0] += d.x * d.x;
+      covariance[1] += d.x * d.y;
+      covariance[2] += d.x * d.z;
+      covariance[3] += d.y * d.y;
+      covariance[4] += d.y * d.z;
+      covariance[5] += d.z * d.z;
+    }
+    glm::vec3 normal;
+    if (!NormalFromCovariance(covariance, &normal)) {
+      continue;
+    }
+    correspondences.Add(queries[i], glm::vec3(centroid), normal);
+  }
+}
+
+bool PointToPlaneIcp::Solve(
+    const std::function<void(int, int, const glm::mat4&)>& associate,
+    const glm::mat4& initial_target_T_source, Result* result) {
+  glm::mat4 target_T_source = initial_target_T_source;
+  const int num_tasks = static_cast<int>(systems_.size());
+  LinearSystem total;
+  total.Clear();
+  bool solved = false;
+  bool converged = false;
+  int iteration = 0;
+
+  for (; iteration < options_.max_iterations && !converged; ++iteration) {
+    thread_pool_->ParallelFor(num_tasks, [&](int task) {
+      associate(task, num_tasks, target_T_source);
+      systems_[task].Clear();
+      Accumulate(correspondences_[task], &systems_[task]);
+    });
+
+    total.Clear();
+    for (const LinearSystem& system : systems_) {
+      total.Add(system);
+    }
+    if (total.count < options_.min_correspondences) {
+      // The last update moved the estimate out of the overlap, so it is no
+      // better than the initial guess.
+      solved = false;
+      break;
+    }
+
+    double x[6];
+    if (!SolveCholesky6(total.ata, total.atb, x)) {
+      break;
+    }
+    solved = true;
+
+    // Apply the update on the left: target_T_source = delta * target_T_source.
+    glm::vec3 rotation_vector(x[0], x[1], x[2]);
+    glm::vec3 translation(x[3], x[4], x[5]);
+    glm::mat4 delta(RotationFromVector(rotation_vector));
+    delta[3] = glm::vec4(translation, 1.0f);
+    target_T_source = delta * target_T_source;
+
+    converged = glm::length(rotation_vector) < options_.convergence_rotation &&
+                glm::length(translation) < options_.convergence_translation;
+  }
+
+  result->target_T_source = target_T_source;
+  result->num_correspondences = total.count;
+  result->rms_error =
+      total.count > 0 ? static_cast<float>(std::sqrt(total.error / total.count))
+                      : 0.0f;
+  result->num_iterations = iteration;
+  result->converged = converged;
+  return solved;
+}
+
+void PointToPlaneIcp::Accumulate(const Correspondences& correspondences,
+                                 LinearSystem* system) {
+  using simd::Float4;
+
+  const size_t size = correspondences.Size();
+  const size_t simd_size = size & ~static_cast<size_t>(3);
+
+  // Jacobian row of one correspondence: [source x normal, normal], and the
+  // residual normal . (source - target).
+  Float4 ata[21];
+  Float4 atb[6];
+  Float4 error;
+  size_t groups = 0;
+  for (size_t i = 0; i < simd_size; i += 4) {
+    if (groups == 0) {
+      std::fill(ata, ata + 21, simd::Splat(0.0f));
+      std::fill(atb, atb + 6, simd::Splat(0.0f));
+      error = simd::Splat(0.0f);
+    }
+
+    Float4 sx = simd::Load(&correspondences.source_x[i]);
+    Float4 sy = simd::Load(&correspondences.source_y[i]);
+    Float4 sz = simd::Load(&correspondences.source_z[i]);
+    Float4 nx = simd::Load(&correspondences.normal_x[i]);
+    Float4 ny = simd::Load(&correspondences.normal_y[i]);
+    Float4 nz = simd::Load(&correspondences.normal_z[i]);
+    Float4 residual =
+        nx * (sx - simd::Load(&correspondences.target_x[i])) +
+        ny * (sy - simd::Load(&correspondences.target_y[i])) +
+        nz * (sz - simd::Load(&correspondences.target_z[i]));
+
+    Float4 j[6] = {sy * nz - sz * ny, sz * nx - sx * nz, sx * ny - sy * nx,
+                   nx, ny, nz};
+    int k = 0;
+    for (int row = 0; row < 6; ++row) {
+      for (int col = row; col < 6; ++col) {
+        ata[k++] += j[row] * j[col];
+      }
+      atb[row] += j[row] * residual;
+    }
+    error += residual * residual;
+
+    if (++groups == kGroupsPerFlush || i + 4 == simd_size) {
+      for (int n = 0; n < 21; ++n) {
+        system->ata[n] += simd::HorizontalSum(ata[n]);
+      }
+      for (int n = 0; n < 6; ++n) {
+        system->atb[n] += simd::HorizontalSum(atb[n]);
+      }
+      system->error += simd::HorizontalSum(error);
+      groups = 0;
+    }
+  }
+
+  // Remaining correspondences that do not fill a SIMD group.
+  for (size_t i = simd_size; i < size; ++i) {
+    glm::vec3 s(correspondences.source_x[i], correspondences.source_y[i],
+                correspondences.source_z[i]);
+    glm::vec3 t(correspondences.target_x[i], correspondences.target_y[i],
+                correspondences.target_z[i]);
+    glm::vec3 n(correspondences.normal_x[i], correspondences.normal_y[i],
+                correspondences.normal_z[i]);
+    float residual = glm::dot(n, s - t);
+    glm::vec3 c = glm::cross(s, n);
+    float j[6] = {c.x, c.y, c.z, n.x, n.y, n.z};
+    int k = 0;
+    for (int row = 0; row < 6; ++row) {
+      for (int col = row; col < 6; ++col) {
+        system->ata[k++] += j[row] * j[col];
+      }
+      system->atb[row] += j[row] * residual;
+    }
+    system->error += residual * residual;
+  }
+  system->count += static_cast<int>(size);
+}
+
+}  // namespace tango_perception
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-perception/image_pyramid.h"
+
+#include <algorithm>
+
+namespace tango_perception {
+
+ImagePyramid::ImagePyramid()
+    : timestamp_(0.0), frame_number_(0), num_levels_(0),
+      num_built_levels_(0) {}
+
+void ImagePyramid::Reset(const TangoImageBuffer& frame, int num_levels) {
+  timestamp_ = frame.timestamp;
+  frame_number_ = frame.frame_number;
+
+  const ImageView<const uint8_t> luma = GetLumaPlane(frame);
+  int width = luma.GetWidth();
+  int height = luma.GetHeight();
+  num_levels_ = 1;
+  while (num_levels_ < num_levels && width >= 2 && height >= 2) {
+    width /= 2;
+    height /= 2;
+    ++num_levels_;
+  }
+  levels_.assign(num_levels_, ImageView<const uint8_t>());
+  levels_[0] = luma;
+  if (storage_.size() < levels_.size()) {
+    storage_.resize(levels_.size());
+  }
+  num_built_levels_.store(1, std::memory_order_relaxed);
+}
+
+ImageView<const uint8_t> ImagePyramid::GetLevel(int level) {
+  if (level < num_built_levels_.load(std::memory_order_acquire)) {
+    return levels_[level];
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  int num_built = num_built_levels_.load(std::memory_order_relaxed);
+  for (; num_built <= level; ++num_built) {
+    const ImageView<const uint8_t>& source = levels_[num_built - 1];
+    const int width = source.GetWidth() / 2;
+    const int height = source.GetHeight() / 2;
+    std::vector<uint8_t>& storage = storage_[num_built];
+    storage.resize(static_cast<size_t>(width) * height);
+    const ImageView<uint8_t> destination(storage.data(), width, height,
+                                         width);
+    Downscale2x(source, destination);
+    levels_[num_built] = destination;
+    // Publish the level to the lock-free readers above.
+    num_built_levels_.store(num_built + 1, std::memory_order_release);
+  }
+  return levels_[level];
+}
+
+ImagePyramidCache::ImagePyramidCache(int num_levels)
+    : num_levels_(std::max(num_levels, 1)), latest_data_(nullptr) {}
+
+std::shared_ptr<ImagePyramid> ImagePyramidCache::Get(
+    const TangoImageBuffer& frame) {
+  if (frame.format != TANGO_HAL_PIXEL_FORMAT_YCrCb_420_SP &&
+      frame.format != TANGO_HAL_PIXEL_FORMAT_YV12) {
+    return nullptr;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (latest_ != nullptr && latest_->GetTimestamp() == frame.timestamp &&
+      latest_data_ == frame.data) {
+    return latest_;
+  }
+
+  // latest_ is about to be replaced, so any pyramid held only by pyramids_
+  // is free, including the previous one if no consumer kept it.
+  latest_.reset();
+  std::shared_ptr<ImagePyramid> pyramid;
+  for (const std::shared_ptr<ImagePyramid>& candidate : pyramids_) {
+    if (candidate.use_count() == 1) {
+      // Order the reset after the reads of the last consumer.
+      std::atomic_thread_fence(std::memory_order_acquire);
+      pyramid = candidate;
+      break;
+    }
+  }
+  if (pyramid == nullptr) {
+    pyramid = std::make_shared<ImagePyramid>();
+    pyramids_.push_back(pyramid);
+  }
+  pyramid->Reset(frame, num_levels_);
+  latest_ = pyramid;
+  latest_data_ = frame.data;
+  return pyramid;
+}
+
+}  // namespace tango_perception
@@ -0,0 +1,394 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-perception/point_cloud_index.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+// Maximum number of points in a leaf of the k-d tree.
+const uint32_t kLeafSize = 16;
+
+bool CompareNeighbors(const tango_perception::Neighbor& a,
+                      const tango_perception::Neighbor& b) {
+  return a.distance_squared < b.distance_squared;
+}
+
+float DistanceSquared(const glm::vec4& point, const glm::vec3& query) {
+  float dx = point.x - query.x;
+  float dy = point.y - query.y;
+  float dz = point.z - query.z;
+  return dx * dx + dy * dy + dz * dz;
+}
+
+// Offer a candidate to a bounded max-heap of the k nearest neighbours.
+void PushNeighbor(const glm::vec4& point, float distance_squared, size_t k,
+                  std::vector<tango_perception::Neighbor>* heap) {
+  if (heap->size() < k) {
+    heap->push_back({point, distance_squared});
+    std::push_heap(heap->begin(), heap->end(), CompareNeighbors);
+  } else if (distance_squared < heap->front().distance_squared) {
+    std::pop_heap(heap->begin(), heap->end(), CompareNeighbors);
+    heap->back() = {point, distance_squared};
+    std::push_heap(heap->begin(), heap->end(), CompareNeighbors);
+  }
+}
+
+// Linear k nearest search over points, used for the pending list.
+void FindKNearestLinear(const std::vector<glm::vec4>& points,
+                        const glm::vec3& query, size_t k,
+                        std::vector<tango_perception::Neighbor>* heap) {
+  for (const glm::vec4& point : points) {
+    PushNeighbor(point, DistanceSquared(point, query), k, heap);
+  }
+}
+}  // namespace
+
+namespace tango_perception {
+
+KdTree::KdTree(std::vector<glm::vec4>* points) {
+  points_.swap(*points);
+  if (!points_.empty()) {
+    nodes_.reserve(2 * (points_.size() / kLeafSize + 1));
+    Build(0, static_cast<uint32_t>(points_.size()));
+  }
+}
+
+int32_t KdTree::Build(uint32_t begin, uint32_t end) {
+  int32_t node_index = static_cast<int32_t>(nodes_.size());
+  nodes_.push_back({begin, end, -1, -1, 0, 0.0f});
+  if (end - begin <= kLeafSize) {
+    return node_index;
+  }
+
+  // Split along the axis of largest extent at the median.
+  glm::vec3 min_bound(std::numeric_limits<float>::max());
+  glm::vec3 max_bound(-std::numeric_limits<float>::max());
+  for (uint32_t i = begin; i < end; ++i) {
+    min_bound = glm::min(min_bound, glm::vec3(points_[i]));
+    max_bound = glm::max(max_bound, glm::vec3(points_[i]));
+  }
+  glm::vec3 extent = max_bound - min_bound;
+  int32_t axis = 0;
+  if (extent.y > extent[axis]) {
+    axis = 1;
+  }
+  if (extent.z > extent[axis]) {
+    axis = 2;
+  }
+
+  uint32_t middle = begin + (end - begin) / 2;
+  std::nth_element(points_.begin() + begin, points_.begin() + middle,
+                   points_.begin() + end,
+                   [axis](const glm::vec4& a, const glm::vec4& b) {
+                     return a[axis] < b[axis];
+                   });
+  // Read the split before the children reorder their ranges.
+  const float split = points_[middle][axis];
+
+  int32_t left = Build(begin, middle);
+  int32_t right = Build(middle, end);
+  Node& node = nodes_[node_index];
+  node.left = left;
+  node.right = right;
+  node.axis = axis;
+  node.split = split;
+  return node_index;
+}
+
+void KdTree::FindKNearest(const glm::vec3& query, size_t k,
+                          std::vector<Neighbor>* neighbors) const {
+  if (!nodes_.empty() && k > 0) {
+    SearchKNearest(0, query, k, neighbors);
+  }
+}
+
+void KdTree::FindInRadius(const glm::vec3& query, float radius,
+                          std::vector<Neighbor>* neighbors) const {
+  if (!nodes_.empty()) {
+    SearchInRadius(0, query, radius * radius, neighbors);
+  }
+}
+
+void KdTree::SearchKNearest(int32_t node_index, const glm::vec3& query,
+                            size_t k, std::vector<Neighbor>* neighbors) const {
+  const Node& node = nodes_[node_index];
+  if (node.left < 0) {
+    for (uint32_t i = node.begin; i < node.end; ++i) {
+      PushNeighbor(points_[i], DistanceSquared(points_[i], query), k,
+                   neighbors);
+    }
+    return;
+  }
+
+  float plane_distance = query[node.axis] - node.split;
+  int32_t near_child = plane_distance < 0.0f ? node.left : node.right;
+  int32_t far_child = plane_distance < 0.0f ? node.right : node.left;
+  SearchKNearest(near_child, query, k, neighbors);
+  if (neighbors->size() < k ||
+      plane_distance * plane_distance < neighbors->front().distance_squared) {
+    SearchKNearest(far_child, query, k, neighbors);
+  }
+}
+
+void KdTree::SearchInRadius(int32_t node_index, const glm::vec3& query,
+                            float radius_squared,
+                            std::vector<Neighbor>* neighbors) const {
+  const Node& node = nodes_[node_index];
+  if (node.left < 0) {
+    for (uint32_t i = node.begin; i < node.end; ++i) {
+      float distance_squared = DistanceSquared(points_[i], query);
+      if (distance_squared <= radius_squared) {
+        neighbors->push_back({points_[i], distance_squared});
+      }
+    }
+    return;
+  }
+
+  float plane_distance = query[node.axis] - node.split;
+  if (plane_distance < 0.0f || plane_distance * plane_distance <=
+                                   radius_squared) {
+    SearchInRadius(node.left, query, radius_squared, neighbors);
+  }
+  if (plane_distance >= 0.0f || plane_distance * plane_distance <=
+                                    radius_squared) {
+    SearchInRadius(node.right, query, radius_squared, neighbors);
+  }
+}
+
+PointCloudIndex::PointCloudIndex()
+    : generation_(0),
+      rebuild_requested_(false),
+      full_rebuild_requested_(false),
+      rebuild_running_(false),
+      stop_requested_(false) {
+  rebuild_thread_ = std::thread(&PointCloudIndex::RebuildThread, this);
+}
+
+PointCloudIndex::~PointCloudIndex() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_requested_ = true;
+  }
+  rebuild_condition_.notify_all();
+  rebuild_thread_.join();
+}
+
+void PointCloudIndex::AddPointCloud(const TangoPointCloud* point_cloud,
+                                    const glm::mat4& index_T_point_cloud,
+                                    float min_confidence) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  pending_points_.reserve(pending_points_.size() + point_cloud->num_points);
+  for (uint32_t i = 0; i < point_cloud->num_points; ++i) {
+    const float* point = point_cloud->points[i];
+    if (point[3] < min_confidence) {
+      continue;
+    }
+    glm::vec4 index_point =
+        index_T_point_cloud * glm::vec4(point[0], point[1], point[2], 1.0f);
+    index_point.w = point[3];
+    pending_points_.push_back(index_point);
+  }
+  MaybeScheduleRebuildLocked();
+}
+
+void PointCloudIndex::AddPoints(const float (*points)[4], size_t num_points) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  pending_points_.reserve(pending_points_.size() + num_points);
+  for (size_t i = 0; i < num_points; ++i) {
+    pending_points_.push_back(
+        glm::vec4(points[i][0], points[i][1], points[i][2], points[i][3]));
+  }
+  MaybeScheduleRebuildLocked();
+}
+
+void PointCloudIndex::FindKNearest(const std::vector<glm::vec3>& queries,
+                                   size_t k,
+                                   std::vector<Neighbor>* results) const {
+  const Neighbor kEmptyNeighbor = {glm::vec4(0.0f),
+                                   std::numeric_limits<float>::infinity()};
+  results->assign(queries.size() * k, kEmptyNeighbor);
+  if (k == 0) {
+    return;
+  }
+
+  // The pending points are searched under the lock; the trees are immutable
+  // and are searched on a snapshot after releasing it.
+  std::vector<Neighbor> heap;
+  heap.reserve(k);
+  TreeList trees;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    trees = trees_;
+    for (size_t i = 0; i < queries.size(); ++i) {
+      heap.clear();
+      FindKNearestLinear(pending_points_, queries[i], k, &heap);
+      std::copy(heap.begin(), heap.end(), results->begin() + i * k);
+    }
+  }
+
+  for (size_t i = 0; i < queries.size(); ++i) {
+    std::vector<Neighbor>::iterator first = results->begin() + i * k;
+    heap.clear();
+    for (std::vector<Neighbor>::iterator it = first; it != first + k; ++it) {
+      if (it->distance_squared != kEmptyNeighbor.distance_squared) {
+        heap.push_back(*it);
+      }
+    }
+    std::make_heap(heap.begin(), heap.end(), CompareNeighbors);
+    for (const std::shared_ptr<const KdTree>& tree : trees) {
+      tree->FindKNearest(queries[i], k, &heap);
+    }
+    std::sort_heap(heap.begin(), heap.end(), CompareNeighbors);
+    std::copy(heap.begin(), heap.end(), first);
+    std::fill(first + heap.size(), first + k, kEmptyNeighbor);
+  }
+}
+
+bool PointCloudIndex::FindNearest(const glm::vec3& query,
+                                  Neighbor* result) const {
+  std::vector<Neighbor> results;
+  FindKNearest(std::vector<glm::vec3>(1, query), 1, &results);
+  if (results[0].distance_squared == std::numeric_limits<float>::infinity()) {
+    return false;
+  }
+  *result = results[0];
+  return true;
+}
+
+void PointCloudIndex::FindInRadius(const glm::vec3& query, float radius,
+                                   std::vector<Neighbor>* results) const {
+  results->clear();
+  const float radius_squared = radius * radius;
+  TreeList trees;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    trees = trees_;
+    for (const glm::vec4& point : pending_points_) {
+      float distance_squared = DistanceSquared(point, query);
+      if (distance_squared <= radius_squared) {
+        results->push_back({point, distance_squared});
+      }
+    }
+  }
+
+  for (const std::shared_ptr<const KdTree>& tree : trees) {
+    tree->FindInRadius(query, radius, results);
+  }
+}
+
+void PointCloudIndex::RequestRebuild() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    rebuild_requested_ = true;
+    full_rebuild_requested_ = true;
+  }
+  rebuild_condition_.notify_all();
+}
+
+void PointCloudIndex::WaitForRebuild() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  rebuild_condition_.wait(
+      lock, [this] { return !rebuild_requested_ && !rebuild_running_; });
+}
+
+void PointCloudIndex::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++generation_;
+  trees_.clear();
+  pending_points_.clear();
+  rebuild_requested_ = false;
+  full_rebuild_requested_ = false;
+}
+
+size_t PointCloudIndex::Size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t size = pending_points_.size();
+  for (const std::shared_ptr<const KdTree>& tree : trees_) {
+    size += tree->Size();
+  }
+  return size;
+}
+
+void PointCloudIndex::MaybeScheduleRebuildLocked() {
+  if (pending_points_.size() >= kPendingPointsForRebuild &&
+      !rebuild_requested_) {
+    rebuild_requested_ = true;
+    rebuild_condition_.notify_all();
+  }
+}
+
+void PointCloudIndex::RebuildThread() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    rebuild_condition_.wait(
+        lock, [this] { return stop_requested_ || rebuild_requested_; });
+    if (stop_requested_) {
+      break;
+    }
+
+    // Snapshot the pending points and the trees that will be merged with
+    // them. Only this thread replaces trees_, so the merged trees are still
+    // the tail of trees_ when the new tree is swapped in below.
+    const uint64_t generation = generation_;
+    const bool full_rebuild = full_rebuild_requested_;
+    rebuild_requested_ = false;
+    full_rebuild_requested_ = false;
+    rebuild_running_ = true;
+
+    std::vector<glm::vec4> points(pending_points_);
+    const size_t num_pending = pending_points_.size();
+    size_t num_merged = 0;
+    size_t merged_size = points.size();
+    while (num_merged < trees_.size()) {
+      const KdTree& tree = *trees_[trees_.size() - num_merged - 1];
+      if (!full_rebuild && tree.Size() > 2 * merged_size) {
+        break;
+      }
+      merged_size += tree.Size();
+      ++num_merged;
+    }
+    TreeList merged_trees(trees_.end() - num_merged, trees_.end());
+    lock.unlock();
+
+    points.reserve(merged_size);
+    for (const std::shared_ptr<const KdTree>& tree : merged_trees) {
+      points.insert(points.end(), tree->GetPoints().begin(),
+                    tree->GetPoints().end());
+    }
+    merged_trees.clear();
+    std::shared_ptr<const KdTree> new_tree;
+    if (!points.empty()) {
+      new_tree = std::make_shared<KdTree>(&points);
+    }
+
+    lock.lock();
+    if (generation == generation_) {
+      trees_.resize(trees_.size() - num_merged);
+      if (new_tree) {
+        trees_.push_back(new_tree);
+      }
+      pending_points_.erase(pending_points_.begin(),
+                            pending_points_.begin() + num_pending);
+    }
+    rebuild_running_ = false;
+    MaybeScheduleRebuildLocked();
+    rebuild_condition_.notify_all();
+  }
+}
+
+}  // namespace tango_perception
@@ -0,0 +1,181 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-perception/point_cloud_recorder.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "tango-perception/bit_stream.h"
+
+namespace {
+
+// Chunk payload: timestamp, point count, pose, coded points. The file has no
+// header fields.
+const tango_perception::ChunkFileFormat kFormat = {
+    0x52435054,  // "TPCR"
+    1,
+    0x4b435054,  // "TPCK"
+    0x49435054,  // "TPCI"
+    0x45435054,  // "TPCE"
+};
+
+// Size of the fixed part of a chunk payload.
+const size_t kChunkHeaderSize =
+    sizeof(double) + sizeof(uint32_t) + tango_perception::kChunkPoseSize;
+
+// Number of frames that can be queued for the writer thread. At 5 Hz this
+// absorbs close to a second of storage stalls.
+const int kNumFrameBuffers = 4;
+
+const float kMetersToMillimeters = 1000.0f;
+const float kMillimetersToMeters = 0.001f;
+const float kConfidenceScale = 255.0f;
+
+int16_t QuantizeMillimeters(float meters) {
+  float millimeters = std::round(meters * kMetersToMillimeters);
+  millimeters = std::min(std::max(millimeters, -32767.0f), 32767.0f);
+  return static_cast<int16_t>(millimeters);
+}
+
+uint8_t QuantizeConfidence(float confidence) {
+  float scaled = std::round(confidence * kConfidenceScale);
+  return static_cast<uint8_t>(std::min(std::max(scaled, 0.0f), 255.0f));
+}
+
+}  // namespace
+
+namespace tango_perception {
+
+PointCloudRecorder::PointCloudRecorder()
+    : recorder_(kFormat, kNumFrameBuffers, &PointCloudRecorder::EncodeFrame) {}
+
+bool PointCloudRecorder::Open(const std::string& path, uint32_t max_points) {
+  return recorder_.Open(path, std::vector<uint8_t>(), [=](Frame* frame) {
+    frame->xyz.resize(3 * max_points);
+    frame->confidence.resize(max_points);
+  });
+}
+
+bool PointCloudRecorder::Record(const TangoPointCloud* point_cloud,
+                                const TangoPoseData& pose) {
+  return recorder_.Record([&](Frame* frame) {
+    const uint32_t num_points = std::min(
+        point_cloud->num_points,
+        static_cast<uint32_t>(frame->confidence.size()));
+    frame->timestamp = point_cloud->timestamp;
+    frame->pose = pose;
+    frame->num_points = num_points;
+    int16_t* xyz = frame->xyz.data();
+    uint8_t* confidence = frame->confidence.data();
+    for (uint32_t i = 0; i < num_points; ++i) {
+      const float* point = point_cloud->points[i];
+      xyz[3 * i + 0] = QuantizeMillimeters(point[0]);
+      xyz[3 * i + 1] = QuantizeMillimeters(point[1]);
+      xyz[3 * i + 2] = QuantizeMillimeters(point[2]);
+      confidence[i] = QuantizeConfidence(point[3]);
+    }
+  });
+}
+
+void PointCloudRecorder::Close() { recorder_.Close(); }
+
+bool PointCloudRecorder::IsOpen() const { return recorder_.IsOpen(); }
+
+uint32_t PointCloudRecorder::GetNumFramesWritten() const {
+  return recorder_.GetNumFramesWritten();
+}
+
+uint32_t PointCloudRecorder::GetNumFramesDropped() const {
+  return recorder_.GetNumFramesDropped();
+}
+
+uint64_t PointCloudRecorder::GetNumBytesWritten() const {
+  return recorder_.GetNumBytesWritten();
+}
+
+void PointCloudRecorder::EncodeFrame(const Frame& frame,
+                                     std::vector<uint8_t>* chunk) {
+  AppendValue(frame.num_points, chunk);
+  AppendPose(frame.pose, chunk);
+
+  // Tango clouds come out roughly in scan order, so each point is predicted
+  // by its predecessor. Every channel keeps its own coder statistics.
+  BitWriter writer(chunk);
+  AdaptiveRiceCoder coders[4];
+  int32_t previous[4] = {0, 0, 0, 0};
+  const int16_t* xyz = frame.xyz.data();
+  for (uint32_t i = 0; i < frame.num_points; ++i) {
+    for (int c = 0; c < 3; ++c) {
+      const int32_t value = xyz[3 * i + c];
+      coders[c].Encode(ZigZagEncode(value - previous[c]), &writer);
+      previous[c] = value;
+    }
+    const int32_t confidence = frame.confidence[i];
+    coders[3].Encode(ZigZagEncode(confidence - previous[3]), &writer);
+    previous[3] = confidence;
+  }
+  writer.Flush();
+}
+
+PointCloudReader::PointCloudReader() : file_(kFormat) {}
+
+bool PointCloudReader::Open(const std::string& path) {
+  std::vector<uint8_t> header_fields;
+  return file_.Open(path, 0, &header_fields);
+}
+
+void PointCloudReader::Close() { file_.Close(); }
+
+bool PointCloudReader::ReadFrame(size_t frame, std::vector<float>* points,
+                                 TangoPoseData* pose) {
+  if (!file_.ReadChunk(frame, &chunk_buffer_) ||
+      chunk_buffer_.size() < kChunkHeaderSize) {
+    return false;
+  }
+  const size_t payload_size = chunk_buffer_.size();
+
+  const uint8_t* data = chunk_buffer_.data();
+  ConsumeValue<double>(&data);  // Timestamp, already in the index.
+  const size_t num_points = ConsumeValue<uint32_t>(&data);
+  ConsumePose(&data, pose);
+
+  // Every point takes at least one bit per channel, so a count the coded
+  // points cannot hold means the chunk is corrupt.
+  const size_t coded_size = chunk_buffer_.data() + payload_size - data;
+  if (num_points > 2 * coded_size || num_points > points->max_size() / 4) {
+    return false;
+  }
+
+  BitReader reader(data, coded_size);
+  AdaptiveRiceCoder coders[4];
+  int32_t previous[4] = {0, 0, 0, 0};
+  points->resize(4 * num_points);
+  float* point = points->data();
+  for (size_t i = 0; i < num_points; ++i, point += 4) {
+    for (int c = 0; c < 3; ++c) {
+      previous[c] = static_cast<int16_t>(
+          previous[c] + ZigZagDecode(coders[c].Decode(&reader)));
+      point[c] = previous[c] * kMillimetersToMeters;
+    }
+    previous[3] = static_cast<uint8_t>(
+        previous[3] + ZigZagDecode(coders[3].Decode(&reader)));
+    point[3] = previous[3] / kConfidenceScale;
+  }
+  return true;
+}
+
+}  // namespace tango_perception
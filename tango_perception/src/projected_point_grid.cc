@@ -0,0 +1,219 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-perception/projected_point_grid.h"
+
+#include <algorithm>
+
+namespace tango_perception {
+
+ProjectedPointGrid::ProjectedPointGrid(int cell_size)
+    : cell_size_(std::max(cell_size, 1)),
+      camera_width_(0),
+      camera_height_(0),
+      display_width_(0),
+      display_height_(0),
+      cells_x_(0),
+      cells_y_(0),
+      is_built_(false),
+      timestamp_(0.0),
+      rotation_(TANGO_SUPPORT_ROTATION_IGNORED) {}
+
+void ProjectedPointGrid::SetCameraIntrinsics(
+    const TangoCameraIntrinsics& intrinsics) {
+  projection_.SetCameraIntrinsics(intrinsics);
+  camera_width_ = intrinsics.width;
+  camera_height_ = intrinsics.height;
+  is_built_ = false;
+}
+
+void ProjectedPointGrid::Build(
+    const TangoPointCloud* point_cloud,
+    const glm::mat4& color_camera_T_point_cloud,
+    TangoSupport_Rotation color_to_display_rotation) {
+  const bool is_sideways =
+      color_to_display_rotation == TANGO_SUPPORT_ROTATION_90 ||
+      color_to_display_rotation == TANGO_SUPPORT_ROTATION_270;
+  display_width_ = is_sideways ? camera_height_ : camera_width_;
+  display_height_ = is_sideways ? camera_width_ : camera_height_;
+  cells_x_ = (display_width_ + cell_size_ - 1) / cell_size_;
+  cells_y_ = (display_height_ + cell_size_ - 1) / cell_size_;
+  timestamp_ = point_cloud->timestamp;
+  rotation_ = color_to_display_rotation;
+  is_built_ = true;
+
+  // The matrix and the intrinsics are unpacked once and the projection is
+  // spelled out, glm's operators are slow without inlining.
+  const glm::mat4& m = color_camera_T_point_cloud;
+  const TangoCameraIntrinsics& intrinsics = projection_.GetIntrinsics();
+  const float fx = static_cast<float>(intrinsics.fx);
+  const float fy = static_cast<float>(intrinsics.fy);
+  const float cx = static_cast<float>(intrinsics.cx);
+  const float cy = static_cast<float>(intrinsics.cy);
+  const float p1 = projection_.GetP1();
+  const float p2 = projection_.GetP2();
+  const float width = static_cast<float>(camera_width_);
+  const float height = static_cast<float>(camera_height_);
+  projected_x_.clear();
+  projected_y_.clear();
+  projected_index_.clear();
+  projected_cell_.clear();
+  for (uint32_t i = 0; i < point_cloud->num_points; ++i) {
+    const float* point = point_cloud->points[i];
+    const float z =
+        m[0][2] * point[0] + m[1][2] * point[1] + m[2][2] * point[2] + m[3][2];
+    if (!(z > 0.0f)) {
+      continue;
+    }
+    const float inverse_z = 1.0f / z;
+    const float nx = inverse_z * (m[0][0] * point[0] + m[1][0] * point[1] +
+                                  m[2][0] * point[2] + m[3][0]);
+    const float ny = inverse_z * (m[0][1] * point[0] + m[1][1] * point[1] +
+                                  m[2][1] * point[2] + m[3][1]);
+    const float radius_squared = nx * nx + ny * ny;
+    const float scale = projection_.GetDistortionScale(radius_squared);
+    const float xy = 2.0f * nx * ny;
+    const float px =
+        fx * (nx * scale + p1 * xy + p2 * (radius_squared + 2.0f * nx * nx)) +
+        cx;
+    const float py =
+        fy * (ny * scale + p2 * xy + p1 * (radius_squared + 2.0f * ny * ny)) +
+        cy;
+    if (!(px >= 0.0f && px < width && py >= 0.0f && py < height)) {
+      continue;
+    }
+
+    // The inverse of the display to camera mapping of
+    // GetCameraPixelFromDisplayUv().
+    float x, y;
+    switch (color_to_display_rotation) {
+      case TANGO_SUPPORT_ROTATION_90:
+        x = py;
+        y = width - px;
+        break;
+      case TANGO_SUPPORT_ROTATION_180:
+        x = width - px;
+        y = height - py;
+        break;
+      case TANGO_SUPPORT_ROTATION_270:
+        x = height - py;
+        y = px;
+        break;
+      default:
+        x = px;
+        y = py;
+        break;
+    }
+    const int cell_x =
+        std::min(static_cast<int>(x) / cell_size_, cells_x_ - 1);
+    const int cell_y =
+        std::min(static_cast<int>(y) / cell_size_, cells_y_ - 1);
+    projected_x_.push_back(x);
+    projected_y_.push_back(y);
+    projected_index_.push_back(i);
+    projected_cell_.push_back(
+        static_cast<uint32_t>(cell_y * cells_x_ + cell_x));
+  }
+
+  // Counting sort by cell.
+  const int num_cells = cells_x_ * cells_y_;
+  cell_offsets_.assign(num_cells + 1, 0);
+  for (uint32_t cell : projected_cell_) {
+    ++cell_offsets_[cell + 1];
+  }
+  for (int cell = 0; cell < num_cells; ++cell) {
+    cell_offsets_[cell + 1] += cell_offsets_[cell];
+  }
+  const size_t num_projected = projected_cell_.size();
+  cell_x_.resize(num_projected);
+  cell_y_.resize(num_projected);
+  cell_points_.resize(num_projected);
+  for (size_t k = 0; k < num_projected; ++k) {
+    const uint32_t slot = cell_offsets_[projected_cell_[k]]++;
+    cell_x_[slot] = projected_x_[k];
+    cell_y_[slot] = projected_y_[k];
+    cell_points_[slot] = projected_index_[k];
+  }
+  for (int cell = num_cells; cell > 0; --cell) {
+    cell_offsets_[cell] = cell_offsets_[cell - 1];
+  }
+  cell_offsets_[0] = 0;
+}
+
+bool ProjectedPointGrid::IsBuiltFor(
+    const TangoPointCloud* point_cloud,
+    TangoSupport_Rotation color_to_display_rotation) const {
+  return is_built_ && timestamp_ == point_cloud->timestamp &&
+         rotation_ == color_to_display_rotation;
+}
+
+template <typename Visitor>
+void ProjectedPointGrid::ForEachPointNear(const float uv[2], float radius,
+                                          const Visitor& visit) const {
+  if (!is_built_ || cells_x_ == 0 || cells_y_ == 0) {
+    return;
+  }
+  const float x = uv[0] * display_width_;
+  const float y = uv[1] * display_height_;
+  const int cell_x0 =
+      std::max(static_cast<int>(std::max(x - radius, 0.0f)) / cell_size_, 0);
+  const int cell_y0 =
+      std::max(static_cast<int>(std::max(y - radius, 0.0f)) / cell_size_, 0);
+  const int cell_x1 = std::min(
+      static_cast<int>(std::max(x + radius, 0.0f)) / cell_size_, cells_x_ - 1);
+  const int cell_y1 = std::min(
+      static_cast<int>(std::max(y + radius, 0.0f)) / cell_size_, cells_y_ - 1);
+  if (cell_x0 > cell_x1) {
+    return;
+  }
+  for (int cell_y = cell_y0; cell_y <= cell_y1; ++cell_y) {
+    // The cells of a row are contiguous in the sorted arrays.
+    const int row = cell_y * cells_x_;
+    const uint32_t begin = cell_offsets_[row + cell_x0];
+    const uint32_t end = cell_offsets_[row + cell_x1 + 1];
+    for (uint32_t k = begin; k < end; ++k) {
+      visit(cell_x_[k] - x, cell_y_[k] - y, cell_points_[k]);
+    }
+  }
+}
+
+bool ProjectedPointGrid::FindNearest(const float uv[2], float radius,
+                                     uint32_t* point_index) const {
+  float best_distance = radius * radius;
+  bool found = false;
+  ForEachPointNear(uv, radius, [&](float dx, float dy, uint32_t point) {
+    const float distance = dx * dx + dy * dy;
+    if (distance <= best_distance) {
+      best_distance = distance;
+      *point_index = point;
+      found = true;
+    }
+  });
+  return found;
+}
+
+void ProjectedPointGrid::FindInRadius(
+    const float uv[2], float radius,
+    std::vector<uint32_t>* point_indices) const {
+  const float radius_squared = radius * radius;
+  ForEachPointNear(uv, radius, [&](float dx, float dy, uint32_t point) {
+    if (dx * dx + dy * dy <= radius_squared) {
+      point_indices->push_back(point);
+    }
+  });
+}
+
+}  // namespace tango_perception
@@ -0,0 +1,333 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-perception/push_pull_hole_filler.h"
+
+#include <algorithm>
+
+#include "tango-perception/simd.h"
+
+namespace {
+
+using tango_perception::simd::Float4;
+
+// Number of row bands per thread, so that uneven bands balance out.
+const int kTasksPerThread = 4;
+
+// Confidence below which a pixel counts as out of reach of any depth.
+const float kMinConfidence = 1e-4f;
+
+// Weights of the nearer and the farther coarse sample when upsampling by
+// two with pixel centers aligned.
+const float kNearWeight = 0.75f;
+const float kFarWeight = 0.25f;
+
+// Confidence of a full resolution pixel, one where the depth is known.
+inline float GetSparseConfidence(float depth) {
+  return depth > 0.0f ? 1.0f : 0.0f;
+}
+
+// Confidence saturates at one, where the average depth stays the same.
+inline void Normalize(float* weighted, float* confidence) {
+  const float scale = *confidence > 1.0f ? 1.0f / *confidence : 1.0f;
+  *weighted *= scale;
+  *confidence *= scale;
+}
+
+// output = kNearWeight * near + kFarWeight * far.
+void InterpolateRows(const float* near, const float* far, int length,
+                     float* output) {
+  const Float4 near_weight = tango_perception::simd::Splat(kNearWeight);
+  const Float4 far_weight = tango_perception::simd::Splat(kFarWeight);
+  int i = 0;
+  for (; i + 4 <= length; i += 4) {
+    tango_perception::simd::Store(
+        output + i, near_weight * tango_perception::simd::Load(near + i) +
+                        far_weight * tango_perception::simd::Load(far + i));
+  }
+  for (; i < length; ++i) {
+    output[i] = kNearWeight * near[i] + kFarWeight * far[i];
+  }
+}
+
+// Double the width of a row. Fine column 2i lies between coarse columns
+// i - 1 and i, column 2i + 1 between columns i and i + 1.
+void UpsampleColumns(const float* coarse, int coarse_width, int fine_width,
+                     float* fine) {
+  const int last_column = coarse_width - 1;
+  // The first and last coarse columns clamp their neighbours, so the loop
+  // in between needs no bounds checks.
+  auto upsample_edge = [&](int i) {
+    const float near = kNearWeight * coarse[i];
+    fine[2 * i] = near + kFarWeight * coarse[std::max(i - 1, 0)];
+    if (2 * i + 1 < fine_width) {
+      fine[2 * i + 1] =
+          near + kFarWeight * coarse[std::min(i + 1, last_column)];
+    }
+  };
+  upsample_edge(0);
+  for (int i = 1; i < last_column; ++i) {
+    const float near = kNearWeight * coarse[i];
+    fine[2 * i] = near + kFarWeight * coarse[i - 1];
+    fine[2 * i + 1] = near + kFarWeight * coarse[i + 1];
+  }
+  if (last_column > 0) {
+    upsample_edge(last_column);
+  }
+}
+
+}  // namespace
+
+namespace tango_perception {
+
+PushPullHoleFiller::PushPullHoleFiller(ThreadPool* thread_pool)
+    : thread_pool_(thread_pool),
+      max_levels_(0),
+      width_(0),
+      height_(0),
+      row_buffer_size_(0) {}
+
+void PushPullHoleFiller::SetMaxLevels(int max_levels) {
+  max_levels_ = std::max(max_levels, 0);
+  // Force the pyramid to be rebuilt on the next frame.
+  width_ = 0;
+  height_ = 0;
+}
+
+void PushPullHoleFiller::AllocateLevels(int width, int height) {
+  if (width == width_ && height == height_) {
+    return;
+  }
+  width_ = width;
+  height_ = height;
+  levels_.clear();
+  int level_width = width;
+  int level_height = height;
+  while ((level_width > 1 || level_height > 1) &&
+         (max_levels_ == 0 ||
+          static_cast<int>(levels_.size()) < max_levels_)) {
+    level_width = (level_width + 1) / 2;
+    level_height = (level_height + 1) / 2;
+    Level level;
+    level.width = level_width;
+    level.height = level_height;
+    level.weighted.resize(static_cast<size_t>(level_width) * level_height);
+    level.confidence.resize(level.weighted.size());
+    levels_.push_back(level);
+  }
+  // Every band holds the vertically interpolated coarse row and the
+  // upsampled row, both with weighted depth and confidence.
+  const int max_bands = thread_pool_->GetNumThreads() * kTasksPerThread;
+  const int coarse_width = levels_.empty() ? 0 : levels_[0].width;
+  row_buffer_size_ = 2 * static_cast<size_t>(coarse_width + width);
+  row_buffers_.resize(row_buffer_size_ * max_bands);
+  depth_image_.assign(static_cast<size_t>(width) * height, 0.0f);
+}
+
+template <typename Task>
+void PushPullHoleFiller::ForEachBand(int height, const Task& task) {
+  const int max_bands = thread_pool_->GetNumThreads() * kTasksPerThread;
+  const int rows_per_band = (height + max_bands - 1) / max_bands;
+  const int num_bands = (height + rows_per_band - 1) / rows_per_band;
+  thread_pool_->ParallelFor(num_bands, [&](int band) {
+    const int row_begin = band * rows_per_band;
+    task(row_begin, std::min(row_begin + rows_per_band, height), band);
+  });
+}
+
+void PushPullHoleFiller::Fill(const std::vector<float>& sparse_depth,
+                              int width, int height) {
+  if (width <= 0 || height <= 0 ||
+      sparse_depth.size() != static_cast<size_t>(width) * height) {
+    depth_image_.clear();
+    width_ = 0;
+    height_ = 0;
+    return;
+  }
+  AllocateLevels(width, height);
+  const int num_levels = static_cast<int>(levels_.size());
+  if (num_levels == 0) {
+    // A single pixel has nothing to fill from.
+    depth_image_ = sparse_depth;
+    return;
+  }
+
+  // Push: index -1 is the sparse depth itself.
+  for (int index = -1; index + 1 < num_levels; ++index) {
+    ForEachBand(levels_[index + 1].height,
+                [&](int row_begin, int row_end, int) {
+                  PushRows(sparse_depth, index, row_begin, row_end);
+                });
+  }
+
+  // Pull: the coarsest level is kept as it is.
+  for (int index = num_levels - 2; index >= -1; --index) {
+    const int fine_height = index < 0 ? height_ : levels_[index].height;
+    ForEachBand(fine_height, [&](int row_begin, int row_end, int band) {
+      PullRows(sparse_depth, index, row_begin, row_end,
+               &row_buffers_[band * row_buffer_size_]);
+    });
+  }
+}
+
+void PushPullHoleFiller::PushRows(const std::vector<float>& sparse_depth,
+                                  int index, int row_begin, int row_end) {
+  Level& coarse = levels_[index + 1];
+  const int fine_width = index < 0 ? width_ : levels_[index].width;
+  const int fine_height = index < 0 ? height_ : levels_[index].height;
+  // An odd last row or column is counted twice, which does not change its
+  // average.
+  for (int y = row_begin; y < row_end; ++y) {
+    const size_t row0 = static_cast<size_t>(2 * y) * fine_width;
+    const size_t row1 =
+        static_cast<size_t>(std::min(2 * y + 1, fine_height - 1)) * fine_width;
+    float* weighted_row =
+        &coarse.weighted[static_cast<size_t>(y) * coarse.width];
+    float* confidence_row =
+        &coarse.confidence[static_cast<size_t>(y) * coarse.width];
+    if (index < 0) {
+      // Unknown depth is zero and adds nothing to the sum.
+      const float* depth0 = &sparse_depth[row0];
+      const float* depth1 = &sparse_depth[row1];
+      for (int x = 0; x < coarse.width; ++x) {
+        const int x0 = 2 * x;
+        const int x1 = std::min(x0 + 1, fine_width - 1);
+        float weighted = depth0[x0] + depth0[x1] + depth1[x0] + depth1[x1];
+        float confidence =
+            GetSparseConfidence(depth0[x0]) + GetSparseConfidence(depth0[x1]) +
+            GetSparseConfidence(depth1[x0]) + GetSparseConfidence(depth1[x1]);
+        Normalize(&weighted, &confidence);
+        weighted_row[x] = weighted;
+        confidence_row[x] = confidence;
+      }
+    } else {
+      const Level& fine = levels_[index];
+      const float* weighted0 = &fine.weighted[row0];
+      const float* weighted1 = &fine.weighted[row1];
+      const float* confidence0 = &fine.confidence[row0];
+      const float* confidence1 = &fine.confidence[row1];
+      for (int x = 0; x < coarse.width; ++x) {
+        const int x0 = 2 * x;
+        const int x1 = std::min(x0 + 1, fine_width - 1);
+        float weighted =
+            weighted0[x0] + weighted0[x1] + weighted1[x0] + weighted1[x1];
+        float confidence = confidence0[x0] + confidence0[x1] +
+                           confidence1[x0] + confidence1[x1];
+        Normalize(&weighted, &confidence);
+        weighted_row[x] = weighted;
+        confidence_row[x] = confidence;
+      }
+    }
+  }
+}
+
+void PushPullHoleFiller::UpsampleRow(int index, int y, float* temp,
+                                     float* weighted,
+                                     float* confidence) const {
+  const Level& coarse = levels_[index + 1];
+  const int fine_width = index < 0 ? width_ : levels_[index].width;
+  // Fine row 2i lies between coarse rows i - 1 and i, row 2i + 1 between
+  // rows i and i + 1.
+  const int near_row = y / 2;
+  const int far_row = std::min(
+      std::max(y % 2 == 0 ? near_row - 1 : near_row + 1, 0), coarse.height - 1);
+  const size_t near_offset = static_cast<size_t>(near_row) * coarse.width;
+  const size_t far_offset = static_cast<size_t>(far_row) * coarse.width;
+  float* temp_weighted = temp;
+  float* temp_confidence = temp + coarse.width;
+  InterpolateRows(&coarse.weighted[near_offset], &coarse.weighted[far_offset],
+                  coarse.width, temp_weighted);
+  InterpolateRows(&coarse.confidence[near_offset],
+                  &coarse.confidence[far_offset], coarse.width,
+                  temp_confidence);
+  UpsampleColumns(temp_weighted, coarse.width, fine_width, weighted);
+  UpsampleColumns(temp_confidence, coarse.width, fine_width, confidence);
+}
+
+void PushPullHoleFiller::PullRows(const std::vector<float>& sparse_depth,
+                                  int index, int row_begin, int row_end,
+                                  float* row_buffer) {
+  const int fine_width = index < 0 ? width_ : levels_[index].width;
+  float* up_weighted = row_buffer + 2 * levels_[0].width;
+  float* up_confidence = up_weighted + width_;
+  const Float4 one = simd::Splat(1.0f);
+  const Float4 zero = simd::Splat(0.0f);
+  const Float4 min_confidence = simd::Splat(kMinConfidence);
+  for (int y = row_begin; y < row_end; ++y) {
+    UpsampleRow(index, y, row_buffer, up_weighted, up_confidence);
+    const size_t offset = static_cast<size_t>(y) * fine_width;
+    int x = 0;
+    if (index < 0) {
+      // Known depth is kept as it is, holes get the normalized depth of the
+      // coarser level.
+      const float* sparse_row = &sparse_depth[offset];
+      float* depth_row = &depth_image_[offset];
+      for (; x + 4 <= fine_width; x += 4) {
+        const Float4 depth = simd::Load(sparse_row + x);
+        const Float4 confidence = simd::Load(up_confidence + x);
+        const Float4 filled = simd::Select(
+            confidence > min_confidence,
+            simd::Load(up_weighted + x) / simd::Max(confidence, min_confidence),
+            zero);
+        simd::Store(depth_row + x, simd::Select(depth > zero, depth, filled));
+      }
+      for (; x < fine_width; ++x) {
+        const float depth = sparse_row[x];
+        depth_row[x] = depth > 0.0f ? depth
+                                    : (up_confidence[x] > kMinConfidence
+                                           ? up_weighted[x] / up_confidence[x]
+                                           : 0.0f);
+      }
+    } else {
+      // Pixels take from the coarser level what they miss in confidence.
+      float* weighted_row = &levels_[index].weighted[offset];
+      float* confidence_row = &levels_[index].confidence[offset];
+      for (; x + 4 <= fine_width; x += 4) {
+        const Float4 confidence = simd::Load(confidence_row + x);
+        const Float4 missing = one - confidence;
+        simd::Store(weighted_row + x,
+                    simd::Load(weighted_row + x) +
+                        missing * simd::Load(up_weighted + x));
+        simd::Store(confidence_row + x,
+                    confidence + missing * simd::Load(up_confidence + x));
+      }
+      for (; x < fine_width; ++x) {
+        const float missing = 1.0f - confidence_row[x];
+        weighted_row[x] += missing * up_weighted[x];
+        confidence_row[x] += missing * up_confidence[x];
+      }
+    }
+  }
+}
+
+void PushPullHoleFiller::ConvertToGrayscale(float max_depth,
+                                            std::vector<uint8_t>* grayscale) {
+  grayscale->resize(depth_image_.size());
+  uint8_t* output = grayscale->data();
+  const float scale = 255.0f / max_depth;
+  ForEachBand(height_, [&](int row_begin, int row_end, int) {
+    for (int y = row_begin; y < row_end; ++y) {
+      const float* depth_row = &depth_image_[static_cast<size_t>(y) * width_];
+      uint8_t* output_row = output + static_cast<size_t>(y) * width_;
+      for (int x = 0; x < width_; ++x) {
+        output_row[x] = static_cast<uint8_t>(
+            static_cast<int>(std::min(depth_row[x] * scale, 255.0f)));
+      }
+    }
+  });
+}
+
+}  // namespace tango_perception
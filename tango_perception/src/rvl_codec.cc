@@ -0,0 +1,190 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-perception/rvl_codec.h"
+
+#include <cstring>
+
+#include "tango-perception/bit_stream.h"
+
+namespace {
+
+// Nibbles are packed eight to a 32 bit word, first nibble in the most
+// significant bits, and the words are stored little endian.
+class NibbleWriter {
+ public:
+  explicit NibbleWriter(uint8_t* output)
+      : output_(output), word_(0), num_nibbles_(0) {}
+
+  // Write value in groups of 3 bits, least significant first, with the high
+  // bit of each nibble set if more groups follow.
+  void WriteVariableLength(uint32_t value) {
+    // Most differences of smooth depth fit a single nibble.
+    if (value < 8) {
+      WriteNibble(value);
+      return;
+    }
+    do {
+      uint32_t nibble = value & 7;
+      value >>= 3;
+      if (value != 0) {
+        nibble |= 8;
+      }
+      WriteNibble(nibble);
+    } while (value != 0);
+  }
+
+  // Write the pending nibbles and return the end of the output.
+  uint8_t* Flush() {
+    if (num_nibbles_ > 0) {
+      word_ <<= 4 * (8 - num_nibbles_);
+      WriteWord();
+    }
+    return output_;
+  }
+
+ private:
+  void WriteNibble(uint32_t nibble) {
+    word_ = (word_ << 4) | nibble;
+    if (++num_nibbles_ == 8) {
+      WriteWord();
+    }
+  }
+
+  void WriteWord() {
+    std::memcpy(output_, &word_, sizeof(word_));
+    output_ += sizeof(word_);
+    word_ = 0;
+    num_nibbles_ = 0;
+  }
+
+  uint8_t* output_;
+  uint32_t word_;
+  int num_nibbles_;
+};
+
+class NibbleReader {
+ public:
+  NibbleReader(const uint8_t* data, size_t size)
+      : data_(data),
+        end_(data + size / sizeof(uint32_t) * sizeof(uint32_t)),
+        word_(0),
+        num_nibbles_(0),
+        is_valid_(true) {}
+
+  // Read a value written by NibbleWriter::WriteVariableLength(). Reading
+  // past the end returns zeros and clears IsValid().
+  uint32_t ReadVariableLength() {
+    uint32_t value = 0;
+    int shift = 0;
+    uint32_t nibble;
+    do {
+      if (num_nibbles_ == 0) {
+        if (data_ == end_) {
+          is_valid_ = false;
+          return 0;
+        }
+        std::memcpy(&word_, data_, sizeof(word_));
+        data_ += sizeof(word_);
+        num_nibbles_ = 8;
+      }
+      nibble = word_ >> 28;
+      word_ <<= 4;
+      --num_nibbles_;
+      if (shift < 32) {
+        value |= (nibble & 7) << shift;
+      }
+      shift += 3;
+    } while (nibble & 8);
+    return value;
+  }
+
+  bool IsValid() const { return is_valid_; }
+
+ private:
+  const uint8_t* data_;
+  const uint8_t* end_;
+  uint32_t word_;
+  int num_nibbles_;
+  bool is_valid_;
+};
+
+}  // namespace
+
+namespace tango_perception {
+
+void RvlEncode(const uint16_t* depth, size_t num_pixels,
+               std::vector<uint8_t>* output) {
+  // A pixel costs at most 6 nibbles of difference plus one of run length,
+  // so the code is written in place into a buffer of that bound and then
+  // trimmed. The buffer keeps its capacity when reused across frames.
+  const size_t offset = output->size();
+  output->resize(offset + 4 * num_pixels + 2 * sizeof(uint32_t));
+  NibbleWriter writer(output->data() + offset);
+
+  const uint16_t* end = depth + num_pixels;
+  int32_t previous = 0;
+  while (depth != end) {
+    const uint16_t* zeros_begin = depth;
+    while (depth != end && *depth == 0) {
+      ++depth;
+    }
+    writer.WriteVariableLength(static_cast<uint32_t>(depth - zeros_begin));
+
+    const uint16_t* nonzeros_begin = depth;
+    while (depth != end && *depth != 0) {
+      ++depth;
+    }
+    writer.WriteVariableLength(static_cast<uint32_t>(depth - nonzeros_begin));
+    for (const uint16_t* pixel = nonzeros_begin; pixel != depth; ++pixel) {
+      const int32_t current = *pixel;
+      writer.WriteVariableLength(ZigZagEncode(current - previous));
+      previous = current;
+    }
+  }
+  output->resize(writer.Flush() - output->data());
+}
+
+bool RvlDecode(const uint8_t* data, size_t size, size_t num_pixels,
+               uint16_t* depth) {
+  NibbleReader reader(data, size);
+  uint16_t* end = depth + num_pixels;
+  int32_t previous = 0;
+  while (depth != end) {
+    const uint32_t num_zeros = reader.ReadVariableLength();
+    if (!reader.IsValid() || num_zeros > static_cast<size_t>(end - depth)) {
+      return false;
+    }
+    std::memset(depth, 0, num_zeros * sizeof(*depth));
+    depth += num_zeros;
+
+    const uint32_t num_nonzeros = reader.ReadVariableLength();
+    if (!reader.IsValid() ||
+        num_nonzeros > static_cast<size_t>(end - depth)) {
+      return false;
+    }
+    for (uint32_t i = 0; i < num_nonzeros; ++i) {
+      previous += ZigZagDecode(reader.ReadVariableLength());
+      *depth++ = static_cast<uint16_t>(previous);
+    }
+    if (!reader.IsValid()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace tango_perception
@@ -0,0 +1,243 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-perception/sensor_mailboxes.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Packing of a region into the word of a consumer.
+const uint64_t kRegionSetBit = 1ull << 63;
+const uint64_t kRegionChromaBit = 1ull << 62;
+const int kRegionEndShift = 31;
+const uint64_t kRegionRowMask = (1ull << 31) - 1;
+
+// Copy the rows [begin_row, end_row) of one plane. Rows are cut to the
+// destination stride, which is at most the source stride.
+void CopyRows(const uint8_t* source, size_t source_stride,
+              uint8_t* destination, size_t destination_stride,
+              uint32_t begin_row, uint32_t end_row) {
+  if (begin_row >= end_row) {
+    return;
+  }
+  if (source_stride == destination_stride) {
+    std::memcpy(destination + begin_row * destination_stride,
+                source + begin_row * source_stride,
+                (end_row - begin_row) * destination_stride);
+    return;
+  }
+  for (uint32_t row = begin_row; row < end_row; ++row) {
+    std::memcpy(destination + row * destination_stride,
+                source + row * source_stride, destination_stride);
+  }
+}
+
+// Copy the luma rows [begin_row, end_row) of an image, and with needs_chroma
+// the chroma rows covering them, from a buffer with source_stride to one
+// with destination_stride.
+void CopyImageRows(TangoImageFormatType format, uint32_t height,
+                   const uint8_t* source, size_t source_stride,
+                   uint8_t* destination, size_t destination_stride,
+                   uint32_t begin_row, uint32_t end_row, bool needs_chroma) {
+  CopyRows(source, source_stride, destination, destination_stride, begin_row,
+           end_row);
+  if (!needs_chroma) {
+    return;
+  }
+
+  // Every chroma row covers two luma rows. The chroma planes hold
+  // height / 2 rows, see GetImageBufferDataSize().
+  const uint32_t chroma_begin = begin_row / 2;
+  const uint32_t chroma_end = std::min((end_row + 1) / 2, height / 2);
+  source += source_stride * height;
+  destination += destination_stride * height;
+  switch (format) {
+    case TANGO_HAL_PIXEL_FORMAT_YCrCb_420_SP:
+      CopyRows(source, source_stride, destination, destination_stride,
+               chroma_begin, chroma_end);
+      break;
+    case TANGO_HAL_PIXEL_FORMAT_YV12:
+      // The V and then the U plane, at half the stride.
+      for (int plane = 0; plane < 2; ++plane) {
+        CopyRows(source + plane * (source_stride / 2) * (height / 2),
+                 source_stride / 2,
+                 destination + plane * (destination_stride / 2) * (height / 2),
+                 destination_stride / 2, chroma_begin, chroma_end);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+// Bytes per row of an image without padding. Even for YUV formats, whose
+// chroma rows are half as long.
+size_t GetPackedStride(TangoImageFormatType format, uint32_t width) {
+  switch (format) {
+    case TANGO_HAL_PIXEL_FORMAT_YCrCb_420_SP:
+    case TANGO_HAL_PIXEL_FORMAT_YV12:
+      return (static_cast<size_t>(width) + 1) & ~static_cast<size_t>(1);
+    case TANGO_HAL_PIXEL_FORMAT_RGBA_8888:
+    default:
+      return static_cast<size_t>(width) * 4;
+  }
+}
+
+}  // namespace
+
+namespace tango_perception {
+
+size_t GetImageBufferDataSize(TangoImageFormatType format, uint32_t stride,
+                              uint32_t height) {
+  switch (format) {
+    case TANGO_HAL_PIXEL_FORMAT_YCrCb_420_SP:
+    case TANGO_HAL_PIXEL_FORMAT_YV12:
+      // A full resolution luma plane followed by quarter resolution chroma.
+      return static_cast<size_t>(stride) * height * 3 / 2;
+    case TANGO_HAL_PIXEL_FORMAT_RGBA_8888:
+    default:
+      return static_cast<size_t>(stride) * height;
+  }
+}
+
+ImageRegions::ImageRegions() {
+  for (int i = 0; i < kMaxConsumers; ++i) {
+    regions_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+void ImageRegions::Set(int consumer, uint32_t begin_row, uint32_t end_row,
+                       bool needs_chroma) {
+  end_row = std::max(begin_row, end_row);
+  const uint64_t region =
+      kRegionSetBit | (needs_chroma ? kRegionChromaBit : 0) |
+      (static_cast<uint64_t>(end_row) & kRegionRowMask) << kRegionEndShift |
+      (static_cast<uint64_t>(begin_row) & kRegionRowMask);
+  regions_[consumer].store(region, std::memory_order_relaxed);
+}
+
+void ImageRegions::Clear(int consumer) {
+  regions_[consumer].store(0, std::memory_order_relaxed);
+}
+
+bool ImageRegions::GetUnion(uint32_t height, uint32_t* begin_row,
+                            uint32_t* end_row, bool* needs_chroma) const {
+  bool any_set = false;
+  uint32_t begin = height;
+  uint32_t end = 0;
+  bool chroma = false;
+  for (int i = 0; i < kMaxConsumers; ++i) {
+    const uint64_t region = regions_[i].load(std::memory_order_relaxed);
+    if ((region & kRegionSetBit) == 0) {
+      continue;
+    }
+    any_set = true;
+    const uint32_t region_begin =
+        static_cast<uint32_t>(region & kRegionRowMask);
+    const uint32_t region_end = std::min(
+        static_cast<uint32_t>((region >> kRegionEndShift) & kRegionRowMask),
+        height);
+    if (region_begin >= region_end) {
+      continue;
+    }
+    begin = std::min(begin, region_begin);
+    end = std::max(end, region_end);
+    chroma = chroma || (region & kRegionChromaBit) != 0;
+  }
+  if (begin >= end) {
+    begin = end = 0;
+  }
+  *begin_row = begin;
+  *end_row = end;
+  *needs_chroma = chroma;
+  return any_set;
+}
+
+PointCloudMailbox::PointCloudMailbox(uint32_t max_points)
+    : max_points_(max_points) {
+  for (int i = 0; i < 3; ++i) {
+    storage_[i].resize(static_cast<size_t>(max_points) * 4);
+    TangoPointCloud* slot = mailbox_.GetSlot(i);
+    std::memset(slot, 0, sizeof(*slot));
+    slot->points = reinterpret_cast<float(*)[4]>(storage_[i].data());
+  }
+}
+
+void PointCloudMailbox::Update(const TangoPointCloud* point_cloud) {
+  TangoPointCloud* back = mailbox_.GetBackBuffer();
+  back->version = point_cloud->version;
+  back->timestamp = point_cloud->timestamp;
+  back->num_points = std::min(point_cloud->num_points, max_points_);
+  std::memcpy(back->points, point_cloud->points,
+              sizeof(float) * 4 * back->num_points);
+  mailbox_.Publish();
+}
+
+ImageBufferMailbox::ImageBufferMailbox(TangoImageFormatType format,
+                                       uint32_t width, uint32_t height,
+                                       uint32_t stride) {
+  stride = std::max(stride,
+                    static_cast<uint32_t>(GetPackedStride(format, width)));
+  for (int i = 0; i < 3; ++i) {
+    storage_[i].resize(GetImageBufferDataSize(format, stride, height));
+    TangoImageBuffer* slot = mailbox_.GetSlot(i);
+    std::memset(slot, 0, sizeof(*slot));
+    slot->width = width;
+    slot->height = height;
+    slot->stride = stride;
+    slot->format = format;
+    slot->data = storage_[i].data();
+  }
+}
+
+void ImageBufferMailbox::Update(const TangoImageBuffer* image_buffer) {
+  TangoImageBuffer* back = mailbox_.GetBackBuffer();
+  std::vector<uint8_t>& storage = storage_[back - mailbox_.GetSlot(0)];
+  const TangoImageFormatType format = image_buffer->format;
+  const uint32_t height = image_buffer->height;
+
+  // Rows are kept at the stride of the frame if they fit, and otherwise
+  // repacked without their padding, so the callback thread only allocates
+  // when the frames are larger than the slots were made for.
+  size_t stride = image_buffer->stride;
+  size_t data_size = GetImageBufferDataSize(format, stride, height);
+  if (data_size > storage.size()) {
+    stride = std::min(stride, GetPackedStride(format, image_buffer->width));
+    data_size = GetImageBufferDataSize(format, stride, height);
+    if (data_size > storage.size()) {
+      storage.resize(data_size);
+    }
+  }
+  uint8_t* data = storage.data();
+  *back = *image_buffer;
+  back->stride = static_cast<uint32_t>(stride);
+  back->data = data;
+
+  uint32_t begin_row, end_row;
+  bool needs_chroma;
+  if (!regions_.GetUnion(height, &begin_row, &end_row, &needs_chroma)) {
+    begin_row = 0;
+    end_row = height;
+    needs_chroma = true;
+  }
+  CopyImageRows(format, height, image_buffer->data, image_buffer->stride,
+                data, stride, begin_row, end_row, needs_chroma);
+  mailbox_.Publish();
+}
+
+}  // namespace tango_perception
@@ -0,0 +1,207 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-perception/temporal_depth_fusion.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Weight of a sample relative to one from the next newer point cloud.
+const float kAgeDecay = 0.5f;
+
+// Samples whose depth differs from the pixel by less than this fraction of
+// it are taken to see the same surface.
+const float kAgreementTolerance = 0.05f;
+
+// Lower bound of the point confidence, so that no sample has zero weight.
+const float kMinPointConfidence = 0.1f;
+
+// Rows per band when sorting samples; a band of sums of a 1920 pixel wide
+// image fits in the L2 cache.
+const int kBandRows = 16;
+
+}  // namespace
+
+namespace tango_perception {
+
+TemporalDepthFusion::TemporalDepthFusion(int history_size, uint32_t max_points)
+    : max_points_(max_points),
+      width_(0),
+      height_(0),
+      frames_(std::max(history_size, 1)),
+      newest_(0),
+      num_frames_(0) {
+  for (Frame& frame : frames_) {
+    frame.timestamp = 0.0;
+    frame.num_points = 0;
+    frame.points.resize(4 * static_cast<size_t>(max_points));
+  }
+  const size_t max_samples = frames_.size() * max_points;
+  samples_.reserve(max_samples);
+  sorted_samples_.reserve(max_samples);
+  touched_pixels_.reserve(max_samples);
+}
+
+void TemporalDepthFusion::SetCameraIntrinsics(
+    const TangoCameraIntrinsics& intrinsics) {
+  projection_.SetCameraIntrinsics(intrinsics);
+  width_ = intrinsics.width;
+  height_ = intrinsics.height;
+  depth_image_.assign(static_cast<size_t>(width_) * height_, 0.0f);
+  sums_.assign(2 * depth_image_.size(), 0.0f);
+  band_offsets_.assign((height_ + kBandRows - 1) / kBandRows + 1, 0);
+  touched_pixels_.clear();
+}
+
+void TemporalDepthFusion::AddPointCloud(const TangoPointCloud* point_cloud) {
+  if (num_frames_ > 0 &&
+      frames_[newest_].timestamp == point_cloud->timestamp) {
+    return;
+  }
+  newest_ = (newest_ + 1) % static_cast<int>(frames_.size());
+  num_frames_ = std::min(num_frames_ + 1, static_cast<int>(frames_.size()));
+  Frame& frame = frames_[newest_];
+  frame.timestamp = point_cloud->timestamp;
+  frame.num_points = std::min(point_cloud->num_points, max_points_);
+  const float* points = point_cloud->points[0];
+  std::copy(points, points + 4 * frame.num_points, frame.points.begin());
+}
+
+void TemporalDepthFusion::Clear() { num_frames_ = 0; }
+
+int TemporalDepthFusion::Fuse(const TransformLookup& lookup) {
+  // Only the pixels of the previous result need clearing.
+  for (uint32_t pixel : touched_pixels_) {
+    depth_image_[pixel] = 0.0f;
+    sums_[2 * pixel] = 0.0f;
+    sums_[2 * pixel + 1] = 0.0f;
+  }
+  touched_pixels_.clear();
+
+  samples_.clear();
+  int num_fused = 0;
+  const int history_size = static_cast<int>(frames_.size());
+  for (int age = 0; age < num_frames_; ++age) {
+    const Frame& frame =
+        frames_[(newest_ - age + history_size) % history_size];
+    glm::mat4 camera_T_points;
+    if (!lookup(frame.timestamp, &camera_T_points)) {
+      continue;
+    }
+    ProjectFrame(frame, camera_T_points,
+                 std::pow(kAgeDecay, static_cast<float>(age)), num_fused == 0);
+    ++num_fused;
+  }
+
+  SortSamplesByBand();
+  for (const Sample& sample : sorted_samples_) {
+    AccumulateSample(sample);
+  }
+
+  for (uint32_t pixel : touched_pixels_) {
+    depth_image_[pixel] = sums_[2 * pixel] / sums_[2 * pixel + 1];
+  }
+  return num_fused;
+}
+
+void TemporalDepthFusion::ProjectFrame(const Frame& frame,
+                                       const glm::mat4& camera_T_points,
+                                       float age_weight, bool is_newest) {
+  // The matrix and the intrinsics are unpacked once and the projection is
+  // spelled out, glm's operators are slow without inlining.
+  const glm::mat4& m = camera_T_points;
+  const TangoCameraIntrinsics& intrinsics = projection_.GetIntrinsics();
+  const float fx = static_cast<float>(intrinsics.fx);
+  const float fy = static_cast<float>(intrinsics.fy);
+  const float cx = static_cast<float>(intrinsics.cx);
+  const float cy = static_cast<float>(intrinsics.cy);
+  const float p1 = projection_.GetP1();
+  const float p2 = projection_.GetP2();
+  const float* points = frame.points.data();
+  for (uint32_t i = 0; i < frame.num_points; ++i) {
+    const float* point = points + 4 * i;
+    const float z =
+        m[0][2] * point[0] + m[1][2] * point[1] + m[2][2] * point[2] + m[3][2];
+    if (!(z > 0.0f)) {
+      continue;
+    }
+    const float inverse_z = 1.0f / z;
+    const float nx = inverse_z * (m[0][0] * point[0] + m[1][0] * point[1] +
+                                  m[2][0] * point[2] + m[3][0]);
+    const float ny = inverse_z * (m[0][1] * point[0] + m[1][1] * point[1] +
+                                  m[2][1] * point[2] + m[3][1]);
+    const float radius_squared = nx * nx + ny * ny;
+    const float scale = projection_.GetDistortionScale(radius_squared);
+    const float xy = 2.0f * nx * ny;
+    const float px =
+        fx * (nx * scale + p1 * xy + p2 * (radius_squared + 2.0f * nx * nx)) +
+        cx;
+    const float py =
+        fy * (ny * scale + p2 * xy + p1 * (radius_squared + 2.0f * ny * ny)) +
+        cy;
+    const int x = static_cast<int>(px);
+    const int y = static_cast<int>(py);
+    if (px < 0.0f || py < 0.0f || x >= width_ || y >= height_) {
+      continue;
+    }
+    Sample sample;
+    sample.pixel = static_cast<uint32_t>(y) * width_ + x;
+    sample.depth = z;
+    sample.weight = age_weight * std::max(point[3], kMinPointConfidence);
+    sample.is_newest = is_newest;
+    samples_.push_back(sample);
+  }
+}
+
+void TemporalDepthFusion::SortSamplesByBand() {
+  const uint32_t band_pixels = static_cast<uint32_t>(kBandRows) * width_;
+  std::fill(band_offsets_.begin(), band_offsets_.end(), 0);
+  for (const Sample& sample : samples_) {
+    ++band_offsets_[sample.pixel / band_pixels + 1];
+  }
+  for (size_t band = 1; band < band_offsets_.size(); ++band) {
+    band_offsets_[band] += band_offsets_[band - 1];
+  }
+  sorted_samples_.resize(samples_.size());
+  for (const Sample& sample : samples_) {
+    sorted_samples_[band_offsets_[sample.pixel / band_pixels]++] = sample;
+  }
+}
+
+void TemporalDepthFusion::AccumulateSample(const Sample& sample) {
+  float& depth_sum = sums_[2 * sample.pixel];
+  float& weight_sum = sums_[2 * sample.pixel + 1];
+  if (weight_sum == 0.0f) {
+    touched_pixels_.push_back(sample.pixel);
+  } else {
+    const float mean = depth_sum / weight_sum;
+    if (std::abs(sample.depth - mean) > kAgreementTolerance * mean) {
+      // Within the newest cloud the nearest surface wins, as in a z-test.
+      // Older clouds never override what newer ones saw.
+      if (!sample.is_newest || sample.depth > mean) {
+        return;
+      }
+      depth_sum = 0.0f;
+      weight_sum = 0.0f;
+    }
+  }
+  depth_sum += sample.weight * sample.depth;
+  weight_sum += sample.weight;
+}
+
+}  // namespace tango_perception
@@ -0,0 +1,110 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-perception/thread_pool.h"
+
+namespace tango_perception {
+
+ThreadPool::ThreadPool(int num_threads)
+    : task_(nullptr),
+      num_tasks_(0),
+      job_generation_(0),
+      busy_workers_(0),
+      stop_requested_(false),
+      next_task_(0) {
+  if (num_threads <= 0) {
+    num_threads = static_cast<int>(std::thread::hardware_concurrency());
+  }
+  for (int i = 1; i < num_threads; ++i) {
+    workers_.push_back(std::thread(&ThreadPool::WorkerThread, this));
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_requested_ = true;
+  }
+  job_condition_.notify_all();
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+void ThreadPool::ParallelFor(int num_tasks,
+                             const std::function<void(int)>& task) {
+  if (num_tasks <= 0) {
+    return;
+  }
+  if (workers_.empty() || num_tasks == 1) {
+    for (int i = 0; i < num_tasks; ++i) {
+      task(i);
+    }
+    return;
+  }
+
+  std::lock_guard<std::mutex> call_lock(call_mutex_);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    task_ = &task;
+    num_tasks_ = num_tasks;
+    next_task_ = 0;
+    busy_workers_ = static_cast<int>(workers_.size());
+    ++job_generation_;
+  }
+  job_condition_.notify_all();
+
+  RunTasks();
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_condition_.wait(lock, [this] { return busy_workers_ == 0; });
+  task_ = nullptr;
+}
+
+void ThreadPool::RunTasks() {
+  while (true) {
+    int index = next_task_.fetch_add(1);
+    if (index >= num_tasks_) {
+      break;
+    }
+    (*task_)(index);
+  }
+}
+
+void ThreadPool::WorkerThread() {
+  uint64_t seen_generation = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      job_condition_.wait(lock, [this, seen_generation] {
+        return stop_requested_ || job_generation_ != seen_generation;
+      });
+      if (stop_requested_) {
+        return;
+      }
+      seen_generation = job_generation_;
+    }
+
+    RunTasks();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--busy_workers_ == 0) {
+      done_condition_.notify_all();
+    }
+  }
+}
+
+}  // namespace tango_perception
@@ -0,0 +1,222 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tango-perception/yuv_converter.h"
+
+#include <algorithm>
+
+// The vector extensions of simd.h have no portable byte interleaving, which
+// the deinterleaving of NV21 and the packing of RGBA need, so the kernels use
+// intrinsics directly.
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define TANGO_PERCEPTION_YUV_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define TANGO_PERCEPTION_YUV_SSE2
+#endif
+
+namespace {
+
+const int kTasksPerThread = 4;
+
+// Full range BT.601 in 7 bit fixed point, as in ConvertYuvToRgba():
+//   r = y + 1.402 v
+//   g = y - 0.344 u - 0.714 v
+//   b = y + 1.772 u
+// with u and v centered on zero. Every intermediate fits in int16.
+const int kShift = 7;
+#if defined(TANGO_PERCEPTION_YUV_SSE2)
+const int kRound = 1 << (kShift - 1);
+#endif
+const int16_t kRv = 179;
+const int16_t kGu = 44;
+const int16_t kGv = 91;
+const int16_t kBu = 227;
+
+// Pixels converted per vector iteration.
+const int kBlockWidth = 16;
+
+#if defined(TANGO_PERCEPTION_YUV_NEON)
+
+// Add the chroma terms to 8 even and 8 odd luma values and store the 16
+// pixels.
+inline void StoreRgbaNeon(uint8x8x2_t y, int16x8_t r, int16x8_t g,
+                          int16x8_t b, uint8_t* rgba) {
+  const int16x8_t y_even = vreinterpretq_s16_u16(vmovl_u8(y.val[0]));
+  const int16x8_t y_odd = vreinterpretq_s16_u16(vmovl_u8(y.val[1]));
+  const uint8x8x2_t red = vzip_u8(vqmovun_s16(vaddq_s16(y_even, r)),
+                                  vqmovun_s16(vaddq_s16(y_odd, r)));
+  const uint8x8x2_t green = vzip_u8(vqmovun_s16(vaddq_s16(y_even, g)),
+                                    vqmovun_s16(vaddq_s16(y_odd, g)));
+  const uint8x8x2_t blue = vzip_u8(vqmovun_s16(vaddq_s16(y_even, b)),
+                                   vqmovun_s16(vaddq_s16(y_odd, b)));
+  uint8x16x4_t output;
+  output.val[0] = vcombine_u8(red.val[0], red.val[1]);
+  output.val[1] = vcombine_u8(green.val[0], green.val[1]);
+  output.val[2] = vcombine_u8(blue.val[0], blue.val[1]);
+  output.val[3] = vdupq_n_u8(255);
+  vst4q_u8(rgba, output);
+}
+
+// Convert the leading multiple of kBlockWidth columns of a pair of rows and
+// return the number of columns converted.
+int ConvertRowPairVector(const uint8_t* y_row0, const uint8_t* y_row1,
+                         const uint8_t* vu_row, int width, uint8_t* rgba_row0,
+                         uint8_t* rgba_row1) {
+  const int vector_width = width / kBlockWidth * kBlockWidth;
+  const int16x8_t offset = vdupq_n_s16(128);
+  for (int x = 0; x < vector_width; x += kBlockWidth) {
+    // vld2 splits the interleaved V and U, and the luma into the even and
+    // odd columns that share a chroma sample.
+    const uint8x8x2_t vu = vld2_u8(vu_row + x);
+    const int16x8_t v =
+        vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vu.val[0])), offset);
+    const int16x8_t u =
+        vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vu.val[1])), offset);
+    const int16x8_t r = vrshrq_n_s16(vmulq_n_s16(v, kRv), kShift);
+    const int16x8_t g = vrshrq_n_s16(
+        vmlsq_n_s16(vmulq_n_s16(u, -kGu), v, kGv), kShift);
+    const int16x8_t b = vrshrq_n_s16(vmulq_n_s16(u, kBu), kShift);
+    StoreRgbaNeon(vld2_u8(y_row0 + x), r, g, b, rgba_row0 + 4 * x);
+    StoreRgbaNeon(vld2_u8(y_row1 + x), r, g, b, rgba_row1 + 4 * x);
+  }
+  return vector_width;
+}
+
+#elif defined(TANGO_PERCEPTION_YUV_SSE2)
+
+// Saturate the sums of the chroma term with 8 even and 8 odd luma values to
+// bytes, in column order.
+inline __m128i AddChroma(__m128i y_even, __m128i y_odd, __m128i chroma) {
+  const __m128i packed = _mm_packus_epi16(_mm_add_epi16(y_even, chroma),
+                                          _mm_add_epi16(y_odd, chroma));
+  return _mm_unpacklo_epi8(packed, _mm_srli_si128(packed, 8));
+}
+
+// Add the chroma terms to 16 luma values and store the 16 pixels.
+inline void StoreRgbaSse(__m128i y, __m128i r, __m128i g, __m128i b,
+                         uint8_t* rgba) {
+  const __m128i y_even = _mm_and_si128(y, _mm_set1_epi16(0xff));
+  const __m128i y_odd = _mm_srli_epi16(y, 8);
+  const __m128i red = AddChroma(y_even, y_odd, r);
+  const __m128i green = AddChroma(y_even, y_odd, g);
+  const __m128i blue = AddChroma(y_even, y_odd, b);
+  const __m128i alpha = _mm_set1_epi8(-1);
+
+  // Interleave to RG and BA pairs, then the pairs to pixels.
+  const __m128i rg_low = _mm_unpacklo_epi8(red, green);
+  const __m128i rg_high = _mm_unpackhi_epi8(red, green);
+  const __m128i ba_low = _mm_unpacklo_epi8(blue, alpha);
+  const __m128i ba_high = _mm_unpackhi_epi8(blue, alpha);
+  __m128i* output = reinterpret_cast<__m128i*>(rgba);
+  _mm_storeu_si128(output, _mm_unpacklo_epi16(rg_low, ba_low));
+  _mm_storeu_si128(output + 1, _mm_unpackhi_epi16(rg_low, ba_low));
+  _mm_storeu_si128(output + 2, _mm_unpacklo_epi16(rg_high, ba_high));
+  _mm_storeu_si128(output + 3, _mm_unpackhi_epi16(rg_high, ba_high));
+}
+
+// Convert the leading multiple of kBlockWidth columns of a pair of rows and
+// return the number of columns converted.
+int ConvertRowPairVector(const uint8_t* y_row0, const uint8_t* y_row1,
+                         const uint8_t* vu_row, int width, uint8_t* rgba_row0,
+                         uint8_t* rgba_row1) {
+  const int vector_width = width / kBlockWidth * kBlockWidth;
+  const __m128i low_bytes = _mm_set1_epi16(0xff);
+  const __m128i offset = _mm_set1_epi16(128);
+  const __m128i round = _mm_set1_epi16(kRound);
+  for (int x = 0; x < vector_width; x += kBlockWidth) {
+    // Every 16 bit lane holds a V, U pair, and two luma values sharing it.
+    const __m128i vu =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(vu_row + x));
+    const __m128i v = _mm_sub_epi16(_mm_and_si128(vu, low_bytes), offset);
+    const __m128i u = _mm_sub_epi16(_mm_srli_epi16(vu, 8), offset);
+    const __m128i r = _mm_srai_epi16(
+        _mm_add_epi16(_mm_mullo_epi16(v, _mm_set1_epi16(kRv)), round), kShift);
+    const __m128i g = _mm_srai_epi16(
+        _mm_sub_epi16(
+            _mm_sub_epi16(round, _mm_mullo_epi16(u, _mm_set1_epi16(kGu))),
+            _mm_mullo_epi16(v, _mm_set1_epi16(kGv))),
+        kShift);
+    const __m128i b = _mm_srai_epi16(
+        _mm_add_epi16(_mm_mullo_epi16(u, _mm_set1_epi16(kBu)), round), kShift);
+    StoreRgbaSse(_mm_loadu_si128(reinterpret_cast<const __m128i*>(y_row0 + x)),
+                 r, g, b, rgba_row0 + 4 * x);
+    StoreRgbaSse(_mm_loadu_si128(reinterpret_cast<const __m128i*>(y_row1 + x)),
+                 r, g, b, rgba_row1 + 4 * x);
+  }
+  return vector_width;
+}
+
+#else
+
+int ConvertRowPairVector(const uint8_t*, const uint8_t*, const uint8_t*, int,
+                         uint8_t*, uint8_t*) {
+  return 0;
+}
+
+#endif
+
+}  // namespace
+
+namespace tango_perception {
+
+YuvToRgbConverter::YuvToRgbConverter(ThreadPool* thread_pool)
+    : thread_pool_(thread_pool) {}
+
+void YuvToRgbConverter::Convert(const YuvPlanes& yuv,
+                                ImageView<uint8_t> rgba) {
+  const int width = std::min(yuv.y.GetWidth(), rgba.GetWidth());
+  const int height = std::min(yuv.y.GetHeight(), rgba.GetHeight());
+  if (width <= 0 || height <= 0) {
+    return;
+  }
+  // The vector kernels read NV21 chroma as V, U pairs and write packed
+  // pixels.
+  const bool is_nv21 = yuv.v.GetPixelStride() == 2 &&
+                       yuv.u.GetPixelStride() == 2 &&
+                       yuv.u.GetData() == yuv.v.GetData() + 1 &&
+                       rgba.GetPixelStride() == 4;
+  const int num_row_pairs = (height + 1) / 2;
+  const int num_tasks = std::min(
+      thread_pool_->GetNumThreads() * kTasksPerThread, num_row_pairs);
+  thread_pool_->ParallelFor(num_tasks, [&](int task) {
+    const int begin = task * num_row_pairs / num_tasks;
+    const int end = (task + 1) * num_row_pairs / num_tasks;
+    for (int pair = begin; pair < end; ++pair) {
+      const int y = 2 * pair;
+      const int num_rows = std::min(2, height - y);
+      int x = 0;
+      if (is_nv21 && num_rows == 2) {
+        x = ConvertRowPairVector(yuv.y.GetRow(y), yuv.y.GetRow(y + 1),
+                                 yuv.v.GetRow(pair), width, rgba.GetRow(y),
+                                 rgba.GetRow(y + 1));
+      }
+      if (x < width) {
+        // x is even, so the crop starts on a chroma sample.
+        const int tail_width = width - x;
+        const int chroma_width = (tail_width + 1) / 2;
+        YuvPlanes tail;
+        tail.y = yuv.y.Crop(x, y, tail_width, num_rows);
+        tail.u = yuv.u.Crop(x / 2, pair, chroma_width, 1);
+        tail.v = yuv.v.Crop(x / 2, pair, chroma_width, 1);
+        ConvertYuvToRgba(tail, rgba.Crop(x, y, tail_width, num_rows));
+      }
+    }
+  });
+}
+
+}  // namespace tango_perception